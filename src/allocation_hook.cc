@@ -0,0 +1,27 @@
+// Replaces the global operator new to charge each allocation to the phase
+// being measured. Only linked into the programs reporting allocations, so
+// that the others keep the allocator of the C++ library.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include <cstdlib>
+#include <new>
+
+#include "stats.h"
+
+void *operator new(size_t size) {
+  count_allocation(size);
+  void *memory = malloc(size == 0 ? 1 : size);
+  if (memory == nullptr) {
+    throw bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+  free(memory);
+}
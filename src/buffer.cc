@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <iostream>
 
+#include "stats.h"
+
 using namespace std;
 
 // Placing declarations in an anonymous namespace makes them visible only to
@@ -73,6 +75,7 @@ Buffer::~Buffer() {
 char Buffer::next() {
   // Refill buffer if empty.
   if (buffer_.empty()) {
+    Phase_Scope scope(PHASE_BUFFERING);
     fill_buffer(stream_, &buffer_, MAX_BUFFER_SIZE);
   }
   // Return EOF if buffer is still empty after refill attempt.
@@ -0,0 +1,691 @@
+// Implementation of Code_Generator class.
+// @author Hieu Le
+// @version 12/20/2016
+
+#include "code_generator.h"
+
+#include <algorithm>
+
+#include "stats.h"
+
+namespace {
+
+// Returns the TrAL instruction performing an IR operation.
+inst_type instruction_of(const ir_opcode_type opcode) {
+  switch (opcode) {
+    case IR_MOVE: return INST_MOVE;
+    case IR_ADD: return INST_ADD;
+    case IR_SUB: return INST_SUB;
+    case IR_MUL: return INST_MUL;
+    case IR_DIV: return INST_DIV;
+    case IR_NEG: return INST_NEG;
+    case IR_NOT: return INST_NOT;
+    case IR_BRUN: return INST_BRUN;
+    case IR_BREZ: return INST_BREZ;
+    case IR_BRPO: return INST_BRPO;
+    case IR_BRNE: return INST_BRNE;
+    case IR_OUTB: return INST_OUTB;
+    case IR_HALT: return INST_HALT;
+    default: return INST_GARBAGE;
+  }
+}
+
+}  // namespace
+
+Code_Generator::Code_Generator(Emitter *emitter,
+                               const allocation_strategy_type the_strategy,
+                               const int n_registers)
+    : e(emitter), allocator(Register_File::create(n_registers)),
+      strategy(the_strategy), program(nullptr), function(nullptr),
+      spill_base(0), frame_size(0), scan(nullptr), scratch(nullptr) {}
+
+Code_Generator::~Code_Generator() {
+  delete allocator;
+  delete scan;
+  for (string *label : spill_labels) {
+    delete label;
+  }
+}
+
+void Code_Generator::generate(IR_Program *the_program) {
+  program = the_program;
+
+  // Take every register the allocator can give. Linear scan assigns them
+  // itself, while local allocation hands them out again.
+  while (allocator->has_free_register()) {
+    registers.push_back(allocator->allocate_register());
+  }
+  if (strategy == ALLOC_LOCAL) {
+    for (Register *reg : registers) {
+      allocator->deallocate_register(reg);
+    }
+  }
+
+  for (IR_Function *each : program->functions) {
+    generate(each);
+  }
+
+  // Emit data directives for all program variables.
+  const IR_Function *main_function = program->functions.front();
+  if (!main_function->variables.empty()) {
+    e->emit_comment("Data directives for program variables.");
+    for (const IR_Variable &variable : main_function->variables) {
+      e->emit_data_directive(&variable.name, 1);
+    }
+  }
+  // Emit data directives for all spilled memory.
+  if (!spill_labels.empty()) {
+    e->emit_comment("Data directives for spilled memories.");
+    for (const string *label : spill_labels) {
+      e->emit_data_directive(label, 1);
+    }
+  }
+  // The stack comes last, so that frames may grow past it.
+  if (program->functions.size() > 1) {
+    e->emit_stack_directive();
+  }
+}
+
+void Code_Generator::generate(IR_Function *the_function) {
+  function = the_function;
+
+  const int n_vregs = function->vreg_types.size();
+  vreg_register.assign(n_vregs, nullptr);
+  vreg_spill.assign(n_vregs, -1);
+  register_order.clear();
+  // A procedure may run while the spill slots of its caller are live.
+  spill_base = spill_labels.size();
+  free_spill_slots = priority_queue<int, vector<int>, greater<int>>();
+  delete scan;
+  scan = nullptr;
+  scratch = nullptr;
+  find_last_references();
+  if (strategy == ALLOC_LINEAR_SCAN) {
+    allocate_by_linear_scan();
+  }
+
+  // Output a label for the program or procedure.
+  const string function_label = "_" + function->name;
+  e->emit_label(&function_label);
+
+  frame_size = 0;
+  saved_registers.clear();
+  if (function == program->functions.front()) {
+    if (program->functions.size() > 1) {
+      e->emit_stack_setup(allocator->get_stack_register());
+    }
+  } else {
+    // Registers[0] is the link register, which the caller saves.
+    for (unsigned int i = 1; i < registers.size(); ++i) {
+      if (strategy == ALLOC_LOCAL || registers[i] == scratch
+          || find(vreg_register.begin(), vreg_register.end(), registers[i])
+             != vreg_register.end()) {
+        saved_registers.push_back(registers[i]);
+      }
+    }
+    frame_size = 2 + function->variables.size() + saved_registers.size();
+    emit_prologue();
+  }
+
+  int position = 0;
+  for (const Basic_Block *block : function->blocks) {
+    if (!block->label.empty()) {
+      e->emit_label(&block->label);
+    }
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (strategy == ALLOC_LINEAR_SCAN) {
+        generate_allocated(instruction, position);
+      } else {
+        generate(instruction, position);
+      }
+      ++position;
+    }
+  }
+}
+
+void Code_Generator::emit_prologue() const {
+  const Register *stack = allocator->get_stack_register();
+  e->emit_comment("Move the stack register past the frame.");
+  e->emit_2addr(INST_ADD, stack, frame_size);
+  if (!saved_registers.empty()) {
+    e->emit_comment("Save the registers used by the procedure.");
+  }
+  const int n_saved = saved_registers.size();
+  for (int i = 0; i < n_saved; ++i) {
+    e->emit_move(stack, i - n_saved, saved_registers[i]);
+  }
+}
+
+void Code_Generator::emit_epilogue() const {
+  const Register *stack = allocator->get_stack_register();
+  if (!saved_registers.empty()) {
+    e->emit_comment("Restore the registers used by the procedure.");
+  }
+  const int n_saved = saved_registers.size();
+  for (int i = 0; i < n_saved; ++i) {
+    e->emit_move(saved_registers[i], stack, i - n_saved);
+  }
+  e->emit_comment("Pop the frame and return to the caller.");
+  e->emit_2addr(INST_SUB, stack, frame_size);
+  e->emit_return(registers.front(), stack);
+}
+
+void Code_Generator::find_last_references() {
+  last_reference.assign(function->vreg_types.size(), -1);
+  int position = 0;
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg()) {
+          last_reference[operand->get_value()] = position;
+        }
+      }
+      ++position;
+    }
+  }
+}
+
+void Code_Generator::generate(const IR_Instruction &instruction,
+                              const int position) {
+  bool loaded = false;
+  Register *reg = nullptr;
+
+  if (instruction.comment != nullptr) {
+    e->emit_comment(instruction.comment);
+  }
+
+  switch (instruction.opcode) {
+    case IR_MOVE:
+      if (instruction.dst.is_variable()) {
+        // There is no memory to memory move, so the value goes through a
+        // register.
+        reg = operand_register(instruction.src1, loaded);
+        emit_move(instruction.dst, reg);
+      } else {
+        reg = result_register(instruction.dst, instruction.src1, position);
+        if (!is_in(instruction.src1, reg)) {
+          emit_move(reg, instruction.src1);
+        }
+        assign_register(instruction.dst.get_value(), reg);
+      }
+      break;
+
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+      // TrAL only has two-address arithmetic: compute src1 op src2 in place
+      // in the register receiving the result.
+      reg = result_register(instruction.dst, instruction.src1, position);
+      if (!is_in(instruction.src1, reg)) {
+        emit_move(reg, instruction.src1);
+      }
+      emit_2addr(instruction_of(instruction.opcode), reg, instruction.src2);
+      assign_register(instruction.dst.get_value(), reg);
+      break;
+
+    case IR_NEG:
+    case IR_NOT:
+      reg = result_register(instruction.dst, instruction.src1, position);
+      if (!is_in(instruction.src1, reg)) {
+        emit_move(reg, instruction.src1);
+      }
+      e->emit_1addr(instruction_of(instruction.opcode), reg);
+      assign_register(instruction.dst.get_value(), reg);
+      break;
+
+    case IR_BRUN:
+      e->emit_branch(&instruction.target->label);
+      break;
+
+    case IR_BREZ:
+    case IR_BRPO:
+    case IR_BRNE:
+      reg = operand_register(instruction.src1, loaded);
+      e->emit_branch(instruction_of(instruction.opcode), reg,
+                     &instruction.target->label);
+      break;
+
+    case IR_OUTB:
+      reg = operand_register(instruction.src1, loaded);
+      e->emit_1addr(INST_OUTB, reg);
+      break;
+
+    case IR_PARAM:
+      reg = operand_register(instruction.src1, loaded);
+      e->emit_move(allocator->get_stack_register(),
+                   2 + instruction.src2.get_value(), reg);
+      break;
+
+    case IR_HALT:
+      e->emit_halt();
+      break;
+
+    case IR_CALL:
+    case IR_RETURN:
+      generate_call(instruction);
+      break;
+
+    default:
+      break;
+  }
+
+  if (loaded) {
+    allocator->deallocate_register(reg);
+  }
+  release_dead(instruction, position);
+}
+
+void Code_Generator::allocate_by_linear_scan() {
+  Liveness liveness(function);
+  for (int n_registers = registers.size(); scan == nullptr; --n_registers) {
+    scan = new Linear_Scan(function, liveness, n_registers);
+    for (unsigned int v = 0; v < vreg_register.size(); ++v) {
+      const int reg = scan->get_register(v);
+      vreg_register[v] = reg == -1 ? nullptr : registers[reg];
+    }
+
+    // Operands living in memory are carried through a register that is
+    // free at their instruction. Set one register aside for them if some
+    // instruction finds all registers busy.
+    if (scratch != nullptr) {
+      break;
+    }
+    int position = 0;
+    for (const Basic_Block *block : function->blocks) {
+      for (const IR_Instruction &instruction : block->instructions) {
+        if (scratch == nullptr && needs_scratch(instruction, position)
+            && scan->get_free_register(position) == -1) {
+          scratch = registers[n_registers - 1];
+          delete scan;
+          scan = nullptr;
+        }
+        ++position;
+      }
+    }
+  }
+
+  // Spilled temporaries go to the spill slots chosen by the scan, while
+  // spilled variables stay in their memory.
+  for (int slot = 0; slot < scan->get_spill_slot_count(); ++slot) {
+    spill_labels.push_back(new string(program->new_label("spill")));
+  }
+  for (unsigned int v = 0; v < vreg_spill.size(); ++v) {
+    const int slot = scan->get_spill_slot(v);
+    vreg_spill[v] = slot == -1 ? -1 : spill_base + slot;
+  }
+}
+
+void Code_Generator::generate_allocated(const IR_Instruction &instruction,
+                                        const int position) {
+  IR_Operand src1 = instruction.src1;
+  IR_Operand src2 = instruction.src2;
+  Register *reg = register_of(instruction.dst);
+
+  if (instruction.comment != nullptr) {
+    e->emit_comment(instruction.comment);
+  }
+
+  switch (instruction.opcode) {
+    case IR_MOVE:
+      if (reg != nullptr) {
+        if (!is_in(src1, reg)) {
+          emit_move(reg, src1);
+        }
+      } else if (register_of(src1) != nullptr) {
+        emit_move(instruction.dst, register_of(src1));
+      } else if (!share_memory(instruction.dst, src1)) {
+        // There is no memory to memory move, so the value goes through a
+        // register.
+        reg = scratch_register(position);
+        emit_move(reg, src1);
+        emit_move(instruction.dst, reg);
+      }
+      break;
+
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+      // The result is computed in place of src1, which must not overwrite
+      // src2 first.
+      if (reg != nullptr && is_in(src2, reg) && src1 != src2) {
+        if (instruction.opcode == IR_ADD || instruction.opcode == IR_MUL) {
+          swap(src1, src2);
+        } else if (instruction.opcode == IR_SUB) {
+          // src1 - src2 = -(src2 - src1)
+          emit_2addr(INST_SUB, reg, src1);
+          e->emit_1addr(INST_NEG, reg);
+          break;
+        } else {
+          reg = nullptr;
+        }
+      }
+      if (reg == nullptr) {
+        reg = free_register(src1, position);
+      }
+      if (!is_in(src1, reg)) {
+        emit_move(reg, src1);
+      }
+      emit_2addr(instruction_of(instruction.opcode), reg, src2);
+      store_result(instruction.dst, reg);
+      break;
+
+    case IR_NEG:
+    case IR_NOT:
+      if (reg == nullptr) {
+        reg = free_register(src1, position);
+      }
+      if (!is_in(src1, reg)) {
+        emit_move(reg, src1);
+      }
+      e->emit_1addr(instruction_of(instruction.opcode), reg);
+      store_result(instruction.dst, reg);
+      break;
+
+    case IR_BRUN:
+      e->emit_branch(&instruction.target->label);
+      break;
+
+    case IR_BREZ:
+    case IR_BRPO:
+    case IR_BRNE:
+    case IR_OUTB:
+    case IR_PARAM:
+      reg = register_of(src1);
+      if (reg == nullptr) {
+        reg = scratch_register(position);
+        emit_move(reg, src1);
+      }
+      if (instruction.opcode == IR_OUTB) {
+        e->emit_1addr(INST_OUTB, reg);
+      } else if (instruction.opcode == IR_PARAM) {
+        e->emit_move(allocator->get_stack_register(), 2 + src2.get_value(),
+                     reg);
+      } else {
+        e->emit_branch(instruction_of(instruction.opcode), reg,
+                       &instruction.target->label);
+      }
+      break;
+
+    case IR_HALT:
+      e->emit_halt();
+      break;
+
+    case IR_CALL:
+    case IR_RETURN:
+      generate_call(instruction);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void Code_Generator::generate_call(const IR_Instruction &instruction) {
+  if (instruction.opcode == IR_RETURN) {
+    emit_epilogue();
+    return;
+  }
+  const string callee =
+      "_" + program->functions[instruction.src1.get_value()]->name;
+  const string return_label = program->new_label("call_return");
+  e->emit_call(&callee, &return_label, registers.front(),
+               allocator->get_stack_register());
+}
+
+bool Code_Generator::needs_scratch(const IR_Instruction &instruction,
+                                   const int position) const {
+  const Register *reg = register_of(instruction.dst);
+  switch (instruction.opcode) {
+    case IR_MOVE:
+      return reg == nullptr && register_of(instruction.src1) == nullptr
+          && !share_memory(instruction.dst, instruction.src1);
+
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+      if (reg == nullptr) {
+        return !reuses_operand(instruction.src1, position);
+      }
+      return instruction.opcode == IR_DIV && is_in(instruction.src2, reg)
+          && instruction.src1 != instruction.src2;
+
+    case IR_NEG:
+    case IR_NOT:
+      return reg == nullptr && !reuses_operand(instruction.src1, position);
+
+    case IR_BREZ:
+    case IR_BRPO:
+    case IR_BRNE:
+    case IR_OUTB:
+    case IR_PARAM:
+      return register_of(instruction.src1) == nullptr;
+
+    default:
+      return false;
+  }
+}
+
+Register *Code_Generator::scratch_register(const int position) const {
+  if (scratch != nullptr) {
+    return scratch;
+  }
+  return registers[scan->get_free_register(position)];
+}
+
+Register *Code_Generator::free_register(const IR_Operand &src,
+                                        const int position) const {
+  if (reuses_operand(src, position)) {
+    return register_of(src);
+  }
+  return scratch_register(position);
+}
+
+bool Code_Generator::reuses_operand(const IR_Operand &src,
+                                    const int position) const {
+  return register_of(src) != nullptr
+      && scan->is_last_use(src.get_value(), position);
+}
+
+void Code_Generator::store_result(const IR_Operand &dst,
+                                  const Register *reg) const {
+  Register *target = register_of(dst);
+  if (target == nullptr) {
+    emit_move(dst, reg);
+  } else if (target != reg) {
+    e->emit_move(target, reg);
+  }
+}
+
+Register *Code_Generator::register_of(const IR_Operand &operand) const {
+  return operand.is_vreg() ? vreg_register[operand.get_value()] : nullptr;
+}
+
+bool Code_Generator::share_memory(const IR_Operand &a,
+                                  const IR_Operand &b) const {
+  if (a.is_immediate() || b.is_immediate()) {
+    return false;
+  }
+  if (a == b) {
+    return true;
+  }
+  const int a_variable = variable_of(a);
+  return a_variable != -1 && a_variable == variable_of(b);
+}
+
+Register *Code_Generator::allocate_register() {
+  // Spill the virtual register that most recently got a register if there is
+  // no register available for allocation.
+  if (!allocator->has_free_register()) {
+    const int victim = register_order.back();
+    Register *victim_register = vreg_register[victim];
+    const int spill_memory = allocate_spill_memory();
+    e->emit_comment("Spill register to memory since all registers are live.");
+    e->emit_move(spill_labels[spill_memory], victim_register);
+    vreg_spill[victim] = spill_memory;
+    vreg_register[victim] = nullptr;
+    register_order.pop_back();
+    allocator->deallocate_register(victim_register);
+  }
+  ++counters.register_allocations;
+  return allocator->allocate_register();
+}
+
+void Code_Generator::assign_register(const int vreg, Register *reg) {
+  // The register may have been taken over from a source operand that dies.
+  for (unsigned int i = 0; i < register_order.size(); ++i) {
+    if (vreg_register[register_order[i]] == reg) {
+      vreg_register[register_order[i]] = nullptr;
+      register_order.erase(register_order.begin() + i);
+      break;
+    }
+  }
+
+  // The virtual register now holds a new value, so any spilled copy of it is
+  // obsolete.
+  if (vreg_spill[vreg] != -1) {
+    free_spill_memory(vreg_spill[vreg]);
+    vreg_spill[vreg] = -1;
+  }
+
+  vreg_register[vreg] = reg;
+  register_order.push_back(vreg);
+}
+
+Register *Code_Generator::result_register(const IR_Operand &dst,
+                                          const IR_Operand &src,
+                                          const int position) {
+  if (vreg_register[dst.get_value()] != nullptr) {
+    return vreg_register[dst.get_value()];
+  }
+  if (src.is_vreg() && vreg_register[src.get_value()] != nullptr
+      && last_reference[src.get_value()] == position) {
+    return vreg_register[src.get_value()];
+  }
+  return allocate_register();
+}
+
+Register *Code_Generator::operand_register(const IR_Operand &operand,
+                                           bool &loaded) {
+  if (operand.is_vreg() && vreg_register[operand.get_value()] != nullptr) {
+    loaded = false;
+    return vreg_register[operand.get_value()];
+  }
+  Register *reg = allocate_register();
+  emit_move(reg, operand);
+  loaded = true;
+  return reg;
+}
+
+void Code_Generator::release_dead(const IR_Instruction &instruction,
+                                  const int position) {
+  release(instruction.dst, position);
+  release(instruction.src1, position);
+  release(instruction.src2, position);
+}
+
+void Code_Generator::release(const IR_Operand &operand, const int position) {
+  if (!operand.is_vreg() || last_reference[operand.get_value()] != position) {
+    return;
+  }
+  const int vreg = operand.get_value();
+  if (vreg_register[vreg] != nullptr) {
+    allocator->deallocate_register(vreg_register[vreg]);
+    vreg_register[vreg] = nullptr;
+    register_order.erase(find(register_order.begin(), register_order.end(),
+                              vreg));
+  }
+  if (vreg_spill[vreg] != -1) {
+    free_spill_memory(vreg_spill[vreg]);
+    vreg_spill[vreg] = -1;
+  }
+}
+
+int Code_Generator::allocate_spill_memory() {
+  ++counters.spills;
+  if (!free_spill_slots.empty()) {
+    const int slot = free_spill_slots.top();
+    free_spill_slots.pop();
+    return slot;
+  }
+  // Reserves a new memory location if every spill slot is live.
+  spill_labels.push_back(new string(program->new_label("spill")));
+  return spill_labels.size() - 1;
+}
+
+void Code_Generator::free_spill_memory(const int slot) {
+  free_spill_slots.push(slot);
+}
+
+bool Code_Generator::is_in(const IR_Operand &operand,
+                           const Register *reg) const {
+  return operand.is_vreg() && vreg_register[operand.get_value()] == reg;
+}
+
+void Code_Generator::emit_move(const Register *reg,
+                               const IR_Operand &operand) const {
+  if (operand.is_immediate()) {
+    e->emit_move(reg, operand.get_value());
+  } else if (operand.is_vreg() && vreg_register[operand.get_value()]) {
+    e->emit_move(reg, vreg_register[operand.get_value()]);
+  } else if (in_frame(operand)) {
+    e->emit_move(reg, allocator->get_stack_register(),
+                 frame_offset_of(operand));
+  } else {
+    e->emit_move(reg, memory_of(operand));
+  }
+}
+
+void Code_Generator::emit_2addr(const inst_type inst, const Register *reg,
+                                const IR_Operand &operand) const {
+  if (operand.is_immediate()) {
+    e->emit_2addr(inst, reg, operand.get_value());
+  } else if (operand.is_vreg() && vreg_register[operand.get_value()]) {
+    e->emit_2addr(inst, reg, vreg_register[operand.get_value()]);
+  } else if (in_frame(operand)) {
+    e->emit_2addr(inst, reg, allocator->get_stack_register(),
+                  frame_offset_of(operand));
+  } else {
+    e->emit_2addr(inst, reg, memory_of(operand));
+  }
+}
+
+void Code_Generator::emit_move(const IR_Operand &operand,
+                               const Register *reg) const {
+  if (in_frame(operand)) {
+    e->emit_move(allocator->get_stack_register(), frame_offset_of(operand),
+                 reg);
+  } else {
+    e->emit_move(memory_of(operand), reg);
+  }
+}
+
+int Code_Generator::variable_of(const IR_Operand &operand) const {
+  if (operand.is_variable()) {
+    return operand.get_value();
+  }
+  return operand.is_vreg() ? function->promoted_from[operand.get_value()]
+                           : -1;
+}
+
+bool Code_Generator::in_frame(const IR_Operand &operand) const {
+  return frame_size != 0 && variable_of(operand) != -1;
+}
+
+int Code_Generator::frame_offset_of(const IR_Operand &operand) const {
+  return 2 + variable_of(operand) - frame_size;
+}
+
+const string *Code_Generator::memory_of(const IR_Operand &operand) const {
+  if (operand.is_variable()) {
+    return &function->variables[operand.get_value()].name;
+  }
+  if (function->promoted_from[operand.get_value()] != -1) {
+    return &function->variables[function->promoted_from[operand.get_value()]]
+        .name;
+  }
+  return spill_labels[vreg_spill[operand.get_value()]];
+}
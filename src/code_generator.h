@@ -0,0 +1,213 @@
+// Code generator translates the IR of a program to TrAL.
+// @author Hieu Le
+// @version 12/20/2016
+
+#ifndef CODE_GENERATOR_H
+#define CODE_GENERATOR_H
+
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "emitter.h"
+#include "ir.h"
+#include "linear_scan.h"
+#include "liveness.h"
+#include "register.h"
+#include "register_allocator.h"
+
+using namespace std;
+
+// Ways of allocating registers.
+typedef enum allocation_strategy {
+  // Registers are handed out while the code is translated and are freed at
+  // the last reference of their virtual register.
+  ALLOC_LOCAL       = 1200,
+  // Registers are assigned by linear scan over the live intervals of the
+  // whole function before any code is translated.
+  ALLOC_LINEAR_SCAN = 1201
+} allocation_strategy_type;
+
+class Code_Generator {
+ public:
+  // Constructs a Code_Generator that writes through the given Emitter and
+  // allocates registers with the given strategy from a TrAL machine with
+  // the given number of registers, which Register_File must support.
+  Code_Generator(Emitter *emitter, const allocation_strategy_type strategy,
+                 const int n_registers);
+  ~Code_Generator();
+
+  /* Outputs TrAL code for the main program and for every procedure,
+     followed by data directives for the variables of the main program and
+     for the memory used for register spilling.
+
+     A procedure keeps its formal parameters and local variables in a frame
+     on the stack. Programs with procedures first point the stack register
+     at the memory reserved for the stack, after every other data
+     directive. The stack register points past the last frame, and a frame
+     holds, from its bottom:
+
+       the return address
+       the link register of the caller
+       the formal parameters, then the local variables
+       the registers saved by the procedure
+
+     The caller stores the actual parameters and calls. The procedure then
+     moves the stack register past its frame and saves the registers it
+     uses, other than the link register, which the caller saves. */
+  void generate(IR_Program *the_program);
+
+ private:
+  Emitter *e;
+  Register_File *allocator;
+  allocation_strategy_type strategy;
+
+  IR_Program *program;
+  IR_Function *function;
+
+  // Register holding each virtual register, or nullptr if it has none.
+  vector<Register *> vreg_register;
+
+  // Spill memory holding each virtual register, or -1 if it has none.
+  vector<int> vreg_spill;
+
+  // Position of the last instruction that refers to each virtual register.
+  // Temporaries never live across a loop back edge, so a virtual register
+  // dies at its last reference in layout order.
+  vector<int> last_reference;
+
+  // Virtual registers currently held in registers, oldest first.
+  vector<int> register_order;
+
+  // Labels of the memory used for register spilling, indexed by spill slot.
+  // Every function gets its own spill slots, starting from spill_base.
+  vector<string *> spill_labels;
+  int spill_base;
+
+  // Spill slots that hold no live value, the lowest first.
+  priority_queue<int, vector<int>, greater<int>> free_spill_slots;
+
+  // Registers available for allocation.
+  vector<Register *> registers;
+
+  // Registers saved in the frame of a procedure, and the size of the frame,
+  // or 0 for the main program.
+  vector<Register *> saved_registers;
+  int frame_size;
+
+  // Linear scan of the function, and the register reserved to carry
+  // operands that live in memory, or nullptr if none had to be reserved.
+  Linear_Scan *scan;
+  Register *scratch;
+
+  // Outputs the code of a single function.
+  void generate(IR_Function *the_function);
+
+  // Computes last_reference for the current function.
+  void find_last_references();
+
+  // Moves the stack register past the frame of a procedure and saves
+  // registers, or restores them and returns.
+  void emit_prologue() const;
+  void emit_epilogue() const;
+
+  // Translates a single instruction found at a given position.
+  void generate(const IR_Instruction &instruction, const int position);
+
+  // Assigns a register or a memory location to every virtual register of
+  // the function by linear scan.
+  void allocate_by_linear_scan();
+
+  // Translates a single instruction whose virtual registers have all been
+  // assigned a location.
+  void generate_allocated(const IR_Instruction &instruction,
+                          const int position);
+
+  // Translates a call or a return.
+  void generate_call(const IR_Instruction &instruction);
+
+  // Checks if translating an allocated instruction takes a register besides
+  // the ones of its operands.
+  bool needs_scratch(const IR_Instruction &instruction,
+                     const int position) const;
+
+  // Returns a register that is free during the instruction at a given
+  // position.
+  Register *scratch_register(const int position) const;
+
+  // Returns a register to compute an instruction in when its result goes to
+  // memory: the one of its first operand if the operand dies, or else a
+  // scratch register.
+  Register *free_register(const IR_Operand &src, const int position) const;
+
+  // Checks if the register of the first operand of the instruction at a given
+  // position may receive its result.
+  bool reuses_operand(const IR_Operand &src, const int position) const;
+
+  // Writes the result of an allocated instruction, computed in a register,
+  // to the location of its destination.
+  void store_result(const IR_Operand &dst, const Register *reg) const;
+
+  // Returns the register holding an operand, or nullptr.
+  Register *register_of(const IR_Operand &operand) const;
+
+  // Checks if two operands live in the same memory.
+  bool share_memory(const IR_Operand &a, const IR_Operand &b) const;
+
+  // Gets a free register, spilling the virtual register that most recently
+  // got one if there is no register available for allocation.
+  Register *allocate_register();
+
+  // Binds a virtual register to a register.
+  void assign_register(const int vreg, Register *reg);
+
+  // Chooses the register receiving the result of an instruction. The register
+  // of src is reused when src dies at the instruction.
+  Register *result_register(const IR_Operand &dst, const IR_Operand &src,
+                            const int position);
+
+  // Returns the register holding an operand, loading it into a newly
+  // allocated register if needed. Sets loaded when the register must be
+  // freed by the caller.
+  Register *operand_register(const IR_Operand &operand, bool &loaded);
+
+  // Releases the register or spill memory of the virtual registers of an
+  // instruction that die at it.
+  void release_dead(const IR_Instruction &instruction, const int position);
+  void release(const IR_Operand &operand, const int position);
+
+  // Allocates a memory location used for register spilling, reusing the
+  // lowest free one, and returns its slot.
+  int allocate_spill_memory();
+
+  // Makes a spill slot available for reuse.
+  void free_spill_memory(const int slot);
+
+  // Checks if an operand is held in a given register.
+  bool is_in(const IR_Operand &operand, const Register *reg) const;
+
+  // Emit "move reg, operand" and "inst reg, operand" for any kind of operand.
+  void emit_move(const Register *reg, const IR_Operand &operand) const;
+  void emit_2addr(const inst_type inst, const Register *reg,
+                  const IR_Operand &operand) const;
+
+  // Emit "move operand, reg" for a variable or a spilled virtual register.
+  void emit_move(const IR_Operand &operand, const Register *reg) const;
+
+  // Returns the variable whose memory holds an operand, or -1 if it is an
+  // immediate or a temporary.
+  int variable_of(const IR_Operand &operand) const;
+
+  // Checks if an operand lives in the frame of a procedure, and returns the
+  // offset of its word from the stack register.
+  bool in_frame(const IR_Operand &operand) const;
+  int frame_offset_of(const IR_Operand &operand) const;
+
+  // Returns the name of the memory holding a variable or a spilled virtual
+  // register outside of a frame. A promoted variable is spilled to its own
+  // memory.
+  const string *memory_of(const IR_Operand &operand) const;
+};
+
+#endif
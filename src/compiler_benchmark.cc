@@ -0,0 +1,285 @@
+// Measures the throughput of the scanner, the parser and the whole compiler
+// on generated TruPL programs of several shapes and sizes.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+#include "parser.h"
+#include "workload.h"
+
+namespace {
+
+// Shapes of the generated programs: straight-line code with shallow
+// expressions, and deeply nested loops and conditionals.
+struct Workload {
+  const char *name;
+  int expression_depth;
+  int loop_nesting;
+  double comment_density;
+};
+
+const Workload WORKLOADS[] = {
+  {"flat", 1, 0, 0.1},
+  {"nested", 3, 3, 0.3},
+};
+
+// Sizes of the programs when none are given.
+const char DEFAULT_SIZES[] = "16k,64k,256k";
+
+// Optimization levels of the whole compiler when none are given: the level
+// truc runs at by default, and the highest.
+const char DEFAULT_LEVELS[] = "1,2";
+
+// Discards the target code written by the compiler.
+class Null_Buffer : public streambuf {
+ protected:
+  int overflow(int c) override {
+    return c == EOF ? 0 : c;
+  }
+
+  streamsize xsputn(const char *, streamsize count) override {
+    return count;
+  }
+};
+
+// The input of a benchmark.
+struct Input {
+  const Workload *workload;
+  string source;
+  long long lines;
+  long long tokens;
+};
+
+// The times taken by the runs of one benchmark on one input.
+struct Result {
+  const char *benchmark;
+  const Input *input;
+  int level;
+  vector<double> seconds;
+  double mean;
+  double stddev;
+  double best;
+};
+
+// Scans the whole input and returns the number of tokens before EOF.
+long long scan(const string &source) {
+  istringstream in(source);
+  Scanner scanner(new Buffer(&in));
+  long long tokens = 0;
+  Token *token = scanner.next_token();
+  while (token->get_token_type() != TOKEN_EOF) {
+    delete token;
+    token = scanner.next_token();
+    ++tokens;
+  }
+  delete token;
+  return tokens;
+}
+
+// Parses and analyzes the input down to the IR, then optimizes it at a level
+// and generates code if asked to.
+void compile(const string &source, const bool generate_code,
+             const int level) {
+  istringstream in(source);
+  Parser parser(new Scanner(new Buffer(&in)));
+  parser.set_generate_code(generate_code);
+  parser.set_optimization_level(level);
+  if (!parser.parse_program() || !parser.done_with_input()) {
+    cerr << "ERROR: The generated program does not compile" << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Runs a benchmark once without timing it to warm up the caches and the
+// allocator, then a number of times.
+Result measure(const char *benchmark, const Input &input, const int runs,
+               const int level) {
+  Result result;
+  result.benchmark = benchmark;
+  result.input = &input;
+  result.level = level;
+  for (int i = 0; i <= runs; ++i) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (strcmp(benchmark, "scanner") == 0) {
+      scan(input.source);
+    } else {
+      compile(input.source, strcmp(benchmark, "truc") == 0, level);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i > 0) {
+      result.seconds.push_back(elapsed.count());
+    }
+  }
+
+  double total = 0;
+  result.best = result.seconds.front();
+  for (const double seconds : result.seconds) {
+    total += seconds;
+    result.best = min(result.best, seconds);
+  }
+  result.mean = total / runs;
+  double squares = 0;
+  for (const double seconds : result.seconds) {
+    squares += (seconds - result.mean) * (seconds - result.mean);
+  }
+  result.stddev = runs > 1 ? sqrt(squares / (runs - 1)) : 0;
+  return result;
+}
+
+void print_table(ostream &out, const vector<Result> &results) {
+  out << left << setw(8) << "Bench" << setw(6) << "Level" << setw(8)
+      << "Input" << right << setw(10) << "Bytes" << setw(11) << "Mean ms"
+      << setw(10) << "Stddev %" << setw(11) << "Best ms" << setw(9) << "MB/s"
+      << setw(11) << "Ktokens/s" << setw(10) << "Klines/s" << endl;
+  for (const Result &result : results) {
+    const Input &input = *result.input;
+    out << left << setw(8) << result.benchmark << setw(6) << result.level
+        << setw(8) << input.workload->name << right << setw(10)
+        << input.source.size() << fixed << setprecision(2) << setw(11)
+        << result.mean * 1000
+        << setprecision(1) << setw(10) << 100 * result.stddev / result.mean
+        << setprecision(2) << setw(11) << result.best * 1000
+        << setw(9) << input.source.size() / result.mean / 1e6
+        << setprecision(0) << setw(11) << input.tokens / result.mean / 1e3
+        << setw(10) << input.lines / result.mean / 1e3 << endl;
+    out.unsetf(ios::floatfield);
+  }
+}
+
+void print_json(ostream &out, const vector<Result> &results,
+                const int runs) {
+  out << "{\"runs\": " << runs << ", \"results\": [";
+  for (unsigned int i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    const Input &input = *result.input;
+    out << (i > 0 ? ", " : "") << "{\"benchmark\": \"" << result.benchmark
+        << "\", \"level\": " << result.level
+        << ", \"workload\": \"" << input.workload->name
+        << "\", \"bytes\": " << input.source.size() << ", \"lines\": "
+        << input.lines << ", \"tokens\": " << input.tokens
+        << ", \"mean_seconds\": " << result.mean << ", \"stddev_seconds\": "
+        << result.stddev << ", \"best_seconds\": " << result.best
+        << ", \"mb_per_second\": " << input.source.size() / result.mean / 1e6
+        << ", \"tokens_per_second\": " << input.tokens / result.mean
+        << ", \"lines_per_second\": " << input.lines / result.mean
+        << ", \"seconds\": [";
+    for (unsigned int j = 0; j < result.seconds.size(); ++j) {
+      out << (j > 0 ? ", " : "") << result.seconds[j];
+    }
+    out << "]}";
+  }
+  out << "]}" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int runs = 5;
+  const char *sizes = DEFAULT_SIZES;
+  const char *levels = DEFAULT_LEVELS;
+  bool json = false;
+  const char *json_filename = nullptr;
+  bool usage = false;
+  for (int i = 1; i < argc && !usage; ++i) {
+    if (strncmp(argv[i], "--runs=", 7) == 0) {
+      runs = atoi(argv[i] + 7);
+      usage = runs < 1;
+    } else if (strncmp(argv[i], "--levels=", 9) == 0) {
+      levels = argv[i] + 9;
+    } else if (strncmp(argv[i], "--sizes=", 8) == 0) {
+      sizes = argv[i] + 8;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (strncmp(argv[i], "--json=", 7) == 0) {
+      json_filename = argv[i] + 7;
+    } else {
+      usage = true;
+    }
+  }
+
+  vector<long long> target_sizes;
+  istringstream size_list(sizes);
+  string size;
+  while (!usage && getline(size_list, size, ',')) {
+    target_sizes.push_back(parse_workload_size(size.c_str()));
+    usage = target_sizes.back() <= 0;
+  }
+  vector<int> target_levels;
+  istringstream level_list(levels);
+  string level;
+  while (!usage && getline(level_list, level, ',')) {
+    target_levels.push_back(atoi(level.c_str()));
+    usage = level.empty() || target_levels.back() < 0
+        || target_levels.back() > MAX_OPTIMIZATION_LEVEL;
+  }
+  if (usage || target_sizes.empty() || target_levels.empty()) {
+    cerr << "Usage: " << argv[0] << " [--runs=<count>]"
+         << " [--levels=<level>,...] [--sizes=<bytes>[k|m|g],...]"
+         << " [--json | --json=<file name>]" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vector<Input> inputs;
+  for (const Workload &workload : WORKLOADS) {
+    for (const long long target_size : target_sizes) {
+      Workload_Shape shape = default_workload_shape();
+      shape.target_bytes = target_size;
+      shape.expression_depth = workload.expression_depth;
+      shape.loop_nesting = workload.loop_nesting;
+      shape.comment_density = workload.comment_density;
+      Input input;
+      input.workload = &workload;
+      input.source = generate_workload(shape);
+      input.lines = count(input.source.begin(), input.source.end(), '\n');
+      input.tokens = scan(input.source);
+      inputs.push_back(input);
+    }
+  }
+
+  // The target code is thrown away rather than written to standard output.
+  // The scanner and the parser stop short of the optimizer, so only the
+  // whole compiler runs at each level.
+  Null_Buffer null_buffer;
+  streambuf *standard_output = cout.rdbuf(&null_buffer);
+  vector<Result> results;
+  for (const char *benchmark : {"scanner", "parser"}) {
+    for (const Input &input : inputs) {
+      results.push_back(measure(benchmark, input, runs, 0));
+    }
+  }
+  for (const int level : target_levels) {
+    for (const Input &input : inputs) {
+      results.push_back(measure("truc", input, runs, level));
+    }
+  }
+  cout.rdbuf(standard_output);
+
+  if (json_filename != nullptr) {
+    ofstream out(json_filename);
+    if (!out) {
+      cerr << "ERROR: Cannot open " << json_filename << endl;
+      exit(EXIT_FAILURE);
+    }
+    print_json(out, results, runs);
+  }
+  if (json) {
+    print_json(cout, results, runs);
+  } else {
+    print_table(cout, results);
+  }
+  return 0;
+}
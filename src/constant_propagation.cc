@@ -0,0 +1,220 @@
+// Implementation of constant and copy propagation.
+// @author Hieu Le
+// @version 12/30/2016
+
+#include "constant_propagation.h"
+
+#include <climits>
+#include <vector>
+
+#include "word.h"
+
+namespace {
+
+// What a virtual register holds, from most to least known.
+typedef enum fact_kind { FACT_UNREACHED,  // No path reaches this point yet.
+                         FACT_CONSTANT,   // The constant value.
+                         FACT_COPY,       // A copy of virtual register value.
+                         FACT_ANY } fact_kind_type;
+
+struct Fact {
+  fact_kind_type kind;
+  int value;
+
+  bool operator==(const Fact &other) const {
+    return kind == other.kind
+        && (kind == FACT_UNREACHED || kind == FACT_ANY
+            || value == other.value);
+  }
+  bool operator!=(const Fact &other) const { return !(*this == other); }
+};
+
+const Fact UNREACHED = {FACT_UNREACHED, 0};
+const Fact ANY = {FACT_ANY, 0};
+
+// Facts about every virtual register at some point.
+typedef vector<Fact> State;
+
+// Returns the fact about an operand read in a given state.
+Fact fact_of(const IR_Operand &operand, const State &state) {
+  if (operand.is_immediate()) {
+    return {FACT_CONSTANT, operand.get_value()};
+  }
+  if (operand.is_vreg()) {
+    const Fact &fact = state[operand.get_value()];
+    if (fact.kind == FACT_ANY) {
+      return {FACT_COPY, operand.get_value()};
+    }
+    return fact;
+  }
+  // Memory may hold anything.
+  return ANY;
+}
+
+// Returns the fact about the value an instruction computes.
+Fact evaluate(const IR_Instruction &instruction, const State &state) {
+  const Fact first = fact_of(instruction.src1, state);
+  if (instruction.opcode == IR_MOVE) {
+    return first;
+  }
+  const Fact second = instruction.src2.is_none()
+      ? Fact{FACT_CONSTANT, 0} : fact_of(instruction.src2, state);
+  if (first.kind == FACT_UNREACHED || second.kind == FACT_UNREACHED) {
+    return UNREACHED;
+  }
+  int result;
+  if (first.kind == FACT_CONSTANT && second.kind == FACT_CONSTANT
+      && fold_constants(instruction.opcode, first.value, second.value, result)) {
+    return {FACT_CONSTANT, result};
+  }
+  return ANY;
+}
+
+// Updates a state past an instruction.
+void transfer(const IR_Instruction &instruction, State &state) {
+  if (!instruction.dst.is_vreg()) {
+    return;
+  }
+  const int vreg = instruction.dst.get_value();
+  Fact fact = evaluate(instruction, state);
+  if (fact.kind == FACT_COPY && fact.value == vreg) {
+    // A register copied to itself keeps what is known about it.
+    return;
+  }
+  for (Fact &other : state) {
+    if (other.kind == FACT_COPY && other.value == vreg) {
+      other = ANY;
+    }
+  }
+  state[vreg] = fact;
+}
+
+// Combines the facts of two paths merging.
+void meet(State &state, const State &other) {
+  for (unsigned int v = 0; v < state.size(); ++v) {
+    if (state[v].kind == FACT_UNREACHED) {
+      state[v] = other[v];
+    } else if (other[v].kind != FACT_UNREACHED && state[v] != other[v]) {
+      state[v] = ANY;
+    }
+  }
+}
+
+// Replaces an operand by what it is known to hold.
+void rewrite(IR_Operand &operand, const State &state) {
+  if (!operand.is_vreg()) {
+    return;
+  }
+  const Fact &fact = state[operand.get_value()];
+  if (fact.kind == FACT_CONSTANT) {
+    operand = IR_Operand(IR_IMMEDIATE, fact.value);
+  } else if (fact.kind == FACT_COPY) {
+    operand = IR_Operand(IR_VREG, fact.value);
+  }
+}
+
+}  // namespace
+
+bool fold_constants(const ir_opcode_type opcode, const int first,
+                    const int second, int &result) {
+  switch (opcode) {
+    case IR_MOVE: result = first; return true;
+    case IR_ADD: result = wrap(static_cast<long long>(first) + second);
+      return true;
+    case IR_SUB: result = wrap(static_cast<long long>(first) - second);
+      return true;
+    case IR_MUL: result = wrap(static_cast<long long>(first) * second);
+      return true;
+    case IR_DIV:
+      // Leave division by zero and the overflowing INT_MIN / -1 to the
+      // running program.
+      if (second == 0 || (second == -1 && first == INT_MIN)) {
+        return false;
+      }
+      result = wrap(static_cast<long long>(first) / second);
+      return true;
+    case IR_NEG: result = wrap(-static_cast<long long>(first)); return true;
+    case IR_NOT: result = first == 0 ? 1 : 0; return true;
+    default: return false;
+  }
+}
+
+bool is_taken(const ir_opcode_type opcode, const int condition) {
+  switch (opcode) {
+    case IR_BREZ: return condition == 0;
+    case IR_BRPO: return condition > 0;
+    case IR_BRNE: return condition < 0;
+    default: return true;
+  }
+}
+
+void propagate_constants(IR_Function *function) {
+  function->build_cfg();
+  const int n_blocks = function->blocks.size();
+  const int n_vregs = function->vreg_types.size();
+
+  // Solve in = meet of the out states of the predecessors reached so far,
+  // with every register holding any value at the entry of the function.
+  vector<State> in(n_blocks, State(n_vregs, UNREACHED));
+  vector<State> out(n_blocks, State(n_vregs, UNREACHED));
+  vector<bool> reached(n_blocks, false);
+  in[0].assign(n_vregs, ANY);
+  reached[0] = true;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const Basic_Block *block : function->blocks) {
+      if (block->id > 0) {
+        State state(n_vregs, UNREACHED);
+        for (const Basic_Block *predecessor : block->predecessors) {
+          if (reached[predecessor->id]) {
+            meet(state, out[predecessor->id]);
+            reached[block->id] = true;
+          }
+        }
+        in[block->id] = state;
+      }
+      if (!reached[block->id]) {
+        continue;
+      }
+      State state = in[block->id];
+      for (const IR_Instruction &instruction : block->instructions) {
+        transfer(instruction, state);
+      }
+      if (state != out[block->id]) {
+        out[block->id] = state;
+        changed = true;
+      }
+    }
+  }
+
+  // Rewrite the reads, then fold what became constant.
+  for (Basic_Block *block : function->blocks) {
+    State state = in[block->id];
+    vector<IR_Instruction> code;
+    for (IR_Instruction instruction : block->instructions) {
+      rewrite(instruction.src1, state);
+      rewrite(instruction.src2, state);
+      transfer(instruction, state);
+
+      if (instruction.dst.is_vreg()) {
+        const Fact &fact = state[instruction.dst.get_value()];
+        if (fact.kind == FACT_CONSTANT && instruction.opcode != IR_MOVE) {
+          instruction = IR_Instruction(IR_MOVE, instruction.dst,
+                                       IR_Operand(IR_IMMEDIATE, fact.value),
+                                       IR_Operand(), nullptr);
+        }
+      } else if (instruction.is_conditional_branch()
+                 && instruction.src1.is_immediate()) {
+        if (!is_taken(instruction.opcode, instruction.src1.get_value())) {
+          continue;
+        }
+        instruction = IR_Instruction(IR_BRUN, IR_Operand(), IR_Operand(),
+                                     IR_Operand(), instruction.target);
+      }
+      code.push_back(instruction);
+    }
+    block->instructions.swap(code);
+  }
+  function->build_cfg();
+}
@@ -0,0 +1,38 @@
+// Constant and copy propagation.
+// @author Hieu Le
+// @version 12/30/2016
+
+#ifndef CONSTANT_PROPAGATION_H
+#define CONSTANT_PROPAGATION_H
+
+#include "ir.h"
+
+/* Computes the result of an operation on constants, with second set to 0
+   for the unary ones, wrapping around like TruPro words. Returns false for
+   the divisions left to fail at run time: those by zero and INT_MIN / -1.
+   Shared by the parser and the passes folding constants. */
+bool fold_constants(const ir_opcode_type opcode, const int first,
+                    const int second, int &result);
+
+// Checks if a conditional branch on a constant condition is taken.
+bool is_taken(const ir_opcode_type opcode, const int condition);
+
+/* Replaces the reads of a virtual register by the constant it holds, or by
+   the virtual register it was copied from, wherever this is known for every
+   path reaching the read.
+
+   A forward dataflow analysis finds what each virtual register holds at the
+   entry of each block: a constant, a copy of another virtual register, or
+   any value. Assigning a register forgets the copies of it, and where paths
+   merge, such as at _if_done and _while_cond, only the facts shared by all
+   of them remain. Blocks not yet reached do not weaken what is known, so a
+   constant written before a loop and left alone within it stays known
+   inside.
+
+   Computations whose operands are all constants become moves of their
+   result, except divisions by zero and INT_MIN / -1, which are left to fail
+   at run time. A conditional branch on a constant becomes a branch, or goes
+   away if never taken. */
+void propagate_constants(IR_Function *function);
+
+#endif
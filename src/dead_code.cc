@@ -0,0 +1,168 @@
+// Implementation of dead code elimination.
+// @author Hieu Le
+// @version 12/30/2016
+
+#include "dead_code.h"
+
+#include <vector>
+
+#include "liveness.h"
+
+namespace {
+
+// Checks if an instruction only computes its destination, so that it may
+// go when nothing reads the result.
+bool is_removable(const IR_Instruction &instruction) {
+  if (!instruction.dst.is_vreg()) {
+    return false;
+  }
+  switch (instruction.opcode) {
+    case IR_MOVE:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_NEG:
+    case IR_NOT:
+      return true;
+
+    case IR_DIV:
+      return instruction.src2.is_immediate()
+          && instruction.src2.get_value() != 0;
+
+    default:
+      return false;
+  }
+}
+
+// Deletes the branches to the block laid out next, which is reached
+// whether they are taken or not.
+void remove_branches_to_next(IR_Function *function) {
+  for (unsigned int i = 0; i + 1 < function->blocks.size(); ++i) {
+    vector<IR_Instruction> &code = function->blocks[i]->instructions;
+    if (!code.empty() && code.back().is_branch()
+        && code.back().target == function->blocks[i + 1]) {
+      code.pop_back();
+    }
+  }
+}
+
+// Updates the virtual registers whose value is needed before an instruction
+// from those needed after it. Returns false if the instruction only computes
+// a value that nothing needs, which then reads nothing.
+bool is_needed(const IR_Instruction &instruction, Register_Set &needed) {
+  if (is_removable(instruction)
+      && !needed.contains(instruction.dst.get_value())) {
+    return false;
+  }
+  if (instruction.dst.is_vreg()) {
+    needed.erase(instruction.dst.get_value());
+  }
+  for (const IR_Operand *operand : {&instruction.src1, &instruction.src2}) {
+    if (operand->is_vreg()) {
+      needed.insert(operand->get_value());
+    }
+  }
+  return true;
+}
+
+// Deletes the computations whose result no instruction that stays reads.
+// Unlike liveness, a value read only by removed computations is not
+// needed, so one pass removes whole chains of them.
+void remove_dead_computations(IR_Function *function) {
+  function->build_cfg();
+  const int n_blocks = function->blocks.size();
+  const int n_vregs = function->vreg_types.size();
+  vector<Register_Set> needed_in(n_blocks, Register_Set(n_vregs));
+  vector<Register_Set> needed_out(n_blocks, Register_Set(n_vregs));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = n_blocks - 1; i >= 0; --i) {
+      const Basic_Block *block = function->blocks[i];
+      for (const Basic_Block *successor : block->successors) {
+        needed_out[block->id].unite(needed_in[successor->id]);
+      }
+      Register_Set needed = needed_out[block->id];
+      const vector<IR_Instruction> &code = block->instructions;
+      for (int j = code.size() - 1; j >= 0; --j) {
+        is_needed(code[j], needed);
+      }
+      if (needed_in[block->id].unite(needed)) {
+        changed = true;
+      }
+    }
+  }
+
+  // Walk each block backwards from what is needed after it.
+  for (Basic_Block *block : function->blocks) {
+    Register_Set needed = needed_out[block->id];
+    vector<IR_Instruction> &code = block->instructions;
+    vector<bool> kept(code.size());
+    for (int i = code.size() - 1; i >= 0; --i) {
+      kept[i] = is_needed(code[i], needed);
+    }
+    vector<IR_Instruction> live_code;
+    for (unsigned int i = 0; i < code.size(); ++i) {
+      if (kept[i]) {
+        live_code.push_back(code[i]);
+      }
+    }
+    code = live_code;
+  }
+}
+
+}  // namespace
+
+void remove_unreachable_blocks(IR_Function *function) {
+  function->build_cfg();
+  vector<bool> reached(function->blocks.size(), false);
+  vector<Basic_Block *> work = {function->blocks.front()};
+  reached[0] = true;
+  while (!work.empty()) {
+    Basic_Block *block = work.back();
+    work.pop_back();
+    for (Basic_Block *successor : block->successors) {
+      if (!reached[successor->id]) {
+        reached[successor->id] = true;
+        work.push_back(successor);
+      }
+    }
+  }
+
+  vector<Basic_Block *> blocks;
+  for (Basic_Block *block : function->blocks) {
+    if (reached[block->id]) {
+      blocks.push_back(block);
+    } else {
+      delete block;
+    }
+  }
+  function->blocks = blocks;
+  function->build_cfg();
+}
+
+void eliminate_dead_code(IR_Function *function) {
+  remove_unreachable_blocks(function);
+  remove_branches_to_next(function);
+  remove_dead_computations(function);
+  function->build_cfg();
+}
+
+void remove_unused_variables(IR_Function *function) {
+  // Spilled promoted variables stay in their memory.
+  vector<bool> removed(function->variables.size(), true);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_variable()) {
+          removed[operand->get_value()] = false;
+        } else if (operand->is_vreg()
+                   && function->promoted_from[operand->get_value()] != -1) {
+          removed[function->promoted_from[operand->get_value()]] = false;
+        }
+      }
+    }
+  }
+  function->remove_variables(removed);
+}
@@ -0,0 +1,35 @@
+// Dead code and dead store elimination.
+// @author Hieu Le
+// @version 12/30/2016
+
+#ifndef DEAD_CODE_H
+#define DEAD_CODE_H
+
+#include "ir.h"
+
+/* Deletes the blocks of a function that no path from its entry block
+   reaches, and updates its control flow graph. */
+void remove_unreachable_blocks(IR_Function *function);
+
+/* Removes the code of a function that cannot affect its output:
+
+   - blocks that no path from the entry block reaches, such as the branch
+     of an if statement whose condition is constant;
+   - branches to the block laid out next;
+   - computations of virtual registers that are not live after them, which
+     includes assignments to a promoted variable overwritten before being
+     read. Divisions are kept unless their divisor is a nonzero constant,
+     since dividing by zero stops the program.
+
+   A computation whose result only feeds removed ones goes too, so a
+   single pass leaves no dead computation behind. Writes to memory are
+   always kept. */
+void eliminate_dead_code(IR_Function *function);
+
+/* Removes the variables of a function that neither its instructions nor
+   its virtual registers refer to, so that no data directive is emitted for
+   them. Only for the main program, since the formal parameters of a
+   procedure sit at fixed places in its frame. */
+void remove_unused_variables(IR_Function *function);
+
+#endif
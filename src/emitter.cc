@@ -4,8 +4,11 @@
 
 #include "emitter.h"
 
+#include "stats.h"
+
 Emitter::Emitter() {
   label_num = 0;
+  comments = false;
 }
 
 Emitter::~Emitter() {}
@@ -16,6 +19,7 @@ string *Emitter::get_new_label() {
   string *label = new string("_L");
   string *number = itos(label_num);
   label_num++;
+  ++counters.labels;
   *label += *number;
   delete number;
   return label;
@@ -27,6 +31,7 @@ string *Emitter::get_new_label(const char prefix[]) {
   string *label = new string("_");
   string *number = itos(label_num);
   label_num++;
+  ++counters.labels;
   *label = *label + prefix + *number;
   delete number;
   return label;
@@ -48,28 +53,48 @@ void Emitter::emit_label(const string *label) const {
 
 // move Ri, #1
 void Emitter::emit_move(const Register *reg, int immediate) const {
+  count_instruction(INST_MOVE);
   cout << "\t\t" << "move " << "R" << reg->get_num();
   cout << ", #" << immediate << endl;
 }
 
 // move Ri, Rj
 void Emitter::emit_move(const Register *reg, const Register *regr) const {
+  count_instruction(INST_MOVE);
   cout << "\t\t" << "move " << "R" << reg->get_num();
   cout << ", R" << regr->get_num() << endl;
 }
 
 // move Ri, variable
 void Emitter::emit_move(const Register *reg, const string *var) const {
+  count_instruction(INST_MOVE);
   cout << "\t\t" << "move " << "R" << reg->get_num();
   cout << ", " << *var << endl;
 }
 
 // move variable, Ri
 void Emitter::emit_move(const string *id, const Register *reg) const {
+  count_instruction(INST_MOVE);
   cout << "\t\t" << "move " << *id << ", ";
   cout << 'R' << reg->get_num() << endl;
 }
 
+// move Ri, (Rb, #offset)
+void Emitter::emit_move(const Register *reg, const Register *base,
+                        int offset) const {
+  count_instruction(INST_MOVE);
+  cout << "\t\t" << "move " << "R" << reg->get_num();
+  cout << ", " << relative(base, offset) << endl;
+}
+
+// move (Rb, #offset), Ri
+void Emitter::emit_move(const Register *base, int offset,
+                        const Register *reg) const {
+  count_instruction(INST_MOVE);
+  cout << "\t\t" << "move " << relative(base, offset) << ", ";
+  cout << 'R' << reg->get_num() << endl;
+}
+
 void Emitter::emit_2addr(inst_type inst, const Register *reg,
                          int immediate) const {
   cout << "\t\t";
@@ -91,6 +116,13 @@ void Emitter::emit_2addr(inst_type inst, const Register *reg,
   cout << " R" << reg->get_num() << ", " << *var << endl;
 }
 
+void Emitter::emit_2addr(inst_type inst, const Register *reg,
+                         const Register *base, int offset) const {
+  cout << "\t\t";
+  translate_and_emit(inst);
+  cout << " R" << reg->get_num() << ", " << relative(base, offset) << endl;
+}
+
 void Emitter::emit_1addr(inst_type inst, const Register *reg) const {
   cout << "\t\t";
   translate_and_emit(inst);
@@ -98,6 +130,7 @@ void Emitter::emit_1addr(inst_type inst, const Register *reg) const {
 }
 
 void Emitter::emit_branch(const string *dest) const {
+  count_instruction(INST_BRUN);
   cout << "\t\t" << "brun " << *dest << endl;
 }
 
@@ -115,9 +148,36 @@ void Emitter::emit_branch(inst_type inst, const Register *reg,
 }
 
 void Emitter::emit_halt() const {
+  count_instruction(INST_HALT);
   cout << "\t\t" << "halt" << endl;
 }
 
+void Emitter::emit_call(const string *dest, const string *return_label,
+                        const Register *link, const Register *stack) const {
+  emit_move(stack, 1, link);
+  emit_2addr(INST_LEA, link, return_label);
+  emit_move(stack, 0, link);
+  emit_branch(dest);
+  emit_label(return_label);
+  emit_move(link, stack, 1);
+}
+
+void Emitter::emit_return(const Register *link, const Register *stack) const {
+  emit_move(link, stack, 0);
+  count_instruction(INST_BRUN);
+  cout << "\t\t" << "brun " << "R" << link->get_num() << endl;
+}
+
+void Emitter::emit_stack_setup(const Register *stack) const {
+  const string label = STACK_LABEL;
+  emit_2addr(INST_LEA, stack, &label);
+}
+
+void Emitter::emit_stack_directive() const {
+  const string label = STACK_LABEL;
+  emit_data_directive(&label, TRAL_STACK_WORDS);
+}
+
 void Emitter::emit_data_directive(const string *label, int size) const {
   int length = label->size();
   if (length < 7) {
@@ -134,12 +194,27 @@ void Emitter::emit_data_directive(int size) const {
 }
 
 void Emitter::emit_comment(const char comment[]) const {
-#if COMMENT_MODE
-  cout << "\t\t" << "; " << comment << endl;
-#endif
+  if (comments) {
+    cout << "\t\t" << "; " << comment << endl;
+  }
+}
+
+void Emitter::set_comments(const bool enabled) {
+  comments = enabled;
+}
+
+string Emitter::relative(const Register *base, int offset) const {
+  stringstream out;
+  out << "(R" << base->get_num();
+  if (offset != 0) {
+    out << ", #" << offset;
+  }
+  out << ")";
+  return out.str();
 }
 
 void Emitter::translate_and_emit(inst_type inst) const {
+  count_instruction(inst);
   switch (inst) {
     case INST_MOVE:
       cout << "move";
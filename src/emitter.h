@@ -12,11 +12,14 @@
 
 #include "register.h"
 
-// Enable expressive comment when generating target code.
-#define COMMENT_MODE 1
-
 using namespace std;
 
+// Label and size in words of the memory holding the frames of procedures.
+// TruPL identifiers cannot hold an underscore, so no variable clashes with
+// the label.
+const char STACK_LABEL[] = "stack_base";
+const int TRAL_STACK_WORDS = 1024;
+
 // Instruction mnemonics.
 typedef enum instruction_type { INST_MOVE = 802,
                                 INST_ADD =  803,
@@ -34,10 +37,12 @@ typedef enum instruction_type { INST_MOVE = 802,
                                 INST_HALT = 815,
                                 INST_GARBAGE = 899} inst_type;
 
+/* Emitter writes TrAL to standard output. Subclasses lower the same
+   stream of calls to other targets. */
 class Emitter {
  public:
   Emitter();
-  ~Emitter();
+  virtual ~Emitter();
 
   /* Label handling. */
 
@@ -49,22 +54,29 @@ class Emitter {
   string *get_new_label(const char prefix[]);
 
   // Outputs a previously generated label.
-  void emit_label(const string *label) const;
+  virtual void emit_label(const string *label) const;
 
   /* Instruction handling. */
 
   /* The first set handles the move to register instrucitons. */
   // For immediate mode.
-  void emit_move(const Register *reg, int immedidate) const;
+  virtual void emit_move(const Register *reg, int immedidate) const;
   // For register direct mode.
-  void emit_move(const Register *reg, const Register *regd) const;
+  virtual void emit_move(const Register *reg, const Register *regd) const;
   // For memory direct mode.
-  void emit_move(const Register *reg, const string *var) const;
+  virtual void emit_move(const Register *reg, const string *var) const;
 
   // Emit instructions of the form "move dest, Rn".
 
   // Here is reg to memory move.
-  void emit_move(const string *var, const Register *reg) const;
+  virtual void emit_move(const string *var, const Register *reg) const;
+
+  // For register relative mode, "move Ri, (Rb, #offset)" and
+  // "move (Rb, #offset), Ri".
+  virtual void emit_move(const Register *reg, const Register *base,
+                         int offset) const;
+  virtual void emit_move(const Register *base, int offset,
+                         const Register *reg) const;
 
   /* All the other two-address instructions are handled here.
      The first address is always a register. */
@@ -72,35 +84,63 @@ class Emitter {
   // To output "add R0, foovar", call
   // emit_2addr (ADD, <pointer to object for register 0>,
   //             <pointer to string containing "foovar">)
-  void emit_2addr(inst_type inst, const Register *reg, int immediate) const;
-  void emit_2addr(inst_type inst, const Register *reg,
-                  const Register *src) const;
-  void emit_2addr(inst_type inst, const Register *reg, const string *var) const;
+  virtual void emit_2addr(inst_type inst, const Register *reg,
+                          int immediate) const;
+  virtual void emit_2addr(inst_type inst, const Register *reg,
+                          const Register *src) const;
+  virtual void emit_2addr(inst_type inst, const Register *reg,
+                          const string *var) const;
+  virtual void emit_2addr(inst_type inst, const Register *reg,
+                          const Register *base, int offset) const;
 
   /* One address instructions. */
 
-  void emit_1addr(inst_type inst, const Register *reg) const;
+  virtual void emit_1addr(inst_type inst, const Register *reg) const;
 
   /* Branch instructions. */
 
   // For brun.
-  void emit_branch(const string *dest) const;
+  virtual void emit_branch(const string *dest) const;
   // For the conditional branches with immmediate mode targets.
-  void emit_branch(inst_type inst, const Register *reg, int dest) const;
+  virtual void emit_branch(inst_type inst, const Register *reg,
+                           int dest) const;
   // For conditional branches that target labels
-  void emit_branch(inst_type inst, const Register *reg,
-                   const string *dest) const;
+  virtual void emit_branch(inst_type inst, const Register *reg,
+                           const string *dest) const;
 
   /* Halt instruction. */
-  void emit_halt() const;
+  virtual void emit_halt() const;
+
+  /* Procedure calls. The caller leaves the return address at (stack) and
+     the value of the link register at (stack, #1), and restores the link
+     register once the callee returns to return_label. The callee returns
+     through the link register, which it may change freely. */
+  virtual void emit_call(const string *dest, const string *return_label,
+                         const Register *link, const Register *stack) const;
+  // The stack register must point to the return address again.
+  virtual void emit_return(const Register *link, const Register *stack) const;
+
+  // Points the stack register at the memory reserved by
+  // emit_stack_directive(). Emitted first in programs with procedures.
+  virtual void emit_stack_setup(const Register *stack) const;
+  // Reserves the memory for the frames, after the other data directives.
+  // Deeper calls go on past it if the machine has the memory.
+  virtual void emit_stack_directive() const;
 
   /* Data directives. */
-  void emit_data_directive(const string *label, int size) const;
-  void emit_data_directive(int size) const;
+  virtual void emit_data_directive(const string *label, int size) const;
+  virtual void emit_data_directive(int size) const;
 
   /* If you want your compiler to add comments to your Tral program,
      this is the ticket. Hmm, compilers that write comments! */
-  void emit_comment(const char comment[]) const;
+  virtual void emit_comment(const char comment[]) const;
+
+  // Sets whether emit_comment() writes anything. Defaults to false.
+  void set_comments(const bool enabled);
+
+ protected:
+  // See set_comments().
+  bool comments;
 
  private:
   // The current unique number used to generate each label.
@@ -111,6 +151,9 @@ class Emitter {
 
   // Emit an instruction mnemonic.
   void translate_and_emit(inst_type inst) const;
+
+  // Returns a register relative operand.
+  string relative(const Register *base, int offset) const;
 };
 
 #endif
@@ -0,0 +1,164 @@
+// Implementation of evaluation ordering.
+// @author Hieu Le
+// @version 12/23/2016
+
+#include "evaluation_order.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Checks if an instruction computes an expression without side effects.
+bool is_arithmetic(const IR_Instruction &instruction) {
+  switch (instruction.opcode) {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_NEG:
+    case IR_NOT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Expression trees of a single block.
+class Expression_Forest {
+ public:
+  Expression_Forest(const vector<IR_Instruction> &the_code,
+                    const vector<int> &references)
+      : code(the_code), child(code.size(), vector<int>(2, -1)),
+        parent(code.size(), -1), need(code.size(), 0) {
+    // Index of the instruction defining each virtual register so far.
+    vector<int> definition(references.size(), -1);
+    for (unsigned int i = 0; i < code.size(); ++i) {
+      const IR_Instruction &instruction = code[i];
+      if (!is_arithmetic(instruction)) {
+        continue;
+      }
+      // A temporary referenced exactly twice is defined by one instruction
+      // and read by another.
+      const IR_Operand *operands[] = {&instruction.src1, &instruction.src2};
+      for (int k = 0; k < 2; ++k) {
+        if (operands[k]->is_vreg() && definition[operands[k]->get_value()] != -1
+            && references[operands[k]->get_value()] == 2) {
+          child[i][k] = definition[operands[k]->get_value()];
+          parent[child[i][k]] = i;
+        }
+      }
+      if (instruction.dst.is_vreg()) {
+        definition[instruction.dst.get_value()] = i;
+      }
+    }
+  }
+
+  // Returns the instructions of the block with every expression tree laid
+  // out in Sethi-Ullman order.
+  vector<IR_Instruction> reorder() {
+    // Only move the instructions of a tree that fills a range of the block
+    // on its own, so that nothing else is computed between them.
+    vector<bool> movable(code.size(), false);
+    for (int i = code.size() - 1; i >= 0; --i) {
+      if (!is_arithmetic(code[i])) {
+        continue;
+      }
+      if (parent[i] != -1) {
+        movable[i] = movable[parent[i]];
+      } else {
+        int size = 0;
+        movable[i] = i - first_of(i, size) + 1 == size;
+      }
+    }
+
+    vector<IR_Instruction> result;
+    for (unsigned int i = 0; i < code.size(); ++i) {
+      if (!movable[i]) {
+        result.push_back(code[i]);
+      } else if (parent[i] == -1) {
+        // Subtrees are placed along with their root.
+        label(i);
+        emit(i, result);
+      }
+    }
+    return result;
+  }
+
+ private:
+  const vector<IR_Instruction> &code;
+
+  // Instructions computing the first and second operand of each
+  // instruction, or -1 when the operand is not a subtree.
+  vector<vector<int>> child;
+
+  // Instruction reading the result of each instruction as a subtree, or -1.
+  vector<int> parent;
+
+  // Number of registers needed by each subtree.
+  vector<int> need;
+
+  // Returns the smallest index of an instruction in a subtree and counts
+  // its instructions.
+  int first_of(const int node, int &size) const {
+    ++size;
+    int first = node;
+    for (int k = 0; k < 2; ++k) {
+      if (child[node][k] != -1) {
+        first = min(first, first_of(child[node][k], size));
+      }
+    }
+    return first;
+  }
+
+  // Returns the number of registers needed by an operand of an instruction.
+  // Only the first operand must be loaded into a register when it is not a
+  // subtree.
+  int operand_need(const int node, const int k) const {
+    return child[node][k] != -1 ? need[child[node][k]] : (k == 0 ? 1 : 0);
+  }
+
+  // Computes the register needs of a subtree.
+  void label(const int node) {
+    for (int k = 0; k < 2; ++k) {
+      if (child[node][k] != -1) {
+        label(child[node][k]);
+      }
+    }
+    const int left = operand_need(node, 0);
+    const int right = operand_need(node, 1);
+    need[node] = left == right ? left + 1 : max(left, right);
+  }
+
+  // Outputs a subtree, computing its most demanding operand first.
+  void emit(const int node, vector<IR_Instruction> &result) const {
+    const int first = operand_need(node, 1) > operand_need(node, 0) ? 1 : 0;
+    for (int k : {first, 1 - first}) {
+      if (child[node][k] != -1) {
+        emit(child[node][k], result);
+      }
+    }
+    result.push_back(code[node]);
+  }
+};
+
+}  // namespace
+
+void order_evaluation(IR_Function *function) {
+  vector<int> references(function->vreg_types.size(), 0);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg()) {
+          ++references[operand->get_value()];
+        }
+      }
+    }
+  }
+
+  for (Basic_Block *block : function->blocks) {
+    Expression_Forest forest(block->instructions, references);
+    block->instructions = forest.reorder();
+  }
+}
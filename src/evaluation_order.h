@@ -0,0 +1,23 @@
+// Evaluation order of expressions.
+// @author Hieu Le
+// @version 12/23/2016
+
+#ifndef EVALUATION_ORDER_H
+#define EVALUATION_ORDER_H
+
+#include "ir.h"
+
+/* Reorders the computation of each expression of a function so that it
+   takes as few registers as possible, after Sethi and Ullman.
+
+   Within a block, an arithmetic instruction whose temporary result is only
+   read by a later arithmetic instruction is a subtree of that instruction.
+   Since the second operand of two-address code may come straight from
+   memory, a variable or a constant needs a register as the first operand
+   only. A subtree whose operands need l and r registers needs l + 1
+   registers when l = r, and max(l, r) otherwise, provided the operand
+   needing more registers is computed first. Only the order in which
+   operands are computed changes, never the operands of an instruction. */
+void order_evaluation(IR_Function *function);
+
+#endif
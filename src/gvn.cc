@@ -0,0 +1,210 @@
+// Implementation of global value numbering.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "gvn.h"
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A computation, as its opcode and the value numbers of its operands.
+typedef tuple<int, int, int> Computation;
+
+// The value number of a computation, along with the version holding it.
+typedef pair<int, IR_Operand> Holder;
+
+// Checks if an instruction writes its destination and nothing else.
+bool computes_value(const IR_Instruction &instruction) {
+  switch (instruction.opcode) {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_NEG:
+    case IR_NOT:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+class Numberer {
+ public:
+  explicit Numberer(SSA_Form &ssa);
+
+  // Numbers the blocks along a walk of the dominator tree.
+  void run();
+
+ private:
+  SSA_Form &ssa;
+  IR_Function *function;
+  int next;
+
+  // Value number of each version, or -1 if not numbered yet.
+  vector<int> numbers;
+  map<int, int> constants;
+
+  // Computations of the blocks dominating the current one, with the
+  // entries to restore when leaving a block.
+  map<Computation, Holder> computations;
+  vector<pair<Computation, Holder>> undo;
+
+  // Version of each original register reaching the current point, and the
+  // block writing each version.
+  vector<vector<int>> current;
+  vector<int> writers;
+
+  int number_of(const IR_Operand &operand);
+  bool is_available(const IR_Operand &holder, const Basic_Block *block) const;
+  void record(const Computation &computation, const Holder &holder);
+  void number_block(Basic_Block *block, vector<int> &written);
+};
+
+Numberer::Numberer(SSA_Form &ssa)
+    : ssa(ssa), function(ssa.get_function()), next(0),
+      numbers(function->vreg_types.size(), -1),
+      current(function->vreg_types.size()),
+      writers(function->vreg_types.size(), -1) {}
+
+int Numberer::number_of(const IR_Operand &operand) {
+  if (operand.is_none()) {
+    return -1;
+  }
+  if (operand.is_immediate()) {
+    map<int, int>::const_iterator it = constants.find(operand.get_value());
+    if (it != constants.end()) {
+      return it->second;
+    }
+    return constants[operand.get_value()] = next++;
+  }
+  if (operand.is_vreg()) {
+    int &number = numbers[operand.get_value()];
+    if (number == -1) {
+      // Only the original registers read before being written get here.
+      number = next++;
+    }
+    return number;
+  }
+  // Memory may change between two reads.
+  return next++;
+}
+
+bool Numberer::is_available(const IR_Operand &holder,
+                            const Basic_Block *block) const {
+  // Without a phi where the writes of its original register merge, a
+  // version is only known to be there within its own block.
+  const int original = ssa.original_of(holder.get_value());
+  return !current[original].empty()
+      && current[original].back() == holder.get_value()
+      && (ssa.count_versions(original) == 1 || ssa.is_global(original)
+          || writers[holder.get_value()] == block->id);
+}
+
+void Numberer::record(const Computation &computation, const Holder &holder) {
+  map<Computation, Holder>::iterator it = computations.find(computation);
+  if (it == computations.end()) {
+    undo.push_back({computation, {-1, IR_Operand()}});
+    computations[computation] = holder;
+  } else {
+    undo.push_back(*it);
+    it->second = holder;
+  }
+}
+
+void Numberer::number_block(Basic_Block *block, vector<int> &written) {
+  for (IR_Instruction &instruction : block->instructions) {
+    const IR_Operand &dst = instruction.dst;
+    if (instruction.opcode == IR_PHI) {
+      // The sources along back edges are not numbered yet.
+      int number = -2;
+      for (const pair<Basic_Block *, IR_Operand> &source :
+               instruction.sources) {
+        const int vreg = source.second.get_value();
+        const int other = ssa.original_of(vreg) == vreg
+            ? number_of(source.second) : numbers[vreg];
+        number = number == -2 || number == other ? other : -1;
+      }
+      numbers[dst.get_value()] = number < 0 ? next++ : number;
+    } else if (instruction.opcode == IR_MOVE && dst.is_vreg()) {
+      numbers[dst.get_value()] = number_of(instruction.src1);
+    } else if (computes_value(instruction) && dst.is_vreg()) {
+      int first = number_of(instruction.src1);
+      int second = number_of(instruction.src2);
+      if ((instruction.opcode == IR_ADD || instruction.opcode == IR_MUL)
+          && second < first) {
+        swap(first, second);
+      }
+      const Computation computation(instruction.opcode, first, second);
+      map<Computation, Holder>::const_iterator it =
+          computations.find(computation);
+      if (it == computations.end()) {
+        numbers[dst.get_value()] = next;
+        record(computation, {next++, dst});
+      } else if (is_available(it->second.second, block)) {
+        numbers[dst.get_value()] = it->second.first;
+        instruction = IR_Instruction(IR_MOVE, dst, it->second.second,
+                                     IR_Operand(), nullptr);
+      } else {
+        numbers[dst.get_value()] = it->second.first;
+        record(computation, {it->second.first, dst});
+      }
+    } else if (dst.is_vreg()) {
+      numbers[dst.get_value()] = next++;
+    }
+
+    if (dst.is_vreg()) {
+      const int original = ssa.original_of(dst.get_value());
+      current[original].push_back(dst.get_value());
+      writers[dst.get_value()] = block->id;
+      written.push_back(original);
+    }
+  }
+}
+
+void Numberer::run() {
+  // Blocks to enter, or to leave once the blocks they dominate are done,
+  // along with the size of the undo log on entry.
+  vector<pair<Basic_Block *, bool>> work = {{function->blocks.front(), false}};
+  vector<unsigned int> marks(function->blocks.size());
+  vector<vector<int>> written(function->blocks.size());
+  while (!work.empty()) {
+    Basic_Block *block = work.back().first;
+    const bool done = work.back().second;
+    work.pop_back();
+    if (done) {
+      while (undo.size() > marks[block->id]) {
+        if (undo.back().second.first == -1) {
+          computations.erase(undo.back().first);
+        } else {
+          computations[undo.back().first] = undo.back().second;
+        }
+        undo.pop_back();
+      }
+      for (const int original : written[block->id]) {
+        current[original].pop_back();
+      }
+      continue;
+    }
+
+    marks[block->id] = undo.size();
+    number_block(block, written[block->id]);
+    work.push_back({block, true});
+    const vector<Basic_Block *> &children = ssa.get_dominated(block);
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      work.push_back({*it, false});
+    }
+  }
+}
+
+}  // namespace
+
+void number_global_values(SSA_Form &ssa) {
+  Numberer numberer(ssa);
+  numberer.run();
+  ssa.get_function()->build_cfg();
+}
@@ -0,0 +1,26 @@
+// Global value numbering.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef GVN_H
+#define GVN_H
+
+#include "ssa.h"
+
+/* Removes the computations whose value is already held by a virtual
+   register on every path reaching them, across blocks.
+
+   The blocks are numbered along a walk of the dominator tree, so that the
+   computations of a block are known within every block it dominates, such
+   as the condition of an if statement within both branches and after
+   _if_done. Since each version is written once, it keeps its value number
+   wherever it is read: a copy shares the number of its source, and a phi
+   whose sources share a number takes it too. Reads of memory always get a
+   new number, as number_values() does for variables written in between.
+
+   A redundant computation becomes a copy of the version holding the value,
+   provided its original register still holds that version, which copy
+   propagation usually removes once the function leaves SSA form. */
+void number_global_values(SSA_Form &ssa);
+
+#endif
@@ -0,0 +1,251 @@
+// Implementation of procedure inlining.
+// @author Hieu Le
+// @version 12/28/2016
+
+#include "inlining.h"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Returns the number of instructions of a function, leaving out the return
+// closing a procedure.
+int size_of(const IR_Function *function) {
+  int size = 0;
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.opcode != IR_RETURN) {
+        ++size;
+      }
+    }
+  }
+  return size;
+}
+
+// Returns the number of loops around each block, indexed by block id. A
+// branch to a block that is not laid out later closes a loop spanning the
+// blocks in between.
+vector<int> loop_depths(const IR_Function *function) {
+  vector<int> depths(function->blocks.size(), 0);
+  for (const Basic_Block *block : function->blocks) {
+    if (block->instructions.empty()) {
+      continue;
+    }
+    const IR_Instruction &last = block->instructions.back();
+    if (last.is_branch() && last.target->id <= block->id) {
+      for (int id = last.target->id; id <= block->id; ++id) {
+        ++depths[id];
+      }
+    }
+  }
+  return depths;
+}
+
+// Decides whether to expand a call, and tells why.
+bool should_inline(const int size, const int depth, const int calls,
+                   const int growth, const int budget, string &reason) {
+  if (calls == 1) {
+    reason = "only call";
+    return true;
+  }
+  if (size > INLINE_SIZE_LIMIT
+      && (depth == 0 || size > INLINE_LOOP_SIZE_LIMIT)) {
+    reason = "too large";
+    return false;
+  }
+  if (growth + size - 1 > budget) {
+    reason = "over growth budget";
+    return false;
+  }
+  reason = size <= INLINE_SIZE_LIMIT ? "small" : "in loop";
+  return true;
+}
+
+// Counts the calls to each function made by the given one.
+void count_calls(const IR_Function *function, vector<int> &calls) {
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.opcode == IR_CALL) {
+        ++calls[instruction.src1.get_value()];
+      }
+    }
+  }
+}
+
+// Copies the body of a procedure into the caller, at the end of the block
+// current, with the blocks of the copy appended to the caller. The
+// parameters passed by the call become moves to the copies of the formal
+// parameters. Returns the block where the caller goes on.
+Basic_Block *expand(IR_Program *program, IR_Function *caller,
+                    const IR_Function *callee,
+                    const vector<pair<Basic_Block *, int>> &params,
+                    Basic_Block *current) {
+  const string prefix = program->new_label("inline");
+
+  // Fresh storage for the variables and temporaries of the procedure. Data
+  // labels start with a letter, unlike the labels of code.
+  vector<int> variables;
+  for (const IR_Variable &variable : callee->variables) {
+    variables.push_back(caller->add_temporary(
+        prefix.substr(1) + "_" + variable.name, variable.type));
+  }
+  vector<int> vregs;
+  for (const expr_type type : callee->vreg_types) {
+    vregs.push_back(caller->new_vreg(type).get_value());
+  }
+  auto remap = [&](IR_Operand &operand) {
+    if (operand.is_variable()) {
+      operand = IR_Operand(IR_VARIABLE, variables[operand.get_value()]);
+    } else if (operand.is_vreg()) {
+      operand = IR_Operand(IR_VREG, vregs[operand.get_value()]);
+    }
+  };
+
+  // Bind the formal parameters to the actual ones.
+  for (const pair<Basic_Block *, int> &param : params) {
+    IR_Instruction &instruction = param.first->instructions[param.second];
+    const IR_Operand formal(IR_VARIABLE,
+                            variables[instruction.src2.get_value()]);
+    instruction = IR_Instruction(IR_MOVE, formal, instruction.src1,
+                                 IR_Operand(), nullptr);
+  }
+
+  // The entry block of the procedure continues the current block.
+  unordered_map<const Basic_Block *, Basic_Block *> copies;
+  copies[callee->blocks.front()] = current;
+  for (unsigned int i = 1; i < callee->blocks.size(); ++i) {
+    const string &label = callee->blocks[i]->label;
+    copies[callee->blocks[i]] =
+        new Basic_Block(label.empty() ? label : prefix + label);
+  }
+
+  Basic_Block *done = new Basic_Block(prefix + "_return");
+  bool returns_to_done = false;
+  for (unsigned int i = 0; i < callee->blocks.size(); ++i) {
+    const Basic_Block *block = callee->blocks[i];
+    Basic_Block *copy = copies[block];
+    if (i > 0) {
+      caller->blocks.push_back(copy);
+    }
+    for (unsigned int k = 0; k < block->instructions.size(); ++k) {
+      IR_Instruction instruction = block->instructions[k];
+      if (instruction.opcode == IR_RETURN) {
+        // The return closing the procedure falls through to the caller.
+        if (i + 1 == callee->blocks.size()
+            && k + 1 == block->instructions.size()) {
+          continue;
+        }
+        instruction = IR_Instruction(IR_BRUN, IR_Operand(), IR_Operand(),
+                                     IR_Operand(), done);
+        returns_to_done = true;
+      }
+      remap(instruction.dst);
+      remap(instruction.src1);
+      remap(instruction.src2);
+      if (instruction.target != nullptr && instruction.target != done) {
+        instruction.target = copies[instruction.target];
+      }
+      copy->instructions.push_back(instruction);
+    }
+  }
+
+  Basic_Block *last = copies[callee->blocks.back()];
+  if (returns_to_done || (!last->instructions.empty()
+                          && last->instructions.back().ends_control_flow())) {
+    caller->blocks.push_back(done);
+    return done;
+  }
+  delete done;
+  return last;
+}
+
+}  // namespace
+
+void inline_procedures(IR_Program *program, ostream *log) {
+  vector<IR_Function *> &functions = program->functions;
+  const int n_functions = functions.size();
+  vector<int> calls(n_functions, 0);
+  vector<int> sizes(n_functions);
+  for (int f = 0; f < n_functions; ++f) {
+    sizes[f] = size_of(functions[f]);
+    count_calls(functions[f], calls);
+  }
+
+  for (IR_Function *caller : functions) {
+    caller->build_cfg();
+    const vector<int> depths = loop_depths(caller);
+    const int budget =
+        size_of(caller) * INLINE_GROWTH_PERCENT / 100 + INLINE_SIZE_LIMIT;
+    int growth = 0;
+
+    // Rebuild the layout of the caller, splicing in the expansions. The
+    // parameters of a call are the ones passed since the previous call.
+    const vector<Basic_Block *> blocks = caller->blocks;
+    caller->blocks.clear();
+    vector<pair<Basic_Block *, int>> params;
+    for (Basic_Block *block : blocks) {
+      caller->blocks.push_back(block);
+      Basic_Block *current = block;
+      vector<IR_Instruction> code;
+      code.swap(block->instructions);
+      for (const IR_Instruction &instruction : code) {
+        if (instruction.opcode == IR_PARAM) {
+          params.push_back({current, current->instructions.size()});
+        } else if (instruction.opcode == IR_CALL) {
+          const int callee = instruction.src1.get_value();
+          string reason;
+          const bool expanded =
+              should_inline(sizes[callee], depths[block->id], calls[callee],
+                            growth, budget, reason);
+          if (log != nullptr) {
+            *log << caller->name << ": call to " << functions[callee]->name
+                 << " (size " << sizes[callee] << ", loop depth "
+                 << depths[block->id] << ") "
+                 << (expanded ? "inlined" : "kept") << ", " << reason << endl;
+          }
+          if (expanded) {
+            current = expand(program, caller, functions[callee], params,
+                             current);
+            if (calls[callee] > 1) {
+              growth += sizes[callee] - 1;
+            }
+            --calls[callee];
+            params.clear();
+            continue;
+          }
+          params.clear();
+        }
+        current->instructions.push_back(instruction);
+      }
+    }
+  }
+
+  // Remove the procedures nobody calls, and renumber the calls left.
+  vector<int> renumbered(n_functions, -1);
+  vector<IR_Function *> kept;
+  for (int f = 0; f < n_functions; ++f) {
+    if (f == 0 || calls[f] > 0) {
+      renumbered[f] = kept.size();
+      kept.push_back(functions[f]);
+    } else {
+      if (log != nullptr) {
+        *log << functions[f]->name << ": removed, no calls left" << endl;
+      }
+      delete functions[f];
+    }
+  }
+  functions = kept;
+  for (IR_Function *function : functions) {
+    for (Basic_Block *block : function->blocks) {
+      for (IR_Instruction &instruction : block->instructions) {
+        if (instruction.opcode == IR_CALL) {
+          const int callee = renumbered[instruction.src1.get_value()];
+          instruction.src1 = IR_Operand(IR_IMMEDIATE, callee);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,40 @@
+// Inline expansion of procedure calls.
+// @author Hieu Le
+// @version 12/28/2016
+
+#ifndef INLINING_H
+#define INLINING_H
+
+#include <iostream>
+
+#include "ir.h"
+
+using namespace std;
+
+// Limits of the cost model, in IR instructions. A procedure is expanded
+// wherever it is called when it is at most INLINE_SIZE_LIMIT long, and
+// inside loops when it is at most INLINE_LOOP_SIZE_LIMIT long.
+const int INLINE_SIZE_LIMIT = 16;
+const int INLINE_LOOP_SIZE_LIMIT = 64;
+
+// Expansions may make a function grow by this percentage of its size, plus
+// INLINE_SIZE_LIMIT instructions.
+const int INLINE_GROWTH_PERCENT = 100;
+
+/* Replaces calls to small procedures by a copy of their body. The copy gets
+   fresh variables and virtual registers in the caller, the actual
+   parameters are moved to the copies of the formal parameters, and the
+   return branches to the code following the call.
+
+   The size of a procedure is its number of IR instructions. A procedure
+   called only once is always expanded, since the copy replaces its only
+   use. Other calls are expanded within the limits above, as long as the
+   caller stays within its growth budget. Loops are found from the back
+   edges of the layout, which the parser keeps contiguous. Procedures cannot
+   call procedures, so the copies make no calls.
+
+   Procedures left without calls are removed from the program. If log is
+   not nullptr, the decision taken at each call is written to it. */
+void inline_procedures(IR_Program *program, ostream *log);
+
+#endif
@@ -0,0 +1,428 @@
+// Implementation of the IR classes.
+// @author Hieu Le
+// @version 12/20/2016
+
+#include "ir.h"
+
+#include <sstream>
+
+#include "stats.h"
+
+IR_Operand::IR_Operand() : kind(IR_NONE), value(0) {}
+
+IR_Operand::IR_Operand(const ir_operand_kind_type the_kind, const int the_value)
+    : kind(the_kind), value(the_value) {}
+
+ir_operand_kind_type IR_Operand::get_kind() const {
+  return kind;
+}
+
+int IR_Operand::get_value() const {
+  return value;
+}
+
+bool IR_Operand::is_none() const {
+  return kind == IR_NONE;
+}
+
+bool IR_Operand::is_immediate() const {
+  return kind == IR_IMMEDIATE;
+}
+
+bool IR_Operand::is_vreg() const {
+  return kind == IR_VREG;
+}
+
+bool IR_Operand::is_variable() const {
+  return kind == IR_VARIABLE;
+}
+
+bool IR_Operand::operator==(const IR_Operand &other) const {
+  return kind == other.kind && (kind == IR_NONE || value == other.value);
+}
+
+bool IR_Operand::operator!=(const IR_Operand &other) const {
+  return !(*this == other);
+}
+
+IR_Instruction::IR_Instruction(const ir_opcode_type the_opcode,
+                               const IR_Operand &the_dst,
+                               const IR_Operand &the_src1,
+                               const IR_Operand &the_src2,
+                               Basic_Block *the_target)
+    : opcode(the_opcode), dst(the_dst), src1(the_src1), src2(the_src2),
+      target(the_target), comment(nullptr) {}
+
+bool IR_Instruction::is_branch() const {
+  return opcode == IR_BRUN || is_conditional_branch();
+}
+
+bool IR_Instruction::is_conditional_branch() const {
+  return opcode == IR_BREZ || opcode == IR_BRPO || opcode == IR_BRNE;
+}
+
+bool IR_Instruction::ends_control_flow() const {
+  return opcode == IR_BRUN || opcode == IR_HALT || opcode == IR_RETURN;
+}
+
+bool IR_Instruction::may_fail() const {
+  return opcode == IR_DIV
+      && !(src2.is_immediate() && src2.get_value() != 0);
+}
+
+Basic_Block::Basic_Block(const string &the_label) : label(the_label), id(-1) {}
+
+IR_Function::IR_Function(const string &the_name) : name(the_name) {
+  // The entry block.
+  blocks.push_back(new Basic_Block(""));
+}
+
+IR_Function::~IR_Function() {
+  for (Basic_Block *block : blocks) {
+    delete block;
+  }
+}
+
+int IR_Function::add_variable(const string &variable_name,
+                              const expr_type type) {
+  variable_index[variable_name] = variables.size();
+  variables.push_back({variable_name, type, false});
+  return variables.size() - 1;
+}
+
+int IR_Function::add_temporary(const string &variable_name,
+                               const expr_type type) {
+  const int index = add_variable(variable_name, type);
+  variables[index].temporary = true;
+  return index;
+}
+
+int IR_Function::find_variable(const string &variable_name) const {
+  unordered_map<string, int>::const_iterator it =
+      variable_index.find(variable_name);
+  return it == variable_index.end() ? -1 : it->second;
+}
+
+void IR_Function::remove_variables(const vector<bool> &removed) {
+  vector<int> renumbered(variables.size(), -1);
+  vector<IR_Variable> kept;
+  variable_index.clear();
+  for (unsigned int i = 0; i < variables.size(); ++i) {
+    if (!removed[i]) {
+      renumbered[i] = kept.size();
+      variable_index[variables[i].name] = kept.size();
+      kept.push_back(variables[i]);
+    }
+  }
+  variables = kept;
+
+  for (Basic_Block *block : blocks) {
+    for (IR_Instruction &instruction : block->instructions) {
+      for (IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_variable()) {
+          *operand = IR_Operand(IR_VARIABLE,
+                                renumbered[operand->get_value()]);
+        }
+      }
+    }
+  }
+  for (int &variable : promoted_from) {
+    if (variable != -1) {
+      variable = renumbered[variable];
+    }
+  }
+}
+
+IR_Operand IR_Function::new_vreg(const expr_type type) {
+  vreg_types.push_back(type);
+  promoted_from.push_back(-1);
+  return IR_Operand(IR_VREG, vreg_types.size() - 1);
+}
+
+void IR_Function::build_cfg() {
+  for (unsigned int i = 0; i < blocks.size(); ++i) {
+    blocks[i]->id = i;
+    blocks[i]->successors.clear();
+    blocks[i]->predecessors.clear();
+  }
+
+  for (unsigned int i = 0; i < blocks.size(); ++i) {
+    Basic_Block *block = blocks[i];
+    bool falls_through = true;
+    if (!block->instructions.empty()) {
+      const IR_Instruction &last = block->instructions.back();
+      if (last.is_branch()) {
+        block->successors.push_back(last.target);
+      }
+      falls_through = !last.ends_control_flow();
+    }
+    if (falls_through && i + 1 < blocks.size()
+        && (block->successors.empty()
+            || block->successors[0] != blocks[i + 1])) {
+      block->successors.push_back(blocks[i + 1]);
+    }
+    for (Basic_Block *successor : block->successors) {
+      successor->predecessors.push_back(block);
+    }
+  }
+}
+
+string IR_Function::to_string(const IR_Operand &operand) const {
+  stringstream out;
+  switch (operand.get_kind()) {
+    case IR_IMMEDIATE:
+      out << "#" << operand.get_value();
+      break;
+
+    case IR_VREG:
+      out << "v" << operand.get_value();
+      break;
+
+    case IR_VARIABLE:
+      out << variables[operand.get_value()].name;
+      break;
+
+    default:
+      break;
+  }
+  return out.str();
+}
+
+namespace {
+
+// Returns the mnemonic of an IR operation.
+const char *mnemonic(const ir_opcode_type opcode) {
+  switch (opcode) {
+    case IR_MOVE: return "move";
+    case IR_ADD: return "add";
+    case IR_SUB: return "sub";
+    case IR_MUL: return "mul";
+    case IR_DIV: return "div";
+    case IR_NEG: return "neg";
+    case IR_NOT: return "not";
+    case IR_BRUN: return "brun";
+    case IR_BREZ: return "brez";
+    case IR_BRPO: return "brpo";
+    case IR_BRNE: return "brne";
+    case IR_OUTB: return "outb";
+    case IR_HALT: return "halt";
+    case IR_PARAM: return "param";
+    case IR_CALL: return "call";
+    case IR_RETURN: return "return";
+    case IR_PHI: return "phi";
+    default: return "garbage";
+  }
+}
+
+}  // namespace
+
+void IR_Function::print(ostream &out) const {
+  out << name << ":" << endl;
+  for (unsigned int i = 0; i < blocks.size(); ++i) {
+    const Basic_Block *block = blocks[i];
+    out << "  B" << i;
+    if (!block->label.empty()) {
+      out << " (" << block->label << ")";
+    }
+    out << ":";
+    if (!block->successors.empty()) {
+      out << "  ->";
+      for (const Basic_Block *successor : block->successors) {
+        out << " B" << successor->id;
+      }
+    }
+    out << endl;
+
+    for (const IR_Instruction &instruction : block->instructions) {
+      out << "\t";
+      if (!instruction.dst.is_none()) {
+        out << to_string(instruction.dst) << " := ";
+      }
+      out << mnemonic(instruction.opcode);
+      if (!instruction.src1.is_none()) {
+        out << " " << to_string(instruction.src1);
+      }
+      if (!instruction.src2.is_none()) {
+        out << ", " << to_string(instruction.src2);
+      }
+      if (instruction.target != nullptr) {
+        out << (instruction.src1.is_none() ? " " : ", ")
+            << instruction.target->label;
+      }
+      for (unsigned int j = 0; j < instruction.sources.size(); ++j) {
+        out << (j == 0 ? " " : ", ") << "[B"
+            << instruction.sources[j].first->id << ": "
+            << to_string(instruction.sources[j].second) << "]";
+      }
+      out << endl;
+    }
+  }
+}
+
+IR_Program::IR_Program() : label_num(0) {}
+
+IR_Program::~IR_Program() {
+  for (IR_Function *function : functions) {
+    delete function;
+  }
+}
+
+string IR_Program::new_label(const char prefix[]) {
+  stringstream label;
+  label << "_" << prefix << label_num;
+  ++label_num;
+  ++counters.labels;
+  return label.str();
+}
+
+void IR_Program::print(ostream &out) const {
+  for (const IR_Function *function : functions) {
+    function->print(out);
+  }
+}
+
+IR_Builder::IR_Builder(IR_Function *the_function)
+    : function(the_function), current(the_function->blocks.back()),
+      pending_comment(nullptr) {}
+
+Basic_Block *IR_Builder::new_block(const string &label) const {
+  return new Basic_Block(label);
+}
+
+void IR_Builder::emit_label(Basic_Block *block) {
+  function->blocks.push_back(block);
+  current = block;
+}
+
+void IR_Builder::emit_move(const IR_Operand &dst, const IR_Operand &src) {
+  append(IR_Instruction(IR_MOVE, dst, src, IR_Operand(), nullptr));
+}
+
+void IR_Builder::emit_3addr(const ir_opcode_type opcode, const IR_Operand &dst,
+                            const IR_Operand &src1, const IR_Operand &src2) {
+  append(IR_Instruction(opcode, dst, src1, src2, nullptr));
+}
+
+void IR_Builder::emit_2addr(const ir_opcode_type opcode, const IR_Operand &dst,
+                            const IR_Operand &src) {
+  append(IR_Instruction(opcode, dst, src, IR_Operand(), nullptr));
+}
+
+void IR_Builder::emit_1addr(const ir_opcode_type opcode,
+                            const IR_Operand &src) {
+  append(IR_Instruction(opcode, IR_Operand(), src, IR_Operand(), nullptr));
+}
+
+void IR_Builder::emit_branch(Basic_Block *target) {
+  append(IR_Instruction(IR_BRUN, IR_Operand(), IR_Operand(), IR_Operand(),
+                        target));
+}
+
+void IR_Builder::emit_branch(const ir_opcode_type opcode,
+                             const IR_Operand &condition,
+                             Basic_Block *target) {
+  append(IR_Instruction(opcode, IR_Operand(), condition, IR_Operand(),
+                        target));
+}
+
+void IR_Builder::emit_halt() {
+  append(IR_Instruction(IR_HALT, IR_Operand(), IR_Operand(), IR_Operand(),
+                        nullptr));
+}
+
+void IR_Builder::emit_param(const int position, const IR_Operand &value) {
+  append(IR_Instruction(IR_PARAM, IR_Operand(), value,
+                        IR_Operand(IR_IMMEDIATE, position), nullptr));
+}
+
+void IR_Builder::emit_call(const int function_index) {
+  append(IR_Instruction(IR_CALL, IR_Operand(),
+                        IR_Operand(IR_IMMEDIATE, function_index), IR_Operand(),
+                        nullptr));
+}
+
+void IR_Builder::emit_return() {
+  append(IR_Instruction(IR_RETURN, IR_Operand(), IR_Operand(), IR_Operand(),
+                        nullptr));
+}
+
+void IR_Builder::emit_comment(const char comment[]) {
+  pending_comment = comment;
+}
+
+bool IR_Builder::undo_2addr(const ir_opcode_type opcode,
+                            const IR_Operand &dst, IR_Operand *src) {
+  if (current == nullptr || current->instructions.empty()) {
+    return false;
+  }
+  const IR_Instruction &last = current->instructions.back();
+  if (last.opcode != opcode || !(last.dst == dst)) {
+    return false;
+  }
+  *src = last.src1;
+  current->instructions.pop_back();
+  return true;
+}
+
+IR_Builder::Mark IR_Builder::mark() const {
+  Mark mark;
+  mark.blocks = function->blocks.size();
+  mark.instructions = current == nullptr ? 0 : current->instructions.size();
+  mark.current = current;
+  mark.pending_comment = pending_comment;
+  return mark;
+}
+
+void IR_Builder::rollback(const Mark &mark) {
+  while (function->blocks.size() > mark.blocks) {
+    delete function->blocks.back();
+    function->blocks.pop_back();
+  }
+  current = mark.current;
+  if (current != nullptr) {
+    current->instructions.erase(
+        current->instructions.begin() + mark.instructions,
+        current->instructions.end());
+  }
+  pending_comment = mark.pending_comment;
+}
+
+bool IR_Builder::may_fail_since(const Mark &mark) const {
+  if (mark.current != nullptr) {
+    const vector<IR_Instruction> &code = mark.current->instructions;
+    for (unsigned int i = mark.instructions; i < code.size(); ++i) {
+      if (code[i].may_fail()) {
+        return true;
+      }
+    }
+  }
+  for (unsigned int i = mark.blocks; i < function->blocks.size(); ++i) {
+    for (const IR_Instruction &instruction :
+             function->blocks[i]->instructions) {
+      if (instruction.may_fail()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+IR_Function *IR_Builder::get_function() const {
+  return function;
+}
+
+void IR_Builder::append(const IR_Instruction &instruction) {
+  // Code following a branch starts a new block that is only reached by
+  // falling through.
+  if (current == nullptr) {
+    current = new_block("");
+    function->blocks.push_back(current);
+  }
+  current->instructions.push_back(instruction);
+  current->instructions.back().comment = pending_comment;
+  pending_comment = nullptr;
+  if (instruction.is_branch() || instruction.ends_control_flow()) {
+    current = nullptr;
+  }
+}
@@ -0,0 +1,320 @@
+// Typed three-address intermediate representation (IR) of TruPL programs.
+// The parser lowers each program into this form and the code generator
+// translates it to TrAL.
+// @author Hieu Le
+// @version 12/20/2016
+
+#ifndef IR_H
+#define IR_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// For the types of variables and virtual registers.
+#include "symbol_table.h"
+
+using namespace std;
+
+/* IR operations. Each of them mirrors the TrAL instruction with the
+   same name, except that arithmetic takes two source operands and a
+   separate destination:
+
+     IR_MOVE   dst := src1
+     IR_ADD    dst := src1 + src2  (likewise IR_SUB, IR_MUL, IR_DIV)
+     IR_NEG    dst := -src1
+     IR_NOT    dst := not src1
+     IR_BRUN   goto target
+     IR_BREZ   if src1 = 0 goto target
+     IR_BRPO   if src1 > 0 goto target
+     IR_BRNE   if src1 < 0 goto target
+     IR_OUTB   print src1
+     IR_HALT   stop the program
+
+   Procedures add three operations of their own:
+
+     IR_PARAM  formal parameter src2 of the next call := src1
+     IR_CALL   call the function numbered src1 in the program
+     IR_RETURN return from the procedure
+
+   Functions in static single assignment form (see ssa.h) also have
+
+     IR_PHI    dst := the source coming from the predecessor executed last
+*/
+typedef enum ir_opcode { IR_MOVE = 1000,
+                         IR_ADD  = 1001,
+                         IR_SUB  = 1002,
+                         IR_MUL  = 1003,
+                         IR_DIV  = 1004,
+                         IR_NEG  = 1005,
+                         IR_NOT  = 1006,
+                         IR_BRUN = 1007,
+                         IR_BREZ = 1008,
+                         IR_BRPO = 1009,
+                         IR_BRNE = 1010,
+                         IR_OUTB = 1011,
+                         IR_HALT = 1012,
+                         IR_PARAM = 1013,
+                         IR_CALL = 1014,
+                         IR_RETURN = 1015,
+                         IR_PHI = 1016,
+                         IR_GARBAGE = 1099 } ir_opcode_type;
+
+// Kinds of IR operands.
+typedef enum ir_operand_kind { IR_NONE      = 1100,  // No operand.
+                               IR_IMMEDIATE = 1101,  // Integer constant.
+                               IR_VREG      = 1102,  // Virtual register.
+                               IR_VARIABLE  = 1103   // Variable in memory.
+                             } ir_operand_kind_type;
+
+// An operand of an IR instruction. Its value is the constant of an
+// immediate, the number of a virtual register, or the index of a variable in
+// the enclosing IR_Function.
+class IR_Operand {
+ public:
+  // Constructs an absent operand.
+  IR_Operand();
+  IR_Operand(const ir_operand_kind_type kind, const int value);
+
+  ir_operand_kind_type get_kind() const;
+
+  int get_value() const;
+
+  bool is_none() const;
+  bool is_immediate() const;
+  bool is_vreg() const;
+  bool is_variable() const;
+
+  bool operator==(const IR_Operand &other) const;
+  bool operator!=(const IR_Operand &other) const;
+
+ private:
+  ir_operand_kind_type kind;
+  int value;
+};
+
+struct Basic_Block;
+
+// A single three-address instruction.
+struct IR_Instruction {
+  IR_Instruction(const ir_opcode_type opcode, const IR_Operand &dst,
+                 const IR_Operand &src1, const IR_Operand &src2,
+                 Basic_Block *target);
+
+  // Checks if this instruction transfers control to its target.
+  bool is_branch() const;
+
+  // Checks if this is one of brez, brpo or brne.
+  bool is_conditional_branch() const;
+
+  // Checks if control never reaches the following instruction.
+  bool ends_control_flow() const;
+
+  // Checks if this instruction may stop the program: a division whose
+  // divisor is not a nonzero constant.
+  bool may_fail() const;
+
+  ir_opcode_type opcode;
+  IR_Operand dst;
+  IR_Operand src1;
+  IR_Operand src2;
+  // Destination of a branch; nullptr for other instructions.
+  Basic_Block *target;
+  // Comment emitted along with the target code, or nullptr.
+  const char *comment;
+  // Sources of an IR_PHI, each along with the predecessor it comes from.
+  vector<pair<Basic_Block *, IR_Operand>> sources;
+};
+
+/* A maximal sequence of instructions entered only at the top. Branches
+   only appear as the last instruction of a block. When the last
+   instruction does not end the control flow, execution falls through to
+   the next block of the function. */
+struct Basic_Block {
+  // A block with an empty label is only reached by falling through.
+  explicit Basic_Block(const string &label);
+
+  string label;
+  vector<IR_Instruction> instructions;
+
+  // Control flow graph, filled in by IR_Function::build_cfg().
+  int id;
+  vector<Basic_Block *> successors;
+  vector<Basic_Block *> predecessors;
+};
+
+// A variable stored in memory.
+struct IR_Variable {
+  string name;
+  expr_type type;
+
+  // Whether the variable only holds intermediate values, such as the copy
+  // of a formal parameter of an inlined procedure, so that its value need
+  // not be left in memory when the program halts.
+  bool temporary;
+};
+
+// The IR of the main program or of a single procedure.
+class IR_Function {
+ public:
+  explicit IR_Function(const string &name);
+  ~IR_Function();
+
+  // Adds a variable to the function and returns its index.
+  int add_variable(const string &variable_name, const expr_type type);
+
+  // Adds a temporary variable to the function and returns its index.
+  int add_temporary(const string &variable_name, const expr_type type);
+
+  // Returns the index of the named variable, or -1 if there is none.
+  int find_variable(const string &variable_name) const;
+
+  // Removes the variables flagged in removed, which no instruction may refer
+  // to, and renumbers the others.
+  void remove_variables(const vector<bool> &removed);
+
+  // Creates a fresh virtual register holding a value of the given type.
+  IR_Operand new_vreg(const expr_type type);
+
+  // Numbers the blocks in layout order and recomputes their successors and
+  // predecessors.
+  void build_cfg();
+
+  // Writes a human readable listing of the function.
+  void print(ostream &out) const;
+
+  // Returns the printed form of an operand.
+  string to_string(const IR_Operand &operand) const;
+
+  // Name of the program or procedure.
+  string name;
+
+  // Basic blocks in layout order. The first one is the entry block. The
+  // function owns its blocks.
+  vector<Basic_Block *> blocks;
+
+  vector<IR_Variable> variables;
+
+  // Type of each virtual register, indexed by register number.
+  vector<expr_type> vreg_types;
+
+  // Index of the variable each virtual register stands for, or -1 for
+  // temporaries. The memory of that variable holds the virtual register
+  // whenever it does not sit in a register.
+  vector<int> promoted_from;
+
+ private:
+  // Index of each variable by name.
+  unordered_map<string, int> variable_index;
+};
+
+// The IR of a whole program.
+class IR_Program {
+ public:
+  IR_Program();
+  ~IR_Program();
+
+  // Generates a new, unique label of the form "_prefixn".
+  string new_label(const char prefix[]);
+
+  // Writes a human readable listing of every function.
+  void print(ostream &out) const;
+
+  // The main program followed by the procedures in declaration order. The
+  // program owns its functions.
+  vector<IR_Function *> functions;
+
+ private:
+  // The next unique number used to generate labels.
+  unsigned int label_num;
+};
+
+// Appends instructions to the end of an IR_Function. The interface follows
+// the one of Emitter.
+class IR_Builder {
+ public:
+  explicit IR_Builder(IR_Function *function);
+
+  // Creates a block to be placed later by emit_label().
+  Basic_Block *new_block(const string &label) const;
+
+  // Places a block at the end of the function. Following instructions are
+  // appended to it.
+  void emit_label(Basic_Block *block);
+
+  // dst := src
+  void emit_move(const IR_Operand &dst, const IR_Operand &src);
+
+  // dst := src1 op src2
+  void emit_3addr(const ir_opcode_type opcode, const IR_Operand &dst,
+                  const IR_Operand &src1, const IR_Operand &src2);
+
+  // dst := op src
+  void emit_2addr(const ir_opcode_type opcode, const IR_Operand &dst,
+                  const IR_Operand &src);
+
+  // For outb.
+  void emit_1addr(const ir_opcode_type opcode, const IR_Operand &src);
+
+  // For brun.
+  void emit_branch(Basic_Block *target);
+
+  // For the conditional branches.
+  void emit_branch(const ir_opcode_type opcode, const IR_Operand &condition,
+                   Basic_Block *target);
+
+  void emit_halt();
+
+  // Passes a value as the formal parameter at a given position of the next
+  // call.
+  void emit_param(const int position, const IR_Operand &value);
+
+  // Calls the function with the given index in the program.
+  void emit_call(const int function_index);
+
+  void emit_return();
+
+  // Attaches a comment to the next instruction.
+  void emit_comment(const char comment[]);
+
+  // Removes the last instruction if it is "dst := op src" with the given
+  // opcode and destination, and returns its source. Used to cancel out an
+  // operation applied twice.
+  bool undo_2addr(const ir_opcode_type opcode, const IR_Operand &dst,
+                  IR_Operand *src);
+
+  // A point in the code emitted so far.
+  struct Mark {
+    unsigned int blocks;
+    unsigned int instructions;
+    Basic_Block *current;
+    const char *pending_comment;
+  };
+
+  Mark mark() const;
+
+  // Drops the instructions and the blocks emitted since a mark, for code
+  // whose result turns out to be unused.
+  void rollback(const Mark &mark);
+
+  // Checks if any instruction emitted since a mark may stop the program,
+  // in which case it must run even if its result is unused.
+  bool may_fail_since(const Mark &mark) const;
+
+  IR_Function *get_function() const;
+
+ private:
+  IR_Function *function;
+
+  // Block receiving new instructions, or nullptr after a branch.
+  Basic_Block *current;
+
+  // Comment for the next instruction, or nullptr.
+  const char *pending_comment;
+
+  void append(const IR_Instruction &instruction);
+};
+
+#endif
@@ -0,0 +1,591 @@
+// Implementation of the JIT class.
+// @author Hieu Le
+// @version 12/26/2016
+
+#include "jit.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define JIT_SUPPORTED 1
+#endif
+
+namespace {
+
+// x86-64 registers.
+const int RAX = 0;
+const int RCX = 1;
+const int RBX = 3;
+const int RBP = 5;
+const int RSI = 6;
+const int RDI = 7;
+
+// Condition codes of jcc.
+const int CC_BELOW = 0x2;
+const int CC_AE = 0x3;
+const int CC_EQUAL = 0x4;
+const int CC_NOT_EQUAL = 0x5;
+const int CC_LESS = 0xC;
+const int CC_GE = 0xD;
+const int CC_LE = 0xE;
+const int CC_GREATER = 0xF;
+
+// Opcodes of "op r/m32, r32".
+const int OP_ADD = 0x01;
+const int OP_SUB = 0x29;
+const int OP_MOVE = 0x89;
+
+/* Layout of the generated code:
+
+     prologue     saves callee-saved registers and loads the context:
+                  rbx points to memory, rbp holds the step budget and
+                  r12d to r15d hold R0 to R3
+     word 0 ...   each word first charges one step to rbp
+     stubs        exits raising each simulation status
+     epilogue     stores the context back and returns the status
+
+   A word of data executes as an unknown instruction. Calls to the outb
+   routine keep rsp 16-byte aligned and [rsp] holds the context. */
+
+// Prints a value for outb.
+void print_value(JIT_Context *context, const int value) {
+  *context->out << value << '\n';
+}
+
+}  // namespace
+
+JIT::JIT(const Simulator *the_program)
+    : program(the_program), buffer(nullptr), buffer_size(0),
+      instruction_count(0) {}
+
+JIT::~JIT() {
+#ifdef JIT_SUPPORTED
+  if (buffer != nullptr) {
+    munmap(buffer, buffer_size);
+  }
+#endif
+}
+
+bool JIT::is_supported() {
+#ifdef JIT_SUPPORTED
+  return true;
+#else
+  return false;
+#endif
+}
+
+int JIT::host_register(const int reg) {
+  // r12d to r15d survive calls to the outb routine.
+  return 12 + reg;
+}
+
+int JIT::new_label() {
+  label_offsets.push_back(-1);
+  return label_offsets.size() - 1;
+}
+
+void JIT::bind(const int label) {
+  label_offsets[label] = code.size();
+}
+
+void JIT::emit8(const int byte) {
+  code.push_back(static_cast<unsigned char>(byte));
+}
+
+void JIT::emit32(const int value) {
+  const unsigned int bits = static_cast<unsigned int>(value);
+  for (int i = 0; i < 4; ++i) {
+    emit8((bits >> (8 * i)) & 0xFF);
+  }
+}
+
+void JIT::emit64(const unsigned long long value) {
+  for (int i = 0; i < 8; ++i) {
+    emit8((value >> (8 * i)) & 0xFF);
+  }
+}
+
+void JIT::emit_rex(const bool wide, const int reg, const int rm) {
+  const int rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0)
+                  | ((rm & 8) ? 1 : 0);
+  if (rex != 0x40) {
+    emit8(rex);
+  }
+}
+
+void JIT::emit_modrm(const int reg, const int rm) {
+  emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void JIT::emit_label_displacement(const int label) {
+  fixups.push_back(make_pair(static_cast<int>(code.size()), label));
+  emit32(0);
+}
+
+void JIT::emit_jump(const int label) {
+  emit8(0xE9);
+  emit_label_displacement(label);
+}
+
+void JIT::emit_jump(const int condition, const int label) {
+  emit8(0x0F);
+  emit8(0x80 | condition);
+  emit_label_displacement(label);
+}
+
+void JIT::emit_move_immediate(const int reg, const int value) {
+  emit_rex(false, 0, reg);
+  emit8(0xB8 | (reg & 7));
+  emit32(value);
+}
+
+void JIT::emit_move_register(const int dst, const int src) {
+  emit_alu(OP_MOVE, dst, src);
+}
+
+void JIT::emit_alu(const int opcode, const int dst, const int src) {
+  emit_rex(false, src, dst);
+  emit8(opcode);
+  emit_modrm(src, dst);
+}
+
+void JIT::emit_test(const int reg) {
+  emit_rex(false, reg, reg);
+  emit8(0x85);
+  emit_modrm(reg, reg);
+}
+
+void JIT::emit_load(const int reg, const int address) {
+  // mov reg, [rbx + address * 4]
+  emit_rex(false, reg, RBX);
+  emit8(0x8B);
+  emit8(0x80 | ((reg & 7) << 3) | RBX);
+  emit32(address * 4);
+}
+
+void JIT::emit_store(const int address, const int reg) {
+  // mov [rbx + address * 4], reg
+  emit_rex(false, reg, RBX);
+  emit8(0x89);
+  emit8(0x80 | ((reg & 7) << 3) | RBX);
+  emit32(address * 4);
+}
+
+void JIT::emit_load_indexed(const int reg) {
+  // mov reg, [rbx + rax * 4]
+  emit_rex(false, reg, 0);
+  emit8(0x8B);
+  emit8(0x04 | ((reg & 7) << 3));
+  emit8(0x83);
+}
+
+void JIT::emit_store_indexed(const int reg) {
+  // mov [rbx + rax * 4], reg
+  emit_rex(false, reg, 0);
+  emit8(0x89);
+  emit8(0x04 | ((reg & 7) << 3));
+  emit8(0x83);
+}
+
+void JIT::emit_charge_step(const int step_limit) {
+  // sub rbp, 1 borrows once the budget is spent.
+  emit8(0x48);
+  emit8(0x83);
+  emit8(0xED);
+  emit8(0x01);
+  emit_jump(CC_BELOW, step_limit);
+}
+
+void JIT::emit_refund_step() {
+  // add rbp, 1
+  emit8(0x48);
+  emit8(0x83);
+  emit8(0xC5);
+  emit8(0x01);
+}
+
+void JIT::emit_address(const TrAL_Operand &operand, const int bad_address) {
+  emit_move_register(RAX, host_register(operand.reg));
+  if (operand.value != 0) {
+    // add eax, offset
+    emit8(0x05);
+    emit32(operand.value);
+  }
+  // Negative addresses compare above the size of memory.
+  emit8(0x3D);
+  emit32(memory.size());
+  emit_jump(CC_AE, bad_address);
+}
+
+void JIT::emit_operand(const TrAL_Operand &operand, const int reg,
+                       const int bad_address) {
+  switch (operand.mode) {
+    case MODE_IMMEDIATE:
+      emit_move_immediate(reg, operand.value);
+      break;
+
+    case MODE_REGISTER:
+      emit_move_register(reg, host_register(operand.reg));
+      break;
+
+    case MODE_MEMORY:
+      emit_load(reg, operand.value);
+      break;
+
+    default:
+      emit_address(operand, bad_address);
+      emit_load_indexed(reg);
+      break;
+  }
+}
+
+void JIT::emit_jump_to_register(const int reg, const int out_of_range) {
+  emit_move_register(RAX, reg);
+  emit8(0x3D);
+  emit32(targets.size());
+  emit_jump(CC_AE, out_of_range);
+  // mov rdx, targets; jmp [rdx + rax * 8]
+  emit8(0x48);
+  emit8(0xBA);
+  emit64(reinterpret_cast<unsigned long long>(targets.data()));
+  emit8(0xFF);
+  emit8(0x24);
+  emit8(0xC2);
+}
+
+bool JIT::compile() {
+#ifndef JIT_SUPPORTED
+  error = "machine code can only be generated on x86-64";
+  return false;
+#else
+  if (program->get_register_count() > 4) {
+    error = "only machines with 4 registers can be compiled";
+    return false;
+  }
+  if (buffer != nullptr) {
+    return true;
+  }
+
+  const vector<TrAL_Instruction> &words = program->get_code();
+  const int program_size = program->get_program_size();
+  const int size = words.size();
+  const int n_registers = program->get_register_count();
+  memory.assign(size, 0);
+  targets.assign(size, nullptr);
+  code.clear();
+  label_offsets.clear();
+  fixups.clear();
+
+  for (int i = 0; i < program_size; ++i) {
+    new_label();
+  }
+  const int step_limit = new_label();
+  const int garbage = new_label();
+  const int garbage_body = new_label();
+  const int end = new_label();
+  const int bad_address = new_label();
+  const int division_by_zero = new_label();
+  const int exit = new_label();
+
+  // Returns the label of the code for a word.
+  auto word_label = [&](const int address) {
+    if (address >= 0 && address < program_size) {
+      return address;
+    }
+    return address >= 0 && address < size ? garbage : end;
+  };
+
+  // Prologue: push rbx, rbp and r12 to r15, then align the stack and keep
+  // the context at [rsp].
+  emit8(0x53);
+  emit8(0x55);
+  for (int reg = 12; reg <= 15; ++reg) {
+    emit8(0x41);
+    emit8(0x50 | (reg & 7));
+  }
+  const int prologue[] = {0x48, 0x83, 0xEC, 0x08,   // sub rsp, 8
+                          0x48, 0x89, 0x3C, 0x24};  // mov [rsp], rdi
+  for (int byte : prologue) {
+    emit8(byte);
+  }
+  // mov rbx, [rdi + memory]; mov rbp, [rdi + budget]
+  emit8(0x48);
+  emit8(0x8B);
+  emit8(0x80 | (RBX << 3) | RDI);
+  emit32(offsetof(JIT_Context, memory));
+  emit8(0x48);
+  emit8(0x8B);
+  emit8(0x80 | (RBP << 3) | RDI);
+  emit32(offsetof(JIT_Context, budget));
+  for (int i = 0; i < n_registers; ++i) {
+    emit_rex(false, host_register(i), RDI);
+    emit8(0x8B);
+    emit8(0x80 | ((host_register(i) & 7) << 3) | RDI);
+    emit32(offsetof(JIT_Context, registers) + 4 * i);
+  }
+
+  for (int i = 0; i < program_size; ++i) {
+    const TrAL_Instruction &instruction = words[i];
+    const TrAL_Operand &first = instruction.operands[0];
+    const TrAL_Operand &second = instruction.operands[1];
+    const int reg = host_register(first.reg);
+    bind(i);
+    emit_charge_step(step_limit);
+
+    switch (instruction.opcode) {
+      case INST_MOVE:
+        if (first.mode == MODE_REGISTER) {
+          emit_operand(second, reg, bad_address);
+        } else if (first.mode == MODE_MEMORY) {
+          emit_store(first.value, host_register(second.reg));
+        } else {
+          emit_address(first, bad_address);
+          emit_store_indexed(host_register(second.reg));
+        }
+        break;
+
+      case INST_ADD:
+      case INST_SUB:
+      case INST_MUL: {
+        int src = RCX;
+        if (second.mode == MODE_REGISTER) {
+          src = host_register(second.reg);
+        } else {
+          emit_operand(second, RCX, bad_address);
+        }
+        if (instruction.opcode == INST_MUL) {
+          // imul reg, src
+          emit_rex(false, reg, src);
+          emit8(0x0F);
+          emit8(0xAF);
+          emit_modrm(reg, src);
+        } else {
+          emit_alu(instruction.opcode == INST_ADD ? OP_ADD : OP_SUB, reg,
+                   src);
+        }
+        break;
+      }
+
+      case INST_DIV: {
+        emit_operand(second, RCX, bad_address);
+        emit_test(RCX);
+        emit_jump(CC_EQUAL, division_by_zero);
+        // Dividing in 64 bits wraps -2^31 / -1 instead of trapping:
+        // movsxd rcx, ecx; movsxd rax, reg; cqo; idiv rcx; mov reg, eax
+        const int divide[] = {0x48, 0x63, 0xC9};
+        for (int byte : divide) {
+          emit8(byte);
+        }
+        emit_rex(true, RAX, reg);
+        emit8(0x63);
+        emit_modrm(RAX, reg);
+        const int quotient[] = {0x48, 0x99, 0x48, 0xF7, 0xF9};
+        for (int byte : quotient) {
+          emit8(byte);
+        }
+        emit_move_register(reg, RAX);
+        break;
+      }
+
+      case INST_NEG:
+        emit_rex(false, 0, reg);
+        emit8(0xF7);
+        emit_modrm(3, reg);
+        break;
+
+      case INST_NOT:
+        // test reg, reg; sete al; movzx reg, al
+        emit_test(reg);
+        emit8(0x0F);
+        emit8(0x94);
+        emit8(0xC0);
+        emit_rex(false, reg, RAX);
+        emit8(0x0F);
+        emit8(0xB6);
+        emit_modrm(reg, RAX);
+        break;
+
+      case INST_LEA:
+        emit_move_immediate(reg, second.value);
+        break;
+
+      case INST_BRUN:
+        if (first.mode == MODE_REGISTER) {
+          emit_jump_to_register(reg, end);
+        } else {
+          emit_jump(word_label(first.value));
+        }
+        break;
+
+      case INST_BREZ:
+      case INST_BRPO:
+      case INST_BRNE: {
+        const int taken = instruction.opcode == INST_BREZ ? CC_EQUAL
+            : instruction.opcode == INST_BRPO ? CC_GREATER : CC_LESS;
+        emit_test(reg);
+        if (second.mode == MODE_REGISTER) {
+          const int not_taken = instruction.opcode == INST_BREZ
+              ? CC_NOT_EQUAL
+              : instruction.opcode == INST_BRPO ? CC_LE : CC_GE;
+          const int next = new_label();
+          emit_jump(not_taken, next);
+          emit_jump_to_register(host_register(second.reg), end);
+          bind(next);
+        } else {
+          emit_jump(taken, word_label(second.value));
+        }
+        break;
+      }
+
+      case INST_OUTB: {
+        // mov rdi, [rsp]; mov esi, reg; mov rax, print_value; call rax
+        const int context_argument[] = {0x48, 0x8B, 0x3C, 0x24};
+        for (int byte : context_argument) {
+          emit8(byte);
+        }
+        emit_move_register(RSI, reg);
+        emit8(0x48);
+        emit8(0xB8);
+        emit64(reinterpret_cast<unsigned long long>(&print_value));
+        emit8(0xFF);
+        emit8(0xD0);
+        break;
+      }
+
+      case INST_HALT:
+        emit_move_immediate(RAX, SIM_HALTED);
+        emit_jump(exit);
+        break;
+
+      default:
+        emit_jump(garbage_body);
+        break;
+    }
+  }
+  emit_jump(word_label(program_size));
+
+  // A word that is not executed does not count as a step.
+  bind(step_limit);
+  emit_move_immediate(RAX, SIM_STEP_LIMIT);
+  emit_jump(exit);
+
+  bind(garbage);
+  emit_charge_step(step_limit);
+  bind(garbage_body);
+  emit_refund_step();
+  emit_move_immediate(RAX, SIM_UNKNOWN_INSTRUCTION);
+  emit_jump(exit);
+
+  bind(end);
+  emit_charge_step(step_limit);
+  emit_refund_step();
+  emit_move_immediate(RAX, SIM_BAD_ADDRESS);
+  emit_jump(exit);
+
+  bind(bad_address);
+  emit_move_immediate(RAX, SIM_BAD_ADDRESS);
+  emit_jump(exit);
+
+  bind(division_by_zero);
+  emit_move_immediate(RAX, SIM_DIVISION_BY_ZERO);
+
+  // Epilogue: store the registers and the budget back into the context.
+  bind(exit);
+  const int context_pointer[] = {0x48, 0x8B, 0x3C, 0x24};
+  for (int byte : context_pointer) {
+    emit8(byte);
+  }
+  for (int i = 0; i < n_registers; ++i) {
+    emit_rex(false, host_register(i), RDI);
+    emit8(0x89);
+    emit8(0x80 | ((host_register(i) & 7) << 3) | RDI);
+    emit32(offsetof(JIT_Context, registers) + 4 * i);
+  }
+  emit8(0x48);
+  emit8(0x89);
+  emit8(0x80 | (RBP << 3) | RDI);
+  emit32(offsetof(JIT_Context, budget));
+  const int epilogue[] = {0x48, 0x83, 0xC4, 0x08,  // add rsp, 8
+                          0x41, 0x5F, 0x41, 0x5E,  // pop r15; pop r14
+                          0x41, 0x5D, 0x41, 0x5C,  // pop r13; pop r12
+                          0x5D, 0x5B, 0xC3};       // pop rbp; pop rbx; ret
+  for (int byte : epilogue) {
+    emit8(byte);
+  }
+
+  for (const pair<int, int> &fixup : fixups) {
+    const int displacement = label_offsets[fixup.second] - (fixup.first + 4);
+    memcpy(&code[fixup.first], &displacement, 4);
+  }
+
+  buffer_size = code.size();
+  void *memory_map = mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory_map == MAP_FAILED) {
+    error = "cannot allocate executable memory";
+    return false;
+  }
+  memcpy(memory_map, code.data(), buffer_size);
+  if (mprotect(memory_map, buffer_size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory_map, buffer_size);
+    error = "cannot allocate executable memory";
+    return false;
+  }
+  buffer = memory_map;
+
+  const unsigned char *base = static_cast<const unsigned char *>(buffer);
+  for (int i = 0; i < size; ++i) {
+    targets[i] = base + label_offsets[word_label(i)];
+  }
+  code.clear();
+  return true;
+#endif
+}
+
+simulation_status_type JIT::run(ostream &out, long long max_steps) {
+  if (buffer == nullptr) {
+    return SIM_UNKNOWN_INSTRUCTION;
+  }
+  if (max_steps < 0) {
+    max_steps = 0;
+  }
+  memory.assign(memory.size(), 0);
+  context.memory = memory.data();
+  context.budget = max_steps;
+  for (int i = 0; i < 4; ++i) {
+    context.registers[i] = 0;
+  }
+  context.registers[program->get_register_count() - 1] =
+      program->get_program_size();
+  context.out = &out;
+
+  typedef int (*Entry)(JIT_Context *);
+  Entry entry = reinterpret_cast<Entry>(buffer);
+  simulation_status_type status =
+      static_cast<simulation_status_type>(entry(&context));
+  instruction_count =
+      status == SIM_STEP_LIMIT ? max_steps : max_steps - context.budget;
+  return status;
+}
+
+const string &JIT::get_error() const {
+  return error;
+}
+
+long long JIT::get_instruction_count() const {
+  return instruction_count;
+}
+
+int JIT::get_register(const int reg) const {
+  return context.registers[reg];
+}
+
+int JIT::get_memory(const string &label) const {
+  const int address = program->get_address(label);
+  if (address < 0 || address >= static_cast<int>(memory.size())) {
+    return 0;
+  }
+  return memory[address];
+}
@@ -0,0 +1,129 @@
+// JIT translates a loaded TrAL program to x86-64 machine code and runs it
+// in-process. The Simulator serves as its reference interpreter.
+// @author Hieu Le
+// @version 12/26/2016
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "simulator.h"
+
+using namespace std;
+
+// State shared between a run and the generated code.
+struct JIT_Context {
+  // Memory of the TruPro machine, one word per TrAL address.
+  int *memory;
+  // Instructions left before the step limit.
+  long long budget;
+  // R0 to R3, loaded into host registers on entry and stored back on exit.
+  int registers[4];
+  // Receives the values printed by outb.
+  ostream *out;
+};
+
+class JIT {
+ public:
+  // Constructs a JIT for the program loaded in a simulator. The simulator
+  // must outlive the JIT.
+  explicit JIT(const Simulator *program);
+  ~JIT();
+
+  // Checks if machine code can be generated on this host.
+  static bool is_supported();
+
+  // Translates the program into executable memory. Returns false and sets
+  // the error message if the host or the program is not supported.
+  bool compile();
+
+  // Executes the compiled program from address 0 with cleared registers and
+  // memory. Behaves like Simulator::run(), except that only the number of
+  // instructions executed is counted.
+  simulation_status_type run(ostream &out, long long max_steps);
+
+  const string &get_error() const;
+
+  // Returns the number of instructions executed by the last run.
+  long long get_instruction_count() const;
+
+  // Return the content of a register or of the memory word with a given
+  // label after a run. Unknown labels read as 0.
+  int get_register(const int reg) const;
+  int get_memory(const string &label) const;
+
+ private:
+  const Simulator *program;
+
+  // Executable memory holding the generated code, and its size in bytes.
+  void *buffer;
+  size_t buffer_size;
+
+  // Native address of the code for each word, for branches to registers.
+  vector<const void *> targets;
+
+  vector<int> memory;
+  JIT_Context context;
+  long long instruction_count;
+
+  string error;
+
+  // Machine code being generated.
+  vector<unsigned char> code;
+
+  // Offset of each label in code, or -1 if not yet bound, and the places
+  // holding 32-bit displacements to labels.
+  vector<int> label_offsets;
+  vector<pair<int, int> > fixups;
+
+  int new_label();
+  void bind(const int label);
+
+  void emit8(const int byte);
+  void emit32(const int value);
+  void emit64(const unsigned long long value);
+
+  // Emits a REX prefix when one is needed to reach registers r8 to r15 or
+  // for a 64-bit operation.
+  void emit_rex(const bool wide, const int reg, const int rm);
+  // Emits a register to register ModRM byte.
+  void emit_modrm(const int reg, const int rm);
+  // Emits a 32-bit displacement to a label.
+  void emit_label_displacement(const int label);
+
+  void emit_jump(const int label);
+  void emit_jump(const int condition, const int label);
+
+  void emit_move_immediate(const int reg, const int value);
+  void emit_move_register(const int dst, const int src);
+  // Emits "op dst, src" with a one-byte opcode taking its destination in
+  // the r/m field.
+  void emit_alu(const int opcode, const int dst, const int src);
+  void emit_test(const int reg);
+  // Loads and stores words of memory at a fixed address or at the address
+  // in eax.
+  void emit_load(const int reg, const int address);
+  void emit_store(const int address, const int reg);
+  void emit_load_indexed(const int reg);
+  void emit_store_indexed(const int reg);
+  // Emits "sub rbp, 1" and "add rbp, 1", which charge and refund the step
+  // budget.
+  void emit_charge_step(const int step_limit);
+  void emit_refund_step();
+
+  // Computes the address of an indirect or relative operand in eax.
+  void emit_address(const TrAL_Operand &operand, const int bad_address);
+  // Loads an operand into a host register.
+  void emit_operand(const TrAL_Operand &operand, const int reg,
+                    const int bad_address);
+  // Jumps to the word whose address is in a host register.
+  void emit_jump_to_register(const int reg, const int out_of_range);
+
+  // Returns the host register holding a TrAL register.
+  static int host_register(const int reg);
+};
+
+#endif
@@ -0,0 +1,203 @@
+// Implementation of Linear_Scan class.
+// @author Hieu Le
+// @version 12/22/2016
+
+#include "linear_scan.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "stats.h"
+
+Linear_Scan::Linear_Scan(const IR_Function *function,
+                         const Liveness &liveness, const int the_n_registers)
+    : n_registers(the_n_registers),
+      assignment(function->vreg_types.size(), -1),
+      interval_end(function->vreg_types.size(), -1),
+      spilled(function->vreg_types.size(), false), spill_count(0),
+      spill_slot(function->vreg_types.size(), -1), spill_slot_count(0) {
+  build_intervals(function, liveness);
+  allocate();
+  assign_spill_slots(function);
+}
+
+Linear_Scan::~Linear_Scan() {}
+
+int Linear_Scan::get_register(const int vreg) const {
+  return assignment[vreg];
+}
+
+bool Linear_Scan::is_last_use(const int vreg, const int position) const {
+  return interval_end[vreg] == 2 * position;
+}
+
+int Linear_Scan::get_free_register(const int position) const {
+  vector<bool> taken(n_registers, false);
+  for (const Interval &interval : intervals) {
+    if (assignment[interval.vreg] != -1 && interval.start <= 2 * position + 1
+        && interval.end >= 2 * position) {
+      taken[assignment[interval.vreg]] = true;
+    }
+  }
+  for (int r = 0; r < n_registers; ++r) {
+    if (!taken[r]) {
+      return r;
+    }
+  }
+  return -1;
+}
+
+bool Linear_Scan::is_spilled(const int vreg) const {
+  return spilled[vreg];
+}
+
+int Linear_Scan::get_spill_count() const {
+  return spill_count;
+}
+
+int Linear_Scan::get_spill_slot(const int vreg) const {
+  return spill_slot[vreg];
+}
+
+int Linear_Scan::get_spill_slot_count() const {
+  return spill_slot_count;
+}
+
+void Linear_Scan::build_intervals(const IR_Function *function,
+                                  const Liveness &liveness) {
+  const int n_vregs = function->vreg_types.size();
+  vector<int> start(n_vregs, -1);
+  vector<int> end(n_vregs, -1);
+  auto extend = [&](const int vreg, const int point) {
+    if (start[vreg] == -1 || point < start[vreg]) {
+      start[vreg] = point;
+    }
+    if (point > end[vreg]) {
+      end[vreg] = point;
+    }
+  };
+
+  for (const Basic_Block *block : function->blocks) {
+    const int first = code.size();
+    for (const IR_Instruction &instruction : block->instructions) {
+      const int i = code.size();
+      code.push_back(&instruction);
+      if (instruction.src1.is_vreg()) {
+        extend(instruction.src1.get_value(), 2 * i);
+      }
+      if (instruction.src2.is_vreg()) {
+        extend(instruction.src2.get_value(), 2 * i + 1);
+      }
+      if (instruction.dst.is_vreg()) {
+        extend(instruction.dst.get_value(), 2 * i + 1);
+      }
+    }
+    if (block->instructions.empty()) {
+      continue;
+    }
+    const int last = code.size() - 1;
+    for (const int v : liveness.get_live_in(block).members()) {
+      extend(v, 2 * first);
+    }
+    for (const int v : liveness.get_live_out(block).members()) {
+      extend(v, 2 * last + 1);
+    }
+  }
+
+  for (int v = 0; v < n_vregs; ++v) {
+    if (start[v] != -1) {
+      intervals.push_back({v, start[v], end[v]});
+      interval_end[v] = end[v];
+    }
+  }
+  stable_sort(intervals.begin(), intervals.end(),
+              [](const Interval &a, const Interval &b) {
+                return a.start < b.start;
+              });
+}
+
+void Linear_Scan::allocate() {
+  // Intervals currently holding a register, ordered by end point.
+  vector<Interval> active;
+  vector<bool> free_register(n_registers, true);
+
+  for (const Interval &current : intervals) {
+    // Release the registers of the intervals that are over.
+    while (!active.empty() && active.front().end < current.start) {
+      free_register[assignment[active.front().vreg]] = true;
+      active.erase(active.begin());
+    }
+
+    // Prefer the register of the first operand of the defining instruction,
+    // which saves a move in two-address code.
+    int reg = -1;
+    if (current.start % 2 == 1) {
+      const IR_Instruction *definition = code[current.start / 2];
+      if (definition->src1.is_vreg()) {
+        const int hint = assignment[definition->src1.get_value()];
+        if (hint != -1 && free_register[hint]) {
+          reg = hint;
+        }
+      }
+    }
+    for (int r = 0; reg == -1 && r < n_registers; ++r) {
+      if (free_register[r]) {
+        reg = r;
+      }
+    }
+
+    if (reg == -1) {
+      // Spill the interval that ends last.
+      ++spill_count;
+      ++counters.spills;
+      if (active.empty() || active.back().end <= current.end) {
+        spilled[current.vreg] = true;
+        continue;
+      }
+      const Interval victim = active.back();
+      active.pop_back();
+      reg = assignment[victim.vreg];
+      assignment[victim.vreg] = -1;
+      spilled[victim.vreg] = true;
+    }
+
+    assignment[current.vreg] = reg;
+    free_register[reg] = false;
+    ++counters.register_allocations;
+    vector<Interval>::iterator position = active.begin();
+    while (position != active.end() && position->end <= current.end) {
+      ++position;
+    }
+    active.insert(position, current);
+  }
+}
+
+void Linear_Scan::assign_spill_slots(const IR_Function *function) {
+  // Slots in use as <end point, slot>, the earliest ending first, and slots
+  // free for reuse, the lowest first.
+  priority_queue<pair<int, int>, vector<pair<int, int>>,
+                 greater<pair<int, int>>> busy;
+  priority_queue<int, vector<int>, greater<int>> free_slots;
+
+  for (const Interval &interval : intervals) {
+    if (!spilled[interval.vreg]
+        || function->promoted_from[interval.vreg] != -1) {
+      continue;
+    }
+    while (!busy.empty() && busy.top().first < interval.start) {
+      free_slots.push(busy.top().second);
+      busy.pop();
+    }
+    int slot;
+    if (free_slots.empty()) {
+      slot = spill_slot_count++;
+    } else {
+      slot = free_slots.top();
+      free_slots.pop();
+    }
+    spill_slot[interval.vreg] = slot;
+    busy.push({interval.end, slot});
+  }
+}
@@ -0,0 +1,110 @@
+// Linear scan register allocation over live intervals.
+// @author Hieu Le
+// @version 12/22/2016
+
+#ifndef LINEAR_SCAN_H
+#define LINEAR_SCAN_H
+
+#include <vector>
+
+#include "ir.h"
+#include "liveness.h"
+
+using namespace std;
+
+/* Assigns registers to the virtual registers of a whole function in a
+   single pass over their live intervals, after Poletto and Sarkar.
+
+   Instructions are numbered in layout order. Instruction i reads its
+   operands at point 2i and writes its result at point 2i + 1, so a source
+   operand dying at an instruction may share its register with the result.
+   The second operand of a binary operation is kept alive until 2i + 1
+   because two-address code overwrites the first operand before reading the
+   second one. The live interval of a virtual register spans every point
+   from its first to its last reference, extended to the boundaries of the
+   blocks it is live into or out of. This keeps the virtual registers that
+   are live around a loop in the same register for the whole loop.
+
+   When all registers are taken, the interval ending last goes to memory
+   for its whole lifetime. A spilled variable stays in its own memory, while
+   spilled temporaries share spill slots: the intervals are colored in order
+   of start point, each taking the lowest slot freed by an interval that is
+   over. This uses as many slots as there are spilled temporaries live at
+   the same point, which is the minimum. */
+class Linear_Scan {
+ public:
+  // Allocates registers numbered from 0 to n_registers - 1 to the virtual
+  // registers of a function whose control flow graph is up to date.
+  Linear_Scan(const IR_Function *function, const Liveness &liveness,
+              const int n_registers);
+  ~Linear_Scan();
+
+  // Returns the register of a virtual register, or -1 if it lives in
+  // memory.
+  int get_register(const int vreg) const;
+
+  // Checks if a virtual register is last read as the first operand of the
+  // instruction at a given position.
+  bool is_last_use(const int vreg, const int position) const;
+
+  // Returns a register holding no live value while the instruction at a
+  // given position executes, or -1 if there is none.
+  int get_free_register(const int position) const;
+
+  // Checks if a virtual register that is referenced lives in memory.
+  bool is_spilled(const int vreg) const;
+
+  // Number of virtual registers that live in memory.
+  int get_spill_count() const;
+
+  // Returns the spill slot of a spilled temporary, or -1 for any other
+  // virtual register.
+  int get_spill_slot(const int vreg) const;
+
+  // Number of spill slots used.
+  int get_spill_slot_count() const;
+
+ private:
+  // Live interval of a virtual register, in points.
+  struct Interval {
+    int vreg;
+    int start;
+    int end;
+  };
+
+  int n_registers;
+
+  // Register of each virtual register, or -1.
+  vector<int> assignment;
+
+  // Last point of the interval of each virtual register, or -1.
+  vector<int> interval_end;
+
+  // Virtual registers sent to memory.
+  vector<bool> spilled;
+
+  // Instructions of the function in layout order.
+  vector<const IR_Instruction *> code;
+
+  // Intervals of the virtual registers that are referenced, ordered by
+  // start point.
+  vector<Interval> intervals;
+
+  int spill_count;
+
+  // Spill slot of each virtual register, or -1.
+  vector<int> spill_slot;
+
+  int spill_slot_count;
+
+  // Computes the live intervals of all virtual registers.
+  void build_intervals(const IR_Function *function, const Liveness &liveness);
+
+  // Walks the intervals in order of start point, assigning registers.
+  void allocate();
+
+  // Assigns spill slots to the spilled temporaries of a function.
+  void assign_spill_slots(const IR_Function *function);
+};
+
+#endif
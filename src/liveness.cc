@@ -0,0 +1,107 @@
+// Implementation of Liveness class.
+// @author Hieu Le
+// @version 12/22/2016
+
+#include "liveness.h"
+
+Register_Set::Register_Set() {}
+
+Register_Set::Register_Set(const int size)
+    : words((size + WORD_BITS - 1) / WORD_BITS, 0) {}
+
+bool Register_Set::unite(const Register_Set &other) {
+  unsigned long long added = 0;
+  for (unsigned int i = 0; i < words.size(); ++i) {
+    added |= other.words[i] & ~words[i];
+    words[i] |= other.words[i];
+  }
+  return added != 0;
+}
+
+bool Register_Set::unite_difference(const Register_Set &other,
+                                    const Register_Set &excluded) {
+  unsigned long long added = 0;
+  for (unsigned int i = 0; i < words.size(); ++i) {
+    const unsigned long long word = other.words[i] & ~excluded.words[i];
+    added |= word & ~words[i];
+    words[i] |= word;
+  }
+  return added != 0;
+}
+
+vector<int> Register_Set::members() const {
+  vector<int> vregs;
+  for (unsigned int i = 0; i < words.size(); ++i) {
+    for (unsigned long long word = words[i]; word != 0; word &= word - 1) {
+      vregs.push_back(i * WORD_BITS + __builtin_ctzll(word));
+    }
+  }
+  return vregs;
+}
+
+Liveness::Liveness(const IR_Function *function) : iterations(0) {
+  const int n_blocks = function->blocks.size();
+  const int n_vregs = function->vreg_types.size();
+
+  // Virtual registers read before being written in each block, and virtual
+  // registers written in each block.
+  vector<Register_Set> uses(n_blocks, Register_Set(n_vregs));
+  vector<Register_Set> defs(n_blocks, Register_Set(n_vregs));
+  for (const Basic_Block *block : function->blocks) {
+    Register_Set &block_uses = uses[block->id];
+    Register_Set &block_defs = defs[block->id];
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand : {&instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg() && !block_defs.contains(operand->get_value())) {
+          block_uses.insert(operand->get_value());
+        }
+      }
+      if (instruction.dst.is_vreg()) {
+        block_defs.insert(instruction.dst.get_value());
+      }
+    }
+  }
+
+  // Solve live_in = uses + (live_out - defs), where live_out is the union of
+  // the live_in sets of the successors. Visiting the blocks backwards makes
+  // the sets converge in few iterations.
+  live_in = uses;
+  live_out.assign(n_blocks, Register_Set(n_vregs));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    ++iterations;
+    for (int i = n_blocks - 1; i >= 0; --i) {
+      const Basic_Block *block = function->blocks[i];
+      Register_Set &out = live_out[block->id];
+      for (const Basic_Block *successor : block->successors) {
+        out.unite(live_in[successor->id]);
+      }
+      if (live_in[block->id].unite_difference(out, defs[block->id])) {
+        changed = true;
+      }
+    }
+  }
+}
+
+Liveness::~Liveness() {}
+
+bool Liveness::is_live_in(const Basic_Block *block, const int vreg) const {
+  return live_in[block->id].contains(vreg);
+}
+
+bool Liveness::is_live_out(const Basic_Block *block, const int vreg) const {
+  return live_out[block->id].contains(vreg);
+}
+
+const Register_Set &Liveness::get_live_in(const Basic_Block *block) const {
+  return live_in[block->id];
+}
+
+const Register_Set &Liveness::get_live_out(const Basic_Block *block) const {
+  return live_out[block->id];
+}
+
+int Liveness::get_iterations() const {
+  return iterations;
+}
@@ -0,0 +1,82 @@
+// Liveness analysis of the virtual registers of an IR function.
+// @author Hieu Le
+// @version 12/22/2016
+
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <vector>
+
+#include "ir.h"
+
+using namespace std;
+
+// A set of virtual registers, packed one bit per register in machine words.
+class Register_Set {
+ public:
+  Register_Set();
+
+  // Creates an empty set able to hold the registers numbered below size.
+  explicit Register_Set(const int size);
+
+  // Checks if a virtual register is in the set.
+  inline bool contains(const int vreg) const {
+    return (words[vreg / WORD_BITS] >> (vreg % WORD_BITS)) & 1;
+  }
+
+  inline void insert(const int vreg) {
+    words[vreg / WORD_BITS] |= 1ULL << (vreg % WORD_BITS);
+  }
+
+  inline void erase(const int vreg) {
+    words[vreg / WORD_BITS] &= ~(1ULL << (vreg % WORD_BITS));
+  }
+
+  // Adds the registers of another set of the same size. Returns true if any
+  // of them was not in the set.
+  bool unite(const Register_Set &other);
+
+  // Adds the registers of a set that are not in another, all three of the
+  // same size. Returns true if any of them was not in the set.
+  bool unite_difference(const Register_Set &other,
+                        const Register_Set &excluded);
+
+  // Lists the registers of the set in increasing order.
+  vector<int> members() const;
+
+ private:
+  static const int WORD_BITS = 64;
+
+  vector<unsigned long long> words;
+};
+
+class Liveness {
+ public:
+  // Computes the virtual registers live at the entry and at the exit of each
+  // block of a function. The control flow graph of the function must be up
+  // to date.
+  explicit Liveness(const IR_Function *function);
+  ~Liveness();
+
+  // Checks if a virtual register is live at the entry of a block.
+  bool is_live_in(const Basic_Block *block, const int vreg) const;
+
+  // Checks if a virtual register is live at the exit of a block.
+  bool is_live_out(const Basic_Block *block, const int vreg) const;
+
+  // Virtual registers live at the entry and at the exit of a block.
+  const Register_Set &get_live_in(const Basic_Block *block) const;
+  const Register_Set &get_live_out(const Basic_Block *block) const;
+
+  // Number of times the sets were recomputed before reaching a fixed point.
+  int get_iterations() const;
+
+ private:
+  // Sets of live virtual registers, indexed by block id then by register.
+  vector<Register_Set> live_in;
+  vector<Register_Set> live_out;
+
+  int iterations;
+};
+
+#endif
@@ -0,0 +1,204 @@
+// Implementation of loop-invariant code motion.
+// @author Hieu Le
+// @version 12/29/2016
+
+#include "loop_invariants.h"
+
+#include <utility>
+#include <vector>
+
+#include "word.h"
+
+namespace {
+
+// Checks if an instruction computes a value without any other effect, so
+// that it may run when the loop does not.
+bool is_pure(const IR_Instruction &instruction) {
+  switch (instruction.opcode) {
+    case IR_MOVE:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_NEG:
+    case IR_NOT:
+      return true;
+
+    case IR_DIV:
+      // Dividing by zero stops the program.
+      return instruction.src2.is_immediate()
+          && instruction.src2.get_value() != 0;
+
+    default:
+      return false;
+  }
+}
+
+// Hoists the invariant computations of a loop into a new preheader. The
+// control flow graph must be up to date.
+void hoist(IR_Function *function, Basic_Block *header, Basic_Block *end,
+           const vector<int> &definitions) {
+  // Virtual registers and variables written inside the loop.
+  vector<int> loop_definitions(function->vreg_types.size(), 0);
+  vector<bool> stored(function->variables.size(), false);
+  bool calls = false;
+  for (int id = header->id; id <= end->id; ++id) {
+    for (const IR_Instruction &instruction :
+             function->blocks[id]->instructions) {
+      if (instruction.dst.is_vreg()) {
+        ++loop_definitions[instruction.dst.get_value()];
+      } else if (instruction.dst.is_variable()) {
+        stored[instruction.dst.get_value()] = true;
+      }
+      calls = calls || instruction.opcode == IR_CALL;
+    }
+  }
+
+  vector<bool> hoisted(function->vreg_types.size(), false);
+  auto is_invariant = [&](const IR_Operand &operand) {
+    if (operand.is_vreg()) {
+      return loop_definitions[operand.get_value()] == 0
+          || hoisted[operand.get_value()];
+    }
+    if (operand.is_variable()) {
+      // A procedure may write its frame, which holds its variables.
+      return !stored[operand.get_value()] && !calls;
+    }
+    return true;
+  };
+
+  // Instructions are visited in layout order, so a hoisted instruction only
+  // reads values computed before the loop or hoisted before it. A temporary
+  // read in the loop before its only definition would see the value of the
+  // previous iteration, so it stays.
+  vector<bool> read(function->vreg_types.size(), false);
+  vector<IR_Instruction> preheader_code;
+  for (int id = header->id; id <= end->id; ++id) {
+    vector<IR_Instruction> &code = function->blocks[id]->instructions;
+    for (unsigned int i = 0; i < code.size(); ++i) {
+      const IR_Instruction &instruction = code[i];
+      for (const IR_Operand *source : {&instruction.src1, &instruction.src2}) {
+        if (source->is_vreg()) {
+          read[source->get_value()] = true;
+        }
+      }
+      if (!is_pure(instruction) || !instruction.dst.is_vreg()) {
+        continue;
+      }
+      const int vreg = instruction.dst.get_value();
+      if (function->promoted_from[vreg] != -1 || definitions[vreg] != 1
+          || read[vreg]
+          || !is_invariant(instruction.src1)
+          || !is_invariant(instruction.src2)) {
+        continue;
+      }
+      hoisted[vreg] = true;
+      preheader_code.push_back(instruction);
+      code.erase(code.begin() + i);
+      --i;
+    }
+  }
+
+  if (!preheader_code.empty()) {
+    Basic_Block *preheader = new Basic_Block("");
+    preheader->instructions = preheader_code;
+    function->blocks.insert(function->blocks.begin() + header->id,
+                            preheader);
+  }
+}
+
+}  // namespace
+
+vector<pair<Basic_Block *, Basic_Block *>> find_loops(
+    const IR_Function *function) {
+  vector<pair<Basic_Block *, Basic_Block *>> loops;
+  for (Basic_Block *block : function->blocks) {
+    if (block->instructions.empty()) {
+      continue;
+    }
+    const IR_Instruction &last = block->instructions.back();
+    if (last.opcode == IR_BRUN && last.target->id <= block->id) {
+      loops.push_back({last.target, block});
+    }
+  }
+  return loops;
+}
+
+bool has_single_entry(const IR_Function *function, const Basic_Block *header,
+                      const Basic_Block *end) {
+  if (header->id == 0) {
+    return false;
+  }
+  const Basic_Block *previous = function->blocks[header->id - 1];
+  for (int id = header->id; id <= end->id; ++id) {
+    for (const Basic_Block *predecessor :
+             function->blocks[id]->predecessors) {
+      if (predecessor->id >= header->id && predecessor->id <= end->id) {
+        continue;
+      }
+      if (id != header->id || predecessor != previous
+          || (!previous->instructions.empty()
+              && previous->instructions.back().target == header)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool is_induction_step(const IR_Instruction &instruction, int &step) {
+  const IR_Operand &dst = instruction.dst;
+  if (!dst.is_vreg()) {
+    return false;
+  }
+  if (instruction.opcode == IR_ADD) {
+    if (instruction.src1 == dst && instruction.src2.is_immediate()) {
+      step = instruction.src2.get_value();
+      return true;
+    }
+    if (instruction.src2 == dst && instruction.src1.is_immediate()) {
+      step = instruction.src1.get_value();
+      return true;
+    }
+  } else if (instruction.opcode == IR_SUB && instruction.src1 == dst
+             && instruction.src2.is_immediate()) {
+    step = wrap(-static_cast<long long>(instruction.src2.get_value()));
+    return true;
+  }
+  return false;
+}
+
+void hoist_loop_invariants(IR_Function *function) {
+  vector<int> definitions(function->vreg_types.size(), 0);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.dst.is_vreg()) {
+        ++definitions[instruction.dst.get_value()];
+      }
+    }
+  }
+
+  function->build_cfg();
+  const vector<pair<Basic_Block *, Basic_Block *>> loops =
+      find_loops(function);
+  for (const pair<Basic_Block *, Basic_Block *> &loop : loops) {
+    // Preheaders shift the blocks, so each loop needs a fresh graph.
+    function->build_cfg();
+    if (has_single_entry(function, loop.first, loop.second)) {
+      hoist(function, loop.first, loop.second, definitions);
+    }
+  }
+
+  // Drop the preheaders of inner loops emptied by their outer loops. Blocks
+  // without a label are only reached by falling through.
+  vector<Basic_Block *> blocks;
+  for (Basic_Block *block : function->blocks) {
+    if (block->label.empty() && block->instructions.empty()
+        && !blocks.empty()) {
+      delete block;
+    } else {
+      blocks.push_back(block);
+    }
+  }
+  function->blocks = blocks;
+  function->build_cfg();
+}
@@ -0,0 +1,46 @@
+// Loop-invariant code motion.
+// @author Hieu Le
+// @version 12/29/2016
+
+#ifndef LOOP_INVARIANTS_H
+#define LOOP_INVARIANTS_H
+
+#include <utility>
+#include <vector>
+
+#include "ir.h"
+
+/* Returns the loops of a function as pairs of their first and last block,
+   in the layout order of their last block, so that inner loops come before
+   the loops enclosing them. A loop is a back edge in the layout, from its
+   last block to the block labeled _while_cond, and spans the blocks in
+   between. The control flow graph must be up to date. */
+vector<pair<Basic_Block *, Basic_Block *>> find_loops(
+    const IR_Function *function);
+
+/* Checks if the loop spanning header to end is entered only by falling
+   through into header, so that a preheader placed before it runs on each
+   entry. The control flow graph must be up to date. */
+bool has_single_entry(const IR_Function *function, const Basic_Block *header,
+                      const Basic_Block *end);
+
+/* Checks if an instruction adds a constant to a virtual register, such as
+   v := v + 1 or v := v - 1, and sets step to the constant added if so. A
+   virtual register only written within a loop by such instructions is an
+   induction variable of the loop. */
+bool is_induction_step(const IR_Instruction &instruction, int &step);
+
+/* Moves the computations of each while loop whose operands do not change
+   within the loop to a preheader, a block placed right before the loop
+   condition, so that they run once instead of once per iteration.
+
+   Inner loops are handled first, so that their invariants may leave the
+   outer loops too.
+
+   Only temporaries with a single definition in the function are hoisted,
+   since the preheader runs even when the loop does not: the value of a
+   variable after the loop must not change. For the same reason, divisions
+   are hoisted only by a nonzero constant. */
+void hoist_loop_invariants(IR_Function *function);
+
+#endif
@@ -4,22 +4,36 @@
 
 #include "operand.h"
 
+namespace {
+
+// Returns the type of operand holding a given IR value.
+op_type_type type_of(const IR_Operand &value) {
+  switch (value.get_kind()) {
+    case IR_IMMEDIATE:
+      return OPTYPE_IMMEDIATE;
+    case IR_VREG:
+      return OPTYPE_REGISTER;
+    case IR_VARIABLE:
+      return OPTYPE_MEMORY;
+    default:
+      return OPTYPE_GARBAGE;
+  }
+}
+
+}  // namespace
+
 Operand::Operand(const op_type_type o_type, const int val)
-    : op_type(o_type), i_value(val), r_value(nullptr), m_value(nullptr) {}
+    : op_type(o_type), ir_value(IR_IMMEDIATE, val) {}
 
-Operand::Operand(const op_type_type o_type, const string *memory_location_name)
-    : op_type(o_type), i_value(OPTYPE_GARBAGE_I_VALUE), r_value(nullptr),
-      m_value(new string(*memory_location_name)) {}
+Operand::Operand(const IR_Operand &value)
+    : op_type(type_of(value)), ir_value(value) {}
 
-Operand:: Operand(const op_type_type o_type, Register *reg)
-    : op_type(o_type), i_value(OPTYPE_GARBAGE_I_VALUE), r_value(reg),
-      m_value(nullptr) {}
+Operand::Operand(const op_type_type o_type,
+                 const vector<Basic_Block *> &false_labels,
+                 const vector<Basic_Block *> &true_labels)
+    : op_type(o_type), false_labels(false_labels), true_labels(true_labels) {}
 
-Operand::~Operand() {
-  if (m_value != NULL) {
-    delete m_value;
-  }
-}
+Operand::~Operand() {}
 
 op_type_type Operand::get_type() const {
   return op_type;
@@ -29,7 +43,7 @@ int Operand::get_i_value() const {
   // Sanity check
   switch (op_type) {
     case OPTYPE_IMMEDIATE:
-      return i_value;
+      return ir_value.get_value();
       break;
 
     case OPTYPE_MEMORY:
@@ -51,63 +65,43 @@ int Operand::get_i_value() const {
   return OPTYPE_GARBAGE_I_VALUE;
 }
 
-Register *Operand::get_r_value() const {
+const IR_Operand &Operand::get_ir_value() const {
   // Sanity check
   switch (op_type) {
-    case OPTYPE_REGISTER:
-      if (r_value != NULL) {
-        return r_value;
-      } else {
-        bad_op_request("register is null");
-      }
-      break;
-
     case OPTYPE_IMMEDIATE:
-      bad_op_request("register value of immediate operand");
+    case OPTYPE_REGISTER:
+    case OPTYPE_MEMORY:
       break;
 
-    case OPTYPE_MEMORY:
-      bad_op_request("register value of memory operand");
+    case OPTYPE_JUMP:
+      bad_op_request("value of jumping code operand");
       break;
 
     case OPTYPE_GARBAGE:
-      bad_op_request("register value of garbage operand");
+      bad_op_request("value of garbage type operand");
       break;
 
     default:
-      bad_op_request("register valueof undefined type operand");
+      bad_op_request("value of undefined type operand");
       break;
   }
-
-  return NULL;
+  return ir_value;
 }
 
-
-string *Operand::get_m_value() const {
+const vector<Basic_Block *> &Operand::get_false_labels() const {
   // Sanity check
-  switch (op_type) {
-    case OPTYPE_MEMORY:
-      if (m_value != NULL) {
-        return new string (*m_value);
-      } else {
-        bad_op_request("name of m operand is undefined");
-      }
-      break;
-
-    case OPTYPE_IMMEDIATE:
-    case OPTYPE_REGISTER:
-      bad_op_request("name of immediate or register op");
-      break;
-
-    case OPTYPE_GARBAGE:
-      bad_op_request("name of garbage type operand");
-      break;
+  if (op_type != OPTYPE_JUMP) {
+    bad_op_request("false labels of non-jumping operand");
+  }
+  return false_labels;
+}
 
-    default:
-      bad_op_request("name of undefined operand");
-      break;
+const vector<Basic_Block *> &Operand::get_true_labels() const {
+  // Sanity check
+  if (op_type != OPTYPE_JUMP) {
+    bad_op_request("true labels of non-jumping operand");
   }
-  return NULL;
+  return true_labels;
 }
 
 void Operand::bad_op_request(const char *message) const {
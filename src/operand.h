@@ -1,4 +1,4 @@
-// Representation of an operand from the TrAL instruction set.
+// Representation of an operand of an expression during code generation.
 // @author Hieu Le
 // @version 12/05/2016
 
@@ -7,45 +7,60 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
-#include "register.h"
+#include "ir.h"
 
 using namespace std;
 
-/* We will use three types of TrAL operands: immediate,
-   register direct, and memory direct.  
+/* We will use three types of operands: immediate, virtual register
+   and memory direct. Each of them holds an IR_Operand of the
+   corresponding kind.
+
+   A boolean expression inside the condition of an 'if' or 'while'
+   statement may instead be held as jumping code: control falls
+   through (or reaches one of the true labels) when it is true, and
+   branches to one of the false labels otherwise.
 */
 typedef enum OPERAND_TYPE { OPTYPE_IMMEDIATE = 900,
                             OPTYPE_REGISTER  = 901,
                             OPTYPE_MEMORY    = 902,
+                            OPTYPE_JUMP      = 903,
                             OPTYPE_GARBAGE   = 999 } op_type_type;
 
 #define OPTYPE_GARBAGE_I_VALUE 99999999
 
 class Operand {
  public:
+  // Constructs an immediate operand.
   Operand(const op_type_type type, const int val);
-  Operand(const op_type_type type, const string *memory_location_name);
-  Operand(const op_type_type type, Register *reg);
+  // Constructs an operand whose type follows the kind of value.
+  explicit Operand(const IR_Operand &value);
+  Operand(const op_type_type type, const vector<Basic_Block *> &false_labels,
+          const vector<Basic_Block *> &true_labels);
   ~Operand();
 
   op_type_type get_type() const;
 
   int get_i_value() const;
 
-  Register *get_r_value() const;
+  // The IR form of an immediate, register or memory operand.
+  const IR_Operand &get_ir_value() const;
 
-  string *get_m_value() const;
+  // Blocks that must be placed where control goes when a jumping code
+  // operand is false, respectively true.
+  const vector<Basic_Block *> &get_false_labels() const;
+  const vector<Basic_Block *> &get_true_labels() const;
 
  private:
   // The type of this operand.
   const op_type_type op_type;
 
-  /* Depending on the type of the operand, it will either have an
-     immediate value, be in a register or be in memory. */
-  const int i_value;
-  Register * const r_value;
-  string * const m_value;
+  /* Depending on the type of the operand, it will either have a value
+     or be held as jumping code. */
+  const IR_Operand ir_value;
+  const vector<Basic_Block *> false_labels;
+  const vector<Basic_Block *> true_labels;
 
   void bad_op_request(const char *message) const;
 };
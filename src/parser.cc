@@ -4,32 +4,36 @@
 
 #include "parser.h"
 
+#include <algorithm>
+#include <climits>
 #include <string>
 
 // Log a message to console for debugging.
 #define LOG(output) \
-  if (DEBUGMODE) std::cerr << output << std::endl
+  if (debug) std::cerr << output << std::endl
 
 Parser::Parser(Scanner *the_scanner) {
   /* Initialize the parser. */
   lex = the_scanner;
   word = lex->next_token();
-  LOG("Parsing: " << *word->to_string());
+  debug = false;
 
   // Semantic analysis initializations.
   current_env = main_env = procedure_name = nullptr;
   actual_parm_position = formal_parm_position = -1;
   parsing_formal_parm_list = false;
-#if PARSER_TEST_MODE
-  current_env = new string();
-  main_env = new string();
-  procedure_name = new string();
-#endif
+  syntax_only = false;
 
-  // Code generation initializations.
+  // Code generation initializations. The main program is named once its
+  // identifier has been parsed.
   e = new Emitter();
-  allocator = new Register_Allocator();
-  last_register_op = nullptr;
+  program = new IR_Program();
+  program->functions.push_back(new IR_Function(""));
+  ir = new IR_Builder(program->functions.front());
+  jumping_mode = false;
+  register_count = TRAL_REGISTER_COUNT;
+  comments = false;
+  generate_code = true;
 }
 
 Parser::~Parser() {
@@ -43,8 +47,11 @@ Parser::~Parser() {
   if (e != nullptr) {
     delete e;
   }
-  if (allocator != nullptr) {
-    delete allocator;
+  if (ir != nullptr) {
+    delete ir;
+  }
+  if (program != nullptr) {
+    delete program;
   }
 }
 
@@ -55,6 +62,60 @@ bool Parser::done_with_input() const {
   return word->get_token_type() == TOKEN_EOF;
 }
 
+IR_Program *Parser::get_program() const {
+  return program;
+}
+
+void Parser::set_optimization_level(const int level) {
+  passes.set_level(level);
+}
+
+void Parser::set_register_count(const int count) {
+  register_count = count;
+}
+
+void Parser::set_emitter(Emitter *emitter) {
+  delete e;
+  e = emitter;
+  e->set_comments(comments);
+}
+
+void Parser::set_comments(const bool enabled) {
+  comments = enabled;
+  e->set_comments(comments);
+}
+
+void Parser::set_debug(const bool enabled) {
+  debug = enabled;
+  LOG("Parsing: " << *word->to_string());
+}
+
+void Parser::set_syntax_only(const bool enabled) {
+  syntax_only = enabled;
+  // Procedures declared outside of any program belong to an unnamed one.
+  if (syntax_only && current_env == nullptr) {
+    current_env = new string();
+    main_env = new string();
+    procedure_name = new string();
+  }
+}
+
+void Parser::set_inlining_log(ostream *log) {
+  passes.set_inlining_log(log);
+}
+
+void Parser::set_unroll_factor(const int factor) {
+  passes.set_unroll_factor(factor);
+}
+
+Pass_Manager *Parser::get_pass_manager() {
+  return &passes;
+}
+
+void Parser::set_generate_code(const bool generate) {
+  generate_code = generate;
+}
+
 void Parser::parse_error(string *expected, Token *found) const {
   std::cerr << "Parse error: Expected: " << *expected <<
       ", Found:  " << *(found->to_string()) << std::endl;
@@ -69,24 +130,24 @@ void Parser::advance() {
 
 void Parser::multiply_defined_identifier(string *id) const {
   cerr << "The identifier " << *id << " has already been declared. " << endl;
-#if !PARSER_TEST_MODE
-  exit(EXIT_FAILURE);
-#endif
+  if (!syntax_only) {
+    exit(EXIT_FAILURE);
+  }
 }
 
 void Parser::undeclared_identifier(string *id) const {
   cerr << "The identifier " << *id << " has not been declared. " << endl;
-#if !PARSER_TEST_MODE
-  exit(EXIT_FAILURE);
-#endif
+  if (!syntax_only) {
+    exit(EXIT_FAILURE);
+  }
 }
 
 void Parser::type_error(const expr_type expected, const expr_type found) const {
   cerr << "Type error: expected " << *(stab.type_to_string(expected))
        << " found " << *(stab.type_to_string(found)) << "." << endl;
-#if !PARSER_TEST_MODE
-  exit(EXIT_FAILURE);
-#endif
+  if (!syntax_only) {
+    exit(EXIT_FAILURE);
+  }
 }
 
 void Parser::type_error(const expr_type expected1, const expr_type expected2,
@@ -94,30 +155,190 @@ void Parser::type_error(const expr_type expected1, const expr_type expected2,
   cerr << "Type error: expected " << *(stab.type_to_string(expected1))
        << " or " << *(stab.type_to_string(expected2))
        << ", found " << *(stab.type_to_string(found)) << "." << endl;
-#if !PARSER_TEST_MODE
-  exit(EXIT_FAILURE);
-#endif
+  if (!syntax_only) {
+    exit(EXIT_FAILURE);
+  }
+}
+
+void Parser::declare_variable(const string *id) {
+  ir->get_function()->add_variable(*id, UNKNOWN_T);
+}
+
+void Parser::update_variable_types(const expr_type type) {
+  for (IR_Variable &variable : ir->get_function()->variables) {
+    if (variable.type == UNKNOWN_T) {
+      variable.type = type;
+    }
+  }
+}
+
+IR_Operand Parser::variable_operand(const string *id) const {
+  return IR_Operand(IR_VARIABLE, ir->get_function()->find_variable(*id));
+}
+
+int Parser::function_index(const string *id) const {
+  for (unsigned int i = 1; i < program->functions.size(); ++i) {
+    if (program->functions[i]->name == *id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+Basic_Block *Parser::new_block(const char prefix[]) {
+  return ir->new_block(program->new_label(prefix));
 }
 
-const string* Parser::allocate_spill_memory() {
-  for (const auto& entry : spilled_labels) {
-    // Returns any inactive spilled label.
-    if (!entry.second) {
-      return entry.first;
+void Parser::make_condition(Operand*& op) {
+  if (op->get_type() == OPTYPE_JUMP) {
+    return;
+  }
+
+  // A constant condition either always falls through or always jumps.
+  if (op->get_type() == OPTYPE_IMMEDIATE) {
+    vector<Basic_Block *> false_labels;
+    if (op->get_i_value() == 0) {
+      false_labels.push_back(new_block("cond_false"));
+      ir->emit_branch(false_labels.back());
     }
+    delete op;
+    op = new Operand(OPTYPE_JUMP, false_labels, vector<Basic_Block *>());
+    return;
   }
-  // Reserves a new memory location if no previously spilled locaion is active.
-  string *spilled_label = e->get_new_label("spill");
-  spilled_labels.push_back({spilled_label, true});
-  return spilled_label;
+
+  Basic_Block *cond_false = new_block("cond_false");
+  ir->emit_branch(IR_BREZ, op->get_ir_value(), cond_false);
+  delete op;
+  op = new Operand(OPTYPE_JUMP, vector<Basic_Block *>{cond_false},
+                   vector<Basic_Block *>());
 }
 
-void Parser::deallocate_spill_memory(const string *spilled_label) {
-  for (auto& entry : spilled_labels) {
-    if (*entry.first == *spilled_label) {
-      entry.second = false;
+void Parser::negate_condition(Operand*& op) {
+  Basic_Block *not_false = new_block("not_false");
+  vector<Basic_Block *> false_labels;
+  if (op->get_type() == OPTYPE_JUMP) {
+    // Wherever the operand holds, its negation fails: jump away on fall
+    // through and reuse the true labels as false labels. The operand's false
+    // labels now mark where the negation holds.
+    ir->emit_branch(not_false);
+    emit_labels(op->get_false_labels());
+    false_labels = op->get_true_labels();
+  } else {
+    // Boolean values are either 0 or 1, so a positive value means that the
+    // negation is false.
+    ir->emit_branch(IR_BRPO, op->get_ir_value(), not_false);
+  }
+  false_labels.push_back(not_false);
+  delete op;
+  op = new Operand(OPTYPE_JUMP, false_labels, vector<Basic_Block *>());
+}
+
+vector<Basic_Block *> Parser::branch_on_false(Operand *condition,
+                                              Basic_Block *false_target) {
+  vector<Basic_Block *> false_labels;
+  if (condition->get_type() == OPTYPE_JUMP) {
+    // Jumping code already branches to its false labels. Its true labels
+    // join the fall through path here.
+    emit_labels(condition->get_true_labels());
+    false_labels = condition->get_false_labels();
+  } else if (condition->get_type() == OPTYPE_IMMEDIATE) {
+    // A constant condition needs no test.
+    if (condition->get_i_value() == 0) {
+      ir->emit_branch(false_target);
     }
+  } else {
+    // Test the value of the condition.
+    ir->emit_branch(IR_BREZ, condition->get_ir_value(), false_target);
   }
+  delete condition;
+  return false_labels;
+}
+
+void Parser::emit_labels(const vector<Basic_Block *> &labels) {
+  for (Basic_Block *label : labels) {
+    ir->emit_label(label);
+  }
+}
+
+bool Parser::fold_operation(const ir_opcode_type opcode, Operand*& left_op,
+                            Operand*& right_op) {
+  const bool left_constant = left_op->get_type() == OPTYPE_IMMEDIATE;
+  const bool right_constant = right_op->get_type() == OPTYPE_IMMEDIATE;
+
+  if (left_constant && right_constant) {
+    // Fold like the optimization passes, leaving division by zero (and the
+    // overflowing INT_MIN / -1) to be reported when the program runs.
+    int result;
+    if (!fold_constants(opcode, left_op->get_i_value(),
+                        right_op->get_i_value(), result)) {
+      return false;
+    }
+    delete left_op;
+    delete right_op;
+    left_op = new Operand(OPTYPE_IMMEDIATE, result);
+    return true;
+  }
+
+  // x + 0, x - 0, x * 1 and x / 1 are x.
+  if (right_constant) {
+    const int right = right_op->get_i_value();
+    if ((right == 0 && (opcode == IR_ADD || opcode == IR_SUB))
+        || (right == 1 && (opcode == IR_MUL || opcode == IR_DIV))) {
+      delete right_op;
+      return true;
+    }
+  }
+
+  // 0 + x and 1 * x are x.
+  if (left_constant) {
+    const int left = left_op->get_i_value();
+    if ((left == 0 && opcode == IR_ADD) || (left == 1 && opcode == IR_MUL)) {
+      delete left_op;
+      left_op = right_op;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool Parser::absorbs(const Operand* op, const bool disjunction) const {
+  return op->get_type() == OPTYPE_IMMEDIATE
+      && (disjunction ? op->get_i_value() != 0 : op->get_i_value() == 0);
+}
+
+bool Parser::may_drop(const IR_Builder::Mark& start, const Operand* left_op,
+                      const bool logical, const bool disjunction) const {
+  // A condition decided by its left operand skips the right one anyway.
+  if (logical && jumping_mode && absorbs(left_op, disjunction)) {
+    return true;
+  }
+  // Otherwise a division by zero must still stop the program.
+  return !ir->may_fail_since(start);
+}
+
+void Parser::drop_operation(const IR_Builder::Mark& start, Operand*& left_op,
+                            Operand*& right_op, const int result) {
+  // Jumping code may hold blocks that were never placed. The placed ones go
+  // away with the rest of the code.
+  const vector<Basic_Block *> &blocks = ir->get_function()->blocks;
+  for (const Operand *op : {left_op, right_op}) {
+    if (op->get_type() != OPTYPE_JUMP) {
+      continue;
+    }
+    for (const vector<Basic_Block *> *labels :
+             {&op->get_false_labels(), &op->get_true_labels()}) {
+      for (Basic_Block *label : *labels) {
+        if (find(blocks.begin(), blocks.end(), label) == blocks.end()) {
+          delete label;
+        }
+      }
+    }
+  }
+  ir->rollback(start);
+  delete left_op;
+  delete right_op;
+  left_op = new Operand(OPTYPE_IMMEDIATE, result);
 }
 
 namespace {
@@ -165,9 +386,31 @@ inline bool is_number(const Token* token) {
   return token->get_token_type() == TOKEN_NUM;
 }
 
+// Evaluates "left comparator right".
+bool compare(const relop_attr comparator, const int left, const int right) {
+  switch (comparator) {
+    case RELOP_EQ:
+      return left == right;
+    case RELOP_NE:
+      return left != right;
+    case RELOP_GT:
+      return left > right;
+    case RELOP_GE:
+      return left >= right;
+    case RELOP_LT:
+      return left < right;
+    case RELOP_LE:
+      return left <= right;
+    default:
+      return false;
+  }
+}
+
 }  // namespace
 
 bool Parser::parse_program() {
+  Phase_Scope scope(PHASE_PARSING);
+
   // PROGRAM -> program identifier ; DECL_LIST BLOCK ;
   // Predict (program identifier ; DECL_LIST BLOCK ;) == {program}
 
@@ -192,8 +435,8 @@ bool Parser::parse_program() {
       delete global_env_name;
       delete id_name;
 
-      // IR - Output a label for the program.
-      e->emit_label(new string("_" + *main_env));
+      // IR - Name the main program after its identifier.
+      program->functions.front()->name = *main_env;
 
       // ADVANCE
       advance();
@@ -210,7 +453,7 @@ bool Parser::parse_program() {
         */
         if (parse_decl_list()) {
           // Dump the content of symbol table.
-          if (DEBUGMODE) stab.dump();
+          if (debug) stab.dump();
 
           // Match BLOCK, 5th on RHS - ACTION
           if (parse_block()) {
@@ -222,23 +465,25 @@ bool Parser::parse_program() {
               advance();
 
               // IR - Output halt instruction at the end of the program.
-              e->emit_halt();
-
-              // IR - Generate data directives for all memory labels.
-              // Emit data directives for all program variables.
-              if (!program_labels.empty()) {
-                e->emit_comment("Data directives for program variables.");
-                for (const string *label : program_labels) {
-                  e->emit_data_directive(label, 1);
-                }
+              ir->emit_halt();
+              if (!generate_code) {
+                return true;
               }
-              // Emit data directives for all spilled memory.
-              if (!spilled_labels.empty()) {
-                e->emit_comment("Data directives for spilled memories.");
-                for (const auto &entry : spilled_labels) {
-                  e->emit_data_directive(entry.first, 1);
-                }
+
+              // IR - Run the optimization passes of the selected level.
+              {
+                Phase_Scope optimization(PHASE_OPTIMIZATION);
+                passes.run(program);
               }
+              if (debug) program->print(cerr);
+
+              // Translate the IR to target code, along with data directives
+              // for all memory labels.
+              Phase_Scope generation(PHASE_CODE_GENERATION);
+              Code_Generator generator(e, passes.optimizes()
+                                       ? ALLOC_LINEAR_SCAN : ALLOC_LOCAL,
+                                       register_count);
+              generator.generate(program);
 
               // Parse_program succeeded.
               return true;
@@ -364,6 +609,7 @@ bool Parser::parse_variable_decl() {
         if (parse_standard_type(standard_type_type)) {
           // Semantic analysis.
           stab.update_type(standard_type_type);
+          update_variable_types(standard_type_type);
           return true;
 
           // Fail to match STANDARD_TYPE.
@@ -442,11 +688,7 @@ bool Parser::parse_identifier_list() {
       multiply_defined_identifier(identifier_attr);
     } else {
       stab.install(identifier_attr, current_env, UNKNOWN_T);
-    }
-
-    // Reserve a data directive for word if it represents a program variable.
-    if (*current_env == *main_env) {
-      program_labels.push_back(identifier_attr);
+      declare_variable(identifier_attr);
     }
 
     // ADVANCE.
@@ -488,11 +730,7 @@ bool Parser::parse_identifier_list_prm() {
         } else {
           stab.install(identifier_attr, current_env, UNKNOWN_T);
         }
-      }
-
-      // Reserve a data directive for word if it represents a program variable.
-      if (*current_env == *main_env) {
-        program_labels.push_back(identifier_attr);
+        declare_variable(identifier_attr);
       }
 
       // ADVANCE.
@@ -609,6 +847,11 @@ bool Parser::parse_procedure_decl() {
         stab.install(identifier_attr, current_env, PROCEDURE_T);
         current_env = identifier_attr;
         formal_parm_position = 0;
+
+        // IR - The procedure gets its own function.
+        program->functions.push_back(new IR_Function(*identifier_attr));
+        delete ir;
+        ir = new IR_Builder(program->functions.back());
       }
 
       // ADVANCE.
@@ -633,6 +876,13 @@ bool Parser::parse_procedure_decl() {
             if (parse_variable_decl_list() && parse_block()) {
               // Semantic analysis.
               current_env = main_env;
+
+              // IR - Return to the caller at the end of the procedure.
+              ir->emit_return();
+
+              // IR - Resume generating code for the main program.
+              delete ir;
+              ir = new IR_Builder(program->functions.front());
               return true;
 
               // Fail to match VARIABLE_DECL_LIST and BLOCK.
@@ -715,6 +965,7 @@ bool Parser::parse_formal_parm_list() {
       stab.install(identifier_attr, current_env, UNKNOWN_T,
                    formal_parm_position);
       ++formal_parm_position;
+      declare_variable(identifier_attr);
     }
 
     // ADVANCE.
@@ -735,6 +986,7 @@ bool Parser::parse_formal_parm_list() {
         if (parse_standard_type(standard_type_type)) {
           // Semantic analysis.
           stab.update_type(standard_type_type);
+          update_variable_types(standard_type_type);
 
           // Match FORMAL_PARM_LIST_HAT - ACTION.
           return parse_formal_parm_list_hat();
@@ -916,7 +1168,7 @@ bool Parser::parse_stmt() {
     advance();
 
     expr_type adhoc_as_pc_tail_type = GARBAGE_T;
-    Operand* expression = new Operand(OPTYPE_MEMORY, identifier_attr);
+    Operand* expression = nullptr;
 
     // Match ADHOC_AS_PC_TAIL - ACTION.
     if (parse_adhoc_as_pc_tail(adhoc_as_pc_tail_type, expression)) {
@@ -927,41 +1179,14 @@ bool Parser::parse_stmt() {
         type_error(identifier_type, adhoc_as_pc_tail_type);
       }
 
-      // IR - Only generate code for assignment statements.
       if (identifier_type != PROCEDURE_T) {
-        // Make sure that the operand holding expression value is in a register.
-        Register* expression_register = nullptr;
-        if (expression->get_type() == OPTYPE_REGISTER) {
-          expression_register = expression->get_r_value();
-        } else {
-          // Allocate a register for the expression value and move it there.
-          // Spill last_register_op if there is no register available
-          // for allocation. There is no need to reset last_register_op to
-          // expression_register because it will be deallocated right after
-          // its use.
-          if (!allocator->has_free_register()) {
-            const string *spill_location = allocate_spill_memory();
-            e->emit_comment(
-                "Spill register to memory since all registers are live.");
-            e->emit_move(spill_location, (*last_register_op)->get_r_value());
-            allocator->deallocate_register((*last_register_op)->get_r_value());
-            *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-          }
-
-          expression_register = allocator->allocate_register();
-          if (expression->get_type() == OPTYPE_IMMEDIATE) {
-            e->emit_move(expression_register, expression->get_i_value());
-          } else if (expression->get_type() == OPTYPE_MEMORY) {
-            e->emit_move(expression_register, expression->get_m_value());
-          }
-        }
-
-        // Move the content of this register to the memory location of id.
-        e->emit_move(identifier_attr, expression_register);
-
-        // Deallocate the expression operand and the containing register.
-        allocator->deallocate_register(expression_register);
+        // IR - Move the expression value to the memory location of id.
+        ir->emit_move(variable_operand(identifier_attr),
+                      expression->get_ir_value());
         delete expression;
+      } else {
+        // IR - The actual parameters are in place, so call the procedure.
+        ir->emit_call(function_index(identifier_attr));
       }
       return true;
 
@@ -1053,54 +1278,27 @@ bool Parser::parse_if_stmt() {
     expr_type expr_type_result = GARBAGE_T;
     Operand* expression = nullptr;
 
+    // IR - Boolean operators in the condition compile to jumping code.
+    jumping_mode = true;
+
     // Match EXPR - ACTION.
     if (parse_expr(expr_type_result, expression)) {
+      jumping_mode = false;
 
       // Semantic analysis.
       if (expr_type_result != BOOL_T) {
         type_error(BOOL_T, expr_type_result);
       }
 
-      // IR - Make sure that the operand holding expr value is in a register.
-      Register* expression_register = nullptr;
-      if (expression->get_type() == OPTYPE_REGISTER) {
-        expression_register = expression->get_r_value();
-      } else {
-        // Allocate a register for the expression value and move it there.
-        // Spill last_register_op if there is no register available
-        // for allocation. There is no need to reset last_register_op to
-        // expression_register since it will be deallocated right after
-        // its use.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        expression_register = allocator->allocate_register();
-        if (expression->get_type() == OPTYPE_IMMEDIATE) {
-          e->emit_move(expression_register, expression->get_i_value());
-        } else if (expression->get_type() == OPTYPE_MEMORY) {
-          e->emit_move(expression_register, expression->get_m_value());
-        }
-      }
-
       // Generate labels of the 'else' part (even if it doesn't exist) and the
       // next statement after the 'if'.
-      string* else_part = e->get_new_label("else");
-      string* if_done = e->get_new_label("if_done");
+      Basic_Block* else_part = new_block("else");
+      Basic_Block* if_done = new_block("if_done");
 
-      // Test register that holds the value of the expression.
-      // If it is false, jump to the 'else' part.
-      e->emit_branch(INST_BREZ, expression_register, else_part);
-
-      // We are done with the expression operand and the register in which it
-      // resides. Deallocate both.
-      allocator->deallocate_register(expression_register);
-      delete expression;
+      // IR - If the condition is false, jump to the 'else' part. This also
+      // consumes the expression operand.
+      vector<Basic_Block *> false_labels =
+          branch_on_false(expression, else_part);
 
       // Match keyword then.
       if (is_keyword(word, KW_THEN)) {
@@ -1113,8 +1311,9 @@ bool Parser::parse_if_stmt() {
         // Match BLOCK - ACTION.
         if (parse_block()) {
           // IR - Skip over 'else' part.
-          e->emit_branch(if_done);
-          e->emit_label(else_part);
+          ir->emit_branch(if_done);
+          ir->emit_label(else_part);
+          emit_labels(false_labels);
 
           // IR - If there is an 'else' part to the 'if' statement, the code
           // for the 'else' part code will be generated by parse_if_stmt_hat().
@@ -1122,7 +1321,7 @@ bool Parser::parse_if_stmt() {
           // Match IF_STMT_HAT - ACTION.
           if (parse_if_stmt_hat()) {
             // IR - Emit label for statement following the 'if' statement.
-            e->emit_label(if_done);
+            ir->emit_label(if_done);
             return true;
 
             // Fail to match IF_STMT_HAT.
@@ -1188,52 +1387,28 @@ bool Parser::parse_while_stmt() {
 
     expr_type expr_type_result = GARBAGE_T;
     Operand* expression = nullptr;
-    string* while_cond = e->get_new_label("while_cond");
-    string* while_done = e->get_new_label("while_done");
+    Basic_Block* while_cond = new_block("while_cond");
+    Basic_Block* while_done = new_block("while_done");
 
     // IR - Emit label for the evaluation of the 'while' condition.
-    e->emit_label(while_cond);
+    ir->emit_label(while_cond);
+
+    // IR - Boolean operators in the condition compile to jumping code.
+    jumping_mode = true;
 
     // Match EXPR - ACTION.
     if (parse_expr(expr_type_result, expression)) {
+      jumping_mode = false;
+
       // Semantic analysis.
       if (expr_type_result != BOOL_T) {
         type_error(BOOL_T, expr_type_result);
       }
 
-      // IR - Make sure the operand holding expression value is in a register.
-      Register* expression_register = nullptr;
-      if (expression->get_type() == OPTYPE_REGISTER) {
-        expression_register = expression->get_r_value();
-      } else {
-        // Allocate a register for expression value and move it there.
-        // Spill last_register_op if there is no register available for
-        // allocation. There is no need to reset last_register_op to
-        // expression_register since it will be deallocated right after its use.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        expression_register = allocator->allocate_register();
-        if (expression->get_type() == OPTYPE_IMMEDIATE) {
-          e->emit_move(expression_register, expression->get_i_value());
-        } else if (expression->get_type() == OPTYPE_MEMORY) {
-          e->emit_move(expression_register, expression->get_m_value());
-        }
-      }
-
-      // Test the register that holds expression register.
-      // If it is false, skip the body of the loop.
-      e->emit_branch(INST_BREZ, expression_register, while_done);
-
-      // Deallocate the expression operand and the associated register.
-      allocator->deallocate_register(expression_register);
-      delete expression;
+      // IR - If the condition is false, skip the body of the loop. This also
+      // consumes the expression operand.
+      vector<Basic_Block *> false_labels =
+          branch_on_false(expression, while_done);
 
       // Match keyword loop.
       if (is_keyword(word, KW_LOOP)) {
@@ -1245,9 +1420,10 @@ bool Parser::parse_while_stmt() {
         // Code generation for the loop body is handled by parse_block().
         if (parse_block()) {
           // IR - Loop back to evaluate loop condition.
-          e->emit_branch(while_cond);
+          ir->emit_branch(while_cond);
           // IR - Emit label for the statement following the 'while' loop.
-          e->emit_label(while_done);
+          ir->emit_label(while_done);
+          emit_labels(false_labels);
 
           return true;
 
@@ -1294,37 +1470,8 @@ bool Parser::parse_print_stmt() {
         type_error(INT_T, BOOL_T, expr_type_result);
       }
 
-      // IR - Make sure that operand holding expr value is in a register.
-      Register* expression_register = nullptr;
-      if (expression->get_type() == OPTYPE_REGISTER) {
-        expression_register = expression->get_r_value();
-      } else {
-        // Allocate a register for the expression value and move it there.
-        // Spill last_register_op if there is no register available
-        // for allocation. There is no need to reset last_register_op to
-        // expression_register since it will be allocated right after its use.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        expression_register = allocator->allocate_register();
-        if (expression->get_type() == OPTYPE_IMMEDIATE) {
-          e->emit_move(expression_register, expression->get_i_value());
-        } else if (expression->get_type() == OPTYPE_MEMORY) {
-          e->emit_move(expression_register, expression->get_m_value());
-        }
-      }
-
-      // Generate instruction to print expression.
-      e->emit_1addr(INST_OUTB, expression_register);
-
-      // Deallocate the expression operand and the containing register.
-      allocator->deallocate_register(expression_register);
+      // IR - Generate instruction to print expression.
+      ir->emit_1addr(IR_OUTB, expression->get_ir_value());
       delete expression;
 
       return true;
@@ -1372,7 +1519,7 @@ bool Parser::parse_actual_parm_list() {
   LOG("ACTUAL_PARM_LIST -> EXPR ACTUAL_PARM_LIST_HAT");
 
   expr_type expr_type_result = GARBAGE_T;
-  Operand* expression = nullptr;  // Unimplemented.
+  Operand* expression = nullptr;
 
   // Match EXPR - ACTION.
   if (parse_expr(expr_type_result, expression)) {
@@ -1381,6 +1528,10 @@ bool Parser::parse_actual_parm_list() {
     if (expr_type_result != expected_type) {
       type_error(expected_type, expr_type_result);
     }
+
+    // IR - Pass the value of the expression to the formal parameter.
+    ir->emit_param(actual_parm_position, expression->get_ir_value());
+    delete expression;
     ++actual_parm_position;
 
     // Match ACTUAL_PARM_LIST_HAT - ACTION.
@@ -1458,111 +1609,90 @@ bool Parser::parse_expr_hat(expr_type& expr_hat_type, Operand*& left_op) {
         type_error(INT_T, simple_expr_type);
       }
 
-      // IR - Generate code for "left_op relop right_op".
-      // Make sure that left_op is in a register.
-      Register* left_op_reg;
-      if (left_op->get_type() == OPTYPE_REGISTER) {
-        left_op_reg = left_op->get_r_value();
-      } else {
-        // Spill last_register_op if there is no register available
-        // for allocation.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        left_op_reg = allocator->allocate_register();
-        if (left_op->get_type() == OPTYPE_IMMEDIATE) {
-          e->emit_move(left_op_reg, left_op->get_i_value());
-        } else {
-          e->emit_move(left_op_reg, left_op->get_m_value());
-        }
+      // IR - Compare two constants at compile time.
+      if (left_op->get_type() == OPTYPE_IMMEDIATE
+          && right_op->get_type() == OPTYPE_IMMEDIATE) {
+        const bool holds = compare(comparator, left_op->get_i_value(),
+                                   right_op->get_i_value());
         delete left_op;
-        left_op = new Operand(OPTYPE_REGISTER, left_op_reg);
+        delete right_op;
+        left_op = new Operand(OPTYPE_IMMEDIATE, holds ? 1 : 0);
+        return true;
       }
 
-      // Set last_register_op to left_op.
-      last_register_op = &left_op;
-
-      // Store value of left_op - right_op in the register containing left_op.
-      e->emit_comment("Compare two values by examining their difference.");
-      switch (right_op->get_type()) {
-        case OPTYPE_REGISTER:
-          e->emit_2addr(INST_SUB, left_op->get_r_value(),
-                        right_op->get_r_value());
-          break;
-
-        case OPTYPE_IMMEDIATE:
-          e->emit_2addr(INST_SUB, left_op->get_r_value(),
-                        right_op->get_i_value());
-          break;
-
-        case OPTYPE_MEMORY:
-          e->emit_2addr(INST_SUB, left_op->get_r_value(),
-                        right_op->get_m_value());
-          break;
-
-        default:
-          break;
+      // IR - Generate code for "left_op relop right_op". Against 0, the
+      // difference is the left operand itself. Unoptimized variables live
+      // in memory, so load it once for all the branches.
+      IR_Operand difference = left_op->get_ir_value();
+      if (right_op->get_type() != OPTYPE_IMMEDIATE
+          || right_op->get_i_value() != 0) {
+        difference = ir->get_function()->new_vreg(INT_T);
+        ir->emit_comment("Compare two values by examining their difference.");
+        ir->emit_3addr(IR_SUB, difference, left_op->get_ir_value(),
+                       right_op->get_ir_value());
+      } else if (!difference.is_vreg() && !passes.optimizes()) {
+        difference = ir->get_function()->new_vreg(INT_T);
+        ir->emit_move(difference, left_op->get_ir_value());
       }
+      delete left_op;
+      delete right_op;
 
-      string* compare_false = e->get_new_label("compare_false");
-      string* compare_done = e->get_new_label("compare_done");
-
-      e->emit_comment("Normalize result of comparison to 0 or 1.");
+      Basic_Block* compare_false = new_block("compare_false");
+      Basic_Block* compare_done = nullptr;
+      if (jumping_mode) {
+        ir->emit_comment("Branch away if the comparison fails.");
+      } else {
+        compare_done = new_block("compare_done");
+        ir->emit_comment("Normalize result of comparison to 0 or 1.");
+      }
 
       // IR - Emit instruction to evaluate the relational expression.
       switch (comparator) {
         case RELOP_EQ:
-          e->emit_branch(INST_BRNE, left_op->get_r_value(), compare_false);
-          e->emit_branch(INST_BRPO, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BRNE, difference, compare_false);
+          ir->emit_branch(IR_BRPO, difference, compare_false);
           break;
 
         case RELOP_NE:
-          e->emit_branch(INST_BREZ, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BREZ, difference, compare_false);
           break;
 
         case RELOP_GT:
-          e->emit_branch(INST_BRNE, left_op->get_r_value(), compare_false);
-          e->emit_branch(INST_BREZ, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BRNE, difference, compare_false);
+          ir->emit_branch(IR_BREZ, difference, compare_false);
           break;
 
         case RELOP_GE:
-          e->emit_branch(INST_BRNE, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BRNE, difference, compare_false);
           break;
 
         case RELOP_LT:
-          e->emit_branch(INST_BREZ, left_op->get_r_value(), compare_false);
-          e->emit_branch(INST_BRPO, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BREZ, difference, compare_false);
+          ir->emit_branch(IR_BRPO, difference, compare_false);
           break;
 
         case RELOP_LE:
-          e->emit_branch(INST_BRPO, left_op->get_r_value(), compare_false);
+          ir->emit_branch(IR_BRPO, difference, compare_false);
           break;
 
         default:
           break;
       }
 
-      // IR - Emit instructions to populate left_op.
-      e->emit_move(left_op->get_r_value(), 1);
-      e->emit_branch(compare_done);
-      e->emit_label(compare_false);
-      e->emit_move(left_op->get_r_value(), 0);
-      e->emit_label(compare_done);
-
-      // Clean up right operand.
-      if (right_op->get_type() == OPTYPE_REGISTER) {
-        allocator->deallocate_register(right_op->get_r_value());
-      } else if (right_op->get_type() == OPTYPE_MEMORY) {
-        // Deallocate if right_op is stored in a spilled memory.
-        deallocate_spill_memory(right_op->get_m_value());
+      if (jumping_mode) {
+        // IR - Inside a condition the outcome stays in the control flow.
+        left_op = new Operand(OPTYPE_JUMP, vector<Basic_Block *>{compare_false},
+                              vector<Basic_Block *>());
+      } else {
+        // IR - Normalize result of comparison to 0 or 1.
+        IR_Operand result = ir->get_function()->new_vreg(BOOL_T);
+        ir->emit_move(result, IR_Operand(IR_IMMEDIATE, 1));
+        ir->emit_branch(compare_done);
+        ir->emit_label(compare_false);
+        ir->emit_move(result, IR_Operand(IR_IMMEDIATE, 0));
+        ir->emit_label(compare_done);
+        left_op = new Operand(result);
       }
-      delete right_op;
 
       return true;
 
@@ -1590,8 +1720,9 @@ bool Parser::parse_simple_expr(expr_type& simple_expr_type, Operand*& op) {
 
   // Match TERM and SIMPLE_EXPR_PRM - ACTION.
   // IR - Evaluation of operand is delegated to TERM and SIMPLE_EXPR_PRM.
+  const IR_Builder::Mark start = ir->mark();
   if (parse_term(term_type, op)
-      && parse_simple_expr_prm(simple_expr_prm_type, op)) {
+      && parse_simple_expr_prm(simple_expr_prm_type, op, start)) {
     // Semantic analysis.
     if (simple_expr_prm_type == NO_T) {
       simple_expr_type = term_type;
@@ -1609,7 +1740,8 @@ bool Parser::parse_simple_expr(expr_type& simple_expr_type, Operand*& op) {
 }
 
 bool Parser::parse_simple_expr_prm(expr_type& simple_expr_prm0_type,
-                                   Operand*& left_op) {
+                                   Operand*& left_op,
+                                   const IR_Builder::Mark& start) {
   /* SIMPLE_EXPR_PRM -> addop TERM SIMPLE_EXPR_PRM
      Predict(addop TERM SIMPLE_EXPR_PRM) == {addop} */
   if (is_addop(word)) {
@@ -1631,89 +1763,79 @@ bool Parser::parse_simple_expr_prm(expr_type& simple_expr_prm0_type,
 
     Operand* right_op = nullptr;
 
+    // IR - Inside a condition, 'or' compiles to jumping code: a true left
+    // operand jumps over the evaluation of the right operand. A constant
+    // true left operand decides the disjunction on its own.
+    bool short_circuit = jumping_mode && addop_attr == ADDOP_OR
+        && !absorbs(left_op, true);
+    Basic_Block *or_true = nullptr;
+    if (short_circuit) {
+      make_condition(left_op);
+      or_true = new_block("or_true");
+      ir->emit_branch(or_true);
+      emit_labels(left_op->get_false_labels());
+    }
+
     // Match TERM - ACTION.
     if (parse_term(term_type, right_op)) {
-      // IR - Generate code for "left_op addop right_op".
-      // Make sure that the left operand is stored in a register.
-      Register* left_op_reg;
-      if (left_op->get_type() == OPTYPE_REGISTER) {
-        left_op_reg = left_op->get_r_value();
-      } else {
-        // Spill last_register_op if there is no register available
-        // for allocation.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        left_op_reg = allocator->allocate_register();
-        if (left_op->get_type() == OPTYPE_IMMEDIATE) {
-          e->emit_move(left_op_reg, left_op->get_i_value());
-        } else {
-          e->emit_move(left_op_reg, left_op->get_m_value());
-        }
-        delete left_op;
-        left_op = new Operand(OPTYPE_REGISTER, left_op_reg);
-      }
-
-      // Set last_register_op to left_op.
-      last_register_op = &left_op;
-
-      // Output IR to perform the operation.
-      inst_type instruction;
+      // Determine which addop the program has called for.
+      ir_opcode_type opcode;
       if (addop_attr == ADDOP_ADD || addop_attr == ADDOP_OR) {
-        instruction = INST_ADD;
+        opcode = IR_ADD;
       } else {
-        instruction = INST_SUB;
-      }
-
-      // Output the appropriate instruction.
-      switch (right_op->get_type()) {
-        case OPTYPE_REGISTER:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_r_value());
-          break;
-
-        case OPTYPE_IMMEDIATE:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_i_value());
-          break;
-
-        case OPTYPE_MEMORY:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_m_value());
-          break;
-
-        default:
-          break;
+        opcode = IR_SUB;
       }
 
-      // Prevent the case when 'left_op or right_op' > 1 by normalizing
-      // the boolean result to 0 or 1.
-      if (addop_attr == ADDOP_OR) {
-        e->emit_comment("Normalize result of OR operation to 0 or 1.");
-        string *or_done = e->get_new_label("or_done");
-        e->emit_branch(INST_BREZ , left_op->get_r_value(), or_done);
-        e->emit_move(left_op->get_r_value(), 1);
-        e->emit_label(or_done);
-      }
+      if (addop_attr == ADDOP_OR
+          && (absorbs(left_op, true) || absorbs(right_op, true))
+          && may_drop(start, left_op, true, true)) {
+        // IR - 'true or b' and 'b or true' are true without evaluating b.
+        drop_operation(start, left_op, right_op, 1);
+      } else if (short_circuit) {
+        // IR - The disjunction fails only where the right operand fails.
+        make_condition(right_op);
+        vector<Basic_Block *> true_labels = left_op->get_true_labels();
+        true_labels.push_back(or_true);
+        true_labels.insert(true_labels.end(),
+                           right_op->get_true_labels().begin(),
+                           right_op->get_true_labels().end());
+        Operand *condition = new Operand(OPTYPE_JUMP,
+                                         right_op->get_false_labels(),
+                                         true_labels);
+        delete left_op;
+        delete right_op;
+        left_op = condition;
+      } else if (fold_operation(opcode, left_op, right_op)) {
+        // IR - The result is known at compile time. Normalize a constant
+        // disjunction to 0 or 1.
+        if (addop_attr == ADDOP_OR && left_op->get_type() == OPTYPE_IMMEDIATE
+            && left_op->get_i_value() != 0) {
+          delete left_op;
+          left_op = new Operand(OPTYPE_IMMEDIATE, 1);
+        }
+      } else {
+        // IR - Generate code for "left_op addop right_op".
+        IR_Operand result = ir->get_function()->new_vreg(addop_type);
+        ir->emit_3addr(opcode, result, left_op->get_ir_value(),
+                       right_op->get_ir_value());
+
+        // Prevent the case when 'left_op or right_op' > 1 by normalizing
+        // the boolean result to 0 or 1.
+        if (addop_attr == ADDOP_OR) {
+          ir->emit_comment("Normalize result of OR operation to 0 or 1.");
+          Basic_Block *or_done = new_block("or_done");
+          ir->emit_branch(IR_BREZ, result, or_done);
+          ir->emit_move(result, IR_Operand(IR_IMMEDIATE, 1));
+          ir->emit_label(or_done);
+        }
 
-      // Clean up the right operand.
-      if (right_op->get_type() == OPTYPE_REGISTER) {
-        allocator->deallocate_register(right_op->get_r_value());
-      } else if (right_op->get_type() == OPTYPE_MEMORY) {
-        // Deallocate if right_op is stored in a spilled memory.
-        deallocate_spill_memory(right_op->get_m_value());
+        delete left_op;
+        delete right_op;
+        left_op = new Operand(result);
       }
 
-      delete right_op;
-
       // Match SIMPLE_EXPR_PRM - ACTION.
-      if (parse_simple_expr_prm(simple_expr_prm1_type, left_op)) {
+      if (parse_simple_expr_prm(simple_expr_prm1_type, left_op, start)) {
         // Semantic analysis.
         if (simple_expr_prm1_type == NO_T) {
           if (addop_type == term_type) {
@@ -1756,10 +1878,11 @@ bool Parser::parse_term(expr_type& term_type, Operand*& op) {
 
   // Match FACTOR - ACTION.
   // IR - Get operand from parse_factor().
+  const IR_Builder::Mark start = ir->mark();
   if (parse_factor(factor_type, op)) {
     // Match TERM_PRM - ACTION.
     // IR - Send factor operand to parse_term_prm.
-    if (parse_term_prm(term_prm_type, op)) {
+    if (parse_term_prm(term_prm_type, op, start)) {
       // Semantic analysis.
       if (term_prm_type == NO_T) {
         term_type = factor_type;
@@ -1784,7 +1907,8 @@ bool Parser::parse_term(expr_type& term_type, Operand*& op) {
   return false;
 }
 
-bool Parser::parse_term_prm(expr_type& term_prm0_type, Operand*& left_op) {
+bool Parser::parse_term_prm(expr_type& term_prm0_type, Operand*& left_op,
+                            const IR_Builder::Mark& start) {
   /* TERM_PRM -> mulop FACTOR TERM_PRM
      Predict(mulop FACTOR TERM_PRM) = {mulop} */
 
@@ -1808,102 +1932,68 @@ bool Parser::parse_term_prm(expr_type& term_prm0_type, Operand*& left_op) {
     // ADVANCE.
     advance();
 
-    if (parse_factor(factor_type, right_op)) {
-      /* At this point, we can generate code for
-
-	 "left_op operation right_op".
-
-	 First we need to make sure the left operand (which
-	 was passed to us as a parm) is in a register.  If the left op
-	 is in a register, grab the register.  If the left operand is
-	 not in a register, allocate a register and move the operand
-	 there.
-      */
-      Register *left_op_reg;
-      if (left_op->get_type() == OPTYPE_REGISTER) {
-	// The left operand is already in a register.
-	left_op_reg = left_op->get_r_value();
-      } else {
-	// Allocate a new register and move the left op into it.
-        // Spill last_register_op if there is no register available for
-        // allocation.
-        if (!allocator->has_free_register()) {
-          const string *spill_location = allocate_spill_memory();
-          e->emit_comment(
-              "Spill register to memory since all registers are live.");
-          e->emit_move(spill_location, (*last_register_op)->get_r_value());
-          allocator->deallocate_register((*last_register_op)->get_r_value());
-          *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-        }
-
-        left_op_reg = allocator->allocate_register();
-	if (left_op->get_type() == OPTYPE_IMMEDIATE) {
-	  e->emit_move(left_op_reg, left_op->get_i_value());
-	} else {  // left factor op is in memory.
-	  e->emit_move(left_op_reg, left_op->get_m_value());
-	}
-	// We are done with the Operand object that our parent node
-	// gave us, and it no longer describes the left operand.
-	// Delete it and make a new Operand object representing the
-	// current state of the left operand, which is now in a
-	// register.
-	delete left_op;
-	left_op = new Operand(OPTYPE_REGISTER, left_op_reg);
-      }
-
-      // Reset last_register_op to left_op.
-      last_register_op = &left_op;
+    // IR - Inside a condition, 'and' compiles to jumping code: a false left
+    // operand jumps over the evaluation of the right operand. A constant
+    // false left operand decides the conjunction on its own.
+    bool short_circuit = jumping_mode && mulop_attr == MULOP_AND
+        && !absorbs(left_op, false);
+    if (short_circuit) {
+      make_condition(left_op);
+      emit_labels(left_op->get_true_labels());
+    }
 
-      /* Output IR to perform the operation.
-	 First, determine which mulop we the program has called for.
-      */
-      inst_type instruction;
+    if (parse_factor(factor_type, right_op)) {
+      /* Determine which mulop the program has called for. */
+      ir_opcode_type opcode;
       if (mulop_attr == MULOP_MUL || mulop_attr == MULOP_AND) {
-	instruction = INST_MUL;
+        opcode = IR_MUL;
       } else {
-	instruction = INST_DIV;
+        opcode = IR_DIV;
       }
 
-      /* Now, output the appropriate instruction, depending on the
-	 location (immediate, register, memory) of the right hand op.
-       */
-      switch (right_op->get_type()) {
-        case OPTYPE_REGISTER:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_r_value());
-          break;
-
-        case OPTYPE_IMMEDIATE:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_i_value());
-          break;
+      if (opcode == IR_MUL
+          && (absorbs(left_op, false) || absorbs(right_op, false))
+          && may_drop(start, left_op, mulop_attr == MULOP_AND, false)) {
+        // IR - x * 0, 0 * x, 'false and b' and 'b and false' are 0 without
+        // evaluating the other operand.
+        drop_operation(start, left_op, right_op, 0);
+      } else if (short_circuit) {
+        // IR - The conjunction fails wherever either operand fails.
+        make_condition(right_op);
+        vector<Basic_Block *> false_labels = left_op->get_false_labels();
+        false_labels.insert(false_labels.end(),
+                            right_op->get_false_labels().begin(),
+                            right_op->get_false_labels().end());
+        Operand *condition = new Operand(OPTYPE_JUMP, false_labels,
+                                         right_op->get_true_labels());
+        delete left_op;
+        delete right_op;
+        left_op = condition;
+      } else if (fold_operation(opcode, left_op, right_op)) {
+        // IR - The result is known at compile time.
+      } else {
+        /* At this point, we can generate code for
 
-        case OPTYPE_MEMORY:
-          e->emit_2addr(instruction, left_op->get_r_value(),
-                        right_op->get_m_value());
-          break;
+           "left_op operation right_op".
 
-        default:
-          break;
-      }
+           The result goes to a new virtual register. The code generator
+           later decides where operands live.
+        */
+        IR_Operand result = ir->get_function()->new_vreg(mulop_type);
+        ir->emit_3addr(opcode, result, left_op->get_ir_value(),
+                       right_op->get_ir_value());
 
-      /* Clean up.
-	 We are done with the right Operand object.
-      */
-      if (right_op->get_type() == OPTYPE_REGISTER) {
-	// IMPORTANT: don't forget to deallocate the register if
-	// you are done with an operand that resides in a
-	// register.  We only have 3 usuable ones.
-	allocator->deallocate_register(right_op->get_r_value());
-      } else if (right_op->get_type() == OPTYPE_MEMORY) {
-        // Deallocate if right_op is stored in a spilled memory.
-        deallocate_spill_memory(right_op->get_m_value());
+        /* Clean up.
+           We are done with both Operand objects.
+        */
+        delete left_op;
+        delete right_op;
+        left_op = new Operand(result);
       }
-      delete right_op;
 
       // Match TERM_PRM - ACTION.
       // Send left_op to next step in expression parse.
-      if (parse_term_prm(term_prm1_type, left_op)) {
+      if (parse_term_prm(term_prm1_type, left_op, start)) {
 	/* Semantic Analysis cont. */
 	if (term_prm1_type == NO_T && mulop_type == factor_type) {
 	  term_prm0_type = mulop_type;
@@ -1950,7 +2040,7 @@ bool Parser::parse_factor(expr_type& factor0_type, Operand*& op) {
       factor0_type = stab.get_type(identifier_attr, current_env);
     }
     // IR action.
-    op = new Operand(OPTYPE_MEMORY, identifier_attr);
+    op = new Operand(variable_operand(identifier_attr));
 
     // ADVANCE.
     advance();
@@ -2051,53 +2141,35 @@ bool Parser::parse_factor(expr_type& factor0_type, Operand*& op) {
 
 	/* At this point, we need to generate code to apply the sign
 	   operation to the operand.  If the sign is a "+", that's a
-	   no-op.  If it's a "-" or NOT, we need to move the operand
-	   into a register and then generate the instruction to peform
-	   the appropriate operation. */
-        if (sign_operation == 0) {  // SIGN is '+'.
+	   no-op.  If it's a "-" or NOT, we need to generate the
+	   instruction to peform the appropriate operation. */
+        if (sign_operation != 0 && op->get_type() == OPTYPE_IMMEDIATE) {
+          // IR - Apply the sign to a constant at compile time.
+          int value;
+          fold_constants(sign_operation == 1 ? IR_NEG : IR_NOT,
+                         op->get_i_value(), 0, value);
+          delete op;
+          op = new Operand(OPTYPE_IMMEDIATE, value);
+        } else if (sign_operation == 2 && jumping_mode) {  // Jumping 'not'.
+          // IR - Negate the operand as jumping code.
+          negate_condition(op);
+        } else if (sign_operation == 0) {  // SIGN is '+'.
           // do nothing.
 	} else {
-	  // Make sure operand is in a register.
-	  Register *op_register;
-	  if (op->get_type() == OPTYPE_REGISTER) {
-	    op_register = op->get_r_value();
-	  } else {
-            // Spill last_register_op if there is no register available
-            // for allocation.
-            if (!allocator->has_free_register()) {
-              const string *spill_location = allocate_spill_memory();
-              e->emit_comment(
-                  "Spill register to memory since all registers are live.");
-              e->emit_move(spill_location, (*last_register_op)->get_r_value());
-              allocator->deallocate_register(
-                  (*last_register_op)->get_r_value());
-              *last_register_op = new Operand(OPTYPE_MEMORY, spill_location);
-            }
-
-            op_register = allocator->allocate_register();
-	    // Emit instruction to move operand into register.
-	    if (op->get_type() == OPTYPE_IMMEDIATE) {
-	      // move Rn, #immediate_value
-	      e->emit_move(op_register, op->get_i_value());
-	    } else if (op->get_type() == OPTYPE_MEMORY) {
-	      // move RN, #memory_location_name
-	      e->emit_move(op_register, op->get_m_value());
-	    }
-
-	    // The operand is now in register op_register.  Make a new
-	    // operand object to represent it.
-	    delete op;
-            op = new Operand(OPTYPE_REGISTER, op_register);
-	  }  // op not in a register.
-
-          // Reset last_register_op to op.
-          last_register_op = &op;
-
-          // Finally, emit the instruction to perform the SIGN operation.
-          if (sign_operation == 1) {  // SIGN is '-'.
-            e->emit_1addr(INST_NEG, op->get_r_value());
-          } else if (sign_operation == 2) {  // SIGN is 'not'.
-            e->emit_1addr(INST_NOT, op->get_r_value());
+          const ir_opcode_type opcode = sign_operation == 1 ? IR_NEG : IR_NOT;
+          IR_Operand source;
+          if (op->get_ir_value().is_vreg()
+              && ir->undo_2addr(opcode, op->get_ir_value(), &source)) {
+            // IR - The operand was just computed by the same operation,
+            // which cancels out: '- (-x)' is x and 'not (not b)' is b.
+            delete op;
+            op = new Operand(source);
+          } else {
+            // Emit the instruction to perform the SIGN operation.
+            IR_Operand result = ir->get_function()->new_vreg(factor1_type);
+            ir->emit_2addr(opcode, result, op->get_ir_value());
+            delete op;
+            op = new Operand(result);
           }
 	}  // operation is "-" or "NOT".
 
@@ -28,16 +28,24 @@
 #include "symbol_table.h"
 
 // Imports for code generation.
-#include "register.h"
-#include "register_allocator.h"
+#include "code_generator.h"
+#include "constant_propagation.h"
+#include "dead_code.h"
 #include "emitter.h"
+#include "evaluation_order.h"
+#include "gvn.h"
+#include "inlining.h"
+#include "ir.h"
+#include "loop_invariants.h"
 #include "operand.h"
-
-// Disable semantic analysis. Useful for testing syntax analysis.
-#define PARSER_TEST_MODE 0
-
-// Enable descriptive logging. Useful for debugging.
-#define DEBUGMODE 0
+#include "pass_manager.h"
+#include "promotion.h"
+#include "sccp.h"
+#include "ssa.h"
+#include "stats.h"
+#include "strength_reduction.h"
+#include "unrolling.h"
+#include "value_numbering.h"
 
 using namespace std;
 
@@ -54,6 +62,62 @@ class Parser {
   // Returns true if current token is EOF.
   bool done_with_input() const;
 
+  // Returns the IR of the program parsed so far.
+  IR_Program *get_program() const;
+
+  // Sets how hard the generated code is optimized. At level 0, variables
+  // live in memory and registers only hold temporaries. From level 1 on,
+  // calls to small procedures are expanded inline, expressions are
+  // evaluated in the order needing the fewest registers, variables are
+  // promoted to virtual registers and registers are allocated by linear
+  // scan over the whole program. From level 2 on, constants and copies are
+  // also propagated, redundant and dead computations, unreachable blocks and
+  // unused variables removed, invariant computations hoisted out of loops,
+  // multiplications by constants or by induction variables reduced to
+  // additions, and counted loops unrolled. Sparse conditional constant
+  // propagation and global value numbering run on each function in SSA
+  // form in between. Defaults to 0. See Pass_Manager for the passes of
+  // each level.
+  void set_optimization_level(const int level);
+
+  // Sets the number of registers of the target TrAL machine, which
+  // Register_File must support. Defaults to TRAL_REGISTER_COUNT.
+  void set_register_count(const int count);
+
+  // Replaces the emitter writing the target code, which writes TrAL by
+  // default. The parser takes ownership of the emitter.
+  void set_emitter(Emitter *emitter);
+
+  // Sets whether the target code is annotated with comments, on any
+  // emitter. Defaults to false.
+  void set_comments(const bool enabled);
+
+  // Sets whether each token parsed, the symbol table and the IR about to be
+  // translated are logged to cerr. Defaults to false.
+  void set_debug(const bool enabled);
+
+  // Sets whether semantic errors are reported without stopping, and
+  // procedure declarations are accepted outside of any program, to test
+  // the syntax analysis alone. Defaults to false.
+  void set_syntax_only(const bool enabled);
+
+  // Sets how many copies of the body of counted loops are made from level 2
+  // on, or 1 to keep them rolled. Defaults to UNROLL_FACTOR.
+  void set_unroll_factor(const int factor);
+
+  // Sets the stream receiving the inlining decisions taken from level 1 on,
+  // or nullptr, the default, to keep them quiet.
+  void set_inlining_log(ostream *log);
+
+  // Returns the passes optimizing the IR, to enable or disable some of
+  // them or to read how long they took.
+  Pass_Manager *get_pass_manager();
+
+  // Sets whether parse_program() optimizes the IR and translates it to
+  // target code once the program is parsed, or only builds the IR for
+  // get_program(). Defaults to true.
+  void set_generate_code(const bool generate);
+
  private:
   // Parsers for each non-terminal in TruPL.
   bool parse_decl_list();
@@ -108,11 +172,13 @@ class Parser {
 
   bool parse_simple_expr(expr_type& simple_expr_type, Operand*& op);
 
-  bool parse_simple_expr_prm(expr_type& simple_expr_prm_type, Operand*& op);
+  bool parse_simple_expr_prm(expr_type& simple_expr_prm_type, Operand*& op,
+                             const IR_Builder::Mark& start);
 
   bool parse_term(expr_type& term_type, Operand*& op);
 
-  bool parse_term_prm(expr_type& term_prm_type, Operand*& op);
+  bool parse_term_prm(expr_type& term_prm_type, Operand*& op,
+                      const IR_Builder::Mark& start);
 
   bool parse_factor(expr_type& factor_type, Operand*& op);
 
@@ -154,26 +220,92 @@ class Parser {
   Symbol_Table stab;
 
   /*********** Code Generation **********/
-  Register_Allocator *allocator;
   Emitter *e;
 
-  // Labels used to generate data directives for all program variables.
-  vector<const string *> program_labels;
+  // The IR of the program. Each procedure gets its own IR_Function, after
+  // the one of the main program.
+  IR_Program *program;
+
+  // Appends IR to the function of the environment we are currently parsing.
+  IR_Builder *ir;
+
+  // True while parsing the condition of an 'if' or 'while' statement. Boolean
+  // operators are then compiled to short-circuit jumping code.
+  bool jumping_mode;
+
+  // Runs the passes enabled by set_optimization_level().
+  Pass_Manager passes;
+
+  // See set_register_count().
+  int register_count;
+
+  // See set_comments().
+  bool comments;
+
+  // See set_debug().
+  bool debug;
+
+  // See set_syntax_only().
+  bool syntax_only;
+
+  // See set_generate_code().
+  bool generate_code;
+
+  // Reserves memory for a variable of the current environment.
+  void declare_variable(const string *id);
+
+  // Sets the type of the variables just declared, like
+  // Symbol_Table::update_type().
+  void update_variable_types(const expr_type type);
+
+  // Returns the IR operand referring to a variable of the current
+  // environment.
+  IR_Operand variable_operand(const string *id) const;
+
+  // Returns the index of the function of a procedure in the program.
+  int function_index(const string *id) const;
+
+  // Creates a block with a new, unique label of the form "_prefixn".
+  Basic_Block *new_block(const char prefix[]);
+
+  // Turns a boolean operand into jumping code that branches away when the
+  // operand is false.
+  void make_condition(Operand*& op);
+
+  // Negates a boolean operand held as jumping code.
+  void negate_condition(Operand*& op);
+
+  // Consumes a condition: code following this call runs when it is true.
+  // Returns the blocks to be placed together with false_target.
+  vector<Basic_Block *> branch_on_false(Operand *condition,
+                                        Basic_Block *false_target);
+
+  // Places every block from a list of jumping code targets.
+  void emit_labels(const vector<Basic_Block *> &labels);
 
-  // Last operand to be placed in a register, to keep track of which register
-  // to spill onto memory when no register is available for allocation.
-  Operand **last_register_op;
+  // Tries to evaluate "left_op opcode right_op" at compile time, either
+  // because both operands are immediates or because an algebraic identity
+  // such as x*1 or x+0 applies. On success no code is emitted, left_op
+  // holds the result and right_op has been consumed.
+  bool fold_operation(const ir_opcode_type opcode, Operand*& left_op,
+                      Operand*& right_op);
 
-  // Labels used to generate data directives for memory locations used for
-  // register spilling. Each entry has the form <label, status> where status
-  // indicates whether the memory is active.
-  vector<pair<string *, bool>> spilled_labels;
+  // Checks if an operand is the constant that decides a product or a
+  // conjunction, 0, or a disjunction, any true value.
+  bool absorbs(const Operand* op, const bool disjunction) const;
 
-  // Allocates a memory location used for register spilling.
-  const string *allocate_spill_memory();
+  // Checks if the code emitted for the operands of an operation decided by
+  // one of them, since the start of the expression, may be dropped: it
+  // divides by nothing that may be zero, or it is the right operand of a
+  // logical operation skipped like in jumping code.
+  bool may_drop(const IR_Builder::Mark& start, const Operand* left_op,
+                const bool logical, const bool disjunction) const;
 
-  // Deallocates a memory location previously used for register spilling.
-  void deallocate_spill_memory(const string *spilled_label);
+  // Replaces an operation decided by one of its operands, such as x*0 or
+  // 'false and b', with its result. Drops the code emitted for both
+  // operands since the start of the expression.
+  void drop_operation(const IR_Builder::Mark& start, Operand*& left_op,
+                      Operand*& right_op, const int result);
 
   /* These functions are for signalling semantic errors.  None of
      them return - they exit and terminate the compilation.
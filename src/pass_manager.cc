@@ -0,0 +1,235 @@
+// Implementation of the pass manager.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "pass_manager.h"
+
+#include <chrono>
+#include <iomanip>
+
+#include "constant_propagation.h"
+#include "dead_code.h"
+#include "evaluation_order.h"
+#include "gvn.h"
+#include "inlining.h"
+#include "loop_invariants.h"
+#include "promotion.h"
+#include "sccp.h"
+#include "strength_reduction.h"
+#include "unrolling.h"
+#include "value_numbering.h"
+
+namespace {
+
+Pass new_pass(const string &name, const int level,
+              const pass_kind_type kind) {
+  Pass pass;
+  pass.name = name;
+  pass.level = level;
+  pass.kind = kind;
+  pass.runs = 0;
+  pass.seconds = 0;
+  return pass;
+}
+
+// Returns the seconds elapsed since start.
+double seconds_since(const std::chrono::steady_clock::time_point &start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+Pass_Manager::Pass_Manager()
+    : level(0), unroll_factor(UNROLL_FACTOR), inlining_log(nullptr),
+      ssa_seconds(0) {
+  Pass pass = new_pass("inline", 1, PASS_PROGRAM);
+  pass.run_program = [this](IR_Program *program) {
+    inline_procedures(program, inlining_log);
+  };
+  passes.push_back(pass);
+
+  pass = new_pass("order-evaluation", 1, PASS_FUNCTION);
+  pass.run_function = order_evaluation;
+  passes.push_back(pass);
+  pass = new_pass("promote", 1, PASS_FUNCTION);
+  pass.run_function = promote_variables;
+  passes.push_back(pass);
+
+  pass = new_pass("propagate-constants", 2, PASS_FUNCTION);
+  pass.run_function = propagate_constants;
+  passes.push_back(pass);
+  pass = new_pass("number-values", 2, PASS_FUNCTION);
+  pass.run_function = number_values;
+  passes.push_back(pass);
+  pass = new_pass("eliminate-dead-code", 2, PASS_FUNCTION);
+  pass.run_function = eliminate_dead_code;
+  passes.push_back(pass);
+
+  pass = new_pass("sccp", 2, PASS_SSA);
+  pass.run_ssa = propagate_conditional_constants;
+  passes.push_back(pass);
+  pass = new_pass("gvn", 2, PASS_SSA);
+  pass.run_ssa = number_global_values;
+  passes.push_back(pass);
+
+  pass = new_pass("hoist-invariants", 2, PASS_FUNCTION);
+  pass.run_function = hoist_loop_invariants;
+  passes.push_back(pass);
+  pass = new_pass("reduce-strength", 2, PASS_FUNCTION);
+  pass.run_function = reduce_strength;
+  passes.push_back(pass);
+  pass = new_pass("unroll", 2, PASS_FUNCTION);
+  pass.run_function = [this](IR_Function *function) {
+    unroll_loops(function, unroll_factor);
+  };
+  passes.push_back(pass);
+
+  // Forward the copies left by global value numbering, fold the products
+  // set up before the loops and the induction variables of the unrolled
+  // ones, and drop the computations left unread.
+  pass = new_pass("propagate-constants", 2, PASS_FUNCTION);
+  pass.run_function = propagate_constants;
+  passes.push_back(pass);
+  pass = new_pass("eliminate-dead-code", 2, PASS_FUNCTION);
+  pass.run_function = eliminate_dead_code;
+  passes.push_back(pass);
+
+  pass = new_pass("remove-unused-variables", 2, PASS_PROGRAM);
+  pass.run_program = [](IR_Program *program) {
+    remove_unused_variables(program->functions.front());
+  };
+  passes.push_back(pass);
+}
+
+void Pass_Manager::set_level(const int the_level) {
+  level = the_level;
+}
+
+bool Pass_Manager::set_enabled(const string &name, const bool enabled) {
+  for (const Pass &pass : passes) {
+    if (pass.name == name) {
+      overrides[name] = enabled;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Pass_Manager::is_enabled(const Pass &pass) const {
+  map<string, bool>::const_iterator it = overrides.find(pass.name);
+  if (it != overrides.end()) {
+    return it->second;
+  }
+  return pass.level <= level;
+}
+
+bool Pass_Manager::optimizes() const {
+  for (const Pass &pass : passes) {
+    if (is_enabled(pass)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Pass_Manager::set_unroll_factor(const int factor) {
+  unroll_factor = factor;
+}
+
+void Pass_Manager::set_inlining_log(ostream *log) {
+  inlining_log = log;
+}
+
+void Pass_Manager::run(IR_Program *program) {
+  unsigned int i = 0;
+  while (i < passes.size()) {
+    if (passes[i].kind == PASS_PROGRAM) {
+      if (is_enabled(passes[i])) {
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        passes[i].run_program(program);
+        passes[i].seconds += seconds_since(start);
+        ++passes[i].runs;
+      }
+      ++i;
+      continue;
+    }
+
+    // Run the following passes on one function at a time.
+    unsigned int end = i;
+    while (end < passes.size() && passes[end].kind != PASS_PROGRAM) {
+      ++end;
+    }
+    for (IR_Function *function : program->functions) {
+      SSA_Form *ssa = nullptr;
+      for (unsigned int j = i; j < end; ++j) {
+        Pass &pass = passes[j];
+        if (!is_enabled(pass)) {
+          continue;
+        }
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        if (pass.kind == PASS_SSA && ssa == nullptr) {
+          ssa = new SSA_Form(function);
+          ssa_seconds += seconds_since(start);
+          start = std::chrono::steady_clock::now();
+        } else if (pass.kind == PASS_FUNCTION && ssa != nullptr) {
+          ssa->destroy();
+          delete ssa;
+          ssa = nullptr;
+          ssa_seconds += seconds_since(start);
+          start = std::chrono::steady_clock::now();
+        }
+        if (pass.kind == PASS_SSA) {
+          pass.run_ssa(*ssa);
+        } else {
+          pass.run_function(function);
+        }
+        pass.seconds += seconds_since(start);
+        ++pass.runs;
+      }
+      if (ssa != nullptr) {
+        const std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        ssa->destroy();
+        delete ssa;
+        ssa_seconds += seconds_since(start);
+      }
+    }
+    i = end;
+  }
+
+  for (IR_Function *function : program->functions) {
+    function->build_cfg();
+  }
+}
+
+void Pass_Manager::print_timing(ostream &out) const {
+  out << left << setw(26) << "Pass" << right << setw(6) << "Runs"
+      << setw(12) << "Time (ms)" << endl;
+  double total = ssa_seconds;
+  for (const Pass &pass : passes) {
+    if (pass.runs == 0) {
+      continue;
+    }
+    out << left << setw(26) << pass.name << right << setw(6) << pass.runs
+        << setw(12) << fixed << setprecision(3) << pass.seconds * 1000
+        << endl;
+    total += pass.seconds;
+  }
+  if (ssa_seconds > 0) {
+    out << left << setw(26) << "(ssa form)" << right << setw(6) << ""
+        << setw(12) << fixed << setprecision(3) << ssa_seconds * 1000
+        << endl;
+  }
+  out << left << setw(26) << "Total" << right << setw(6) << ""
+      << setw(12) << fixed << setprecision(3) << total * 1000 << endl;
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+}
+
+const vector<Pass> &Pass_Manager::get_passes() const {
+  return passes;
+}
@@ -0,0 +1,126 @@
+// Pipeline of the optimization passes run on the IR.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "ssa.h"
+
+using namespace std;
+
+// Highest optimization level, running every pass.
+const int MAX_OPTIMIZATION_LEVEL = 2;
+
+// What an optimization pass works on.
+typedef enum pass_kind { PASS_PROGRAM,   // The whole program.
+                         PASS_FUNCTION,  // Each function in turn.
+                         PASS_SSA        // Each function in SSA form.
+                       } pass_kind_type;
+
+// An optimization pass at some place of the pipeline.
+struct Pass {
+  // Name used to enable or disable the pass.
+  string name;
+
+  // Lowest optimization level running the pass.
+  int level;
+
+  pass_kind_type kind;
+
+  // Runs the pass, whichever matches its kind.
+  function<void(IR_Program *)> run_program;
+  function<void(IR_Function *)> run_function;
+  function<void(SSA_Form &)> run_ssa;
+
+  // Number of programs or functions the pass ran on, and the time it took,
+  // in seconds.
+  int runs;
+  double seconds;
+};
+
+/* Runs the optimization passes enabled at some level, in a fixed order:
+
+     inline                   expand calls to small procedures inline
+     order-evaluation         evaluate expressions needing more registers first
+     promote                  keep variables in virtual registers
+     propagate-constants      propagate constants and copies
+     number-values            remove redundant computations within blocks
+     eliminate-dead-code      remove dead code and unreachable blocks
+     sccp                     sparse conditional constant propagation
+     gvn                      global value numbering
+     hoist-invariants         hoist invariant computations out of loops
+     reduce-strength          replace multiplications with additions
+     unroll                   unroll counted loops
+     propagate-constants      again, to clean up after the loop passes
+     eliminate-dead-code      again
+     remove-unused-variables  drop the data directives of unused variables
+
+   Level 1 runs the first three passes, and level 2 all of them. Any pass
+   can be enabled or disabled by name whatever the level, which applies to
+   every place it appears in. Functions enter SSA form before a run of
+   consecutive SSA passes and leave it after.
+
+   The time spent in each pass is measured, as well as the time spent
+   entering and leaving SSA form. */
+class Pass_Manager {
+ public:
+  // Sets up the pipeline at level 0, which runs no pass.
+  Pass_Manager();
+
+  void set_level(const int level);
+
+  // Overrides the level for every pass with the given name. Returns false
+  // if there is no such pass.
+  bool set_enabled(const string &name, const bool enabled);
+
+  // Checks if a pass runs at the current level, given the overrides.
+  bool is_enabled(const Pass &pass) const;
+
+  // Checks if some pass runs, which leaves virtual registers live across
+  // blocks.
+  bool optimizes() const;
+
+  // Sets how many copies of the body of counted loops are made. Defaults
+  // to UNROLL_FACTOR.
+  void set_unroll_factor(const int factor);
+
+  // Sets the stream receiving the inlining decisions, or nullptr, the
+  // default, to keep them quiet.
+  void set_inlining_log(ostream *log);
+
+  // Runs the enabled passes on a program, then builds the control flow
+  // graph of its functions.
+  void run(IR_Program *program);
+
+  // Writes a table of the number of runs and the time of each pass in
+  // pipeline order, with the passes that did not run left out.
+  void print_timing(ostream &out) const;
+
+  const vector<Pass> &get_passes() const;
+
+ private:
+  vector<Pass> passes;
+
+  int level;
+  map<string, bool> overrides;
+
+  int unroll_factor;
+  ostream *inlining_log;
+
+  // Time spent entering and leaving SSA form, in seconds.
+  double ssa_seconds;
+
+  // The passes refer to the settings of their manager.
+  Pass_Manager(const Pass_Manager &) = delete;
+  Pass_Manager &operator=(const Pass_Manager &) = delete;
+};
+
+#endif
@@ -0,0 +1,122 @@
+// Implementation of variable promotion.
+// @author Hieu Le
+// @version 12/22/2016
+
+#include "promotion.h"
+
+#include <utility>
+#include <vector>
+
+#include "liveness.h"
+
+namespace {
+
+// Replaces every reference to a variable by the virtual register standing
+// for it.
+void replace_variable(IR_Operand &operand, const vector<int> &homes) {
+  if (operand.is_variable()) {
+    operand = IR_Operand(IR_VREG, homes[operand.get_value()]);
+  }
+}
+
+// Computes the value of a temporary directly into the variable it is copied
+// to when the copy is its only use.
+void coalesce_copies(IR_Function *function) {
+  vector<int> references(function->vreg_types.size(), 0);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg()) {
+          ++references[operand->get_value()];
+        }
+      }
+    }
+  }
+
+  for (Basic_Block *block : function->blocks) {
+    vector<IR_Instruction> &code = block->instructions;
+    for (unsigned int i = 1; i < code.size(); ++i) {
+      IR_Instruction &copy = code[i];
+      IR_Instruction &definition = code[i - 1];
+      if (copy.opcode != IR_MOVE || !copy.dst.is_vreg()
+          || copy.src1 != definition.dst || !definition.dst.is_vreg()
+          || function->promoted_from[definition.dst.get_value()] != -1
+          || references[definition.dst.get_value()] != 2) {
+        continue;
+      }
+
+      // Two-address code computes the result in place of src1, so the
+      // variable must not be the second operand of a subtraction or a
+      // division. Other operations commute.
+      if (definition.src2 == copy.dst && definition.src1 != copy.dst) {
+        if (definition.opcode == IR_SUB || definition.opcode == IR_DIV) {
+          continue;
+        }
+        swap(definition.src1, definition.src2);
+      }
+
+      definition.dst = copy.dst;
+      code.erase(code.begin() + i);
+      --i;
+    }
+  }
+}
+
+}  // namespace
+
+void promote_variables(IR_Function *function) {
+  const int n_variables = function->variables.size();
+  vector<int> homes(n_variables);
+  for (int i = 0; i < n_variables; ++i) {
+    homes[i] = function->new_vreg(function->variables[i].type).get_value();
+    function->promoted_from[homes[i]] = i;
+  }
+
+  vector<bool> assigned(n_variables, false);
+  for (Basic_Block *block : function->blocks) {
+    for (IR_Instruction &instruction : block->instructions) {
+      if (instruction.dst.is_variable()) {
+        assigned[instruction.dst.get_value()] = true;
+      }
+      replace_variable(instruction.dst, homes);
+      replace_variable(instruction.src1, homes);
+      replace_variable(instruction.src2, homes);
+    }
+  }
+
+  coalesce_copies(function);
+
+  // Load the variables that may be read before being written.
+  function->build_cfg();
+  Liveness liveness(function);
+  Basic_Block *entry = function->blocks.front();
+  vector<IR_Instruction> loads;
+  for (int i = 0; i < n_variables; ++i) {
+    if (liveness.is_live_in(entry, homes[i])) {
+      loads.push_back(IR_Instruction(IR_MOVE, IR_Operand(IR_VREG, homes[i]),
+                                     IR_Operand(IR_VARIABLE, i), IR_Operand(),
+                                     nullptr));
+    }
+  }
+  entry->instructions.insert(entry->instructions.begin(), loads.begin(),
+                             loads.end());
+
+  // Write the assigned variables back to memory before the program halts,
+  // but for the temporary ones.
+  for (Basic_Block *block : function->blocks) {
+    vector<IR_Instruction> &code = block->instructions;
+    if (code.empty() || code.back().opcode != IR_HALT) {
+      continue;
+    }
+    vector<IR_Instruction> stores;
+    for (int i = 0; i < n_variables; ++i) {
+      if (assigned[i] && !function->variables[i].temporary) {
+        stores.push_back(IR_Instruction(IR_MOVE, IR_Operand(IR_VARIABLE, i),
+                                        IR_Operand(IR_VREG, homes[i]),
+                                        IR_Operand(), nullptr));
+      }
+    }
+    code.insert(code.end() - 1, stores.begin(), stores.end());
+  }
+}
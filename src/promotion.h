@@ -0,0 +1,22 @@
+// Promotion of variables to virtual registers.
+// @author Hieu Le
+// @version 12/22/2016
+
+#ifndef PROMOTION_H
+#define PROMOTION_H
+
+#include "ir.h"
+
+/* Rewrites a function so that each of its variables lives in a virtual
+   register of its own, which the register allocator may then keep in a
+   register across loops. The value of a variable is loaded from memory at
+   the entry of the function only if it may be read before being written,
+   and written back to memory before the program halts only if the
+   function assigns it.
+
+   A temporary that is only copied into a variable right after being
+   computed is replaced by that variable, so "t := a - b; a := t" becomes
+   "a := a - b". */
+void promote_variables(IR_Function *function);
+
+#endif
@@ -1,58 +1,22 @@
-// Implementation of RegisterAllocator class.
+// Implementation of Register_File class.
 // @author Hieu Le
-// @version 12/05/2016
+// @version 12/23/2016
 
 #include "register_allocator.h"
 
-Register_Allocator::Register_Allocator() {
-  for (int i = 0; i < N_REGS; i++) {
-    register_set[i] = new Register(i);
-  }
-
-  // Reserve the stack register. It can not be used except to access the
-  // procedure call stack (which we will not be doing.)
-  register_set[STACK_REG]->set_inuse();
-}
-
-Register_Allocator::~Register_Allocator() {
-  for (int i = 0; i < N_REGS; i++) {
-    delete register_set[i];
-  }
-}
+Register_File::~Register_File() {}
 
-// Find a free register and return it.
-Register *Register_Allocator::allocate_register() {
-  // Iterate over all the registers, looking for one that has
-  // not been allocated.
-  for (int i = 0; i < N_REGS; i++) {
-    if (!register_set[i]->is_inuse()) {
-      register_set[i]->set_inuse();
-      return register_set[i];
-    }
-  }
-  cout << "NO FREE REGISTERS!!!" << endl;
-  return NULL;
-}
-
-// Make a previously allocated register available for reallocation.
-void Register_Allocator::deallocate_register(Register *reg) {
-  if (!register_set[reg->get_num()]->is_inuse()) {
-    // Ooops, your intermediate code generator is broken.
-    freeing_unallocated_register(reg);
-  }
-  register_set[reg->get_num()]->clear_inuse();
+bool Register_File::is_supported(const int n_registers) {
+  return n_registers == 4 || n_registers == 8 || n_registers == 16
+      || n_registers == 32;
 }
 
-bool Register_Allocator::has_free_register() const {
-  for (int i = 0; i < N_REGS; ++i) {
-    if (!register_set[i]->is_inuse()) {
-      return true;
-    }
+Register_File *Register_File::create(const int n_registers) {
+  switch (n_registers) {
+    case 4: return new Register_Allocator<4>();
+    case 8: return new Register_Allocator<8>();
+    case 16: return new Register_Allocator<16>();
+    case 32: return new Register_Allocator<32>();
+    default: return nullptr;
   }
-  return false;
-}
-
-void Register_Allocator::freeing_unallocated_register(Register *reg) {
-  cout << "Attempt to free unallocated register number ";
-  cout << reg->get_num() << endl;
 }
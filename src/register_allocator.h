@@ -1,43 +1,146 @@
 // Register allocator manages Register objects.
 // @author Hieu Le
-// @version 12/05/2016
+// @version 12/23/2016
 
 #ifndef REGISTER_ALLOCATOR_H
 #define REGISTER_ALLOCATOR_H
 
-// The total number of registers.
-#define N_REGS 4
-// R3 is reserved.
-#define STACK_REG 3
-
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <iostream>
+#include <vector>
 
 #include "register.h"
 
 using namespace std;
 
-class Register_Allocator {
+// The number of registers of the standard TrAL machine.
+const int TRAL_REGISTER_COUNT = 4;
+
+// Hands out the registers of a TrAL machine. The last register is reserved
+// as the stack register.
+class Register_File {
+ public:
+  virtual ~Register_File();
+
+  // Gets an unused register.
+  virtual Register *allocate_register() = 0;
+
+  // Frees a previously allocated register.
+  virtual void deallocate_register(Register *r) = 0;
+
+  // Checks if there is a register available for allocation.
+  virtual bool has_free_register() const = 0;
+
+  // Returns the number of registers, including the stack register.
+  virtual int get_register_count() const = 0;
+
+  // Returns the stack register.
+  virtual const Register *get_stack_register() const = 0;
+
+  // Checks if a register file of the given size can be created.
+  static bool is_supported(const int n_registers);
+
+  // Creates a register file with the given number of registers, or returns
+  // nullptr if the size is not supported.
+  static Register_File *create(const int n_registers);
+};
+
+// A register file of N_REGS registers. Free registers are kept as a bit
+// mask, so that allocating the lowest free register is a single
+// find-first-set.
+template <int N_REGS>
+class Register_Allocator : public Register_File {
+  static_assert(N_REGS >= 2 && N_REGS <= 64,
+                "A register file has between 2 and 64 registers.");
+
  public:
   Register_Allocator();
   ~Register_Allocator();
 
-  // Gets an unused register.
   Register *allocate_register();
 
-  // Frees a previously allocated register.
   void deallocate_register(Register *r);
 
-  // Checks if there is a register available for allocation.
   bool has_free_register() const;
 
+  int get_register_count() const;
+
+  const Register *get_stack_register() const;
+
  private:
   // The register set we can allocate from.
-  Register *register_set[N_REGS];
+  vector<Register> register_set;
+
+  // Bit i is set when register i is free.
+  uint64_t free_mask;
 
   // Internal error routine.
   void freeing_unallocated_register(Register *reg);
 };
 
+template <int N_REGS>
+Register_Allocator<N_REGS>::Register_Allocator() {
+  register_set.reserve(N_REGS);
+  for (int i = 0; i < N_REGS; ++i) {
+    register_set.push_back(Register(i));
+  }
+  free_mask = N_REGS == 64 ? ~0ull : (1ull << N_REGS) - 1;
+
+  // Reserve the stack register. It can not be used except to access the
+  // procedure call stack.
+  free_mask &= ~(1ull << (N_REGS - 1));
+  register_set[N_REGS - 1].set_inuse();
+}
+
+template <int N_REGS>
+Register_Allocator<N_REGS>::~Register_Allocator() {}
+
+// Find the lowest free register and return it.
+template <int N_REGS>
+Register *Register_Allocator<N_REGS>::allocate_register() {
+  const int i = __builtin_ffsll(free_mask) - 1;
+  if (i < 0) {
+    cout << "NO FREE REGISTERS!!!" << endl;
+    return NULL;
+  }
+  free_mask &= ~(1ull << i);
+  register_set[i].set_inuse();
+  return &register_set[i];
+}
+
+// Make a previously allocated register available for reallocation.
+template <int N_REGS>
+void Register_Allocator<N_REGS>::deallocate_register(Register *reg) {
+  const int i = reg->get_num();
+  if (free_mask & (1ull << i)) {
+    // Ooops, your intermediate code generator is broken.
+    freeing_unallocated_register(reg);
+  }
+  free_mask |= 1ull << i;
+  register_set[i].clear_inuse();
+}
+
+template <int N_REGS>
+bool Register_Allocator<N_REGS>::has_free_register() const {
+  return free_mask != 0;
+}
+
+template <int N_REGS>
+int Register_Allocator<N_REGS>::get_register_count() const {
+  return N_REGS;
+}
+
+template <int N_REGS>
+const Register *Register_Allocator<N_REGS>::get_stack_register() const {
+  return &register_set[N_REGS - 1];
+}
+
+template <int N_REGS>
+void Register_Allocator<N_REGS>::freeing_unallocated_register(Register *reg) {
+  cout << "Attempt to free unallocated register number ";
+  cout << reg->get_num() << endl;
+}
+
 #endif
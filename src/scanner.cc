@@ -6,6 +6,8 @@
 
 #include <vector>
 
+#include "stats.h"
+
 Scanner::Scanner(char *filename) : buffer_(new Buffer(filename)) {}
 
 Scanner::Scanner(Buffer *buffer) : buffer_(buffer) {}
@@ -1224,5 +1226,6 @@ Token *Scanner::next_token() {
     }
   }
 
+  count_token(token->get_token_type());
   return token;
 }
@@ -0,0 +1,293 @@
+// Implementation of sparse conditional constant propagation.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "sccp.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "constant_propagation.h"
+
+namespace {
+
+// What a version holds, from most to least known.
+typedef enum cell_kind { CELL_UNKNOWN,   // Not computed yet.
+                         CELL_CONSTANT,  // The constant value.
+                         CELL_ANY } cell_kind_type;
+
+struct Cell {
+  cell_kind_type kind;
+  int value;
+};
+
+const Cell UNKNOWN = {CELL_UNKNOWN, 0};
+const Cell ANY = {CELL_ANY, 0};
+
+// Combines the values coming along two paths.
+Cell meet(const Cell &first, const Cell &second) {
+  if (first.kind == CELL_UNKNOWN) {
+    return second;
+  }
+  if (second.kind == CELL_UNKNOWN) {
+    return first;
+  }
+  if (first.kind == CELL_CONSTANT && second.kind == CELL_CONSTANT
+      && first.value == second.value) {
+    return first;
+  }
+  return ANY;
+}
+
+// The analysis, with the two work lists of Wegman and Zadeck: one of the
+// control flow edges found to be taken, and one of the versions whose value
+// changed.
+class Propagator {
+ public:
+  explicit Propagator(IR_Function *function);
+
+  // Runs the analysis to a fixed point.
+  void solve();
+
+  // Rewrites the function from the results.
+  void rewrite();
+
+ private:
+  IR_Function *function;
+
+  vector<Cell> cells;
+  vector<bool> executable;
+
+  // Edges by the ids of their ends, the entry edge coming from -1.
+  set<pair<int, int>> taken;
+  vector<pair<int, int>> edges;
+  vector<int> changed;
+
+  // Instructions reading each version, as block id and index.
+  vector<vector<pair<int, int>>> readers;
+
+  Cell cell_of(const IR_Operand &operand) const;
+  void take(const int from, const Basic_Block *to);
+  void update(const IR_Operand &dst, const Cell &cell);
+  void visit(const Basic_Block *block, const IR_Instruction &instruction);
+};
+
+Propagator::Propagator(IR_Function *function)
+    : function(function),
+      cells(function->vreg_types.size(), UNKNOWN),
+      executable(function->blocks.size(), false),
+      readers(function->vreg_types.size()) {
+  for (const Basic_Block *block : function->blocks) {
+    for (unsigned int i = 0; i < block->instructions.size(); ++i) {
+      const IR_Instruction &instruction = block->instructions[i];
+      vector<IR_Operand> read = {instruction.src1, instruction.src2};
+      for (const pair<Basic_Block *, IR_Operand> &source :
+               instruction.sources) {
+        read.push_back(source.second);
+      }
+      for (const IR_Operand &operand : read) {
+        if (operand.is_vreg()) {
+          readers[operand.get_value()].push_back({block->id, i});
+        }
+      }
+    }
+  }
+}
+
+Cell Propagator::cell_of(const IR_Operand &operand) const {
+  if (operand.is_immediate()) {
+    return {CELL_CONSTANT, operand.get_value()};
+  }
+  if (operand.is_vreg()) {
+    return cells[operand.get_value()];
+  }
+  // Memory may hold anything.
+  return ANY;
+}
+
+void Propagator::take(const int from, const Basic_Block *to) {
+  edges.push_back({from, to->id});
+}
+
+void Propagator::update(const IR_Operand &dst, const Cell &cell) {
+  Cell &old = cells[dst.get_value()];
+  if (old.kind != cell.kind
+      || (cell.kind == CELL_CONSTANT && old.value != cell.value)) {
+    old = cell;
+    changed.push_back(dst.get_value());
+  }
+}
+
+void Propagator::visit(const Basic_Block *block,
+                       const IR_Instruction &instruction) {
+  if (instruction.opcode == IR_PHI) {
+    Cell cell = UNKNOWN;
+    for (const pair<Basic_Block *, IR_Operand> &source :
+             instruction.sources) {
+      if (taken.count({source.first->id, block->id}) > 0) {
+        cell = meet(cell, cell_of(source.second));
+      }
+    }
+    update(instruction.dst, cell);
+  } else if (instruction.is_conditional_branch()) {
+    const Cell condition = cell_of(instruction.src1);
+    const Basic_Block *next = function->blocks[block->id + 1];
+    if (condition.kind == CELL_ANY) {
+      take(block->id, instruction.target);
+      take(block->id, next);
+    } else if (condition.kind == CELL_CONSTANT) {
+      take(block->id,
+           is_taken(instruction.opcode, condition.value)
+           ? instruction.target : next);
+    }
+  } else if (instruction.dst.is_vreg()) {
+    const Cell first = cell_of(instruction.src1);
+    const Cell second = instruction.src2.is_none()
+        ? Cell{CELL_CONSTANT, 0} : cell_of(instruction.src2);
+    Cell cell = ANY;
+    int result;
+    if (first.kind == CELL_UNKNOWN || second.kind == CELL_UNKNOWN) {
+      cell = UNKNOWN;
+    } else if (first.kind == CELL_CONSTANT && second.kind == CELL_CONSTANT
+               && fold_constants(instruction.opcode, first.value,
+                                 second.value, result)) {
+      cell = {CELL_CONSTANT, result};
+    }
+    // Reading an unknown value may only ever lower a cell that is known.
+    if (cell.kind != CELL_UNKNOWN) {
+      update(instruction.dst, cell);
+    }
+  }
+}
+
+void Propagator::solve() {
+  // The versions never written hold whatever the original registers held
+  // on entry.
+  vector<bool> written(cells.size(), false);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.dst.is_vreg()) {
+        written[instruction.dst.get_value()] = true;
+      }
+    }
+  }
+  for (unsigned int v = 0; v < cells.size(); ++v) {
+    if (!written[v]) {
+      cells[v] = ANY;
+    }
+  }
+
+  take(-1, function->blocks.front());
+  while (!edges.empty() || !changed.empty()) {
+    while (!edges.empty()) {
+      const pair<int, int> edge = edges.back();
+      edges.pop_back();
+      if (!taken.insert(edge).second) {
+        continue;
+      }
+      const Basic_Block *block = function->blocks[edge.second];
+      if (executable[block->id]) {
+        // Only the phis depend on the edges taken.
+        for (const IR_Instruction &instruction : block->instructions) {
+          if (instruction.opcode != IR_PHI) {
+            break;
+          }
+          visit(block, instruction);
+        }
+        continue;
+      }
+      executable[block->id] = true;
+      for (const IR_Instruction &instruction : block->instructions) {
+        visit(block, instruction);
+      }
+      // The conditional branches were visited above.
+      const IR_Instruction *last = block->instructions.empty()
+          ? nullptr : &block->instructions.back();
+      if (last != nullptr && last->opcode == IR_BRUN) {
+        take(block->id, last->target);
+      } else if ((last == nullptr || !(last->is_conditional_branch()
+                                       || last->ends_control_flow()))
+                 && block->id + 1 < static_cast<int>(function->blocks.size())) {
+        take(block->id, function->blocks[block->id + 1]);
+      }
+    }
+    while (!changed.empty()) {
+      const int vreg = changed.back();
+      changed.pop_back();
+      for (const pair<int, int> &reader : readers[vreg]) {
+        const Basic_Block *block = function->blocks[reader.first];
+        if (executable[block->id]) {
+          visit(block, block->instructions[reader.second]);
+        }
+      }
+    }
+  }
+}
+
+void Propagator::rewrite() {
+  vector<Basic_Block *> blocks;
+  for (Basic_Block *block : function->blocks) {
+    if (!executable[block->id]) {
+      delete block;
+      continue;
+    }
+    vector<IR_Instruction> code;
+    for (IR_Instruction instruction : block->instructions) {
+      if (instruction.opcode == IR_PHI) {
+        // Its sources stay versions of its own register.
+        vector<pair<Basic_Block *, IR_Operand>> sources;
+        for (const pair<Basic_Block *, IR_Operand> &source :
+                 instruction.sources) {
+          if (taken.count({source.first->id, block->id}) > 0) {
+            sources.push_back(source);
+          }
+        }
+        instruction.sources.swap(sources);
+        code.push_back(instruction);
+        continue;
+      }
+
+      for (IR_Operand *operand : {&instruction.src1, &instruction.src2}) {
+        const Cell cell = cell_of(*operand);
+        if (operand->is_vreg() && cell.kind == CELL_CONSTANT) {
+          *operand = IR_Operand(IR_IMMEDIATE, cell.value);
+        }
+      }
+      if (instruction.dst.is_vreg()) {
+        const Cell cell = cell_of(instruction.dst);
+        if (cell.kind == CELL_CONSTANT
+            && !(instruction.opcode == IR_MOVE
+                 && instruction.src1.is_immediate())) {
+          instruction = IR_Instruction(IR_MOVE, instruction.dst,
+                                       IR_Operand(IR_IMMEDIATE, cell.value),
+                                       IR_Operand(), nullptr);
+        }
+      } else if (instruction.is_conditional_branch()) {
+        const bool to_target =
+            taken.count({block->id, instruction.target->id}) > 0;
+        const bool to_next = taken.count({block->id, block->id + 1}) > 0;
+        if (!to_target) {
+          continue;
+        }
+        if (!to_next) {
+          instruction = IR_Instruction(IR_BRUN, IR_Operand(), IR_Operand(),
+                                       IR_Operand(), instruction.target);
+        }
+      }
+      code.push_back(instruction);
+    }
+    block->instructions.swap(code);
+    blocks.push_back(block);
+  }
+  function->blocks = blocks;
+}
+
+}  // namespace
+
+void propagate_conditional_constants(SSA_Form &ssa) {
+  Propagator propagator(ssa.get_function());
+  propagator.solve();
+  propagator.rewrite();
+  ssa.rebuild_cfg();
+}
@@ -0,0 +1,32 @@
+// Sparse conditional constant propagation.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef SCCP_H
+#define SCCP_H
+
+#include "ssa.h"
+
+/* Replaces the reads of the versions known to hold a constant by that
+   constant, and deletes the code that never runs, after the algorithm of
+   Wegman and Zadeck.
+
+   Each version starts out unknown and only ever becomes a constant, then
+   any value. Blocks are only analyzed once a branch or a fallthrough
+   reaching them is found to be taken, and a branch on a constant only
+   marks the path it takes, so that a phi ignores the values coming along
+   paths never taken. Unlike propagate_constants(), this finds constants
+   guarded by conditions that are themselves constant, such as
+
+     x := 1;
+     while i < 10 loop begin
+       if x <> 1 then begin x := 2; end;
+       ...
+     end;
+
+   where x stays 1 in the loop. Writes of a constant become moves of it,
+   branches on a constant become branches or go away, and blocks never
+   reached are deleted. */
+void propagate_conditional_constants(SSA_Form &ssa);
+
+#endif
@@ -0,0 +1,856 @@
+// Implementation of the Simulator class.
+// @author Hieu Le
+// @version 12/24/2016
+
+#include "simulator.h"
+
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+#include "word.h"
+
+namespace {
+
+// Mnemonic of each instruction, indexed by inst - INST_MOVE.
+const char *MNEMONICS[N_INSTS] = {
+  "move", "add", "sub", "mul", "div", "neg", "not", "lea",
+  "brun", "brez", "brpo", "brne", "outb", "halt"
+};
+
+// Returns the instruction with a given mnemonic, or INST_GARBAGE.
+inst_type find_instruction(const string &mnemonic) {
+  for (int i = 0; i < N_INSTS; ++i) {
+    if (mnemonic == MNEMONICS[i]) {
+      return static_cast<inst_type>(INST_MOVE + i);
+    }
+  }
+  return INST_GARBAGE;
+}
+
+// Returns the number of operands an instruction takes.
+int operand_count(const inst_type inst) {
+  switch (inst) {
+    case INST_NEG:
+    case INST_NOT:
+    case INST_BRUN:
+    case INST_OUTB:
+      return 1;
+
+    case INST_HALT:
+      return 0;
+
+    default:
+      return 2;
+  }
+}
+
+bool is_label_char(const char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+string trim(const string &text) {
+  string::size_type first = text.find_first_not_of(" \t\r");
+  if (first == string::npos) {
+    return "";
+  }
+  string::size_type last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+// Parses a whole string as a decimal integer.
+bool parse_integer(const string &text, int &value) {
+  if (text.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  long number = strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || number < INT_MIN || number > INT_MAX) {
+    return false;
+  }
+  value = static_cast<int>(number);
+  return true;
+}
+
+// Parses a register name of the form "Rn".
+bool parse_register(const string &text, int &reg) {
+  return text.size() > 1 && text[0] == 'R'
+         && isdigit(static_cast<unsigned char>(text[1]))
+         && parse_integer(text.substr(1), reg);
+}
+
+// Splits operands at commas outside of parentheses.
+vector<string> split_operands(const string &text) {
+  vector<string> operands;
+  if (trim(text).empty()) {
+    return operands;
+  }
+  int depth = 0;
+  string::size_type start = 0;
+  for (string::size_type i = 0; i < text.size(); ++i) {
+    if (text[i] == '(') {
+      ++depth;
+    } else if (text[i] == ')') {
+      --depth;
+    } else if (text[i] == ',' && depth == 0) {
+      operands.push_back(trim(text.substr(start, i - start)));
+      start = i + 1;
+    }
+  }
+  operands.push_back(trim(text.substr(start)));
+  return operands;
+}
+
+bool is_branch(const inst_type inst) {
+  return inst == INST_BRUN || inst == INST_BREZ || inst == INST_BRPO
+         || inst == INST_BRNE;
+}
+
+bool is_memory(const addressing_mode_type mode) {
+  return mode == MODE_MEMORY || mode == MODE_INDIRECT
+         || mode == MODE_RELATIVE;
+}
+
+// A label operand waiting for the address of its label.
+struct Fixup {
+  int address;
+  int operand;
+  string label;
+  int line;
+};
+
+}  // namespace
+
+Simulator_Statistics::Simulator_Statistics()
+    : instructions(0), branches(0), branches_taken(0), jumps(0),
+      memory_reads(0), memory_writes(0) {
+  for (int i = 0; i < N_INSTS; ++i) {
+    instruction_counts[i] = 0;
+  }
+}
+
+long long Simulator_Statistics::get_count(const inst_type inst) const {
+  return instruction_counts[inst - INST_MOVE];
+}
+
+void Simulator_Statistics::print(ostream &out) const {
+  out << left << setw(16) << "instructions" << instructions << endl;
+  for (int i = 0; i < N_INSTS; ++i) {
+    if (instruction_counts[i] > 0) {
+      out << "  " << setw(14) << MNEMONICS[i] << instruction_counts[i]
+          << endl;
+    }
+  }
+  out << setw(16) << "branches" << branches << " (" << branches_taken
+      << " taken)" << endl;
+  out << setw(16) << "jumps" << jumps << endl;
+  out << setw(16) << "memory reads" << memory_reads << endl;
+  out << setw(16) << "memory writes" << memory_writes << endl;
+}
+
+Simulator::Simulator(const int the_n_registers, const int the_stack_words)
+    : n_registers(the_n_registers), stack_words(the_stack_words),
+      program_size(0), registers(the_n_registers, 0) {}
+
+bool Simulator::fail(const int line, const string &message) {
+  stringstream text;
+  text << "line " << line << ": " << message;
+  error = text.str();
+  return false;
+}
+
+bool Simulator::parse_operand(const string &text, const int line,
+                              TrAL_Operand &operand, string &label) {
+  operand.mode = MODE_NONE;
+  operand.reg = 0;
+  operand.value = 0;
+  label.clear();
+
+  if (text.empty()) {
+    return fail(line, "missing operand");
+  }
+
+  if (text[0] == '#') {
+    operand.mode = MODE_IMMEDIATE;
+    if (!parse_integer(text.substr(1), operand.value)) {
+      return fail(line, "bad immediate operand " + text);
+    }
+    return true;
+  }
+
+  if (text[0] == '(') {
+    if (text[text.size() - 1] != ')') {
+      return fail(line, "bad indirect operand " + text);
+    }
+    vector<string> parts = split_operands(text.substr(1, text.size() - 2));
+    if (parts.size() == 1) {
+      operand.mode = MODE_INDIRECT;
+    } else if (parts.size() == 2 && parts[1].size() > 1 && parts[1][0] == '#'
+               && parse_integer(parts[1].substr(1), operand.value)) {
+      operand.mode = MODE_RELATIVE;
+    } else {
+      return fail(line, "bad indirect operand " + text);
+    }
+    if (!parse_register(parts[0], operand.reg)
+        || operand.reg >= n_registers) {
+      return fail(line, "bad register " + parts[0]);
+    }
+    return true;
+  }
+
+  if (parse_register(text, operand.reg)) {
+    if (operand.reg >= n_registers) {
+      return fail(line, "bad register " + text);
+    }
+    operand.mode = MODE_REGISTER;
+    return true;
+  }
+
+  // Branches may name their destination by address.
+  if (parse_integer(text, operand.value)) {
+    operand.mode = MODE_IMMEDIATE;
+    return true;
+  }
+
+  for (char c : text) {
+    if (!is_label_char(c)) {
+      return fail(line, "bad operand " + text);
+    }
+  }
+  label = text;
+  return true;
+}
+
+bool Simulator::check_modes(const TrAL_Instruction &instruction) const {
+  const addressing_mode_type first = instruction.operands[0].mode;
+  const addressing_mode_type second = instruction.operands[1].mode;
+  switch (instruction.opcode) {
+    case INST_MOVE:
+      return (first == MODE_REGISTER && second != MODE_NONE)
+             || ((first == MODE_REGISTER || is_memory(first))
+                 && second == MODE_REGISTER);
+
+    case INST_ADD:
+    case INST_SUB:
+    case INST_MUL:
+    case INST_DIV:
+      return first == MODE_REGISTER && second != MODE_NONE;
+
+    case INST_NEG:
+    case INST_NOT:
+    case INST_OUTB:
+      return first == MODE_REGISTER;
+
+    case INST_LEA:
+      return first == MODE_REGISTER && second == MODE_MEMORY;
+
+    case INST_BRUN:
+      return first == MODE_IMMEDIATE || first == MODE_REGISTER;
+
+    case INST_BREZ:
+    case INST_BRPO:
+    case INST_BRNE:
+      return first == MODE_REGISTER
+             && (second == MODE_IMMEDIATE || second == MODE_REGISTER);
+
+    default:
+      return true;
+  }
+}
+
+bool Simulator::load(istream &in) {
+  code.clear();
+  labels.clear();
+  error.clear();
+  program_size = 0;
+
+  vector<Fixup> fixups;
+  vector<string> pending_labels;
+  vector<int> pending_lines;
+  string text;
+  for (int line = 1; getline(in, text); ++line) {
+    string::size_type comment = text.find(';');
+    if (comment != string::npos) {
+      text.erase(comment);
+    }
+    text = trim(text);
+
+    // A label names the next word, which may be on a later line.
+    string::size_type colon = text.find(':');
+    if (colon != string::npos) {
+      string label = text.substr(0, colon);
+      for (char c : label) {
+        if (!is_label_char(c)) {
+          return fail(line, "bad label " + label);
+        }
+      }
+      if (label.empty() || labels.count(label) > 0) {
+        return fail(line, "bad or duplicate label " + label);
+      }
+      labels[label] = -1;
+      pending_labels.push_back(label);
+      pending_lines.push_back(line);
+      text = trim(text.substr(colon + 1));
+    }
+    if (text.empty()) {
+      continue;
+    }
+
+    string::size_type space = text.find_first_of(" \t");
+    string mnemonic = text.substr(0, space);
+    string rest = space == string::npos ? "" : text.substr(space);
+    const int address = code.size();
+    for (const string &label : pending_labels) {
+      labels[label] = address;
+    }
+    pending_labels.clear();
+    pending_lines.clear();
+
+    if (mnemonic == "data") {
+      int size;
+      if (!parse_integer(trim(rest), size) || size < 0) {
+        return fail(line, "bad data size" + rest);
+      }
+      TrAL_Instruction word = {INST_GARBAGE, {{MODE_NONE, 0, 0},
+                                              {MODE_NONE, 0, 0}}};
+      code.insert(code.end(), size, word);
+      continue;
+    }
+
+    TrAL_Instruction instruction = {find_instruction(mnemonic),
+                                    {{MODE_NONE, 0, 0}, {MODE_NONE, 0, 0}}};
+    if (instruction.opcode == INST_GARBAGE) {
+      return fail(line, "unknown instruction " + mnemonic);
+    }
+    vector<string> operands = split_operands(rest);
+    if (static_cast<int>(operands.size())
+        != operand_count(instruction.opcode)) {
+      return fail(line, "wrong number of operands for " + mnemonic);
+    }
+    for (unsigned int i = 0; i < operands.size(); ++i) {
+      string label;
+      if (!parse_operand(operands[i], line, instruction.operands[i], label)) {
+        return false;
+      }
+      if (!label.empty()) {
+        fixups.push_back({address, static_cast<int>(i), label, line});
+        // Labels only name code in branches.
+        instruction.operands[i].mode =
+            is_branch(instruction.opcode) ? MODE_IMMEDIATE : MODE_MEMORY;
+      }
+    }
+    if (!check_modes(instruction)) {
+      return fail(line, "illegal addressing mode for " + mnemonic);
+    }
+    code.push_back(instruction);
+  }
+
+  if (!pending_labels.empty()) {
+    return fail(pending_lines[0], "label " + pending_labels[0]
+                + " names nothing");
+  }
+  for (const Fixup &fixup : fixups) {
+    unordered_map<string, int>::const_iterator it = labels.find(fixup.label);
+    if (it == labels.end()) {
+      return fail(fixup.line, "undefined label " + fixup.label);
+    }
+    code[fixup.address].operands[fixup.operand].value = it->second;
+  }
+
+  program_size = code.size();
+  TrAL_Instruction word = {INST_GARBAGE, {{MODE_NONE, 0, 0},
+                                          {MODE_NONE, 0, 0}}};
+  code.insert(code.end(), stack_words, word);
+  return true;
+}
+
+bool Simulator::address_of(const TrAL_Operand &operand, int &address) const {
+  switch (operand.mode) {
+    case MODE_MEMORY:
+      address = operand.value;
+      break;
+
+    case MODE_INDIRECT:
+      address = registers[operand.reg];
+      break;
+
+    case MODE_RELATIVE:
+      address = wrap(static_cast<long long>(registers[operand.reg])
+                     + operand.value);
+      break;
+
+    default:
+      return false;
+  }
+  return address >= 0 && address < static_cast<int>(memory.size());
+}
+
+bool Simulator::read(const TrAL_Operand &operand, int &value) {
+  switch (operand.mode) {
+    case MODE_IMMEDIATE:
+      value = operand.value;
+      return true;
+
+    case MODE_REGISTER:
+      value = registers[operand.reg];
+      return true;
+
+    default:
+      int address;
+      if (!address_of(operand, address)) {
+        return false;
+      }
+      ++statistics.memory_reads;
+      value = memory[address];
+      return true;
+  }
+}
+
+bool Simulator::write(const TrAL_Operand &operand, const int value) {
+  if (operand.mode == MODE_REGISTER) {
+    registers[operand.reg] = value;
+    return true;
+  }
+  int address;
+  if (!address_of(operand, address)) {
+    return false;
+  }
+  ++statistics.memory_writes;
+  memory[address] = value;
+  return true;
+}
+
+int Simulator::target_of(const TrAL_Operand &operand) const {
+  return operand.mode == MODE_REGISTER ? registers[operand.reg]
+                                       : operand.value;
+}
+
+void Simulator::reset() {
+  statistics = Simulator_Statistics();
+  memory.assign(code.size(), 0);
+  registers.assign(n_registers, 0);
+  registers[n_registers - 1] = program_size;
+}
+
+simulation_status_type Simulator::run(ostream &out,
+                                      const long long max_steps) {
+  reset();
+  const int size = code.size();
+  int ip = 0;
+  while (true) {
+    if (statistics.instructions >= max_steps) {
+      return SIM_STEP_LIMIT;
+    }
+    if (ip < 0 || ip >= size) {
+      return SIM_BAD_ADDRESS;
+    }
+    const TrAL_Instruction &instruction = code[ip];
+    if (instruction.opcode == INST_GARBAGE) {
+      return SIM_UNKNOWN_INSTRUCTION;
+    }
+    ++statistics.instructions;
+    ++statistics.instruction_counts[instruction.opcode - INST_MOVE];
+    ++ip;
+
+    const TrAL_Operand &first = instruction.operands[0];
+    const TrAL_Operand &second = instruction.operands[1];
+    int &reg = registers[first.reg];
+    int value;
+    switch (instruction.opcode) {
+      case INST_MOVE:
+        if (!read(second, value) || !write(first, value)) {
+          return SIM_BAD_ADDRESS;
+        }
+        break;
+
+      case INST_ADD:
+        if (!read(second, value)) {
+          return SIM_BAD_ADDRESS;
+        }
+        reg = wrap(static_cast<long long>(reg) + value);
+        break;
+
+      case INST_SUB:
+        if (!read(second, value)) {
+          return SIM_BAD_ADDRESS;
+        }
+        reg = wrap(static_cast<long long>(reg) - value);
+        break;
+
+      case INST_MUL:
+        if (!read(second, value)) {
+          return SIM_BAD_ADDRESS;
+        }
+        reg = wrap(static_cast<long long>(reg) * value);
+        break;
+
+      case INST_DIV:
+        if (!read(second, value)) {
+          return SIM_BAD_ADDRESS;
+        }
+        if (value == 0) {
+          return SIM_DIVISION_BY_ZERO;
+        }
+        reg = wrap(static_cast<long long>(reg) / value);
+        break;
+
+      case INST_NEG:
+        reg = wrap(-static_cast<long long>(reg));
+        break;
+
+      case INST_NOT:
+        reg = reg == 0 ? 1 : 0;
+        break;
+
+      case INST_LEA:
+        reg = second.value;
+        break;
+
+      case INST_BRUN:
+        ++statistics.jumps;
+        ip = target_of(first);
+        break;
+
+      case INST_BREZ:
+      case INST_BRPO:
+      case INST_BRNE:
+        ++statistics.branches;
+        if ((instruction.opcode == INST_BREZ && reg == 0)
+            || (instruction.opcode == INST_BRPO && reg > 0)
+            || (instruction.opcode == INST_BRNE && reg < 0)) {
+          ++statistics.branches_taken;
+          ip = target_of(second);
+        }
+        break;
+
+      case INST_OUTB:
+        out << reg << '\n';
+        break;
+
+      case INST_HALT:
+        return SIM_HALTED;
+
+      default:
+        return SIM_UNKNOWN_INSTRUCTION;
+    }
+  }
+}
+
+#if defined(__GNUC__)
+
+// Computed goto is a GNU extension.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+namespace {
+
+/* Handlers of the threaded code. Each instruction gets a handler
+   specialized for its addressing modes: I stands for an immediate, R for a
+   register, M for a memory direct operand, and X for an indirect or
+   relative operand. END follows the last word of memory. */
+#define THREADED_HANDLERS(H) \
+  H(MOVE_RI) H(MOVE_RR) H(MOVE_RM) H(MOVE_RX) H(MOVE_MR) H(MOVE_XR) \
+  H(ADD_I) H(ADD_R) H(ADD_M) H(ADD_X) \
+  H(SUB_I) H(SUB_R) H(SUB_M) H(SUB_X) \
+  H(MUL_I) H(MUL_R) H(MUL_M) H(MUL_X) \
+  H(DIV_I) H(DIV_R) H(DIV_M) H(DIV_X) \
+  H(NEG) H(NOT) H(BRUN_I) H(BRUN_R) \
+  H(BREZ_I) H(BREZ_R) H(BRPO_I) H(BRPO_R) H(BRNE_I) H(BRNE_R) \
+  H(OUTB) H(HALT) H(GARBAGE) H(END)
+
+#define HANDLER_KIND(name) H_##name,
+typedef enum handler_kind { THREADED_HANDLERS(HANDLER_KIND) } handler_kind_type;
+#undef HANDLER_KIND
+
+// A pre-decoded instruction of the threaded code.
+struct Threaded_Instruction {
+  // Address of the code executing this instruction.
+  const void *handler;
+  // The register of the first operand, or the base register of its address.
+  int *reg;
+  // The register of the second operand, or the base register of its
+  // address.
+  int *src;
+  // An immediate, a memory address or the offset of a relative operand.
+  int value;
+  // Resolved destination of a branch to an immediate address.
+  Threaded_Instruction *target;
+  // Number of times the instruction was dispatched.
+  long long count;
+};
+
+// Returns the handler for an operand of an arithmetic instruction.
+int arithmetic_handler(const int first_handler, const TrAL_Operand &operand) {
+  switch (operand.mode) {
+    case MODE_IMMEDIATE: return first_handler;
+    case MODE_REGISTER: return first_handler + 1;
+    case MODE_MEMORY: return first_handler + 2;
+    default: return first_handler + 3;
+  }
+}
+
+// Returns the handler executing an instruction.
+handler_kind_type handler_of(const TrAL_Instruction &instruction) {
+  const TrAL_Operand &first = instruction.operands[0];
+  const TrAL_Operand &second = instruction.operands[1];
+  int handler;
+  switch (instruction.opcode) {
+    case INST_MOVE:
+      if (first.mode == MODE_MEMORY) {
+        handler = H_MOVE_MR;
+      } else if (first.mode != MODE_REGISTER) {
+        handler = H_MOVE_XR;
+      } else {
+        handler = arithmetic_handler(H_MOVE_RI, second);
+      }
+      break;
+
+    case INST_ADD: handler = arithmetic_handler(H_ADD_I, second); break;
+    case INST_SUB: handler = arithmetic_handler(H_SUB_I, second); break;
+    case INST_MUL: handler = arithmetic_handler(H_MUL_I, second); break;
+    case INST_DIV: handler = arithmetic_handler(H_DIV_I, second); break;
+    case INST_NEG: handler = H_NEG; break;
+    case INST_NOT: handler = H_NOT; break;
+    // lea loads the address as an immediate.
+    case INST_LEA: handler = H_MOVE_RI; break;
+    case INST_BRUN:
+      handler = first.mode == MODE_REGISTER ? H_BRUN_R : H_BRUN_I;
+      break;
+    case INST_BREZ:
+      handler = second.mode == MODE_REGISTER ? H_BREZ_R : H_BREZ_I;
+      break;
+    case INST_BRPO:
+      handler = second.mode == MODE_REGISTER ? H_BRPO_R : H_BRPO_I;
+      break;
+    case INST_BRNE:
+      handler = second.mode == MODE_REGISTER ? H_BRNE_R : H_BRNE_I;
+      break;
+    case INST_OUTB: handler = H_OUTB; break;
+    case INST_HALT: handler = H_HALT; break;
+    default: handler = H_GARBAGE; break;
+  }
+  return static_cast<handler_kind_type>(handler);
+}
+
+}  // namespace
+
+simulation_status_type Simulator::run_threaded(ostream &out,
+                                               const long long max_steps) {
+#define HANDLER_ADDRESS(name) &&do_##name,
+  static const void *const HANDLERS[] = { THREADED_HANDLERS(HANDLER_ADDRESS) };
+#undef HANDLER_ADDRESS
+
+  reset();
+  const int size = code.size();
+  int *r = registers.data();
+  int *mem = memory.data();
+
+  // Decode every word, then resolve branches to immediate addresses.
+  vector<Threaded_Instruction> threaded(size + 1);
+  for (int i = 0; i < size; ++i) {
+    const TrAL_Instruction &instruction = code[i];
+    const TrAL_Operand &first = instruction.operands[0];
+    const TrAL_Operand &second = instruction.operands[1];
+    Threaded_Instruction &t = threaded[i];
+    t.handler = HANDLERS[handler_of(instruction)];
+    t.reg = r + first.reg;
+    t.src = r + second.reg;
+    t.value = first.mode == MODE_REGISTER ? second.value : first.value;
+    t.target = nullptr;
+    t.count = 0;
+    const int target = instruction.opcode == INST_BRUN ? first.value
+                                                       : second.value;
+    if (instruction.opcode >= INST_BRUN && instruction.opcode <= INST_BRNE) {
+      t.target = &threaded[target >= 0 && target < size ? target : size];
+    }
+  }
+  threaded[size].handler = HANDLERS[H_END];
+  threaded[size].count = 0;
+
+  long long budget = max_steps;
+  long long taken = 0;
+  // An instruction whose memory operand lay outside of memory.
+  const Threaded_Instruction *faulted = nullptr;
+  simulation_status_type status;
+  Threaded_Instruction *t = &threaded[0];
+  int address;
+
+#define DISPATCH() \
+  do { \
+    if (budget-- <= 0) goto step_limit; \
+    ++t->count; \
+    goto *t->handler; \
+  } while (0)
+#define NEXT() do { ++t; DISPATCH(); } while (0)
+#define JUMP(destination) do { t = (destination); DISPATCH(); } while (0)
+#define JUMP_TO_REGISTER(reg) \
+  JUMP(&threaded[*(reg) >= 0 && *(reg) < size ? *(reg) : size])
+// Computes the address of an indirect or relative operand.
+#define ADDRESS(base) \
+  do { \
+    address = wrap(static_cast<long long>(*(base)) + t->value); \
+    if (address < 0 || address >= size) goto bad_operand; \
+  } while (0)
+#define ARITHMETIC(NAME, OP) \
+  do_##NAME##_I: \
+    *t->reg = wrap(static_cast<long long>(*t->reg) OP t->value); NEXT(); \
+  do_##NAME##_R: \
+    *t->reg = wrap(static_cast<long long>(*t->reg) OP *t->src); NEXT(); \
+  do_##NAME##_M: \
+    *t->reg = wrap(static_cast<long long>(*t->reg) OP mem[t->value]); \
+    NEXT(); \
+  do_##NAME##_X: \
+    ADDRESS(t->src); \
+    *t->reg = wrap(static_cast<long long>(*t->reg) OP mem[address]); \
+    NEXT();
+#define DIVISION(SUFFIX, DIVISOR) \
+  do_DIV_##SUFFIX: \
+    if ((DIVISOR) == 0) goto division_by_zero; \
+    *t->reg = wrap(static_cast<long long>(*t->reg) / (DIVISOR)); NEXT();
+#define CONDITIONAL_BRANCH(NAME, TEST) \
+  do_##NAME##_I: \
+    if (*t->reg TEST 0) { ++taken; JUMP(t->target); } NEXT(); \
+  do_##NAME##_R: \
+    if (*t->reg TEST 0) { ++taken; JUMP_TO_REGISTER(t->src); } NEXT();
+
+  DISPATCH();
+
+  do_MOVE_RI: *t->reg = t->value; NEXT();
+  do_MOVE_RR: *t->reg = *t->src; NEXT();
+  do_MOVE_RM: *t->reg = mem[t->value]; NEXT();
+  do_MOVE_RX: ADDRESS(t->src); *t->reg = mem[address]; NEXT();
+  do_MOVE_MR: mem[t->value] = *t->src; NEXT();
+  do_MOVE_XR: ADDRESS(t->reg); mem[address] = *t->src; NEXT();
+
+  ARITHMETIC(ADD, +)
+  ARITHMETIC(SUB, -)
+  ARITHMETIC(MUL, *)
+
+  DIVISION(I, t->value)
+  DIVISION(R, *t->src)
+  DIVISION(M, mem[t->value])
+  do_DIV_X:
+    ADDRESS(t->src);
+    if (mem[address] == 0) goto division_by_zero;
+    *t->reg = wrap(static_cast<long long>(*t->reg) / mem[address]);
+    NEXT();
+
+  do_NEG: *t->reg = wrap(-static_cast<long long>(*t->reg)); NEXT();
+  do_NOT: *t->reg = *t->reg == 0 ? 1 : 0; NEXT();
+
+  do_BRUN_I: JUMP(t->target);
+  do_BRUN_R: JUMP_TO_REGISTER(t->reg);
+  CONDITIONAL_BRANCH(BREZ, ==)
+  CONDITIONAL_BRANCH(BRPO, >)
+  CONDITIONAL_BRANCH(BRNE, <)
+
+  do_OUTB: out << *t->reg << '\n'; NEXT();
+
+  do_HALT: status = SIM_HALTED; goto done;
+  do_GARBAGE: status = SIM_UNKNOWN_INSTRUCTION; goto done;
+  do_END: status = SIM_BAD_ADDRESS; goto done;
+  bad_operand: faulted = t; status = SIM_BAD_ADDRESS; goto done;
+  division_by_zero: status = SIM_DIVISION_BY_ZERO; goto done;
+  step_limit: status = SIM_STEP_LIMIT; goto done;
+
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef JUMP_TO_REGISTER
+#undef ADDRESS
+#undef ARITHMETIC
+#undef DIVISION
+#undef CONDITIONAL_BRANCH
+
+ done:
+  // Recover the counters from the number of times each word was executed.
+  for (int i = 0; i < size; ++i) {
+    const TrAL_Instruction &instruction = code[i];
+    long long count = threaded[i].count;
+    if (instruction.opcode == INST_GARBAGE || count == 0) {
+      continue;
+    }
+    statistics.instructions += count;
+    statistics.instruction_counts[instruction.opcode - INST_MOVE] += count;
+    if (instruction.opcode == INST_BRUN) {
+      statistics.jumps += count;
+    } else if (instruction.opcode >= INST_BREZ
+               && instruction.opcode <= INST_BRNE) {
+      statistics.branches += count;
+    }
+    const long long accesses = &threaded[i] == faulted ? count - 1 : count;
+    if (instruction.opcode == INST_LEA) {
+      continue;
+    }
+    if (is_memory(instruction.operands[0].mode)) {
+      statistics.memory_writes += accesses;
+    }
+    if (is_memory(instruction.operands[1].mode)) {
+      statistics.memory_reads += accesses;
+    }
+  }
+  statistics.branches_taken = taken;
+  return status;
+}
+
+#pragma GCC diagnostic pop
+
+#else
+
+// Without computed goto, threaded code falls back to the switch loop.
+simulation_status_type Simulator::run_threaded(ostream &out,
+                                               const long long max_steps) {
+  return run(out, max_steps);
+}
+
+#endif
+
+const string &Simulator::get_error() const {
+  return error;
+}
+
+const Simulator_Statistics &Simulator::get_statistics() const {
+  return statistics;
+}
+
+int Simulator::get_register(const int reg) const {
+  return registers[reg];
+}
+
+int Simulator::get_memory(const string &label) const {
+  const int address = get_address(label);
+  if (address < 0 || address >= static_cast<int>(memory.size())) {
+    return 0;
+  }
+  return memory[address];
+}
+
+const vector<TrAL_Instruction> &Simulator::get_code() const {
+  return code;
+}
+
+int Simulator::get_program_size() const {
+  return program_size;
+}
+
+int Simulator::get_register_count() const {
+  return n_registers;
+}
+
+int Simulator::get_address(const string &label) const {
+  unordered_map<string, int>::const_iterator it = labels.find(label);
+  return it == labels.end() ? -1 : it->second;
+}
+
+const char *Simulator::describe(const simulation_status_type status) {
+  switch (status) {
+    case SIM_HALTED: return "halted";
+    case SIM_DIVISION_BY_ZERO: return "division by zero";
+    case SIM_UNKNOWN_INSTRUCTION: return "unknown instruction";
+    case SIM_BAD_ADDRESS: return "address out of range";
+    case SIM_STEP_LIMIT: return "step limit reached";
+    default: return "unknown status";
+  }
+}
@@ -0,0 +1,179 @@
+// Simulator executes TrAL programs on the TruPro machine and counts what
+// they do.
+// @author Hieu Le
+// @version 12/24/2016
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// For the instruction mnemonics.
+#include "emitter.h"
+
+using namespace std;
+
+// The number of distinct TrAL instructions, from INST_MOVE to INST_HALT.
+#define N_INSTS (INST_HALT - INST_MOVE + 1)
+
+// Addressing modes of TrAL operands.
+typedef enum addressing_mode { MODE_NONE      = 1300,  // No operand.
+                               MODE_IMMEDIATE = 1301,  // #n, or a code label.
+                               MODE_REGISTER  = 1302,  // Rn
+                               MODE_MEMORY    = 1303,  // A data label.
+                               MODE_INDIRECT  = 1304,  // (Rn)
+                               MODE_RELATIVE  = 1305   // (Rn, #m)
+                             } addressing_mode_type;
+
+// Ways a simulation ends.
+typedef enum simulation_status {
+  SIM_HALTED                  = 1400,  // The program executed halt.
+  SIM_DIVISION_BY_ZERO        = 1401,
+  SIM_UNKNOWN_INSTRUCTION     = 1402,  // Control reached a data word.
+  SIM_BAD_ADDRESS             = 1403,  // An address outside of memory.
+  SIM_STEP_LIMIT              = 1404   // Too many instructions executed.
+} simulation_status_type;
+
+// An operand of a decoded instruction. value holds the constant of an
+// immediate, the address of a memory operand, or the offset of a relative
+// one.
+struct TrAL_Operand {
+  addressing_mode_type mode;
+  int reg;
+  int value;
+};
+
+// A decoded instruction. Words holding data decode to INST_GARBAGE.
+struct TrAL_Instruction {
+  inst_type opcode;
+  TrAL_Operand operands[2];
+};
+
+// Dynamic counts gathered while a program runs.
+struct Simulator_Statistics {
+  Simulator_Statistics();
+
+  // Instructions executed, in total and by instruction.
+  long long instructions;
+  long long instruction_counts[N_INSTS];
+
+  // Conditional branches executed and taken, and unconditional branches.
+  long long branches;
+  long long branches_taken;
+  long long jumps;
+
+  // Data words read from and written to memory. Fetching instructions does
+  // not count.
+  long long memory_reads;
+  long long memory_writes;
+
+  // Returns the number of times an instruction was executed.
+  long long get_count(const inst_type inst) const;
+
+  // Writes the counts as a human readable table.
+  void print(ostream &out) const;
+};
+
+class Simulator {
+ public:
+  // Constructs a simulator of a TruPro machine with the given number of
+  // registers and words of stack beyond the loaded program. The last
+  // register is the stack register, which starts at the first word past the
+  // program.
+  Simulator(const int n_registers, const int stack_words);
+
+  // Assembles a TrAL program and loads it at address 0. Returns false and
+  // sets the error message if the program is malformed.
+  bool load(istream &in);
+
+  // Executes the loaded program from address 0 with cleared registers and
+  // memory, writing what outb prints to out, one value per line. Stops after
+  // max_steps instructions.
+  simulation_status_type run(ostream &out, const long long max_steps);
+
+  // Same as run(), but first translates the program to direct threaded
+  // code: an array holding, for each word, the address of a handler
+  // specialized for its addressing modes and the resolved destination of
+  // its branch. Each handler jumps straight to the next one instead of
+  // going back to a switch. Falls back to run() on compilers without
+  // computed goto.
+  simulation_status_type run_threaded(ostream &out,
+                                      const long long max_steps);
+
+  // Returns the error of the last load.
+  const string &get_error() const;
+
+  const Simulator_Statistics &get_statistics() const;
+
+  // Returns the content of a register or of the memory word with a given
+  // label after a run. Unknown labels read as 0.
+  int get_register(const int reg) const;
+  int get_memory(const string &label) const;
+
+  // Returns the loaded program, decoded word by word and followed by the
+  // words of the stack.
+  const vector<TrAL_Instruction> &get_code() const;
+
+  // Returns the number of words taken by the loaded program.
+  int get_program_size() const;
+
+  int get_register_count() const;
+
+  // Returns the address of a label, or -1 if there is none.
+  int get_address(const string &label) const;
+
+  // Returns a description of a simulation status.
+  static const char *describe(const simulation_status_type status);
+
+ private:
+  int n_registers;
+  int stack_words;
+
+  // Number of words taken by the loaded program.
+  int program_size;
+
+  // Decoded instruction and data of each word of memory.
+  vector<TrAL_Instruction> code;
+  vector<int> memory;
+
+  vector<int> registers;
+
+  // Address of each label.
+  unordered_map<string, int> labels;
+
+  string error;
+
+  Simulator_Statistics statistics;
+
+  // Clears the registers, memory and counters before a run.
+  void reset();
+
+  // Reports a malformed line and returns false.
+  bool fail(const int line, const string &message);
+
+  // Parses a single operand, recording in label the name of a label that
+  // still needs to be resolved.
+  bool parse_operand(const string &text, const int line, TrAL_Operand &operand,
+                     string &label);
+
+  // Checks if the operands of an instruction use addressing modes allowed by
+  // TrAL.
+  bool check_modes(const TrAL_Instruction &instruction) const;
+
+  // Computes the address of a memory operand. Returns false if it lies
+  // outside of memory.
+  bool address_of(const TrAL_Operand &operand, int &address) const;
+
+  // Reads and writes operands, counting memory traffic. Return false on a
+  // bad address.
+  bool read(const TrAL_Operand &operand, int &value);
+  bool write(const TrAL_Operand &operand, const int value);
+
+  // Returns the address a branch jumps to.
+  int target_of(const TrAL_Operand &operand) const;
+};
+
+#endif
@@ -0,0 +1,150 @@
+// Compares the speed of the switch loop and the threaded code of the TrAL
+// simulator, and of native code from the JIT.
+// @author Hieu Le
+// @version 12/24/2016
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "jit.h"
+#include "register_allocator.h"
+#include "simulator.h"
+
+namespace {
+
+// Runs about 14 million instructions when no program is given: a nested
+// loop doing arithmetic on a variable in memory.
+const char DEFAULT_PROGRAM[] =
+    "\t\tmove R0, #2000\n"
+    "_outer:\n"
+    "\t\tmove R1, #1000\n"
+    "_inner:\n"
+    "\t\tmove R2, x\n"
+    "\t\tadd R2, R1\n"
+    "\t\tmul R2, #3\n"
+    "\t\tdiv R2, #2\n"
+    "\t\tmove x, R2\n"
+    "\t\tsub R1, #1\n"
+    "\t\tbrpo R1, _inner\n"
+    "\t\tsub R0, #1\n"
+    "\t\tbrpo R0, _outer\n"
+    "\t\tmove R2, x\n"
+    "\t\toutb R2\n"
+    "\t\thalt\n"
+    "x:\t\tdata 1\n";
+
+// The engines being compared.
+typedef simulation_status_type (Simulator::*Engine)(ostream &,
+                                                    const long long);
+
+// Runs a program a number of times with one engine and reports the fastest
+// and the average run. Returns the time of the fastest run in seconds.
+double measure(Simulator *simulator, Engine engine, const char *name,
+               const int runs, string *output) {
+  double best = 0;
+  double total = 0;
+  for (int i = 0; i < runs; ++i) {
+    ostringstream out;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    simulation_status_type status = (simulator->*engine)(out, 1LL << 62);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (status != SIM_HALTED) {
+      cerr << "ERROR: " << name << ": " << Simulator::describe(status)
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+    *output = out.str();
+    total += elapsed.count();
+    if (i == 0 || elapsed.count() < best) {
+      best = elapsed.count();
+    }
+  }
+
+  const long long instructions = simulator->get_statistics().instructions;
+  cout << name << ": best " << best * 1000 << " ms, mean "
+       << total / runs * 1000 << " ms, " << instructions / best / 1e6
+       << " million instructions/s" << endl;
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  char *filename = nullptr;
+  int runs = 5;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--runs=", 7) == 0) {
+      runs = atoi(argv[i] + 7);
+    } else if (filename == nullptr) {
+      filename = argv[i];
+    } else {
+      runs = 0;
+      break;
+    }
+  }
+  if (runs < 1) {
+    cerr << "Usage: " << argv[0] << " [--runs=<count>] [<TrAL file name>]"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Simulator simulator(TRAL_REGISTER_COUNT, 4096);
+  bool loaded;
+  if (filename == nullptr) {
+    istringstream in(DEFAULT_PROGRAM);
+    loaded = simulator.load(in);
+  } else {
+    ifstream in(filename);
+    loaded = simulator.load(in);
+  }
+  if (!loaded) {
+    cerr << "ERROR: " << simulator.get_error() << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  string switch_output;
+  string threaded_output;
+  double switch_time = measure(&simulator, &Simulator::run, "switch", runs,
+                               &switch_output);
+  double threaded_time = measure(&simulator, &Simulator::run_threaded,
+                                 "threaded", runs, &threaded_output);
+  if (switch_output != threaded_output) {
+    cerr << "ERROR: The engines printed different values" << endl;
+    exit(EXIT_FAILURE);
+  }
+  cout << "speedup: " << switch_time / threaded_time << endl;
+
+  JIT jit(&simulator);
+  if (!jit.compile()) {
+    cout << "jit: " << jit.get_error() << endl;
+    return 0;
+  }
+  double jit_time = 0;
+  for (int i = 0; i < runs; ++i) {
+    ostringstream out;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    jit.run(out, 1LL << 62);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (out.str() != switch_output) {
+      cerr << "ERROR: The JIT printed different values" << endl;
+      exit(EXIT_FAILURE);
+    }
+    if (i == 0 || elapsed.count() < jit_time) {
+      jit_time = elapsed.count();
+    }
+  }
+  cout << "jit: best " << jit_time * 1000 << " ms, "
+       << jit.get_instruction_count() / jit_time / 1e6
+       << " million instructions/s, speedup " << switch_time / jit_time
+       << endl;
+  return 0;
+}
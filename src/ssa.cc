@@ -0,0 +1,300 @@
+// Implementation of the SSA form.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "ssa.h"
+
+#include <utility>
+
+#include "dead_code.h"
+
+namespace {
+
+// Returns the distinct elements of blocks, in order.
+vector<Basic_Block *> distinct(const vector<Basic_Block *> &blocks) {
+  vector<Basic_Block *> result;
+  for (Basic_Block *block : blocks) {
+    bool seen = false;
+    for (const Basic_Block *other : result) {
+      seen = seen || other == block;
+    }
+    if (!seen) {
+      result.push_back(block);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+SSA_Form::SSA_Form(IR_Function *function)
+    : function(function), n_originals(function->vreg_types.size()),
+      originals(n_originals), global(n_originals, false),
+      versions(n_originals, 0) {
+  for (int v = 0; v < n_originals; ++v) {
+    originals[v] = v;
+  }
+  remove_unreachable_blocks(function);
+  if (!function->blocks.front()->predecessors.empty()) {
+    // Give the values on entry a block of their own to come from.
+    function->blocks.insert(function->blocks.begin(), new Basic_Block(""));
+    function->build_cfg();
+  }
+  compute_dominators();
+  place_phis();
+  rename();
+}
+
+IR_Function *SSA_Form::get_function() const {
+  return function;
+}
+
+int SSA_Form::original_of(const int vreg) const {
+  return originals[vreg];
+}
+
+bool SSA_Form::is_global(const int original) const {
+  return global[original];
+}
+
+int SSA_Form::count_versions(const int original) const {
+  return versions[original];
+}
+
+const vector<Basic_Block *> &SSA_Form::get_dominated(
+    const Basic_Block *block) const {
+  return dominated[block->id];
+}
+
+void SSA_Form::rebuild_cfg() {
+  function->build_cfg();
+  compute_dominators();
+}
+
+void SSA_Form::destroy() {
+  for (Basic_Block *block : function->blocks) {
+    vector<IR_Instruction> code;
+    for (IR_Instruction instruction : block->instructions) {
+      if (instruction.opcode == IR_PHI) {
+        continue;
+      }
+      for (IR_Operand *operand :
+               {&instruction.dst, &instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg()) {
+          *operand = IR_Operand(IR_VREG, originals[operand->get_value()]);
+        }
+      }
+      if (instruction.opcode == IR_MOVE
+          && instruction.dst == instruction.src1) {
+        continue;
+      }
+      code.push_back(instruction);
+    }
+    block->instructions.swap(code);
+  }
+  function->vreg_types.resize(n_originals);
+  function->promoted_from.resize(n_originals);
+  originals.resize(n_originals);
+  function->build_cfg();
+}
+
+vector<Basic_Block *> SSA_Form::reverse_postorder() const {
+  // Depth-first search keeping, for each block on the path, the index of
+  // the next successor to visit.
+  vector<Basic_Block *> postorder;
+  vector<bool> visited(function->blocks.size(), false);
+  vector<pair<Basic_Block *, unsigned int>> path = {
+    {function->blocks.front(), 0}
+  };
+  visited[0] = true;
+  while (!path.empty()) {
+    Basic_Block *block = path.back().first;
+    const unsigned int next = path.back().second++;
+    if (next == block->successors.size()) {
+      postorder.push_back(block);
+      path.pop_back();
+    } else if (!visited[block->successors[next]->id]) {
+      visited[block->successors[next]->id] = true;
+      path.push_back({block->successors[next], 0});
+    }
+  }
+  return vector<Basic_Block *>(postorder.rbegin(), postorder.rend());
+}
+
+void SSA_Form::compute_dominators() {
+  // The iterative algorithm of Cooper, Harvey and Kennedy, walking up the
+  // partial dominator tree by postorder number to intersect two paths.
+  const vector<Basic_Block *> order = reverse_postorder();
+  const int n_blocks = function->blocks.size();
+  vector<int> number(n_blocks, -1);
+  for (unsigned int i = 0; i < order.size(); ++i) {
+    number[order[i]->id] = order.size() - i;
+  }
+  dominators.assign(n_blocks, -1);
+  dominators[0] = 0;
+  auto intersect = [&](int first, int second) {
+    while (first != second) {
+      while (number[first] < number[second]) {
+        first = dominators[first];
+      }
+      while (number[second] < number[first]) {
+        second = dominators[second];
+      }
+    }
+    return first;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const Basic_Block *block : order) {
+      if (block->id == 0) {
+        continue;
+      }
+      int dominator = -1;
+      for (const Basic_Block *predecessor : block->predecessors) {
+        if (dominators[predecessor->id] == -1) {
+          continue;
+        }
+        dominator = dominator == -1
+            ? predecessor->id : intersect(predecessor->id, dominator);
+      }
+      if (dominator != dominators[block->id]) {
+        dominators[block->id] = dominator;
+        changed = true;
+      }
+    }
+  }
+
+  dominated.assign(n_blocks, vector<Basic_Block *>());
+  for (Basic_Block *block : function->blocks) {
+    if (block->id > 0 && dominators[block->id] != -1) {
+      dominated[dominators[block->id]].push_back(block);
+    }
+  }
+}
+
+void SSA_Form::place_phis() {
+  // A register read before being written in some block is global. Only
+  // global registers need phis.
+  const int n_blocks = function->blocks.size();
+  vector<vector<Basic_Block *>> writers(n_originals);
+  for (Basic_Block *block : function->blocks) {
+    vector<bool> written(n_originals, false);
+    for (const IR_Instruction &instruction : block->instructions) {
+      for (const IR_Operand *operand : {&instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg() && !written[operand->get_value()]) {
+          global[operand->get_value()] = true;
+        }
+      }
+      if (instruction.dst.is_vreg()) {
+        const int vreg = instruction.dst.get_value();
+        if (!written[vreg]) {
+          writers[vreg].push_back(block);
+        }
+        written[vreg] = true;
+      }
+    }
+  }
+
+  // The dominance frontier of a block holds the merge points where its
+  // dominance ends.
+  vector<vector<Basic_Block *>> frontiers(n_blocks);
+  for (Basic_Block *block : function->blocks) {
+    const vector<Basic_Block *> predecessors = distinct(block->predecessors);
+    if (predecessors.size() < 2) {
+      continue;
+    }
+    for (const Basic_Block *predecessor : predecessors) {
+      for (int runner = predecessor->id; runner != dominators[block->id];
+           runner = dominators[runner]) {
+        frontiers[runner].push_back(block);
+      }
+    }
+  }
+
+  for (int vreg = 0; vreg < n_originals; ++vreg) {
+    if (!global[vreg]) {
+      continue;
+    }
+    vector<bool> has_phi(n_blocks, false);
+    vector<Basic_Block *> work = writers[vreg];
+    while (!work.empty()) {
+      const Basic_Block *block = work.back();
+      work.pop_back();
+      for (Basic_Block *frontier : frontiers[block->id]) {
+        if (has_phi[frontier->id]) {
+          continue;
+        }
+        has_phi[frontier->id] = true;
+        IR_Instruction phi(IR_PHI, IR_Operand(IR_VREG, vreg), IR_Operand(),
+                           IR_Operand(), nullptr);
+        for (Basic_Block *predecessor : distinct(frontier->predecessors)) {
+          phi.sources.push_back({predecessor, IR_Operand(IR_VREG, vreg)});
+        }
+        frontier->instructions.insert(frontier->instructions.begin(), phi);
+        work.push_back(frontier);
+      }
+    }
+  }
+}
+
+void SSA_Form::rename() {
+  // Version of each original register reaching the current point of a
+  // walk of the dominator tree, with the originals written by each block
+  // to undo on the way back up.
+  vector<vector<int>> current(n_originals);
+  vector<vector<int>> written(function->blocks.size());
+  auto rename_read = [&](IR_Operand &operand) {
+    if (operand.is_vreg() && !current[operand.get_value()].empty()) {
+      operand = IR_Operand(IR_VREG, current[operand.get_value()].back());
+    }
+  };
+
+  vector<pair<Basic_Block *, bool>> work = {{function->blocks.front(), false}};
+  while (!work.empty()) {
+    Basic_Block *block = work.back().first;
+    const bool done = work.back().second;
+    work.pop_back();
+    if (done) {
+      for (const int original : written[block->id]) {
+        current[original].pop_back();
+      }
+      continue;
+    }
+
+    for (IR_Instruction &instruction : block->instructions) {
+      if (instruction.opcode != IR_PHI) {
+        rename_read(instruction.src1);
+        rename_read(instruction.src2);
+      }
+      if (instruction.dst.is_vreg()) {
+        const int original = instruction.dst.get_value();
+        instruction.dst = function->new_vreg(function->vreg_types[original]);
+        const int version = instruction.dst.get_value();
+        function->promoted_from[version] = function->promoted_from[original];
+        originals.push_back(original);
+        ++versions[original];
+        current[original].push_back(version);
+        written[block->id].push_back(original);
+      }
+    }
+    for (Basic_Block *successor : distinct(block->successors)) {
+      for (IR_Instruction &instruction : successor->instructions) {
+        if (instruction.opcode != IR_PHI) {
+          break;
+        }
+        for (pair<Basic_Block *, IR_Operand> &source : instruction.sources) {
+          if (source.first == block) {
+            rename_read(source.second);
+          }
+        }
+      }
+    }
+
+    work.push_back({block, true});
+    const vector<Basic_Block *> &children = dominated[block->id];
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      work.push_back({*it, false});
+    }
+  }
+}
@@ -0,0 +1,84 @@
+// Static single assignment (SSA) form of an IR function.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef SSA_H
+#define SSA_H
+
+#include <vector>
+
+#include "ir.h"
+
+using namespace std;
+
+/* Rewrites an IR function into SSA form, where each virtual register is
+   written by a single instruction, and back.
+
+   Every write of a virtual register is given a new virtual register, a
+   version of the original one, and each read is renamed to the version
+   reaching it. Where versions of a register written on different paths
+   merge, such as at the _if_done and _while_cond labels of if and while
+   statements, an IR_PHI picks the version coming from the predecessor
+   executed last. Phis are placed at the iterated dominance frontier of the
+   blocks writing a register, and only for registers read in some block
+   before being written in it, the others never being live across blocks.
+
+   The optimizations working on the SSA form neither move writes nor
+   replace the sources of phis, so two versions of the same register are
+   never live at once. Leaving the form then simply renames every version
+   back to its original register and drops the phis. */
+class SSA_Form {
+ public:
+  // Rewrites function into SSA form, after deleting its unreachable blocks.
+  explicit SSA_Form(IR_Function *function);
+
+  IR_Function *get_function() const;
+
+  // Returns the register a version was made from. Registers read before
+  // any write of them are their own original.
+  int original_of(const int vreg) const;
+
+  // Checks if an original register has a phi wherever its versions merge.
+  bool is_global(const int original) const;
+
+  // Returns the number of writes of an original register.
+  int count_versions(const int original) const;
+
+  // Returns the blocks a block immediately dominates, in layout order.
+  const vector<Basic_Block *> &get_dominated(const Basic_Block *block) const;
+
+  // Updates the control flow graph and the dominator tree after blocks or
+  // branches were deleted.
+  void rebuild_cfg();
+
+  // Renames the versions back to their original registers and removes the
+  // phis. The SSA form may no longer be used.
+  void destroy();
+
+ private:
+  IR_Function *function;
+
+  // Number of virtual registers before the rewrite.
+  int n_originals;
+
+  // Original register of each virtual register.
+  vector<int> originals;
+
+  vector<bool> global;
+  vector<int> versions;
+
+  // Immediate dominator of each block, by id, with the entry block
+  // dominating itself.
+  vector<int> dominators;
+  vector<vector<Basic_Block *>> dominated;
+
+  // Blocks reachable from the entry block, each after its predecessors
+  // along forward edges.
+  vector<Basic_Block *> reverse_postorder() const;
+
+  void compute_dominators();
+  void place_phis();
+  void rename();
+};
+
+#endif
@@ -0,0 +1,277 @@
+// Implementation of the phase statistics.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "stats.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <streambuf>
+#include <vector>
+
+namespace {
+
+bool enabled = false;
+
+// Zero until enabled. Plain data, so that the allocation hook may count
+// allocations made before main().
+Phase_Statistics statistics[PHASE_COUNT];
+
+// Phase being charged, and the phases it paused.
+phase_type current = PHASE_OTHER;
+vector<phase_type> *paused = nullptr;
+
+// When the current phase was last charged, and when each phase last
+// sampled the resident set size.
+std::chrono::steady_clock::time_point last_wall;
+clock_t last_cpu;
+std::chrono::steady_clock::time_point last_sample[PHASE_COUNT];
+
+// Buffer routing cout while statistics are enabled, and the one it
+// replaced.
+streambuf *output_buffer = nullptr;
+streambuf *standard_output = nullptr;
+
+const char *const PHASE_NAMES[PHASE_COUNT] = {
+  "other", "buffering", "parsing", "optimization", "code generation",
+  "output"
+};
+
+// Charges the time elapsed since the last call to the current phase.
+void charge() {
+  const std::chrono::steady_clock::time_point wall =
+      std::chrono::steady_clock::now();
+  const clock_t cpu = clock();
+  const std::chrono::duration<double> elapsed = wall - last_wall;
+  statistics[current].wall_seconds += elapsed.count();
+  statistics[current].cpu_seconds +=
+      static_cast<double>(cpu - last_cpu) / CLOCKS_PER_SEC;
+  last_wall = wall;
+  last_cpu = cpu;
+}
+
+// Records the peak resident set size in the current phase, unless the
+// phase took a sample less than a millisecond ago. Phases entered often,
+// such as the output, do not keep the others from sampling.
+void sample_rss(const bool forced) {
+  if (!forced
+      && last_wall - last_sample[current] < std::chrono::milliseconds(1)) {
+    return;
+  }
+  last_sample[current] = last_wall;
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0
+      && usage.ru_maxrss > statistics[current].peak_rss_kb) {
+    statistics[current].peak_rss_kb = usage.ru_maxrss;
+  }
+}
+
+const char *const TOKEN_NAMES[TOKEN_KINDS] = {
+  "keyword", "punctuation", "relop", "addop", "mulop", "identifier",
+  "number", "eof"
+};
+
+const char *const INSTRUCTION_NAMES[INSTRUCTION_KINDS] = {
+  "move", "add", "sub", "mul", "div", "neg", "not", "lea", "brun", "brez",
+  "brpo", "brne", "outb", "halt"
+};
+
+// Writes a JSON object mapping each name to its count.
+void print_counts(ostream &out, const char *const names[],
+                  const long long counts[], const int size) {
+  out << "{";
+  for (int i = 0; i < size; ++i) {
+    out << (i > 0 ? ", " : "") << "\"" << names[i] << "\": " << counts[i];
+  }
+  out << "}";
+}
+
+// Buffers the output of cout, charging the time spent writing it out to
+// PHASE_OUTPUT.
+class Output_Buffer : public streambuf {
+ public:
+  explicit Output_Buffer(streambuf *the_target) : target(the_target) {
+    setp(buffer, buffer + BUFFER_SIZE);
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    Phase_Scope scope(PHASE_OUTPUT);
+    if (!flush()) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    Phase_Scope scope(PHASE_OUTPUT);
+    return flush() && target->pubsync() != -1 ? 0 : -1;
+  }
+
+ private:
+  static const int BUFFER_SIZE = 4096;
+
+  streambuf *target;
+  char buffer[BUFFER_SIZE];
+
+  bool flush() {
+    const streamsize size = pptr() - pbase();
+    if (target->sputn(pbase(), size) != size) {
+      return false;
+    }
+    setp(buffer, buffer + BUFFER_SIZE);
+    return true;
+  }
+};
+
+// Writes a phase as a row of the table, or as a JSON object.
+void print_phase(ostream &out, const char *name,
+                 const Phase_Statistics &phase, const bool json) {
+  if (json) {
+    out << "{\"name\": \"" << name << "\", \"entries\": " << phase.entries
+        << ", \"wall_ms\": " << phase.wall_seconds * 1000
+        << ", \"cpu_ms\": " << phase.cpu_seconds * 1000
+        << ", \"allocations\": " << phase.allocations
+        << ", \"allocated_bytes\": " << phase.allocated_bytes
+        << ", \"peak_rss_kb\": " << phase.peak_rss_kb << "}";
+    return;
+  }
+  out << left << setw(20) << name << right << setw(10) << phase.entries
+      << setw(12) << phase.wall_seconds * 1000
+      << setw(12) << phase.cpu_seconds * 1000
+      << setw(13) << phase.allocations
+      << setw(16) << phase.allocated_bytes / 1024
+      << setw(15) << phase.peak_rss_kb << endl;
+}
+
+}  // namespace
+
+Counters counters;
+
+void enable_statistics() {
+  if (!enabled) {
+    paused = new vector<phase_type>();
+    paused->reserve(PHASE_COUNT);
+  }
+  if (output_buffer == nullptr) {
+    cout.flush();
+    standard_output = cout.rdbuf();
+    output_buffer = new Output_Buffer(standard_output);
+    cout.rdbuf(output_buffer);
+  }
+  for (Phase_Statistics &phase : statistics) {
+    phase = Phase_Statistics();
+  }
+  current = PHASE_OTHER;
+  last_wall = std::chrono::steady_clock::now();
+  last_cpu = clock();
+  for (std::chrono::steady_clock::time_point &sample : last_sample) {
+    sample = std::chrono::steady_clock::time_point();
+  }
+  enabled = true;
+}
+
+bool statistics_enabled() {
+  return enabled;
+}
+
+const Phase_Statistics &get_phase_statistics(const phase_type phase) {
+  return statistics[phase];
+}
+
+const char *phase_name(const phase_type phase) {
+  return PHASE_NAMES[phase];
+}
+
+void print_statistics(ostream &out, const bool json) {
+  cout.flush();
+  if (output_buffer != nullptr) {
+    cout.rdbuf(standard_output);
+    delete output_buffer;
+    output_buffer = nullptr;
+  }
+  if (enabled) {
+    charge();
+    sample_rss(true);
+  }
+
+  Phase_Statistics total = Phase_Statistics();
+  if (json) {
+    out << "{\"phases\": [";
+  } else {
+    out << left << setw(20) << "Phase" << right << setw(10) << "Entries"
+        << setw(12) << "Wall (ms)" << setw(12) << "CPU (ms)"
+        << setw(13) << "Allocations" << setw(16) << "Allocated (KB)"
+        << setw(15) << "Peak RSS (KB)" << endl;
+    out << fixed << setprecision(3);
+  }
+  for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+    const Phase_Statistics &statistic = statistics[phase];
+    if (json && phase > 0) {
+      out << ", ";
+    }
+    print_phase(out, PHASE_NAMES[phase], statistic, json);
+    total.entries += statistic.entries;
+    total.wall_seconds += statistic.wall_seconds;
+    total.cpu_seconds += statistic.cpu_seconds;
+    total.allocations += statistic.allocations;
+    total.allocated_bytes += statistic.allocated_bytes;
+    if (statistic.peak_rss_kb > total.peak_rss_kb) {
+      total.peak_rss_kb = statistic.peak_rss_kb;
+    }
+  }
+  if (json) {
+    out << "], \"total\": ";
+    print_phase(out, "total", total, true);
+    out << "}" << endl;
+  } else {
+    print_phase(out, "total", total, false);
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+  }
+}
+
+void count_allocation(const size_t size) {
+  ++statistics[current].allocations;
+  statistics[current].allocated_bytes += size;
+}
+
+Phase_Scope::Phase_Scope(const phase_type phase) : active(enabled) {
+  if (active) {
+    charge();
+    paused->push_back(current);
+    current = phase;
+    ++statistics[current].entries;
+  }
+}
+
+Phase_Scope::~Phase_Scope() {
+  if (active) {
+    charge();
+    sample_rss(false);
+    current = paused->back();
+    paused->pop_back();
+  }
+}
+
+void print_counters(ostream &out) {
+  out << "{\"tokens\": ";
+  print_counts(out, TOKEN_NAMES, counters.tokens, TOKEN_KINDS);
+  out << ", \"symbol_table\": {\"lookups\": " << counters.symbol_lookups
+      << ", \"probes\": " << counters.symbol_probes
+      << ", \"longest_probe\": " << counters.longest_symbol_probe << "}"
+      << ", \"register_allocations\": " << counters.register_allocations
+      << ", \"spills\": " << counters.spills
+      << ", \"labels\": " << counters.labels << ", \"instructions\": ";
+  print_counts(out, INSTRUCTION_NAMES, counters.instructions,
+               INSTRUCTION_KINDS);
+  out << "}" << endl;
+}
@@ -0,0 +1,149 @@
+// Time and memory spent in each phase of a compilation, and counters of
+// the work done on its hot paths.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+/* Phases of a compilation. Time spent outside of every phase is charged to
+   PHASE_OTHER. Phases are only timed at coarse boundaries, since reading
+   the clocks costs as much as scanning a token: the scanning and the
+   semantic analysis done along the way are charged to PHASE_PARSING, and
+   the tokens and symbol table lookups are counted instead. */
+typedef enum phase { PHASE_OTHER,
+                     PHASE_BUFFERING,        // Reading the source file.
+                     PHASE_PARSING,          // Parser::parse_program().
+                     PHASE_OPTIMIZATION,     // The passes over the IR.
+                     PHASE_CODE_GENERATION,  // Code_Generator.
+                     PHASE_OUTPUT,           // Writing the target code.
+                     PHASE_COUNT } phase_type;
+
+// What a phase cost, not counting the phases nested within it.
+struct Phase_Statistics {
+  // Number of times the phase was entered.
+  long long entries;
+
+  double wall_seconds;
+  double cpu_seconds;
+
+  // Number and total size of the memory allocations made with operator
+  // new, in programs linking the allocation hook (allocation_hook.cc).
+  long long allocations;
+  long long allocated_bytes;
+
+  // Peak resident set size of the process, in kilobytes, when last sampled
+  // on leaving the phase. Each phase samples at most once per millisecond.
+  long peak_rss_kb;
+};
+
+/* Starts measuring the phases afresh, outside of every Phase_Scope. Until
+   first called, Phase_Scope costs a single test and nothing is measured.
+   Also routes cout through a buffer charging the time spent writing it out
+   to PHASE_OUTPUT, until print_statistics() restores it. */
+void enable_statistics();
+
+bool statistics_enabled();
+
+// Returns what a phase cost so far.
+const Phase_Statistics &get_phase_statistics(const phase_type phase);
+
+// Returns the name of a phase, such as "code generation".
+const char *phase_name(const phase_type phase);
+
+/* Writes what each phase cost as a table, or as a JSON object of the form
+
+     {"phases": [{"name": "parsing", "entries": 1, "wall_ms": 0.2,
+                  "cpu_ms": 0.2, "allocations": 240,
+                  "allocated_bytes": 7680, "peak_rss_kb": 3100}, ...],
+      "total": {...}}
+
+   where total sums the phases, taking the largest peak_rss_kb. */
+void print_statistics(ostream &out, const bool json);
+
+// Charges the time and memory spent during its lifetime to a phase, once
+// statistics are enabled. Scopes nest: an inner phase pauses the outer one,
+// so that each phase is charged its own cost only.
+class Phase_Scope {
+ public:
+  explicit Phase_Scope(const phase_type phase);
+  ~Phase_Scope();
+
+ private:
+  bool active;
+};
+
+// Charges a memory allocation to the current phase. Called by the
+// replacement operator new of the allocation hook, even before main().
+void count_allocation(const size_t size);
+
+// Numbers of token kinds and TrAL instruction kinds, following token_type
+// from TOKEN_KEYWORD and inst_type from INST_MOVE.
+const int TOKEN_KINDS = 8;
+const int FIRST_INSTRUCTION = 802;
+const int INSTRUCTION_KINDS = 14;
+
+/* Counters kept on the hot paths of the compiler whatever the options, at
+   the cost of an increment each. */
+struct Counters {
+  // Tokens scanned, by token_type.
+  long long tokens[TOKEN_KINDS];
+
+  // Symbol table lookups, and the entries they compared in all and at most.
+  long long symbol_lookups;
+  long long symbol_probes;
+  long long longest_symbol_probe;
+
+  // Registers given to virtual registers, and virtual registers spilled, by
+  // either register allocator.
+  long long register_allocations;
+  long long spills;
+
+  // Labels created for the IR or by the emitter.
+  long long labels;
+
+  // Instructions emitted, by inst_type from INST_MOVE. The x86-64 target
+  // counts the TrAL instruction each of its sequences stands for, with a
+  // call or a return standing for a brun.
+  long long instructions[INSTRUCTION_KINDS];
+};
+
+extern Counters counters;
+
+inline void count_token(const int kind) {
+  if (kind >= 0 && kind < TOKEN_KINDS) {
+    ++counters.tokens[kind];
+  }
+}
+
+// Counts a symbol table lookup comparing the given number of entries.
+inline void count_symbol_lookup(const long long probes) {
+  ++counters.symbol_lookups;
+  counters.symbol_probes += probes;
+  if (probes > counters.longest_symbol_probe) {
+    counters.longest_symbol_probe = probes;
+  }
+}
+
+// Counts an instruction by its inst_type.
+inline void count_instruction(const int inst) {
+  const int kind = inst - FIRST_INSTRUCTION;
+  if (kind >= 0 && kind < INSTRUCTION_KINDS) {
+    ++counters.instructions[kind];
+  }
+}
+
+/* Writes the counters as a JSON object of the form
+
+     {"tokens": {"keyword": 12, ..., "eof": 1},
+      "symbol_table": {"lookups": 40, "probes": 95, "longest_probe": 6},
+      "register_allocations": 30, "spills": 2, "labels": 9,
+      "instructions": {"move": 25, ..., "halt": 1}} */
+void print_counters(ostream &out);
+
+#endif
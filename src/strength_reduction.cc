@@ -0,0 +1,255 @@
+// Implementation of strength reduction.
+// @author Hieu Le
+// @version 12/30/2016
+
+#include "strength_reduction.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "loop_invariants.h"
+#include "word.h"
+
+namespace {
+
+// A multiplication of an induction variable kept up to date in a virtual
+// register.
+struct Reduction {
+  int induction;
+  IR_Operand factor;
+  IR_Operand product;
+};
+
+// Reduces the multiplications of the induction variables of a loop. The
+// control flow graph must be up to date.
+void reduce_loop(IR_Function *function, Basic_Block *header,
+                 Basic_Block *end) {
+  // Number of writes to each virtual register within the loop, and whether
+  // they all step it.
+  const int n_vregs = function->vreg_types.size();
+  vector<int> loop_definitions(n_vregs, 0);
+  vector<bool> only_steps(n_vregs, true);
+  int step;
+  for (int id = header->id; id <= end->id; ++id) {
+    for (const IR_Instruction &instruction :
+             function->blocks[id]->instructions) {
+      if (instruction.dst.is_vreg()) {
+        ++loop_definitions[instruction.dst.get_value()];
+        only_steps[instruction.dst.get_value()] =
+            only_steps[instruction.dst.get_value()]
+            && is_induction_step(instruction, step);
+      }
+    }
+  }
+  auto is_induction = [&](const IR_Operand &operand) {
+    return operand.is_vreg() && loop_definitions[operand.get_value()] > 0
+        && only_steps[operand.get_value()];
+  };
+  auto is_invariant = [&](const IR_Operand &operand) {
+    return operand.is_immediate()
+        || (operand.is_vreg() && loop_definitions[operand.get_value()] == 0);
+  };
+
+  // Replace each multiplication that pays off by a move of its product.
+  vector<IR_Instruction> preheader_code;
+  vector<Reduction> reductions;
+  map<pair<int, pair<int, int>>, IR_Operand> products;
+  for (int id = header->id; id <= end->id; ++id) {
+    for (IR_Instruction &instruction : function->blocks[id]->instructions) {
+      if (instruction.opcode != IR_MUL) {
+        continue;
+      }
+      IR_Operand induction = instruction.src1;
+      IR_Operand factor = instruction.src2;
+      if (!is_induction(induction)) {
+        swap(induction, factor);
+      }
+      if (!is_induction(induction) || !is_invariant(factor)) {
+        continue;
+      }
+      const int vreg = induction.get_value();
+      const int cost = loop_definitions[vreg] * cost_of(IR_ADD)
+          + cost_of(IR_MOVE);
+      if (cost >= cost_of(IR_MUL)) {
+        continue;
+      }
+
+      const pair<int, pair<int, int>> key(
+          vreg, {factor.get_kind(), factor.get_value()});
+      if (products.count(key) == 0) {
+        const IR_Operand product = function->new_vreg(INT_T);
+        preheader_code.push_back(IR_Instruction(IR_MUL, product, induction,
+                                                factor, nullptr));
+        reductions.push_back({vreg, factor, product});
+        products[key] = product;
+      }
+      instruction = IR_Instruction(IR_MOVE, instruction.dst, products[key],
+                                   IR_Operand(), nullptr);
+    }
+  }
+  if (reductions.empty()) {
+    return;
+  }
+
+  // Step each product along with its induction variable.
+  for (int id = header->id; id <= end->id; ++id) {
+    vector<IR_Instruction> code;
+    for (const IR_Instruction &instruction :
+             function->blocks[id]->instructions) {
+      code.push_back(instruction);
+      if (!is_induction_step(instruction, step)) {
+        continue;
+      }
+      for (const Reduction &reduction : reductions) {
+        if (reduction.induction != instruction.dst.get_value()) {
+          continue;
+        }
+        IR_Operand increment;
+        if (reduction.factor.is_immediate()) {
+          increment = IR_Operand(
+              IR_IMMEDIATE,
+              wrap(static_cast<long long>(step)
+                   * reduction.factor.get_value()));
+        } else if (step == 1) {
+          increment = reduction.factor;
+        } else {
+          increment = function->new_vreg(INT_T);
+          preheader_code.push_back(
+              IR_Instruction(IR_MUL, increment, reduction.factor,
+                             IR_Operand(IR_IMMEDIATE, step), nullptr));
+        }
+        code.push_back(IR_Instruction(IR_ADD, reduction.product,
+                                      reduction.product, increment,
+                                      nullptr));
+      }
+    }
+    function->blocks[id]->instructions.swap(code);
+  }
+
+  Basic_Block *preheader = new Basic_Block("");
+  preheader->instructions = preheader_code;
+  function->blocks.insert(function->blocks.begin() + header->id, preheader);
+}
+
+// Appends to code the instructions computing dst := src * factor without
+// multiplying. Returns false if they would cost more than the
+// multiplication.
+bool expand_multiplication(IR_Function *function, const IR_Operand &dst,
+                           const IR_Operand &src, const int factor,
+                           vector<IR_Instruction> &code) {
+  if (factor == 0 || factor == 1) {
+    code.push_back(IR_Instruction(
+        IR_MOVE, dst, factor == 0 ? IR_Operand(IR_IMMEDIATE, 0) : src,
+        IR_Operand(), nullptr));
+    return true;
+  }
+  if (factor == -1) {
+    code.push_back(IR_Instruction(IR_NEG, dst, src, IR_Operand(), nullptr));
+    return true;
+  }
+  // Other operands are read more than once.
+  if (!src.is_vreg()) {
+    return false;
+  }
+
+  const unsigned int magnitude = factor < 0
+      ? -static_cast<unsigned int>(factor) : factor;
+  int top = 0;
+  int ones = 0;
+  for (int bit = 0; bit < 32; ++bit) {
+    if (magnitude >> bit & 1) {
+      top = bit;
+      ++ones;
+    }
+  }
+  const int additions = top + ones - 1;
+  const int n_steps = additions + (factor < 0 ? 1 : 0);
+  if (additions * cost_of(IR_ADD) + (factor < 0 ? cost_of(IR_NEG) : 0)
+      >= cost_of(IR_MUL)) {
+    return false;
+  }
+
+  // Only the last step writes dst, which may be src.
+  IR_Operand value = src;
+  int emitted = 0;
+  auto emit = [&](const ir_opcode_type opcode, const IR_Operand &second) {
+    const IR_Operand result =
+        ++emitted == n_steps ? dst : function->new_vreg(INT_T);
+    code.push_back(IR_Instruction(opcode, result, value, second, nullptr));
+    value = result;
+  };
+  for (int bit = top - 1; bit >= 0; --bit) {
+    emit(IR_ADD, value);
+    if (magnitude >> bit & 1) {
+      emit(IR_ADD, src);
+    }
+  }
+  if (factor < 0) {
+    emit(IR_NEG, IR_Operand());
+  }
+  return true;
+}
+
+// Replaces the multiplications and divisions by constants of a block.
+void reduce_block(IR_Function *function, Basic_Block *block) {
+  vector<IR_Instruction> code;
+  for (const IR_Instruction &instruction : block->instructions) {
+    const unsigned int start = code.size();
+    if (instruction.opcode == IR_MUL) {
+      if (instruction.src2.is_immediate()
+          && expand_multiplication(function, instruction.dst,
+                                   instruction.src1,
+                                   instruction.src2.get_value(), code)) {
+        code[start].comment = instruction.comment;
+        continue;
+      }
+      if (instruction.src1.is_immediate()
+          && expand_multiplication(function, instruction.dst,
+                                   instruction.src2,
+                                   instruction.src1.get_value(), code)) {
+        code[start].comment = instruction.comment;
+        continue;
+      }
+    } else if (instruction.opcode == IR_DIV
+               && instruction.src2 == IR_Operand(IR_IMMEDIATE, 1)) {
+      // Dividing by -1 is kept, since INT_MIN / -1 fails at run time.
+      code.push_back(IR_Instruction(IR_MOVE, instruction.dst,
+                                    instruction.src1, IR_Operand(),
+                                    nullptr));
+      code[start].comment = instruction.comment;
+      continue;
+    }
+    code.push_back(instruction);
+  }
+  block->instructions.swap(code);
+}
+
+}  // namespace
+
+int cost_of(const ir_opcode_type opcode) {
+  // Roughly the latencies of the processors running the native code.
+  switch (opcode) {
+    case IR_MUL: return 4;
+    case IR_DIV: return 20;
+    default: return 1;
+  }
+}
+
+void reduce_strength(IR_Function *function) {
+  function->build_cfg();
+  const vector<pair<Basic_Block *, Basic_Block *>> loops =
+      find_loops(function);
+  for (const pair<Basic_Block *, Basic_Block *> &loop : loops) {
+    // Preheaders shift the blocks, so each loop needs a fresh graph.
+    function->build_cfg();
+    if (has_single_entry(function, loop.first, loop.second)) {
+      reduce_loop(function, loop.first, loop.second);
+    }
+  }
+
+  for (Basic_Block *block : function->blocks) {
+    reduce_block(function, block);
+  }
+  function->build_cfg();
+}
@@ -0,0 +1,33 @@
+// Strength reduction of multiplications and divisions.
+// @author Hieu Le
+// @version 12/30/2016
+
+#ifndef STRENGTH_REDUCTION_H
+#define STRENGTH_REDUCTION_H
+
+#include "ir.h"
+
+/* Returns the relative cost of running an operation on the target, in units
+   of an addition. A rewrite is made only when the instructions it emits per
+   execution cost less than the ones it replaces. */
+int cost_of(const ir_opcode_type opcode);
+
+/* Replaces multiplications and divisions by cheaper operations.
+
+   Within each while loop, a multiplication of an induction variable by a
+   value the loop does not change is computed once in a preheader, then
+   kept up to date by adding the matching multiple of the step wherever the
+   induction variable is stepped. An induction variable is a virtual
+   register only ever written within the loop by adding or subtracting a
+   constant to it, such as i in i := i + 1. The multiplication becomes a
+   move, which copy propagation usually removes.
+
+   Elsewhere, a multiplication by a constant becomes a sequence of
+   additions, doubling the other operand for each binary digit of the
+   constant and adding it for each digit set, followed by a negation for a
+   negative constant. Multiplying by 0, 1 or -1 becomes a move or a
+   negation, and dividing by 1 a move, which matters once constants are
+   propagated into the divisor. */
+void reduce_strength(IR_Function *function);
+
+#endif
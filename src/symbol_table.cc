@@ -4,6 +4,8 @@
 
 #include "symbol_table.h"
 
+#include "stats.h"
+
 Symbol_Table::Symbol_Table() {}
 
 Symbol_Table::~Symbol_Table() {}
@@ -46,9 +48,11 @@ bool Symbol_Table::is_decl(const string *id, const string *env) {
   vector<STAB_ENTRY>::iterator it;
   for (it = stab.begin(); it != stab.end(); ++it) {
     if (it->id.compare(*id) == 0 && it->env.compare(*env) == 0) {
+      count_symbol_lookup(it - stab.begin() + 1);
       return true;
     }
   }
+  count_symbol_lookup(stab.size());
   return false;
 }
 
@@ -58,10 +62,12 @@ expr_type Symbol_Table::get_type(string *id, string *env) {
   vector<STAB_ENTRY>::iterator it;
   for (it = stab.begin(); it != stab.end(); ++it) {
     if (it->id.compare(*id) == 0 && it->env.compare(*env) == 0) {
+      count_symbol_lookup(it - stab.begin() + 1);
       return it->type;
     }
   }
 
+  count_symbol_lookup(stab.size());
   return GARBAGE_T;
 }
 
@@ -72,10 +78,12 @@ expr_type Symbol_Table::get_type(string *proc_id, const int pos) {
   for (it = stab.begin(); it != stab.end(); ++it) {
     if (it->env.compare(*proc_id) == 0
         && it->position == pos) {
+      count_symbol_lookup(it - stab.begin() + 1);
       return it->type;
     }
   }
 
+  count_symbol_lookup(stab.size());
   return GARBAGE_T;
 }
 
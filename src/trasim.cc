@@ -0,0 +1,93 @@
+// Main program of the TrAL simulator.
+// @author Hieu Le
+// @version 12/24/2016
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iostream>
+
+#include "jit.h"
+#include "register_allocator.h"
+#include "simulator.h"
+
+// Words of stack placed after the program.
+#define STACK_WORDS 4096
+
+int main(int argc, char **argv) {
+  char *filename = nullptr;
+  int register_count = TRAL_REGISTER_COUNT;
+  long long max_steps = 100000000;
+  bool print_statistics = false;
+  bool use_switch = false;
+  bool use_jit = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--registers=", 12) == 0) {
+      register_count = atoi(argv[i] + 12);
+      if (!Register_File::is_supported(register_count)) {
+        std::cerr << "ERROR: Unsupported number of registers: "
+                  << argv[i] + 12 << " (use 4, 8, 16 or 32)" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    } else if (strncmp(argv[i], "--max-steps=", 12) == 0) {
+      max_steps = atoll(argv[i] + 12);
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      print_statistics = true;
+    } else if (strcmp(argv[i], "--switch") == 0) {
+      use_switch = true;
+    } else if (strcmp(argv[i], "--jit") == 0) {
+      use_jit = true;
+    } else if (filename == nullptr) {
+      filename = argv[i];
+    } else {
+      filename = nullptr;
+      break;
+    }
+  }
+  if (filename == nullptr) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--registers=<count>] [--max-steps=<count>] [--stats]"
+              << " [--switch | --jit] <TrAL file name>" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "ERROR: Cannot open " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Simulator simulator(register_count, STACK_WORDS);
+  if (!simulator.load(in)) {
+    std::cerr << "ERROR: " << filename << ", " << simulator.get_error()
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  simulation_status_type status;
+  if (use_jit) {
+    // Native code only counts instructions.
+    JIT jit(&simulator);
+    if (!jit.compile()) {
+      std::cerr << "ERROR: " << jit.get_error() << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    status = jit.run(std::cout, max_steps);
+    if (print_statistics) {
+      std::cerr << "instructions    " << jit.get_instruction_count()
+                << std::endl;
+    }
+  } else {
+    status = use_switch ? simulator.run(std::cout, max_steps)
+                        : simulator.run_threaded(std::cout, max_steps);
+    if (print_statistics) {
+      simulator.get_statistics().print(std::cerr);
+    }
+  }
+  if (status != SIM_HALTED) {
+    std::cerr << "ERROR: " << Simulator::describe(status) << std::endl;
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
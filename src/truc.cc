@@ -3,23 +3,174 @@
 // @version November 9th, 2016
 
 #include <cstdlib>
+#include <cstring>
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "parser.h"
 #include "scanner.h"
+#include "stats.h"
+#include "x86_emitter.h"
+
+namespace {
+
+// File receiving the counters, "-" for the standard error, or nullptr to
+// leave them out.
+const char *counters_file = nullptr;
+
+// Writes the counters at exit, whether the compilation succeeded or not.
+void write_counters() {
+  if (strcmp(counters_file, "-") == 0) {
+    print_counters(std::cerr);
+    return;
+  }
+  std::ofstream out(counters_file);
+  if (!out) {
+    std::cerr << "ERROR: Cannot write the counters to " << counters_file
+              << std::endl;
+    return;
+  }
+  print_counters(out);
+}
+
+}  // namespace
 
 int main(int argc, char **argv) {
-  char *filename;
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <input file name>" << std::endl;
+  char *filename = nullptr;
+  // Optimize unless told otherwise.
+  int optimization_level = 1;
+  int register_count = TRAL_REGISTER_COUNT;
+  bool native = false;
+  bool comments = false;
+  bool debug = false;
+  bool inlining_log = false;
+  int unroll_factor = UNROLL_FACTOR;
+  bool time_passes = false;
+  // Report the cost of each phase, as a table or as JSON.
+  bool stats = false;
+  bool stats_json = false;
+  // Passes to enable and disable whatever the level.
+  std::vector<std::string> enabled;
+  std::vector<std::string> disabled;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "-O", 2) == 0 && strlen(argv[i]) == 3
+        && argv[i][2] >= '0' && argv[i][2] <= '9') {
+      optimization_level = argv[i][2] - '0';
+      if (optimization_level > MAX_OPTIMIZATION_LEVEL) {
+        std::cerr << "ERROR: Unsupported optimization level: " << argv[i] + 2
+                  << " (use 0 to " << MAX_OPTIMIZATION_LEVEL << ")"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    } else if (strncmp(argv[i], "--registers=", 12) == 0) {
+      register_count = atoi(argv[i] + 12);
+      if (!Register_File::is_supported(register_count)) {
+        std::cerr << "ERROR: Unsupported number of registers: "
+                  << argv[i] + 12 << " (use 4, 8, 16 or 32)" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    } else if (strcmp(argv[i], "--target=x86-64") == 0) {
+      native = true;
+    } else if (strcmp(argv[i], "--target=tral") == 0) {
+      native = false;
+    } else if (strcmp(argv[i], "--comments") == 0) {
+      comments = true;
+    } else if (strcmp(argv[i], "--debug") == 0) {
+      debug = true;
+    } else if (strcmp(argv[i], "--inlining-log") == 0) {
+      inlining_log = true;
+    } else if (strncmp(argv[i], "--unroll=", 9) == 0) {
+      unroll_factor = atoi(argv[i] + 9);
+      if (unroll_factor < 1) {
+        std::cerr << "ERROR: Unsupported unroll factor: " << argv[i] + 9
+                  << " (use 1 or more)" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    } else if (strncmp(argv[i], "--enable-pass=", 14) == 0) {
+      enabled.push_back(argv[i] + 14);
+    } else if (strncmp(argv[i], "--disable-pass=", 15) == 0) {
+      disabled.push_back(argv[i] + 15);
+    } else if (strcmp(argv[i], "--time-passes") == 0) {
+      time_passes = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      stats = true;
+      stats_json = false;
+    } else if (strcmp(argv[i], "--stats=json") == 0) {
+      stats = true;
+      stats_json = true;
+    } else if (strcmp(argv[i], "--counters") == 0) {
+      counters_file = "-";
+    } else if (strncmp(argv[i], "--counters=", 11) == 0) {
+      counters_file = argv[i] + 11;
+    } else if (filename == nullptr) {
+      filename = argv[i];
+    } else {
+      filename = nullptr;
+      break;
+    }
+  }
+  if (filename == nullptr) {
+    std::cerr << "Usage: " << argv[0]
+              << " [-O<level>] [--registers=<count>]"
+              << " [--target=tral|x86-64] [--comments] [--debug]"
+              << " [--inlining-log] [--unroll=<factor>]"
+              << " [--enable-pass=<name>] [--disable-pass=<name>]"
+              << " [--time-passes]"
+              << " [--stats[=json]] [--counters[=<file>]]"
+              << " <input file name>" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (native && register_count > X86_MAX_REGISTERS) {
+    std::cerr << "ERROR: The x86-64 target has at most " << X86_MAX_REGISTERS
+              << " registers" << std::endl;
     exit(EXIT_FAILURE);
   }
 
-  filename = argv[1];
+  if (stats) {
+    enable_statistics();
+  }
+  if (counters_file != nullptr) {
+    atexit(write_counters);
+  }
 
   // Create a Parser for this source file.
   Parser parser(new Scanner(filename));
+  parser.set_optimization_level(optimization_level);
+  parser.set_register_count(register_count);
+  parser.set_unroll_factor(unroll_factor);
+  if (native) {
+    parser.set_emitter(new X86_Emitter(register_count));
+  }
+  parser.set_comments(comments);
+  parser.set_debug(debug);
+  if (inlining_log) {
+    parser.set_inlining_log(&std::cerr);
+  }
+  Pass_Manager *passes = parser.get_pass_manager();
+  for (const bool enable : {true, false}) {
+    for (const std::string &name : enable ? enabled : disabled) {
+      if (!passes->set_enabled(name, enable)) {
+        // List each pass once, although some run twice.
+        std::vector<std::string> names;
+        for (const Pass &pass : passes->get_passes()) {
+          if (std::find(names.begin(), names.end(), pass.name)
+              == names.end()) {
+            names.push_back(pass.name);
+          }
+        }
+        std::cerr << "ERROR: Unknown pass: " << name << " (use";
+        for (const std::string &known : names) {
+          std::cerr << " " << known;
+        }
+        std::cerr << ")" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
 
   // Generate target code for the given source program.
   if (parser.parse_program()) {
@@ -30,6 +181,12 @@ int main(int argc, char **argv) {
   } else {
     std::cerr << "ERROR: Parsing failed!" << std::endl;
   }
+  if (time_passes) {
+    passes->print_timing(std::cerr);
+  }
+  if (stats) {
+    print_statistics(std::cerr, stats_json);
+  }
 
   return 0;
 }
@@ -0,0 +1,65 @@
+// Main program of the synthetic TruPL workload generator.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iostream>
+
+#include "workload.h"
+
+int main(int argc, char **argv) {
+  Workload_Shape shape = default_workload_shape();
+  char *filename = nullptr;
+  bool usage = false;
+  for (int i = 1; i < argc && !usage; ++i) {
+    if (strncmp(argv[i], "--seed=", 7) == 0) {
+      shape.seed = strtoull(argv[i] + 7, nullptr, 10);
+    } else if (strncmp(argv[i], "--declarations=", 15) == 0) {
+      shape.declarations = atoi(argv[i] + 15);
+    } else if (strncmp(argv[i], "--procedures=", 13) == 0) {
+      shape.procedures = atoi(argv[i] + 13);
+    } else if (strncmp(argv[i], "--statements=", 13) == 0) {
+      shape.statements = atoll(argv[i] + 13);
+    } else if (strncmp(argv[i], "--size=", 7) == 0) {
+      shape.target_bytes = parse_workload_size(argv[i] + 7);
+      usage = shape.target_bytes < 0;
+    } else if (strncmp(argv[i], "--depth=", 8) == 0) {
+      shape.expression_depth = atoi(argv[i] + 8);
+    } else if (strncmp(argv[i], "--nesting=", 10) == 0) {
+      shape.loop_nesting = atoi(argv[i] + 10);
+    } else if (strncmp(argv[i], "--comments=", 11) == 0) {
+      shape.comment_density = atof(argv[i] + 11);
+    } else if (filename == nullptr) {
+      filename = argv[i];
+    } else {
+      usage = true;
+    }
+  }
+  if (usage || shape.declarations < 0 || shape.procedures < 0
+      || shape.statements < 0 || shape.expression_depth < 0
+      || shape.loop_nesting < 0) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--seed=<number>] [--declarations=<count>]"
+              << " [--procedures=<count>] [--statements=<count>]"
+              << " [--size=<bytes>[k|m|g]] [--depth=<depth>]"
+              << " [--nesting=<depth>] [--comments=<density>]"
+              << " [<output file name>]" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Workload_Generator generator(shape);
+  if (filename == nullptr) {
+    generator.generate(std::cout);
+    return 0;
+  }
+  std::ofstream out(filename);
+  if (!out) {
+    std::cerr << "ERROR: Cannot open " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  generator.generate(out);
+  return 0;
+}
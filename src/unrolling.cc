@@ -0,0 +1,327 @@
+// Implementation of loop unrolling.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "unrolling.h"
+
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "loop_invariants.h"
+
+namespace {
+
+// Signs of the value compared by a loop condition, as a set of flags.
+const int SIGN_NEGATIVE = 1;
+const int SIGN_ZERO = 2;
+const int SIGN_POSITIVE = 4;
+
+// Returns the signs of its operand for which a conditional branch is taken.
+int taken_signs(const ir_opcode_type opcode) {
+  switch (opcode) {
+    case IR_BREZ: return SIGN_ZERO;
+    case IR_BRPO: return SIGN_POSITIVE;
+    case IR_BRNE: return SIGN_NEGATIVE;
+    default: return 0;
+  }
+}
+
+bool fits(const long long value) {
+  return value >= INT_MIN && value <= INT_MAX;
+}
+
+// A while loop running a known number of times.
+struct Counted_Loop {
+  // Block holding the condition, first and last blocks of the body, and
+  // the block the loop exits to.
+  Basic_Block *header;
+  int body;
+  Basic_Block *end;
+  Basic_Block *exit;
+
+  // Virtual register tested by the condition.
+  int condition;
+
+  int induction;
+  int start;
+  int step;
+  long long iterations;
+};
+
+// Finds the constant a virtual register holds on entry to a loop, from the
+// code falling through into it. Returns false if it is not known.
+bool find_start(const IR_Function *function, const Basic_Block *header,
+                const int vreg, int &start) {
+  for (int id = header->id - 1; id >= 0; --id) {
+    const vector<IR_Instruction> &code = function->blocks[id]->instructions;
+    for (int i = code.size() - 1; i >= 0; --i) {
+      if (code[i].dst == IR_Operand(IR_VREG, vreg)) {
+        start = code[i].src1.get_value();
+        return code[i].opcode == IR_MOVE && code[i].src1.is_immediate();
+      }
+    }
+    const vector<Basic_Block *> &predecessors =
+        function->blocks[id]->predecessors;
+    if (predecessors.size() != 1 || predecessors[0]->id != id - 1) {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Checks if a loop is counted, and fills in loop if so. The control flow
+// graph must be up to date.
+bool analyze(const IR_Function *function, Basic_Block *header,
+             Basic_Block *end, Counted_Loop &loop) {
+  // The condition subtracts a constant from the induction variable, or the
+  // other way around, then branches out on some signs of the difference.
+  const vector<IR_Instruction> &code = header->instructions;
+  if (code.size() != 2 || code[0].opcode != IR_SUB
+      || !code[0].dst.is_vreg()) {
+    return false;
+  }
+  const bool reversed = code[0].src1.is_immediate();
+  const IR_Operand &variable = reversed ? code[0].src2 : code[0].src1;
+  const IR_Operand &bound = reversed ? code[0].src1 : code[0].src2;
+  if (!variable.is_vreg() || !bound.is_immediate()) {
+    return false;
+  }
+  loop.header = header;
+  loop.end = end;
+  loop.condition = code[0].dst.get_value();
+  loop.induction = variable.get_value();
+  loop.exit = code[1].target;
+
+  // The remaining tests sit alone in the blocks following the header.
+  int signs = SIGN_NEGATIVE | SIGN_ZERO | SIGN_POSITIVE;
+  int id = header->id;
+  while (id <= end->id) {
+    const vector<IR_Instruction> &tests = function->blocks[id]->instructions;
+    if (tests.empty()) {
+      break;
+    }
+    const IR_Instruction &test = tests.back();
+    if ((id > header->id && tests.size() != 1)
+        || !test.is_conditional_branch()
+        || test.src1 != IR_Operand(IR_VREG, loop.condition)
+        || test.target != loop.exit) {
+      break;
+    }
+    signs &= ~taken_signs(test.opcode);
+    ++id;
+  }
+  loop.body = id;
+  if (loop.body == header->id || loop.body > end->id
+      || end->id + 1 >= static_cast<int>(function->blocks.size())
+      || function->blocks[end->id + 1] != loop.exit) {
+    return false;
+  }
+
+  // The body only branches forward within itself, steps the induction
+  // variable once at its end and leaves the condition alone. Loops holding
+  // other loops are left alone: the copies of the inner loops would compete
+  // for the registers, and spill what the original loop kept in them.
+  int steps = 0;
+  for (id = loop.body; id <= end->id; ++id) {
+    const vector<IR_Instruction> &body = function->blocks[id]->instructions;
+    for (unsigned int i = 0; i < body.size(); ++i) {
+      const IR_Instruction &instruction = body[i];
+      if (instruction.is_branch() && !(id == end->id && i + 1 == body.size())
+          && (instruction.target->id <= id
+              || instruction.target->id > end->id)) {
+        return false;
+      }
+      if (instruction.src1 == IR_Operand(IR_VREG, loop.condition)
+          || instruction.src2 == IR_Operand(IR_VREG, loop.condition)
+          || instruction.dst == IR_Operand(IR_VREG, loop.condition)) {
+        return false;
+      }
+      if (instruction.dst == variable) {
+        if (id != end->id || !is_induction_step(instruction, loop.step)) {
+          return false;
+        }
+        ++steps;
+      }
+    }
+  }
+  if (steps != 1 || loop.step == 0
+      || !find_start(function, header, loop.induction, loop.start)) {
+    return false;
+  }
+
+  // Turn the signs into a strict comparison with a bound.
+  if (reversed) {
+    signs = (signs & SIGN_ZERO) | (signs & SIGN_NEGATIVE ? SIGN_POSITIVE : 0)
+        | (signs & SIGN_POSITIVE ? SIGN_NEGATIVE : 0);
+  }
+  long long limit = bound.get_value();
+  bool increasing;
+  if (signs == SIGN_NEGATIVE) {
+    increasing = true;
+  } else if (signs == (SIGN_NEGATIVE | SIGN_ZERO)) {
+    increasing = true;
+    ++limit;
+  } else if (signs == SIGN_POSITIVE) {
+    increasing = false;
+  } else if (signs == (SIGN_POSITIVE | SIGN_ZERO)) {
+    increasing = false;
+    --limit;
+  } else {
+    return false;
+  }
+  if (increasing != (loop.step > 0)) {
+    return false;
+  }
+
+  // Count the iterations, making sure that neither the induction variable
+  // nor the condition ever wraps around.
+  const long long distance = increasing
+      ? limit - loop.start : loop.start - limit;
+  const long long stride = increasing ? loop.step : -loop.step;
+  loop.iterations = distance > 0 ? (distance + stride - 1) / stride : 0;
+  const long long last = loop.start + loop.iterations * loop.step;
+  for (const long long value : {static_cast<long long>(loop.start), last}) {
+    const long long difference = reversed
+        ? bound.get_value() - value : value - bound.get_value();
+    if (!fits(value) || !fits(difference)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks if the condition of a loop is read by code outside the loop.
+bool read_outside(const IR_Function *function, const Counted_Loop &loop) {
+  const IR_Operand condition(IR_VREG, loop.condition);
+  for (const Basic_Block *block : function->blocks) {
+    if (block->id >= loop.header->id && block->id <= loop.end->id) {
+      continue;
+    }
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.src1 == condition || instruction.src2 == condition) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Unrolls a counted loop factor times.
+void unroll(IR_Function *function, const Counted_Loop &loop,
+            const int factor) {
+  int size = 0;
+  for (int id = loop.body; id <= loop.end->id; ++id) {
+    size += function->blocks[id]->instructions.size();
+  }
+  long long copies = factor;
+  if (copies > loop.iterations) {
+    copies = loop.iterations;
+  }
+  while (copies > 1 && size * copies > UNROLL_SIZE_LIMIT) {
+    --copies;
+  }
+  if (copies < 2) {
+    return;
+  }
+  const long long rounds = loop.iterations / copies;
+  const bool remainder = loop.iterations % copies != 0;
+  const long long last = loop.start + rounds * copies * loop.step;
+  if (!fits(loop.start - last)) {
+    return;
+  }
+
+  // Copy the body, giving the labels a suffix made unique by the label of
+  // the loop. The back edge of each copy falls through to the next one.
+  vector<Basic_Block *> blocks;
+  for (int copy = 1; copy <= copies; ++copy) {
+    unordered_map<Basic_Block *, Basic_Block *> copy_of;
+    const unsigned int first = blocks.size();
+    for (int id = loop.body; id <= loop.end->id; ++id) {
+      Basic_Block *block = function->blocks[id];
+      Basic_Block *clone = new Basic_Block(
+          block->label.empty() ? ""
+          : block->label + loop.header->label + "_" + to_string(copy));
+      clone->instructions = block->instructions;
+      copy_of[block] = clone;
+      blocks.push_back(clone);
+    }
+    blocks.back()->instructions.pop_back();
+    for (unsigned int i = first; i < blocks.size(); ++i) {
+      for (IR_Instruction &instruction : blocks[i]->instructions) {
+        if (instruction.is_branch()) {
+          instruction.target = copy_of[instruction.target];
+        }
+      }
+    }
+  }
+
+  // Repeat the copies while more than copies iterations remain.
+  if (rounds > 1) {
+    Basic_Block *top = blocks.front();
+    if (top->label.empty()) {
+      top->label = loop.header->label + "_unrolled";
+    }
+    Basic_Block *test = new Basic_Block("");
+    const IR_Operand difference = function->new_vreg(INT_T);
+    test->instructions.push_back(IR_Instruction(
+        IR_SUB, difference, IR_Operand(IR_VREG, loop.induction),
+        IR_Operand(IR_IMMEDIATE, last), nullptr));
+    test->instructions.push_back(IR_Instruction(
+        loop.step > 0 ? IR_BRNE : IR_BRPO, IR_Operand(), difference,
+        IR_Operand(), top));
+    blocks.push_back(test);
+  }
+
+  // Merge the blocks that are only entered by falling through.
+  vector<Basic_Block *> merged;
+  for (Basic_Block *block : blocks) {
+    if (!merged.empty() && block->label.empty()
+        && (merged.back()->instructions.empty()
+            || !merged.back()->instructions.back().is_branch())) {
+      merged.back()->instructions.insert(merged.back()->instructions.end(),
+                                         block->instructions.begin(),
+                                         block->instructions.end());
+      delete block;
+    } else {
+      merged.push_back(block);
+    }
+  }
+
+  // The original loop runs what remains. The condition computed by its
+  // header must not be read outside it to drop it.
+  vector<Basic_Block *>::iterator header_position =
+      function->blocks.begin() + loop.header->id;
+  if (!remainder && !read_outside(function, loop)) {
+    for (int id = loop.header->id; id <= loop.end->id; ++id) {
+      delete function->blocks[id];
+    }
+    header_position = function->blocks.erase(
+        header_position, function->blocks.begin() + loop.end->id + 1);
+  }
+  function->blocks.insert(header_position, merged.begin(), merged.end());
+}
+
+}  // namespace
+
+void unroll_loops(IR_Function *function, const int factor) {
+  if (factor < 2) {
+    return;
+  }
+  function->build_cfg();
+  const vector<pair<Basic_Block *, Basic_Block *>> loops =
+      find_loops(function);
+  for (const pair<Basic_Block *, Basic_Block *> &loop : loops) {
+    // Unrolling moves the blocks, so each loop needs a fresh graph. The
+    // loops enclosing an unrolled loop still span its copies.
+    function->build_cfg();
+    Counted_Loop counted;
+    if (has_single_entry(function, loop.first, loop.second)
+        && analyze(function, loop.first, loop.second, counted)) {
+      unroll(function, counted, factor);
+    }
+  }
+  function->build_cfg();
+}
@@ -0,0 +1,34 @@
+// Unrolling of counted loops.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef UNROLLING_H
+#define UNROLLING_H
+
+#include "ir.h"
+
+// Number of copies of the body made by default.
+const int UNROLL_FACTOR = 4;
+
+// Limit on the size of the copies of a loop body, in IR instructions. The
+// factor is lowered until the copies fit.
+const int UNROLL_SIZE_LIMIT = 64;
+
+/* Unrolls the counted while loops of a function by a given factor, so that
+   the loop condition is tested once every factor iterations.
+
+   A loop is counted when its condition compares an induction variable to a
+   constant, such as i < 10, the induction variable holds a constant on
+   entry and is stepped by a constant once per iteration, at the end of the
+   body. Its number of iterations is then known. The copies of the body run
+   in a loop of their own, tested at the bottom, until fewer than factor
+   iterations remain. The original loop follows and runs the remaining
+   iterations. It is dropped when none remain, so a loop running at most
+   factor times becomes straight-line code.
+
+   Only innermost loops are unrolled. Loops whose induction variable or
+   condition would overflow are left alone, as are loops whose copies would
+   not fit within UNROLL_SIZE_LIMIT for a factor of at least 2. */
+void unroll_loops(IR_Function *function, const int factor);
+
+#endif
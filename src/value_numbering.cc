@@ -0,0 +1,176 @@
+// Implementation of value numbering.
+// @author Hieu Le
+// @version 12/29/2016
+
+#include "value_numbering.h"
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// A computation, as its opcode and the value numbers of its operands.
+typedef tuple<int, int, int> Computation;
+
+// What is known at some point of a block.
+struct Value_Table {
+  // Value number held by each location, keyed by the kind and the value of
+  // its operand. Constants are locations never written.
+  map<pair<int, int>, int> numbers;
+
+  // Value number of each computation, along with the location it was
+  // computed into.
+  map<Computation, pair<int, IR_Operand>> computations;
+};
+
+pair<int, int> key_of(const IR_Operand &operand) {
+  return {operand.get_kind(), operand.get_value()};
+}
+
+// Returns the value number held by an operand, giving a new one to a
+// location read for the first time, or -1 for an absent operand.
+int number_of(Value_Table &table, const IR_Operand &operand, int &next) {
+  if (operand.is_none()) {
+    return -1;
+  }
+  const pair<int, int> key = key_of(operand);
+  map<pair<int, int>, int>::const_iterator it = table.numbers.find(key);
+  if (it != table.numbers.end()) {
+    return it->second;
+  }
+  table.numbers[key] = next;
+  return next++;
+}
+
+// Checks if a location still holds a given value.
+bool holds(const Value_Table &table, const IR_Operand &location,
+           const int number) {
+  map<pair<int, int>, int>::const_iterator it =
+      table.numbers.find(key_of(location));
+  return it != table.numbers.end() && it->second == number;
+}
+
+// Checks if an instruction writes its destination and nothing else.
+bool computes_value(const IR_Instruction &instruction) {
+  switch (instruction.opcode) {
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_NEG:
+    case IR_NOT:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Numbers the instructions of a block, rewriting the redundant ones.
+// Temporaries whose computation is dropped are mapped to the temporary
+// holding their value in replacements.
+void number_block(Basic_Block *block, const vector<bool> &is_temporary,
+                  Value_Table &table, int &next, vector<int> &replacements) {
+  vector<IR_Instruction> code;
+  for (IR_Instruction instruction : block->instructions) {
+    if (instruction.opcode == IR_CALL) {
+      // The callee may write memory.
+      for (map<pair<int, int>, int>::iterator it = table.numbers.begin();
+           it != table.numbers.end();) {
+        if (it->first.first == IR_VARIABLE) {
+          it = table.numbers.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    const IR_Operand &dst = instruction.dst;
+    if (instruction.opcode == IR_MOVE) {
+      const int number = number_of(table, instruction.src1, next);
+      if (holds(table, dst, number)) {
+        continue;
+      }
+      table.numbers[key_of(dst)] = number;
+    } else if (computes_value(instruction)) {
+      int first = number_of(table, instruction.src1, next);
+      int second = number_of(table, instruction.src2, next);
+      if ((instruction.opcode == IR_ADD || instruction.opcode == IR_MUL)
+          && second < first) {
+        swap(first, second);
+      }
+      const Computation computation(instruction.opcode, first, second);
+      map<Computation, pair<int, IR_Operand>>::iterator it =
+          table.computations.find(computation);
+      if (it != table.computations.end()
+          && holds(table, it->second.second, it->second.first)) {
+        const int number = it->second.first;
+        const IR_Operand &holder = it->second.second;
+        if (holds(table, dst, number)) {
+          continue;
+        }
+        table.numbers[key_of(dst)] = number;
+        if (dst.is_vreg() && is_temporary[dst.get_value()]
+            && holder.is_vreg() && is_temporary[holder.get_value()]) {
+          replacements[dst.get_value()] = holder.get_value();
+          continue;
+        }
+        instruction = IR_Instruction(IR_MOVE, dst, holder, IR_Operand(),
+                                     nullptr);
+      } else {
+        table.computations[computation] = {next, dst};
+        table.numbers[key_of(dst)] = next++;
+      }
+    }
+    code.push_back(instruction);
+  }
+  block->instructions.swap(code);
+}
+
+}  // namespace
+
+void number_values(IR_Function *function) {
+  // Temporaries written once keep their value wherever they are read.
+  const int n_vregs = function->vreg_types.size();
+  vector<int> definitions(n_vregs, 0);
+  for (const Basic_Block *block : function->blocks) {
+    for (const IR_Instruction &instruction : block->instructions) {
+      if (instruction.dst.is_vreg()) {
+        ++definitions[instruction.dst.get_value()];
+      }
+    }
+  }
+  vector<bool> is_temporary(n_vregs);
+  for (int i = 0; i < n_vregs; ++i) {
+    is_temporary[i] = definitions[i] == 1 && function->promoted_from[i] == -1;
+  }
+
+  function->build_cfg();
+  vector<Value_Table> exits(function->blocks.size());
+  vector<bool> numbered(function->blocks.size(), false);
+  vector<int> replacements(n_vregs, -1);
+  int next = 0;
+  for (Basic_Block *block : function->blocks) {
+    Value_Table table;
+    if (block->predecessors.size() == 1
+        && numbered[block->predecessors[0]->id]) {
+      table = exits[block->predecessors[0]->id];
+    }
+    number_block(block, is_temporary, table, next, replacements);
+    exits[block->id] = table;
+    numbered[block->id] = true;
+  }
+
+  // Read the original temporaries in place of the dropped ones.
+  for (Basic_Block *block : function->blocks) {
+    for (IR_Instruction &instruction : block->instructions) {
+      for (IR_Operand *operand : {&instruction.src1, &instruction.src2}) {
+        if (operand->is_vreg() && replacements[operand->get_value()] != -1) {
+          *operand = IR_Operand(IR_VREG, replacements[operand->get_value()]);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,29 @@
+// Common subexpression elimination by value numbering.
+// @author Hieu Le
+// @version 12/29/2016
+
+#ifndef VALUE_NUMBERING_H
+#define VALUE_NUMBERING_H
+
+#include "ir.h"
+
+/* Removes the computations of a function whose value is already held by a
+   virtual register or a variable, after local value numbering.
+
+   Each constant, virtual register and variable gets the number of the
+   value it holds, and each computation the number of its opcode applied to
+   the numbers of its operands, in either order for commutative ones. A
+   computation whose number was already computed is replaced by a copy of
+   the location still holding it. When both are temporaries written only
+   once, the copy is dropped and the reads of the result read the original
+   instead.
+
+   Writing a location, such as "move var, Rn", gives it a new number, so the
+   values it used to hold are no longer found there; calls give each
+   variable a new number. Blocks are numbered in layout order, and a block
+   whose only predecessor was already numbered starts from the numbers known
+   at the end of it, so that a condition and the branch depending on it
+   share their computations. */
+void number_values(IR_Function *function);
+
+#endif
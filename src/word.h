@@ -0,0 +1,14 @@
+// Arithmetic on the words of a TruPro machine.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef WORD_H
+#define WORD_H
+
+// Arithmetic on TruPro words wraps around: returns the word holding the low
+// bits of a result computed on wider integers.
+inline int wrap(const long long value) {
+  return static_cast<int>(static_cast<unsigned int>(value));
+}
+
+#endif
@@ -0,0 +1,320 @@
+// Implementation of the workload generator.
+// @author Hieu Le
+// @version 12/31/2016
+
+#include "workload.h"
+
+#include <cstdlib>
+
+#include <sstream>
+
+namespace {
+
+const char *const WORDS[] = {
+  "compute", "the", "running", "total", "of", "each", "value", "before",
+  "printing", "it", "check", "that", "loop", "counter", "stays", "within",
+  "bounds", "and", "then", "update", "result"
+};
+
+const char *const RELOPS[] = {"=", "<>", "<", ">", "<=", ">="};
+
+// Number of statements in a block, not counting the loop increment.
+const int MAX_BLOCK_STATEMENTS = 3;
+
+string name(const char prefix, const int number) {
+  return prefix + to_string(number);
+}
+
+}  // namespace
+
+Workload_Shape default_workload_shape() {
+  Workload_Shape shape;
+  shape.seed = 1;
+  shape.declarations = 20;
+  shape.procedures = 4;
+  shape.statements = 100;
+  shape.target_bytes = 0;
+  shape.expression_depth = 2;
+  shape.loop_nesting = 2;
+  shape.comment_density = 0.1;
+  return shape;
+}
+
+Workload_Generator::Workload_Generator(const Workload_Shape &the_shape)
+    : shape(the_shape), random(the_shape.seed), out(nullptr), written(0) {}
+
+int Workload_Generator::next(const int bound) {
+  // The raw output of the engine is the same everywhere, unlike the
+  // standard distributions.
+  return static_cast<int>(random() % bound);
+}
+
+bool Workload_Generator::chance(const double probability) {
+  return static_cast<double>(random() >> 11) / (1ULL << 53) < probability;
+}
+
+void Workload_Generator::write(const string &text) {
+  out->write(text.data(), text.size());
+  written += text.size();
+}
+
+void Workload_Generator::write_line(const int indent, const string &text) {
+  write(string(2 * indent, ' ') + text + "\n");
+}
+
+void Workload_Generator::maybe_comment(const int indent) {
+  if (!chance(shape.comment_density)) {
+    return;
+  }
+  string comment = "#";
+  const int count = 2 + next(7);
+  for (int i = 0; i < count; ++i) {
+    comment += " ";
+    comment += WORDS[next(sizeof(WORDS) / sizeof(WORDS[0]))];
+  }
+  write_line(indent, comment);
+}
+
+void Workload_Generator::declare(const int indent,
+                                 const vector<string> &names,
+                                 const char *type) {
+  for (unsigned int i = 0; i < names.size(); i += 5) {
+    maybe_comment(indent);
+    string line;
+    for (unsigned int j = i; j < names.size() && j < i + 5; ++j) {
+      line += (j > i ? ", " : "") + names[j];
+    }
+    write_line(indent, line + ": " + type + ";");
+  }
+}
+
+string Workload_Generator::int_operand(const Scope &scope) {
+  const int variables = scope.ints.size() + scope.counters.size();
+  if (variables > 0 && next(10) < 7) {
+    const int index = next(variables);
+    return index < static_cast<int>(scope.ints.size())
+        ? scope.ints[index] : scope.counters[index - scope.ints.size()];
+  }
+  return to_string(next(100));
+}
+
+string Workload_Generator::int_expression(const Scope &scope,
+                                          const int depth) {
+  if (depth == 0) {
+    return int_operand(scope);
+  }
+  // One operand has the full depth, the other one at most as much.
+  string first = int_expression(scope, depth - 1);
+  switch (next(6)) {
+    case 0:
+    case 1:
+      return "(" + first + " + " + int_expression(scope, next(depth)) + ")";
+    case 2:
+      return "(" + int_expression(scope, next(depth)) + " - " + first + ")";
+    case 3:
+      return "(" + first + " * " + int_expression(scope, next(depth)) + ")";
+    case 4:
+      return "(" + first + " / " + to_string(1 + next(9)) + ")";
+    default:
+      return "-" + first;
+  }
+}
+
+string Workload_Generator::bool_expression(const Scope &scope,
+                                           const int depth) {
+  if (depth == 0) {
+    if (!scope.bools.empty() && next(2) == 0) {
+      return scope.bools[next(scope.bools.size())];
+    }
+    return "(" + int_operand(scope) + " " + RELOPS[next(6)] + " "
+        + int_operand(scope) + ")";
+  }
+  string first = bool_expression(scope, depth - 1);
+  switch (next(4)) {
+    case 0:
+      return "(" + first + " and " + bool_expression(scope, next(depth))
+          + ")";
+    case 1:
+      return "(" + first + " or " + bool_expression(scope, next(depth)) + ")";
+    case 2:
+      return "not " + first;
+    default:
+      return "(" + int_expression(scope, depth - 1) + " " + RELOPS[next(6)]
+          + " " + int_expression(scope, next(depth)) + ")";
+  }
+}
+
+void Workload_Generator::statement(const Scope &scope, const bool in_main,
+                                   const int indent, const int loops,
+                                   const int blocks) {
+  maybe_comment(indent);
+  const bool can_loop = loops < shape.loop_nesting;
+  const bool can_branch = blocks < shape.loop_nesting + 1;
+  const bool can_call = in_main && !signatures.empty();
+  const int choice = next(10);
+
+  if (choice == 0 && can_loop) {
+    // Count up to a small bound with the counter of this level.
+    const string &counter = scope.counters[loops];
+    write_line(indent, counter + " := 0;");
+    write_line(indent, "while " + counter + " < " + to_string(1 + next(4))
+               + " loop");
+    write_line(indent, "begin");
+    block(scope, in_main, indent + 1, loops + 1, blocks + 1);
+    write_line(indent + 1, counter + " := " + counter + " + 1;");
+    write_line(indent, "end;");
+  } else if (choice == 1 && can_branch) {
+    write_line(indent, "if " + bool_expression(scope, shape.expression_depth)
+               + " then");
+    write_line(indent, "begin");
+    block(scope, in_main, indent + 1, loops, blocks + 1);
+    if (next(2) == 0) {
+      write_line(indent, "end");
+      write_line(indent, "else");
+      write_line(indent, "begin");
+      block(scope, in_main, indent + 1, loops, blocks + 1);
+    }
+    write_line(indent, "end;");
+  } else if (choice == 2 && can_call) {
+    const int callee = next(signatures.size());
+    string arguments;
+    for (const bool is_bool : signatures[callee]) {
+      arguments += arguments.empty() ? "" : ", ";
+      arguments += is_bool ? bool_expression(scope, shape.expression_depth)
+          : int_expression(scope, shape.expression_depth);
+    }
+    write_line(indent, name('q', callee + 1) + " (" + arguments + ");");
+  } else if (choice <= 4 || (scope.ints.empty() && scope.bools.empty())) {
+    if (next(2) == 0) {
+      write_line(indent, "print "
+                 + bool_expression(scope, shape.expression_depth) + ";");
+    } else {
+      write_line(indent, "print "
+                 + int_expression(scope, shape.expression_depth) + ";");
+    }
+  } else {
+    const int index = next(scope.ints.size() + scope.bools.size());
+    if (index < static_cast<int>(scope.ints.size())) {
+      write_line(indent, scope.ints[index] + " := "
+                 + int_expression(scope, shape.expression_depth) + ";");
+    } else {
+      write_line(indent, scope.bools[index - scope.ints.size()] + " := "
+                 + bool_expression(scope, shape.expression_depth) + ";");
+    }
+  }
+}
+
+void Workload_Generator::block(const Scope &scope, const bool in_main,
+                               const int indent, const int loops,
+                               const int blocks) {
+  const int count = 1 + next(MAX_BLOCK_STATEMENTS);
+  for (int i = 0; i < count; ++i) {
+    statement(scope, in_main, indent, loops, blocks);
+  }
+}
+
+void Workload_Generator::procedure(const int index,
+                                   const long long statements) {
+  Scope scope;
+  string parameters;
+  int number = 0;
+  for (const bool is_bool : signatures[index]) {
+    const string parameter = name('a', ++number);
+    (is_bool ? scope.bools : scope.ints).push_back(parameter);
+    parameters += parameters.empty() ? "" : "; ";
+    parameters += parameter + (is_bool ? ": bool" : ": int");
+  }
+  vector<string> local_ints = {name('w', 1), name('w', 2)};
+  vector<string> local_bools = {name('w', 3)};
+  for (int i = 0; i < shape.loop_nesting; ++i) {
+    scope.counters.push_back(name('c', i + 1));
+  }
+  scope.ints.insert(scope.ints.end(), local_ints.begin(), local_ints.end());
+  scope.bools.insert(scope.bools.end(), local_bools.begin(),
+                     local_bools.end());
+
+  maybe_comment(1);
+  write_line(1, "procedure " + name('q', index + 1) + " (" + parameters
+             + ")");
+  declare(2, local_ints, "int");
+  declare(2, local_bools, "bool");
+  declare(2, scope.counters, "int");
+  write_line(1, "begin");
+  // Locals start out undefined, unlike the variables of the main program.
+  for (const string &local : local_ints) {
+    write_line(2, local + " := 0;");
+  }
+  for (const string &counter : scope.counters) {
+    write_line(2, counter + " := 0;");
+  }
+  for (const string &local : local_bools) {
+    write_line(2, local + " := (0 = 1);");
+  }
+  for (long long i = 0; i < statements; ++i) {
+    statement(scope, false, 2, 0, 0);
+  }
+  write_line(1, "end;");
+}
+
+long long Workload_Generator::generate(ostream &the_out) {
+  out = &the_out;
+  written = 0;
+
+  Scope scope;
+  for (int i = 0; i < shape.declarations; ++i) {
+    (next(4) == 0 ? scope.bools : scope.ints).push_back(name('v', i + 1));
+  }
+  for (int i = 0; i < shape.loop_nesting; ++i) {
+    scope.counters.push_back(name('c', i + 1));
+  }
+  signatures.assign(shape.procedures, vector<bool>());
+  for (vector<bool> &signature : signatures) {
+    const int count = next(4);
+    for (int i = 0; i < count; ++i) {
+      signature.push_back(next(4) == 0);
+    }
+  }
+
+  // Share the statements between the procedures and the main program.
+  const long long share = shape.statements / (shape.procedures + 1);
+  const long long procedure_statements = share > 0 ? share : 1;
+  long long main_statements =
+      shape.statements - shape.procedures * procedure_statements;
+
+  write_line(0, "program workload;");
+  declare(1, scope.ints, "int");
+  declare(1, scope.bools, "bool");
+  declare(1, scope.counters, "int");
+  for (int i = 0; i < shape.procedures; ++i) {
+    procedure(i, procedure_statements);
+  }
+  write_line(0, "begin");
+  for (long long i = 0; i < main_statements || i == 0
+           || written < shape.target_bytes; ++i) {
+    statement(scope, true, 1, 0, 0);
+  }
+  write_line(0, "end;");
+  return written;
+}
+
+string generate_workload(const Workload_Shape &shape) {
+  ostringstream out;
+  Workload_Generator generator(shape);
+  generator.generate(out);
+  return out.str();
+}
+
+long long parse_workload_size(const char *text) {
+  char *end = nullptr;
+  long long size = strtoll(text, &end, 10);
+  if (end == text || size < 0) {
+    return -1;
+  }
+  switch (*end) {
+    case 'k': size <<= 10; ++end; break;
+    case 'm': size <<= 20; ++end; break;
+    case 'g': size <<= 30; ++end; break;
+    default: break;
+  }
+  return *end == '\0' ? size : -1;
+}
@@ -0,0 +1,113 @@
+// Generator of synthetic TruPL programs for benchmarking.
+// @author Hieu Le
+// @version 12/31/2016
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Size and shape of the generated programs.
+struct Workload_Shape {
+  // Programs generated from the same shape and seed are identical.
+  unsigned long long seed;
+
+  // Number of variables of the main program, about one in four of them
+  // bool.
+  int declarations;
+
+  // Number of procedures, each taking up to three parameters and called
+  // from the main program.
+  int procedures;
+
+  // Number of statements at the top level of the main program and of the
+  // procedures together. Loops and conditionals hold more.
+  long long statements;
+
+  // When positive, the main program keeps getting statements until the
+  // program is at least this many bytes long, whatever the statement count.
+  long long target_bytes;
+
+  // Depth of the expression trees: 0 for single operands.
+  int expression_depth;
+
+  // Number of loops nested within each other at most.
+  int loop_nesting;
+
+  // Chance of a comment line before each declaration and statement, from
+  // 0 to 1.
+  double comment_density;
+};
+
+// Returns a shape giving a program of about 10 KB.
+Workload_Shape default_workload_shape();
+
+/* Workload_Generator writes a valid TruPL program of a given shape. The
+   programs pass semantic analysis and terminate: loops count up to a small
+   bound with counters no other statement writes, division is by positive
+   constants only, and arithmetic wraps around. The program is written one
+   statement at a time, so its size is not bounded by memory. */
+class Workload_Generator {
+ public:
+  explicit Workload_Generator(const Workload_Shape &shape);
+
+  // Writes the program and returns its size in bytes.
+  long long generate(ostream &out);
+
+ private:
+  // Variables visible in the procedure or main program being generated.
+  struct Scope {
+    vector<string> ints;
+    vector<string> bools;
+    // The loop counters, one per level of nesting.
+    vector<string> counters;
+  };
+
+  Workload_Shape shape;
+  mt19937_64 random;
+  ostream *out;
+  long long written;
+
+  // Parameter types of each procedure, true for bool.
+  vector<vector<bool>> signatures;
+
+  // Returns a number from 0 to bound - 1.
+  int next(const int bound);
+
+  // Checks if an event with the given chance happens.
+  bool chance(const double probability);
+
+  void write(const string &text);
+  void write_line(const int indent, const string &text);
+  void maybe_comment(const int indent);
+
+  // Writes declarations for names of a type, a few per line.
+  void declare(const int indent, const vector<string> &names,
+               const char *type);
+
+  string int_expression(const Scope &scope, const int depth);
+  string bool_expression(const Scope &scope, const int depth);
+  string int_operand(const Scope &scope);
+
+  // Writes a statement of the main program or a procedure, nested within
+  // a number of loops and blocks.
+  void statement(const Scope &scope, const bool in_main, const int indent,
+                 const int loops, const int blocks);
+  void block(const Scope &scope, const bool in_main, const int indent,
+             const int loops, const int blocks);
+  void procedure(const int index, const long long statements);
+};
+
+// Returns the program generated for a shape.
+string generate_workload(const Workload_Shape &shape);
+
+// Parses a size in bytes such as 512, 64k, 10m or 1g. Returns -1 if
+// malformed.
+long long parse_workload_size(const char *text);
+
+#endif
@@ -0,0 +1,360 @@
+// Implementation of the X86_Emitter class.
+// @author Hieu Le
+// @version 12/27/2016
+
+#include "x86_emitter.h"
+
+#include <sstream>
+
+#include "stats.h"
+
+namespace {
+
+// x86-64 registers holding R0 to R7, by width. They are callee-saved or
+// saved by the outb routine, so printing does not disturb them. eax, ecx
+// and edx are scratch registers; rdx holds the address of the stack for
+// relative operands.
+const char *REGISTER_NAMES[X86_MAX_REGISTERS] = {
+  "%ebx", "%r12d", "%r13d", "%r14d", "%r15d", "%ebp", "%esi", "%edi"
+};
+const char *WIDE_REGISTER_NAMES[X86_MAX_REGISTERS] = {
+  "%rbx", "%r12", "%r13", "%r14", "%r15", "%rbp", "%rsi", "%rdi"
+};
+
+string immediate_of(const int value) {
+  stringstream out;
+  out << "$" << value;
+  return out.str();
+}
+
+// Returns the x86-64 instruction for an arithmetic TrAL instruction other
+// than div.
+const char *arithmetic_of(const inst_type inst) {
+  switch (inst) {
+    case INST_ADD: return "addl";
+    case INST_SUB: return "subl";
+    case INST_MUL: return "imull";
+    case INST_MOVE: return "movl";
+    default: return "ud2";
+  }
+}
+
+// Returns the jump taken by a conditional TrAL branch.
+const char *jump_of(const inst_type inst) {
+  switch (inst) {
+    case INST_BREZ: return "je";
+    case INST_BRPO: return "jg";
+    case INST_BRNE: return "jl";
+    default: return "jmp";
+  }
+}
+
+}  // namespace
+
+X86_Emitter::X86_Emitter(const int the_n_registers)
+    : n_registers(the_n_registers), started(false), in_text(false) {}
+
+X86_Emitter::~X86_Emitter() {}
+
+void X86_Emitter::start() const {
+  if (started) {
+    return;
+  }
+  started = true;
+  cout << "\t.section\t.note.GNU-stack,\"\",@progbits" << endl;
+  cout << "\t.section\t.rodata" << endl;
+  cout << ".Ltrupl_format:" << endl;
+  cout << "\t.string\t\"%d\\n\"" << endl;
+  cout << "\t.bss" << endl;
+  cout << "\t.balign\t4" << endl;
+  cout << ".Ltrupl_stack:" << endl;
+  emit(".zero", immediate_of(4 * X86_STACK_WORDS).substr(1));
+  enter_text();
+
+  // Prints the value in eax, keeping every register holding a TrAL
+  // register.
+  cout << ".Ltrupl_outb:" << endl;
+  emit("pushq", "%rsi");
+  emit("pushq", "%rdi");
+  emit("subq", "$8, %rsp");
+  emit("leaq", ".Ltrupl_format(%rip), %rdi");
+  emit("movl", "%eax, %esi");
+  emit("xorl", "%eax, %eax");
+  emit("call", "printf@PLT");
+  emit("addq", "$8, %rsp");
+  emit("popq", "%rdi");
+  emit("popq", "%rsi");
+  emit("ret", "");
+
+  // main saves the callee-saved registers, keeps the stack 16-byte aligned
+  // for calls, and starts with cleared registers.
+  cout << "\t.globl\tmain" << endl;
+  cout << "main:" << endl;
+  const char *saved[] = {"%rbx", "%rbp", "%r12", "%r13", "%r14", "%r15"};
+  for (const char *reg : saved) {
+    emit("pushq", reg);
+  }
+  emit("subq", "$8, %rsp");
+  for (int i = 0; i < n_registers; ++i) {
+    emit("xorl", string(REGISTER_NAMES[i]) + ", " + REGISTER_NAMES[i]);
+  }
+}
+
+void X86_Emitter::enter_text() const {
+  if (!in_text) {
+    cout << "\t.text" << endl;
+    in_text = true;
+  }
+}
+
+void X86_Emitter::enter_bss() const {
+  if (in_text) {
+    cout << "\t.bss" << endl;
+    cout << "\t.balign\t4" << endl;
+    in_text = false;
+  }
+}
+
+void X86_Emitter::emit(const string &instruction,
+                       const string &operands) const {
+  cout << "\t" << instruction;
+  if (!operands.empty()) {
+    cout << "\t" << operands;
+  }
+  cout << endl;
+}
+
+void X86_Emitter::emit_division(const Register *dividend,
+                                const string &divisor) const {
+  // Dividing in 64 bits wraps -2^31 / -1 like the TruPro machine.
+  emit("movslq", name_of(dividend) + ", %rax");
+  emit(divisor[0] == '$' ? "movq" : "movslq", divisor + ", %rcx");
+  emit("cqto", "");
+  emit("idivq", "%rcx");
+  emit("movl", "%eax, " + name_of(dividend));
+}
+
+string X86_Emitter::name_of(const Register *reg) const {
+  return REGISTER_NAMES[reg->get_num()];
+}
+
+string X86_Emitter::wide_name_of(const Register *reg) const {
+  return WIDE_REGISTER_NAMES[reg->get_num()];
+}
+
+string X86_Emitter::relative_of(const Register *base, int offset) const {
+  emit("leaq", ".Ltrupl_stack(%rip), %rdx");
+  stringstream out;
+  if (offset != 0) {
+    out << 4 * offset;
+  }
+  out << "(%rdx," << wide_name_of(base) << ",4)";
+  return out.str();
+}
+
+string X86_Emitter::label_of(const string *label) {
+  return ".L" + *label;
+}
+
+string X86_Emitter::memory_of(const string *var) {
+  return label_of(var) + "(%rip)";
+}
+
+void X86_Emitter::emit_label(const string *label) const {
+  start();
+  enter_text();
+  cout << label_of(label) << ":" << endl;
+}
+
+void X86_Emitter::emit_move(const Register *reg, int immediate) const {
+  emit_2addr(INST_MOVE, reg, immediate);
+}
+
+void X86_Emitter::emit_move(const Register *reg, const Register *src) const {
+  emit_2addr(INST_MOVE, reg, src);
+}
+
+void X86_Emitter::emit_move(const Register *reg, const string *var) const {
+  emit_2addr(INST_MOVE, reg, var);
+}
+
+void X86_Emitter::emit_move(const string *var, const Register *reg) const {
+  count_instruction(INST_MOVE);
+  start();
+  enter_text();
+  emit("movl", name_of(reg) + ", " + memory_of(var));
+}
+
+void X86_Emitter::emit_move(const Register *reg, const Register *base,
+                            int offset) const {
+  emit_2addr(INST_MOVE, reg, base, offset);
+}
+
+void X86_Emitter::emit_move(const Register *base, int offset,
+                            const Register *reg) const {
+  count_instruction(INST_MOVE);
+  start();
+  enter_text();
+  emit("movl", name_of(reg) + ", " + relative_of(base, offset));
+}
+
+void X86_Emitter::emit_2addr(inst_type inst, const Register *reg,
+                             int immediate) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  if (inst == INST_DIV) {
+    emit_division(reg, immediate_of(immediate));
+  } else {
+    emit(arithmetic_of(inst), immediate_of(immediate) + ", " + name_of(reg));
+  }
+}
+
+void X86_Emitter::emit_2addr(inst_type inst, const Register *reg,
+                             const Register *src) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  if (inst == INST_DIV) {
+    emit_division(reg, name_of(src));
+  } else {
+    emit(arithmetic_of(inst), name_of(src) + ", " + name_of(reg));
+  }
+}
+
+void X86_Emitter::emit_2addr(inst_type inst, const Register *reg,
+                             const string *var) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  if (inst == INST_LEA) {
+    emit("leaq", memory_of(var) + ", " + wide_name_of(reg));
+  } else {
+    emit_memory(inst, reg, memory_of(var));
+  }
+}
+
+void X86_Emitter::emit_2addr(inst_type inst, const Register *reg,
+                             const Register *base, int offset) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  emit_memory(inst, reg, relative_of(base, offset));
+}
+
+void X86_Emitter::emit_memory(inst_type inst, const Register *reg,
+                              const string &memory) const {
+  if (inst == INST_DIV) {
+    emit_division(reg, memory);
+  } else {
+    emit(arithmetic_of(inst), memory + ", " + name_of(reg));
+  }
+}
+
+void X86_Emitter::emit_1addr(inst_type inst, const Register *reg) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  switch (inst) {
+    case INST_NEG:
+      emit("negl", name_of(reg));
+      break;
+
+    case INST_NOT:
+      emit("testl", name_of(reg) + ", " + name_of(reg));
+      emit("sete", "%al");
+      emit("movzbl", "%al, " + name_of(reg));
+      break;
+
+    case INST_OUTB:
+      emit("movl", name_of(reg) + ", %eax");
+      emit("call", ".Ltrupl_outb");
+      break;
+
+    default:
+      emit("ud2", "");
+      break;
+  }
+}
+
+void X86_Emitter::emit_branch(const string *dest) const {
+  count_instruction(INST_BRUN);
+  start();
+  enter_text();
+  emit("jmp", label_of(dest));
+}
+
+void X86_Emitter::emit_branch(inst_type inst, const Register *reg,
+                              int dest) const {
+  count_instruction(inst);
+  // TrAL addresses have no counterpart in native code.
+  start();
+  enter_text();
+  cout << "\t# " << jump_of(inst) << " to TrAL address " << dest
+       << " of " << name_of(reg) << endl;
+  emit("ud2", "");
+}
+
+void X86_Emitter::emit_branch(inst_type inst, const Register *reg,
+                              const string *dest) const {
+  count_instruction(inst);
+  start();
+  enter_text();
+  emit("testl", name_of(reg) + ", " + name_of(reg));
+  emit(jump_of(inst), label_of(dest));
+}
+
+void X86_Emitter::emit_halt() const {
+  count_instruction(INST_HALT);
+  // exit() flushes the values printed so far.
+  start();
+  enter_text();
+  emit("xorl", "%edi, %edi");
+  emit("call", "exit@PLT");
+}
+
+void X86_Emitter::emit_call(const string *dest, const string *return_label,
+                            const Register *link,
+                            const Register *stack) const {
+  // The callee may still change the link register. Keep the native stack
+  // 16-byte aligned for the calls made by the callee.
+  emit_move(stack, 1, link);
+  emit("subq", "$8, %rsp");
+  count_instruction(INST_BRUN);
+  emit("call", label_of(dest));
+  cout << label_of(return_label) << ":" << endl;
+  emit("addq", "$8, %rsp");
+  emit_move(link, stack, 1);
+}
+
+void X86_Emitter::emit_return(const Register * /* link */,
+                              const Register * /* stack */) const {
+  start();
+  enter_text();
+  count_instruction(INST_BRUN);
+  emit("ret", "");
+}
+
+void X86_Emitter::emit_stack_setup(const Register * /* stack */) const {}
+
+void X86_Emitter::emit_stack_directive() const {}
+
+void X86_Emitter::emit_data_directive(const string *label, int size) const {
+  start();
+  enter_bss();
+  cout << label_of(label) << ":" << endl;
+  emit(".zero", immediate_of(4 * size).substr(1));
+}
+
+void X86_Emitter::emit_data_directive(int size) const {
+  start();
+  enter_bss();
+  emit(".zero", immediate_of(4 * size).substr(1));
+}
+
+void X86_Emitter::emit_comment(const char comment[]) const {
+  if (comments) {
+    start();
+    cout << "\t# " << comment << endl;
+  }
+}
@@ -0,0 +1,122 @@
+// X86_Emitter lowers the instructions of the Emitter to x86-64 assembly
+// for the GNU assembler.
+// @author Hieu Le
+// @version 12/27/2016
+
+#ifndef X86_EMITTER_H
+#define X86_EMITTER_H
+
+#include <iostream>
+#include <string>
+
+#include "emitter.h"
+
+using namespace std;
+
+// The most TrAL registers that map to x86-64 registers.
+const int X86_MAX_REGISTERS = 8;
+
+// Size of the procedure call stack in words.
+const int X86_STACK_WORDS = 4096;
+
+/* The output is a whole program. It holds main and a runtime routine
+   printing the values of outb, and it links with the C library:
+
+     gcc -o program program.s
+
+   TrAL registers map to 32-bit general purpose registers, and arithmetic
+   wraps around like on the TruPro machine. Variables become words in .bss.
+   Every label is prefixed with ".L" so that TrAL names cannot clash with
+   those of the C library. Division by zero raises SIGFPE.
+
+   The stack register indexes the words of a stack in .bss, starting from
+   0. Calls use the native call and ret instructions instead of the link
+   register, so the first word of a frame stays unused. */
+class X86_Emitter : public Emitter {
+ public:
+  // Constructs an emitter for a machine with a given number of registers,
+  // at most X86_MAX_REGISTERS.
+  explicit X86_Emitter(const int n_registers);
+  ~X86_Emitter();
+
+  void emit_label(const string *label) const;
+
+  void emit_move(const Register *reg, int immediate) const;
+  void emit_move(const Register *reg, const Register *src) const;
+  void emit_move(const Register *reg, const string *var) const;
+  void emit_move(const string *var, const Register *reg) const;
+  void emit_move(const Register *reg, const Register *base, int offset) const;
+  void emit_move(const Register *base, int offset, const Register *reg) const;
+
+  void emit_2addr(inst_type inst, const Register *reg, int immediate) const;
+  void emit_2addr(inst_type inst, const Register *reg,
+                  const Register *src) const;
+  void emit_2addr(inst_type inst, const Register *reg,
+                  const string *var) const;
+  void emit_2addr(inst_type inst, const Register *reg,
+                  const Register *base, int offset) const;
+
+  void emit_1addr(inst_type inst, const Register *reg) const;
+
+  void emit_branch(const string *dest) const;
+  void emit_branch(inst_type inst, const Register *reg, int dest) const;
+  void emit_branch(inst_type inst, const Register *reg,
+                   const string *dest) const;
+
+  void emit_halt() const;
+
+  void emit_call(const string *dest, const string *return_label,
+                 const Register *link, const Register *stack) const;
+  void emit_return(const Register *link, const Register *stack) const;
+
+  // The stack register starts out cleared, at the bottom of the stack of
+  // the runtime, so these emit nothing.
+  void emit_stack_setup(const Register *stack) const;
+  void emit_stack_directive() const;
+
+  void emit_data_directive(const string *label, int size) const;
+  void emit_data_directive(int size) const;
+
+  void emit_comment(const char comment[]) const;
+
+ private:
+  int n_registers;
+
+  // Whether the preamble has been written, and whether the last line went
+  // to the text section.
+  mutable bool started;
+  mutable bool in_text;
+
+  // Writes the runtime routine and the prologue of main before the first
+  // line of code.
+  void start() const;
+
+  // Switches to the text or to the bss section.
+  void enter_text() const;
+  void enter_bss() const;
+
+  // Writes an instruction with its operands.
+  void emit(const string &instruction, const string &operands) const;
+
+  // Writes an arithmetic instruction or a move with a memory operand.
+  void emit_memory(inst_type inst, const Register *reg,
+                   const string &memory) const;
+
+  // Computes dividend / divisor into the 32-bit register dividend. The
+  // divisor is an operand in AT&T syntax, other than an immediate.
+  void emit_division(const Register *dividend, const string &divisor) const;
+
+  // Returns the x86-64 name of a TrAL register.
+  string name_of(const Register *reg) const;
+  string wide_name_of(const Register *reg) const;
+
+  // Returns the operand naming a label.
+  static string label_of(const string *label);
+  static string memory_of(const string *var);
+
+  // Loads the address of the stack into rdx and returns the operand naming
+  // the word at base + offset.
+  string relative_of(const Register *base, int offset) const;
+};
+
+#endif
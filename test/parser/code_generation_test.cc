@@ -1,5 +1,4 @@
 // Unit tests for Code Generation.
-// NOTE: Comments must be disabled before testing.
 // Copyright 2016 Hieu Le.
 
 #include "src/parser.h"
@@ -17,7 +16,10 @@ class CodeGenerationTest : public testing::Test {
   // Create a parser from given input string.
   std::unique_ptr<Parser> CreateParser(const std::string& input) {
     ss_ = util::make_unique<std::istringstream>(input);
-    return util::make_unique<Parser>(new Scanner(new Buffer(ss_.get())));
+    std::unique_ptr<Parser> parser =
+        util::make_unique<Parser>(new Scanner(new Buffer(ss_.get())));
+    parser->set_comments(false);
+    return parser;
   }
 
   void MatchOutput(const std::string& source, const std::string& expected) {
@@ -405,30 +407,25 @@ TEST_F(CodeGenerationTest, IfStatement) {
               "\t\tsub R1, R0\n"
               "\t\tbrne R1, _compare_false0\n"
               "\t\tbrez R1, _compare_false0\n"
-              "\t\tmove R1, #1\n"
-              "\t\tbrun _compare_done1\n"
-              "_compare_false0:\n"
-              "\t\tmove R1, #0\n"
-              "_compare_done1:\n"
-              "\t\tbrez R1, _else2\n"
 
               "\t\tmove R0, r\n"
               "\t\tmul R0, #2\n"
               "\t\tmove q, R0\n"
-              "\t\tbrun _if_done3\n"
+              "\t\tbrun _if_done2\n"
 
-              "_else2:\n"
+              "_else1:\n"
+              "_compare_false0:\n"
               "\t\tmove R0, t\n"
               "\t\tsub R0, v\n"
-              "\t\tbrez R0, _compare_false4\n"
-              "\t\tbrpo R0, _compare_false4\n"
+              "\t\tbrez R0, _compare_false3\n"
+              "\t\tbrpo R0, _compare_false3\n"
               "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done5\n"
-              "_compare_false4:\n"
+              "\t\tbrun _compare_done4\n"
+              "_compare_false3:\n"
               "\t\tmove R0, #0\n"
-              "_compare_done5:\n"
+              "_compare_done4:\n"
               "\t\tmove s, R0\n"
-              "_if_done3:\n"
+              "_if_done2:\n"
               "\t\thalt\n"
 
               "n:\t\tdata 1\n"
@@ -444,38 +441,18 @@ TEST_F(CodeGenerationTest, IfStatement) {
               "begin if 0 = 1 then "
               "begin print 10; end; end; end;",
 
-              "_foo:\n"
-              "\t\tmove R0, #0\n"
-              "\t\tsub R0, #0\n"
-              "\t\tbrne R0, _compare_false0\n"
-              "\t\tbrpo R0, _compare_false0\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done1\n"
-              "_compare_false0:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done1:\n"
-              "\t\tbrez R0, _else2\n"
-
-              "\t\tmove R0, #0\n"
-              "\t\tsub R0, #1\n"
-              "\t\tbrne R0, _compare_false4\n"
-              "\t\tbrpo R0, _compare_false4\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done5\n"
-              "_compare_false4:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done5:\n"
-              "\t\tbrez R0, _else6\n"
+              "_foo:\n"  // 0 = 0 always holds.
+              "\t\tbrun _else2\n"  // 0 = 1 never holds.
 
               "\t\tmove R0, #10\n"
               "\t\toutb R0\n"
-              "\t\tbrun _if_done7\n"
-              "_else6:\n"
-              "_if_done7:\n"
-
               "\t\tbrun _if_done3\n"
               "_else2:\n"
               "_if_done3:\n"
+
+              "\t\tbrun _if_done1\n"
+              "_else0:\n"
+              "_if_done1:\n"
               "\t\thalt\n");
 
   MatchOutput("program foo; begin "
@@ -485,56 +462,23 @@ TEST_F(CodeGenerationTest, IfStatement) {
 
               "_foo:\n"
               "\t\tmove R0, #0\n"
-              "\t\tsub R0, #0\n"
-              "\t\tbrne R0, _compare_false0\n"
-              "\t\tbrpo R0, _compare_false0\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done1\n"
-              "_compare_false0:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done1:\n"
-
-              "\t\tbrez R0, _else2\n"
-              "\t\tmove R0, #0\n"
               "\t\toutb R0\n"
-              "\t\tbrun _if_done3\n"
-
-              "_else2:\n"
-              "\t\tmove R0, #1\n"
-              "\t\tsub R0, #1\n"
-              "\t\tbrne R0, _compare_false4\n"
-              "\t\tbrpo R0, _compare_false4\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done5\n"
-              "_compare_false4:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done5:\n"
+              "\t\tbrun _if_done1\n"
 
-              "\t\tbrez R0, _else6\n"
+              "_else0:\n"
               "\t\tmove R0, #1\n"
               "\t\toutb R0\n"
-              "\t\tbrun _if_done7\n"
-
-              "_else6:\n"
-              "\t\tmove R0, #2\n"
-              "\t\tsub R0, #2\n"
-              "\t\tbrne R0, _compare_false8\n"
-              "\t\tbrpo R0, _compare_false8\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done9\n"
-              "_compare_false8:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done9:\n"
+              "\t\tbrun _if_done3\n"
 
-              "\t\tbrez R0, _else10\n"
+              "_else2:\n"
               "\t\tmove R0, #2\n"
               "\t\toutb R0\n"
-              "\t\tbrun _if_done11\n"
+              "\t\tbrun _if_done5\n"
 
-              "_else10:\n"
-              "_if_done11:\n"
-              "_if_done7:\n"
+              "_else4:\n"
+              "_if_done5:\n"
               "_if_done3:\n"
+              "_if_done1:\n"
               "\t\thalt\n");
 }
 
@@ -566,24 +510,155 @@ TEST_F(CodeGenerationTest, WhileStatement) {
               "\t\tsub R0, #10\n"
               "\t\tbrez R0, _compare_false2\n"
               "\t\tbrpo R0, _compare_false2\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done3\n"
-              "_compare_false2:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done3:\n"
-              "\t\tbrez R0, _while_done1\n"
 
               "\t\tmove R0, x\n"
               "\t\tadd R0, #1\n"
               "\t\tmove x, R0\n"
               "\t\tbrun _while_cond0\n"
               "_while_done1:\n"
+              "_compare_false2:\n"
 
               "\t\thalt\n"
               "x:\t\tdata 1\n"
               "w:\t\tdata 1\n");
 }
 
+TEST_F(CodeGenerationTest, ShortCircuitCondition) {
+  // if a and b then begin print 1; end;
+  MatchOutput("program foo; a, b: bool;"
+              "begin if a and b then begin print 1; end; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, a\n"
+              "\t\tbrez R0, _cond_false0\n"
+              "\t\tmove R0, b\n"
+              "\t\tbrez R0, _cond_false1\n"
+              "\t\tmove R0, #1\n"
+              "\t\toutb R0\n"
+              "\t\tbrun _if_done3\n"
+              "_else2:\n"
+              "_cond_false0:\n"
+              "_cond_false1:\n"
+              "_if_done3:\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n");
+
+  // while (x < 10) or (y > 0) loop begin x := x + 1; end;
+  MatchOutput("program foo; x, y: int;"
+              "begin while (x < 10) or (y > 0) loop "
+              "begin x := x + 1; end; end;",
+
+              "_foo:\n"
+              "_while_cond0:\n"
+              "\t\tmove R0, x\n"
+              "\t\tsub R0, #10\n"
+              "\t\tbrez R0, _compare_false2\n"
+              "\t\tbrpo R0, _compare_false2\n"
+              "\t\tbrun _or_true3\n"  // Skip y > 0 when x < 10.
+
+              "_compare_false2:\n"
+              "\t\tmove R0, y\n"
+              "\t\tbrne R0, _compare_false4\n"
+              "\t\tbrez R0, _compare_false4\n"
+
+              "_or_true3:\n"
+              "\t\tmove R0, x\n"
+              "\t\tadd R0, #1\n"
+              "\t\tmove x, R0\n"
+              "\t\tbrun _while_cond0\n"
+              "_while_done1:\n"
+              "_compare_false4:\n"
+              "\t\thalt\n"
+              "x:\t\tdata 1\n"
+              "y:\t\tdata 1\n");
+
+  // if not (a or b) and not c then begin print 1; end
+  // else begin print 0; end;
+  MatchOutput("program foo; a, b, c: bool; begin "
+              "if not (a or b) and not c then begin print 1; end "
+              "else begin print 0; end; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, a\n"
+              "\t\tbrez R0, _cond_false0\n"
+              "\t\tbrun _or_true1\n"
+              "_cond_false0:\n"
+              "\t\tmove R0, b\n"
+              "\t\tbrez R0, _cond_false2\n"
+              "\t\tbrun _not_false3\n"  // not (a or b) fails.
+
+              "_cond_false2:\n"
+              "\t\tmove R0, c\n"
+              "\t\tbrpo R0, _not_false4\n"
+              "\t\tmove R0, #1\n"
+              "\t\toutb R0\n"
+              "\t\tbrun _if_done6\n"
+
+              "_else5:\n"
+              "_or_true1:\n"
+              "_not_false3:\n"
+              "_not_false4:\n"
+              "\t\tmove R0, #0\n"
+              "\t\toutb R0\n"
+              "_if_done6:\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n"
+              "c:\t\tdata 1\n");
+}
+
+TEST_F(CodeGenerationTest, ConstantFolding) {
+  MatchOutput("program foo; a, b: int; p, q: bool; begin "
+              "a := 2 * 3 + 4 - 20 / 5; "
+              "a := b * 1 + 0; "
+              "a := 0 + b * 0; "
+              "p := not not q; "
+              "p := (1 < 2) and q; "
+              "a := - - b; "
+              "a := 7 / 0; "
+              "a := -(-(b + 1)) * 2; "
+              "p := not (not (a < b)) or (1 = 1); "
+              "a := (a + b) * 0; "
+              "if (1 = 0) and (a < b) then begin print a; end; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, #6\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, b\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, #0\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, q\n"
+              "\t\tmove p, R0\n"
+              "\t\tmove R0, q\n"
+              "\t\tmove p, R0\n"
+              "\t\tmove R0, b\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, #7\n"  // Division by zero is left to run time.
+              "\t\tdiv R0, #0\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, b\n"  // Negating twice cancels out.
+              "\t\tadd R0, #1\n"
+              "\t\tmul R0, #2\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, #1\n"  // Nothing is computed for an absorbed
+              "\t\tmove p, R0\n"   // operand.
+              "\t\tmove R0, #0\n"
+              "\t\tmove a, R0\n"
+              "\t\tbrun _else3\n"  // Nor for the comparison.
+              "\t\tmove R0, a\n"
+              "\t\toutb R0\n"
+              "\t\tbrun _if_done4\n"
+              "_else3:\n"
+              "_if_done4:\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n"
+              "p:\t\tdata 1\n"
+              "q:\t\tdata 1\n");
+}
+
 TEST_F(CodeGenerationTest, Expression) {
   MatchOutput("program foo; a: int; "
               "begin a := (a * a) + ((a / a) - (a * (a + a) - a)); end;",
@@ -690,44 +765,73 @@ TEST_F(CodeGenerationTest, Expression) {
               "\t\tmove R1, b\n"
               "\t\tmul R1, R0\n"  // Compute b and not c in R1.
 
-              "\t\tmove R0, d\n"
-              "\t\tnot R0\n"
-              "\t\tmove R2, a\n"
-              "\t\tnot R2\n"
-              "\t\tmul R0, R2\n"  // Compute not d and not a in R0.
-
-              "\t\tmove R2, #10\n"
-              "\t\tsub R2, #12\n"
-              "\t\tbrne R2, _compare_false0\n"
-              "\t\tbrpo R2, _compare_false0\n"
-              "\t\tmove R2, #1\n"
-              "\t\tbrun _compare_done1\n"
-              "_compare_false0:\n"
-              "\t\tmove R2, #0\n"  // Compute 10 = 12 in R2.
-              "_compare_done1:\n"
-
-              "\t\tmove _spill2, R2\n"
-              "\t\tmove R2, c\n"
-              "\t\tnot R2\n"
-              "\t\tnot R2\n"
-              "\t\tmove _spill3, R2\n"
-              "\t\tmove R2, _spill2\n"
-              "\t\tmul R2, _spill3\n"  // Compute 10 = 12 and not (not c) in R2.
-
-              "\t\tmul R0, R2\n"
-              "\t\tadd R1, R0\n"
-              "\t\tbrez R1, _or_done4\n"
-              "\t\tmove R1, #1\n"
-              "_or_done4:\n"
-              "\t\tmove a, R1\n"
+              // 10 = 12 is 0, so the conjunction is 0 and none of its
+              // operands is computed.
+              "\t\tmove a, R1\n"  // Or with 0 leaves b and not c.
               "\t\thalt\n"
 
               "a:\t\tdata 1\n"
               "b:\t\tdata 1\n"
               "c:\t\tdata 1\n"
-              "d:\t\tdata 1\n"
-              "_spill2:\tdata 1\n"
-              "_spill3:\tdata 1\n");
+              "d:\t\tdata 1\n");
+}
+
+TEST_F(CodeGenerationTest, ProcedureCall) {
+  // The caller passes the actual parameters above the stack register, and
+  // the procedure finds them in its frame.
+  MatchOutput("program foo; a: int; "
+              "procedure bar(x: int; y: bool) z: int; "
+              "begin z := x * 2; if y then begin print z; end; end; "
+              "begin a := 3; bar(a + 1, a > 2); end;",
+
+              "_foo:\n"
+              "\t\tlea R3, stack_base\n"
+              "\t\tmove R0, #3\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove R0, a\n"
+              "\t\tadd R0, #1\n"
+              "\t\tmove (R3, #2), R0\n"
+              "\t\tmove R0, a\n"
+              "\t\tsub R0, #2\n"
+              "\t\tbrne R0, _compare_false2\n"
+              "\t\tbrez R0, _compare_false2\n"
+              "\t\tmove R0, #1\n"
+              "\t\tbrun _compare_done3\n"
+              "_compare_false2:\n"
+              "\t\tmove R0, #0\n"
+              "_compare_done3:\n"
+              "\t\tmove (R3, #3), R0\n"
+
+              "\t\tmove (R3, #1), R0\n"
+              "\t\tlea R0, _call_return4\n"
+              "\t\tmove (R3), R0\n"
+              "\t\tbrun _bar\n"
+              "_call_return4:\n"
+              "\t\tmove R0, (R3, #1)\n"
+              "\t\thalt\n"
+
+              "_bar:\n"
+              "\t\tadd R3, #7\n"
+              "\t\tmove (R3, #-2), R1\n"
+              "\t\tmove (R3, #-1), R2\n"
+              "\t\tmove R0, (R3, #-5)\n"
+              "\t\tmul R0, #2\n"
+              "\t\tmove (R3, #-3), R0\n"
+              "\t\tmove R0, (R3, #-4)\n"
+              "\t\tbrez R0, _else0\n"
+              "\t\tmove R0, (R3, #-3)\n"
+              "\t\toutb R0\n"
+              "\t\tbrun _if_done1\n"
+              "_else0:\n"
+              "_if_done1:\n"
+              "\t\tmove R1, (R3, #-2)\n"
+              "\t\tmove R2, (R3, #-1)\n"
+              "\t\tsub R3, #7\n"
+              "\t\tmove R0, (R3)\n"
+              "\t\tbrun R0\n"
+
+              "a:\t\tdata 1\n"
+              "stack_base:\tdata 1024\n");
 }
 
 TEST_F(CodeGenerationTest, General) {
@@ -758,12 +862,6 @@ TEST_F(CodeGenerationTest, General) {
               "\t\tsub R0, #100\n"
               "\t\tbrez R0, _compare_false2\n"
               "\t\tbrpo R0, _compare_false2\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done3\n"
-              "_compare_false2:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done3:\n"
-              "\t\tbrez R0, _while_done1\n"
 
               "\t\tmove R0, current\n"
               "\t\tadd R0, #1\n"
@@ -771,27 +869,23 @@ TEST_F(CodeGenerationTest, General) {
               "\t\tmove R1, current\n"
               "\t\tdiv R1, #2\n"
               "\t\tsub R0, R1\n"
-              "\t\tbrne R0, _compare_false4\n"
-              "\t\tbrpo R0, _compare_false4\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done5\n"
-              "_compare_false4:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done5:\n"
-              "\t\tbrez R0, _else6\n"
+              "\t\tbrne R0, _compare_false3\n"
+              "\t\tbrpo R0, _compare_false3\n"
 
               "\t\tmove R0, sum\n"
               "\t\tadd R0, current\n"
               "\t\tmove sum, R0\n"
-              "\t\tbrun _if_done7\n"
-              "_else6:\n"
-              "_if_done7:\n"
+              "\t\tbrun _if_done5\n"
+              "_else4:\n"
+              "_compare_false3:\n"
+              "_if_done5:\n"
 
               "\t\tmove R0, current\n"
               "\t\tadd R0, #1\n"
               "\t\tmove current, R0\n"
               "\t\tbrun _while_cond0\n"
               "_while_done1:\n"
+              "_compare_false2:\n"
 
               "\t\tmove R0, sum\n"
               "\t\toutb R0\n"
@@ -816,49 +910,36 @@ TEST_F(CodeGenerationTest, General) {
               "\t\tmove current, R0\n"
 
               "\t\tmove R0, #1\n"
-              "\t\tsub R0, #1\n"
-              "\t\tbrne R0, _compare_false0\n"
-              "\t\tbrpo R0, _compare_false0\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done1\n"
-              "_compare_false0:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done1:\n"
               "\t\tmove isodd, R0\n"
 
-              "_while_cond2:\n"
+              "_while_cond0:\n"
               "\t\tmove R0, current\n"
               "\t\tsub R0, #100\n"
-              "\t\tbrpo R0, _compare_false4\n"
-              "\t\tmove R0, #1\n"
-              "\t\tbrun _compare_done5\n"
-              "_compare_false4:\n"
-              "\t\tmove R0, #0\n"
-              "_compare_done5:\n"
-              "\t\tbrez R0, _while_done3\n"
+              "\t\tbrpo R0, _compare_false2\n"
 
               "\t\tmove R0, isodd\n"
-              "\t\tbrez R0, _else6\n"
+              "\t\tbrez R0, _else3\n"
               "\t\tmove R0, oddsum\n"
               "\t\tadd R0, current\n"
               "\t\tmove oddsum, R0\n"
-              "\t\tbrun _if_done7\n"
+              "\t\tbrun _if_done4\n"
 
-              "_else6:\n"
+              "_else3:\n"
               "\t\tmove R0, evensum\n"
               "\t\tadd R0, current\n"
               "\t\tmove evensum, R0\n"
 
-              "_if_done7:\n"
+              "_if_done4:\n"
               "\t\tmove R0, current\n"
               "\t\tadd R0, #1\n"
               "\t\tmove current, R0\n"
               "\t\tmove R0, isodd\n"
               "\t\tnot R0\n"
               "\t\tmove isodd, R0\n"
-              "\t\tbrun _while_cond2\n"
+              "\t\tbrun _while_cond0\n"
 
-              "_while_done3:\n"
+              "_while_done1:\n"
+              "_compare_false2:\n"
               "\t\tmove R0, evensum\n"
               "\t\toutb R0\n"
               "\t\tmove R0, oddsum\n"
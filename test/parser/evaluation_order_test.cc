@@ -0,0 +1,109 @@
+// Unit tests for the evaluation order of expressions.
+// NOTE: Comments must be disabled before testing.
+// Copyright 2016 Hieu Le.
+
+#include "src/parser.h"
+
+#include <memory>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "util/ptr_util.h"
+
+namespace {
+
+class EvaluationOrderTest : public testing::Test {
+ protected:
+  // Parses a given program without optimization and returns its IR. Target
+  // code is discarded.
+  IR_Program* ParseProgram(const std::string& input) {
+    ss_ = util::make_unique<std::istringstream>(input);
+    parser_ = util::make_unique<Parser>(new Scanner(new Buffer(ss_.get())));
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser_->parse_program());
+    testing::internal::GetCapturedStdout();
+    return parser_->get_program();
+  }
+
+  // Counts the spill memories in the target code of a program translated
+  // with registers allocated along the code.
+  int CountSpills(IR_Program* program) {
+    Emitter emitter;
+    Code_Generator generator(&emitter, ALLOC_LOCAL, TRAL_REGISTER_COUNT);
+    testing::internal::CaptureStdout();
+    generator.generate(program);
+    std::istringstream output(testing::internal::GetCapturedStdout());
+    int spills = 0;
+    std::string line;
+    while (std::getline(output, line)) {
+      if (line.find("_spill") == 0) {
+        ++spills;
+      }
+    }
+    return spills;
+  }
+
+ private:
+  std::unique_ptr<std::istringstream> ss_;
+  std::unique_ptr<Parser> parser_;
+};
+
+TEST_F(EvaluationOrderTest, AvoidSpills) {
+  // Computed left to right, the right leaning product holds four partial
+  // results at once. Computing the right operand first only takes two
+  // registers.
+  IR_Program* program = ParseProgram(
+      "program foo; a, b, c, d, e, f, g, h: int; "
+      "begin a := (a + b) * ((c + d) * ((e + f) * (g + h))); end;");
+  EXPECT_EQ(2, CountSpills(program));
+  order_evaluation(program->functions[0]);
+  EXPECT_EQ(0, CountSpills(program));
+
+  // The left leaning product takes two registers in any order.
+  program = ParseProgram(
+      "program foo; a, b, c, d, e, f: int; "
+      "begin a := (a + b) * (c + d) * (e + f); end;");
+  EXPECT_EQ(0, CountSpills(program));
+  order_evaluation(program->functions[0]);
+  EXPECT_EQ(0, CountSpills(program));
+}
+
+TEST_F(EvaluationOrderTest, OperandsKeepTheirRoles) {
+  // v0 := a + b; v1 := c * d; v2 := #2 - v1; v3 := v0 - v2; a := v3
+  IR_Program* program = ParseProgram(
+      "program foo; a, b, c, d: int; "
+      "begin a := (a + b) - (2 - c * d); end;");
+  IR_Function* function = program->functions[0];
+  order_evaluation(function);
+
+  // The subtraction on the right needs two registers since its first
+  // operand is a constant, so it goes first.
+  const std::vector<IR_Instruction>& code = function->blocks[0]->instructions;
+  ASSERT_EQ(6u, code.size());
+  EXPECT_EQ(IR_MUL, code[0].opcode);
+  EXPECT_EQ(IR_SUB, code[1].opcode);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 2), code[1].src1);
+  EXPECT_EQ(IR_ADD, code[2].opcode);
+  EXPECT_EQ(IR_SUB, code[3].opcode);
+  EXPECT_EQ(code[2].dst, code[3].src1);
+  EXPECT_EQ(code[1].dst, code[3].src2);
+  EXPECT_EQ(IR_MOVE, code[4].opcode);
+  EXPECT_EQ(IR_HALT, code[5].opcode);
+}
+
+TEST_F(EvaluationOrderTest, OptimizedCode) {
+  // At level 1, the right operand is computed first and no register is
+  // spilled.
+  std::istringstream input(
+      "program foo; a, b, c, d, e, f, g, h: int; "
+      "begin a := (a + b) * ((c + d) * ((e + f) * (g + h))); end;");
+  Parser parser(new Scanner(new Buffer(&input)));
+  parser.set_optimization_level(1);
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(parser.parse_program());
+  const std::string output = testing::internal::GetCapturedStdout();
+  EXPECT_EQ(std::string::npos, output.find("_spill"));
+  EXPECT_LT(output.find(", f\n"), output.find(", d\n"));
+}
+
+}  // namespace
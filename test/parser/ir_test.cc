@@ -0,0 +1,491 @@
+// Unit tests for the intermediate representation built by the parser.
+// Copyright 2016 Hieu Le.
+
+#include "src/parser.h"
+
+#include <memory>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "util/ptr_util.h"
+
+namespace {
+
+class IRTest : public testing::Test {
+ protected:
+  // Parses a given program at an optimization level and returns its IR.
+  // Target code is discarded.
+  IR_Program* ParseProgram(const std::string& input, const int level = 0) {
+    ss_ = util::make_unique<std::istringstream>(input);
+    parser_ = util::make_unique<Parser>(new Scanner(new Buffer(ss_.get())));
+    parser_->set_optimization_level(level);
+    parser_->set_inlining_log(&log_);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser_->parse_program());
+    testing::internal::GetCapturedStdout();
+    return parser_->get_program();
+  }
+
+  // Returns the block of a function with a given label.
+  Basic_Block* FindBlock(const IR_Function* function,
+                         const std::string& label) {
+    for (Basic_Block* block : function->blocks) {
+      if (block->label == label) {
+        return block;
+      }
+    }
+    ADD_FAILURE() << "No block labeled " << label;
+    return nullptr;
+  }
+
+  // Returns the number of instructions with a given opcode in a function.
+  int CountOpcode(const IR_Function* function, const ir_opcode_type opcode) {
+    int count = 0;
+    for (const Basic_Block* block : function->blocks) {
+      for (const IR_Instruction& instruction : block->instructions) {
+        if (instruction.opcode == opcode) {
+          ++count;
+        }
+      }
+    }
+    return count;
+  }
+
+  std::ostringstream log_;
+
+ private:
+  std::unique_ptr<std::istringstream> ss_;
+  std::unique_ptr<Parser> parser_;
+};
+
+TEST_F(IRTest, StraightLineCode) {
+  IR_Program* program = ParseProgram(
+      "program foo; a, b: int; p: bool; "
+      "begin a := b * 2 + 1; p := not p; print a; end;");
+  ASSERT_EQ(1u, program->functions.size());
+  IR_Function* function = program->functions[0];
+  EXPECT_EQ("foo", function->name);
+
+  // Variables keep their declared types.
+  ASSERT_EQ(3u, function->variables.size());
+  EXPECT_EQ("a", function->variables[0].name);
+  EXPECT_EQ(INT_T, function->variables[0].type);
+  EXPECT_EQ(INT_T, function->variables[1].type);
+  EXPECT_EQ(BOOL_T, function->variables[2].type);
+  EXPECT_EQ(0, function->find_variable("a"));
+  EXPECT_EQ(-1, function->find_variable("c"));
+
+  // v0 := b * #2; v1 := v0 + #1; a := v1; v2 := not p; p := v2; outb a; halt
+  ASSERT_EQ(1u, function->blocks.size());
+  const std::vector<IR_Instruction>& code = function->blocks[0]->instructions;
+  ASSERT_EQ(7u, code.size());
+  EXPECT_EQ(IR_MUL, code[0].opcode);
+  EXPECT_EQ(IR_Operand(IR_VREG, 0), code[0].dst);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 1), code[0].src1);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 2), code[0].src2);
+  EXPECT_EQ(IR_ADD, code[1].opcode);
+  EXPECT_EQ(IR_Operand(IR_VREG, 0), code[1].src1);
+  EXPECT_EQ(IR_MOVE, code[2].opcode);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 0), code[2].dst);
+  EXPECT_EQ(IR_Operand(IR_VREG, 1), code[2].src1);
+  EXPECT_EQ(IR_NOT, code[3].opcode);
+  EXPECT_EQ(IR_OUTB, code[5].opcode);
+  EXPECT_TRUE(code[5].dst.is_none());
+  EXPECT_EQ(IR_HALT, code[6].opcode);
+
+  // Virtual registers are typed.
+  ASSERT_EQ(3u, function->vreg_types.size());
+  EXPECT_EQ(INT_T, function->vreg_types[0]);
+  EXPECT_EQ(INT_T, function->vreg_types[1]);
+  EXPECT_EQ(BOOL_T, function->vreg_types[2]);
+
+  EXPECT_TRUE(function->blocks[0]->successors.empty());
+}
+
+TEST_F(IRTest, WhileLoop) {
+  IR_Program* program = ParseProgram(
+      "program foo; a, b: int; "
+      "begin while a <> b loop begin a := a - 1; end; print a; end;");
+  IR_Function* function = program->functions[0];
+
+  Basic_Block* entry = function->blocks[0];
+  Basic_Block* cond = FindBlock(function, "_while_cond0");
+  Basic_Block* done = FindBlock(function, "_while_done1");
+  ASSERT_TRUE(cond != nullptr && done != nullptr);
+
+  // The condition branches away to its false label, otherwise it falls
+  // through to the body, which loops back.
+  ASSERT_EQ(2u, cond->instructions.size());
+  EXPECT_EQ(IR_SUB, cond->instructions[0].opcode);
+  const IR_Instruction& exit = cond->instructions[1];
+  EXPECT_EQ(IR_BREZ, exit.opcode);
+  EXPECT_EQ("_compare_false2", exit.target->label);
+
+  ASSERT_EQ(1u, entry->successors.size());
+  EXPECT_EQ(cond, entry->successors[0]);
+
+  ASSERT_EQ(2u, cond->successors.size());
+  EXPECT_EQ(exit.target, cond->successors[0]);
+  Basic_Block* body = cond->successors[1];
+  EXPECT_EQ("", body->label);
+  EXPECT_EQ(IR_BRUN, body->instructions.back().opcode);
+  ASSERT_EQ(1u, body->successors.size());
+  EXPECT_EQ(cond, body->successors[0]);
+
+  // The loop header is entered from the program and from the back edge.
+  ASSERT_EQ(2u, cond->predecessors.size());
+  EXPECT_EQ(entry, cond->predecessors[0]);
+  EXPECT_EQ(body, cond->predecessors[1]);
+
+  // The 'while' label falls through to the false label of the condition.
+  ASSERT_EQ(1u, done->successors.size());
+  EXPECT_EQ(exit.target, done->successors[0]);
+  EXPECT_EQ(IR_HALT, exit.target->instructions.back().opcode);
+  EXPECT_TRUE(exit.target->successors.empty());
+}
+
+TEST_F(IRTest, IfStatement) {
+  IR_Program* program = ParseProgram(
+      "program foo; a: int; "
+      "begin if a > 0 then begin a := 1; end "
+      "else begin a := 2; end; end;");
+  IR_Function* function = program->functions[0];
+
+  Basic_Block* entry = function->blocks[0];
+  Basic_Block* else_part = FindBlock(function, "_else1");
+  Basic_Block* if_done = FindBlock(function, "_if_done2");
+  ASSERT_TRUE(else_part != nullptr && if_done != nullptr);
+
+  // a > 0 takes two branches, so the first one ends the entry block.
+  ASSERT_EQ(2u, entry->successors.size());
+  Basic_Block* compare_false = entry->successors[0];
+  EXPECT_EQ("_compare_false0", compare_false->label);
+  Basic_Block* second_test = entry->successors[1];
+  ASSERT_EQ(2u, second_test->successors.size());
+  EXPECT_EQ(compare_false, second_test->successors[0]);
+
+  // The 'then' part jumps over the 'else' part.
+  Basic_Block* then_part = second_test->successors[1];
+  ASSERT_EQ(1u, then_part->successors.size());
+  EXPECT_EQ(if_done, then_part->successors[0]);
+
+  // The 'else' label falls through to the false label of the condition,
+  // which holds the 'else' part.
+  ASSERT_EQ(1u, else_part->successors.size());
+  EXPECT_EQ(compare_false, else_part->successors[0]);
+  ASSERT_EQ(1u, compare_false->successors.size());
+  EXPECT_EQ(if_done, compare_false->successors[0]);
+  EXPECT_EQ(2u, if_done->predecessors.size());
+}
+
+TEST_F(IRTest, Procedure) {
+  IR_Program* program = ParseProgram(
+      "program foo; a: int; "
+      "procedure bar(x: int; y: bool) z: int; begin z := x; end; "
+      "begin a := 1; end;");
+  ASSERT_EQ(2u, program->functions.size());
+  EXPECT_EQ(1u, program->functions[0]->variables.size());
+
+  // Formal parameters and local variables belong to the procedure.
+  IR_Function* procedure = program->functions[1];
+  EXPECT_EQ("bar", procedure->name);
+  ASSERT_EQ(3u, procedure->variables.size());
+  EXPECT_EQ(INT_T, procedure->variables[0].type);
+  EXPECT_EQ(BOOL_T, procedure->variables[1].type);
+  EXPECT_EQ("z", procedure->variables[2].name);
+  EXPECT_EQ(INT_T, procedure->variables[2].type);
+
+  const std::vector<IR_Instruction>& code =
+      procedure->blocks[0]->instructions;
+  ASSERT_EQ(2u, code.size());
+  EXPECT_EQ(IR_MOVE, code[0].opcode);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 2), code[0].dst);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 0), code[0].src1);
+  EXPECT_EQ(IR_RETURN, code[1].opcode);
+}
+
+TEST_F(IRTest, ProcedureCall) {
+  IR_Program* program = ParseProgram(
+      "program foo; a: int; "
+      "procedure bar(x: int; y: int) begin print x - y; end; "
+      "begin bar(a, 2); end;");
+  ASSERT_EQ(2u, program->functions.size());
+
+  // Each actual parameter is passed by position before the call.
+  const std::vector<IR_Instruction>& code =
+      program->functions[0]->blocks[0]->instructions;
+  ASSERT_EQ(4u, code.size());
+  EXPECT_EQ(IR_PARAM, code[0].opcode);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 0), code[0].src1);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 0), code[0].src2);
+  EXPECT_EQ(IR_PARAM, code[1].opcode);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 2), code[1].src1);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 1), code[1].src2);
+  EXPECT_EQ(IR_CALL, code[2].opcode);
+  EXPECT_EQ(IR_Operand(IR_IMMEDIATE, 1), code[2].src1);
+  EXPECT_EQ(IR_HALT, code[3].opcode);
+
+  // The procedure ends with a return.
+  const IR_Function* procedure = program->functions[1];
+  const IR_Instruction& last = procedure->blocks.back()->instructions.back();
+  EXPECT_EQ(IR_RETURN, last.opcode);
+  EXPECT_TRUE(last.ends_control_flow());
+}
+
+TEST_F(IRTest, InlinedProcedure) {
+  IR_Program* program = ParseProgram(
+      "program foo; a: int; "
+      "procedure bar(x: int) y: int; begin y := x * x; print y; end; "
+      "begin while a < 3 loop begin bar(a); bar(a + 1); a := a + 1; end; "
+      "end;", 1);
+
+  // Both calls are expanded, and the procedure goes away.
+  ASSERT_EQ(1u, program->functions.size());
+  const IR_Function* main = program->functions[0];
+  EXPECT_EQ(0, CountOpcode(main, IR_CALL));
+  EXPECT_EQ(0, CountOpcode(main, IR_PARAM));
+  EXPECT_EQ(0, CountOpcode(main, IR_RETURN));
+  EXPECT_EQ("foo: call to bar (size 3, loop depth 1) inlined, small\n"
+            "foo: call to bar (size 3, loop depth 1) inlined, only call\n"
+            "bar: removed, no calls left\n",
+            log_.str());
+
+  // Each expansion has its own copies of the variables of the procedure,
+  // named like data labels.
+  EXPECT_EQ(5u, main->variables.size());
+  EXPECT_EQ("inline3_x", main->variables[1].name);
+  EXPECT_EQ("inline3_y", main->variables[2].name);
+  EXPECT_EQ("inline4_x", main->variables[3].name);
+  EXPECT_FALSE(main->variables[0].temporary);
+  EXPECT_TRUE(main->variables[1].temporary);
+
+  // Only the variables of the program are written back before it halts.
+  int stores = 0;
+  for (const Basic_Block* block : main->blocks) {
+    if (!block->instructions.empty()
+        && block->instructions.back().opcode == IR_HALT) {
+      for (const IR_Instruction& instruction : block->instructions) {
+        if (instruction.dst.is_variable()) {
+          EXPECT_EQ(0, instruction.dst.get_value());
+          ++stores;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(1, stores);
+}
+
+TEST_F(IRTest, KeptProcedure) {
+  std::string body;
+  for (int i = 0; i < 6; ++i) {
+    body += "y := y * x + 1; ";
+  }
+  IR_Program* program = ParseProgram(
+      "program foo; "
+      "procedure bar(x: int) y: int; begin " + body + "print y; end; "
+      "begin bar(1); bar(2); end;", 1);
+
+  // A large procedure called outside loops keeps its calls.
+  ASSERT_EQ(2u, program->functions.size());
+  EXPECT_EQ(2, CountOpcode(program->functions[0], IR_CALL));
+  EXPECT_EQ("foo: call to bar (size 19, loop depth 0) kept, too large\n"
+            "foo: call to bar (size 19, loop depth 0) kept, too large\n",
+            log_.str());
+
+  // Nothing is expanded without optimization.
+  log_.str("");
+  program = ParseProgram("program foo; "
+                         "procedure bar(x: int) begin print x; end; "
+                         "begin bar(1); end;");
+  EXPECT_EQ(2u, program->functions.size());
+  EXPECT_EQ("", log_.str());
+}
+
+TEST_F(IRTest, ValueNumbering) {
+  IR_Program* program = ParseProgram(
+      "program foo; a, b, c, d, e: int; "
+      "begin a := b + c; d := c + b; b := 1; e := b + c; end;");
+  IR_Function* function = program->functions[0];
+  number_values(function);
+
+  // c + b reuses the value of b + c, but not once b is written.
+  const std::vector<IR_Instruction>& code =
+      function->blocks[0]->instructions;
+  ASSERT_EQ(7u, code.size());
+  EXPECT_EQ(IR_ADD, code[0].opcode);
+  EXPECT_EQ(IR_Operand(IR_VREG, 0), code[0].dst);
+  EXPECT_EQ(IR_MOVE, code[2].opcode);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 3), code[2].dst);
+  EXPECT_EQ(IR_Operand(IR_VREG, 0), code[2].src1);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 1), code[3].dst);
+  EXPECT_EQ(IR_ADD, code[4].opcode);
+  EXPECT_EQ(IR_Operand(IR_VREG, 2), code[4].dst);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 1), code[4].src1);
+}
+
+TEST_F(IRTest, DeadCode) {
+  IR_Program* program = ParseProgram(
+      "program foo; a, b, unused: int; "
+      "begin a := 1; a := 2; "
+      "if 1 = 0 then begin print 5; end else begin print a; end; "
+      "while 0 > 1 loop begin print 9; end; print b; end;", 2);
+  const IR_Function* function = program->functions[0];
+
+  // The branches never taken and the first store to a are gone, and so are
+  // the branches to the next block.
+  EXPECT_EQ(0, CountOpcode(function, IR_BRUN));
+  int prints = 0;
+  for (const Basic_Block* block : function->blocks) {
+    for (const IR_Instruction& instruction : block->instructions) {
+      EXPECT_NE(IR_Operand(IR_IMMEDIATE, 1), instruction.src1);
+      if (instruction.opcode == IR_OUTB) {
+        EXPECT_NE(IR_Operand(IR_IMMEDIATE, 5), instruction.src1);
+        EXPECT_NE(IR_Operand(IR_IMMEDIATE, 9), instruction.src1);
+        ++prints;
+      }
+    }
+  }
+  EXPECT_EQ(2, prints);
+
+  // No data directive is left for the unused variable.
+  ASSERT_EQ(2u, function->variables.size());
+  EXPECT_EQ("a", function->variables[0].name);
+  EXPECT_EQ("b", function->variables[1].name);
+  EXPECT_EQ(-1, function->find_variable("unused"));
+  EXPECT_EQ(1, function->find_variable("b"));
+}
+
+TEST_F(IRTest, DeadCycles) {
+  IR_Program* program = ParseProgram(
+      "program foo; m: int; "
+      "procedure bar(n: int) i, d: int; "
+      "begin i := 0; d := 0; "
+      "while i < n loop begin d := d + 3; d := d * 2; i := i + 1; end; "
+      "print i; end; "
+      "begin bar(m); end;", 2);
+  const IR_Function* function = program->functions[0];
+
+  // d only feeds itself around the loop, so its computations all go, and so
+  // does its data directive.
+  for (const Basic_Block* block : function->blocks) {
+    for (const IR_Instruction& instruction : block->instructions) {
+      EXPECT_NE(IR_Operand(IR_IMMEDIATE, 3), instruction.src2);
+    }
+  }
+  for (const IR_Variable& variable : function->variables) {
+    EXPECT_NE('d', variable.name.back());
+  }
+}
+
+TEST_F(IRTest, FullUnrolling) {
+  IR_Program* program = ParseProgram(
+      "program foo; i: int; "
+      "begin i := 0; while i < 3 loop begin print i; i := i + 1; end; end;",
+      2);
+  const IR_Function* function = program->functions[0];
+
+  // The loop runs fewer times than the unroll factor, so only the copies of
+  // its body remain, each printing a constant.
+  for (const ir_opcode_type opcode : {IR_BRUN, IR_BREZ, IR_BRPO, IR_BRNE}) {
+    EXPECT_EQ(0, CountOpcode(function, opcode));
+  }
+  std::vector<IR_Operand> printed;
+  for (const Basic_Block* block : function->blocks) {
+    for (const IR_Instruction& instruction : block->instructions) {
+      if (instruction.opcode == IR_OUTB) {
+        printed.push_back(instruction.src1);
+      }
+    }
+  }
+  ASSERT_EQ(3u, printed.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(IR_Operand(IR_IMMEDIATE, i), printed[i]);
+  }
+
+  // A counted loop holding another loop is not copied.
+  program = ParseProgram(
+      "program foo; i, j: int; "
+      "begin i := 0; while i < 3 loop begin j := 0; "
+      "while j < i loop begin print j; j := j + 1; end; "
+      "i := i + 1; end; end;",
+      2);
+  EXPECT_EQ(1, CountOpcode(program->functions[0], IR_OUTB));
+}
+
+TEST_F(IRTest, ConditionalConstants) {
+  IR_Program* program = ParseProgram(
+      "program foo; i, x, s: int; "
+      "begin i := 0; x := 1; s := 0; "
+      "while i < s + 100 loop begin "
+      "if x <> 1 then begin x := 2; end; "
+      "s := s + x; i := i + 1; end; print s; end;",
+      2);
+  const IR_Function* function = program->functions[0];
+
+  // The branch writing 2 to x is never taken, so x stays 1 and only the
+  // loop condition is left to test.
+  EXPECT_EQ(2, CountOpcode(function, IR_BREZ) + CountOpcode(function, IR_BRPO)
+            + CountOpcode(function, IR_BRNE));
+  for (const Basic_Block* block : function->blocks) {
+    for (const IR_Instruction& instruction : block->instructions) {
+      EXPECT_NE(IR_Operand(IR_IMMEDIATE, 2), instruction.src1);
+    }
+  }
+}
+
+TEST_F(IRTest, GlobalValueNumbering) {
+  IR_Program* program = ParseProgram(
+      "program foo; i, u: int; "
+      "begin i := 0; while i * i < 50 loop begin u := i + 3; "
+      "if u * u > 30 then begin print 1; end; "
+      "print u * u; i := i + 1; end; end;",
+      2);
+  const IR_Function* function = program->functions[0];
+
+  // The square of u computed by the condition is printed after _if_done.
+  EXPECT_EQ(2, CountOpcode(function, IR_MUL));
+  const Basic_Block* done = FindBlock(function, "_if_done5");
+  ASSERT_NE(nullptr, done);
+  ASSERT_EQ(IR_OUTB, done->instructions[0].opcode);
+  EXPECT_TRUE(done->instructions[0].src1.is_vreg());
+}
+
+TEST_F(IRTest, PassManager) {
+  std::istringstream source(
+      "program foo; i: int; "
+      "begin i := 0; while i < 3 loop begin print i; i := i + 1; end; end;");
+  Parser parser(new Scanner(new Buffer(&source)));
+  parser.set_optimization_level(2);
+  Pass_Manager* passes = parser.get_pass_manager();
+  EXPECT_FALSE(passes->set_enabled("vectorize", true));
+  EXPECT_TRUE(passes->set_enabled("unroll", false));
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(parser.parse_program());
+  testing::internal::GetCapturedStdout();
+
+  // The loop stays rolled, and every other pass ran once.
+  EXPECT_EQ(1, CountOpcode(parser.get_program()->functions[0], IR_BRUN));
+  for (const Pass& pass : passes->get_passes()) {
+    EXPECT_EQ(pass.name == "unroll" ? 0 : 1, pass.runs) << pass.name;
+  }
+}
+
+TEST_F(IRTest, NoCodeGeneration) {
+  std::istringstream source(
+      "program foo; i: int; "
+      "begin i := 0; while i < 3 loop begin print i; i := i + 1; end; end;");
+  Parser parser(new Scanner(new Buffer(&source)));
+  parser.set_optimization_level(2);
+  parser.set_generate_code(false);
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(parser.parse_program());
+  EXPECT_EQ("", testing::internal::GetCapturedStdout());
+
+  // The IR is built but left unoptimized.
+  EXPECT_EQ(1, CountOpcode(parser.get_program()->functions[0], IR_BRUN));
+  for (const Pass& pass : parser.get_pass_manager()->get_passes()) {
+    EXPECT_EQ(0, pass.runs) << pass.name;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,131 @@
+// Unit tests for x86-64 code generation.
+// Copyright 2016 Hieu Le.
+
+#include "src/parser.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "src/x86_emitter.h"
+
+namespace {
+
+class NativeCodeTest : public testing::Test {
+ protected:
+  // Compiles a program to x86-64 assembly without optimization.
+  std::string Compile(const std::string& source, const int registers) {
+    std::istringstream ss(source);
+    Parser parser(new Scanner(new Buffer(&ss)));
+    parser.set_register_count(registers);
+    parser.set_emitter(new X86_Emitter(registers));
+    parser.set_comments(false);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser.parse_program());
+    return testing::internal::GetCapturedStdout();
+  }
+};
+
+TEST_F(NativeCodeTest, Preamble) {
+  std::string output = Compile("program p; begin print 1; end;", 8);
+
+  // The outb routine saves the registers that printf may clobber.
+  EXPECT_NE(std::string::npos,
+            output.find(".Ltrupl_outb:\n"
+                        "\tpushq\t%rsi\n"
+                        "\tpushq\t%rdi\n"
+                        "\tsubq\t$8, %rsp\n"
+                        "\tleaq\t.Ltrupl_format(%rip), %rdi\n"));
+
+  // main starts with cleared registers.
+  EXPECT_NE(std::string::npos,
+            output.find("\t.globl\tmain\nmain:\n"
+                        "\tpushq\t%rbx\n"
+                        "\tpushq\t%rbp\n"
+                        "\tpushq\t%r12\n"
+                        "\tpushq\t%r13\n"
+                        "\tpushq\t%r14\n"
+                        "\tpushq\t%r15\n"
+                        "\tsubq\t$8, %rsp\n"
+                        "\txorl\t%ebx, %ebx\n"
+                        "\txorl\t%r12d, %r12d\n"
+                        "\txorl\t%r13d, %r13d\n"
+                        "\txorl\t%r14d, %r14d\n"
+                        "\txorl\t%r15d, %r15d\n"
+                        "\txorl\t%ebp, %ebp\n"
+                        "\txorl\t%esi, %esi\n"
+                        "\txorl\t%edi, %edi\n"
+                        ".L_p:\n"));
+}
+
+TEST_F(NativeCodeTest, Instructions) {
+  std::string output = Compile(
+      "program p; a, b: int; c: bool; "
+      "begin a := 7; b := a / -2 * a; c := not c; print b; end;", 4);
+  std::string::size_type start = output.find(".L_p:\n");
+  ASSERT_NE(std::string::npos, start);
+  EXPECT_EQ(".L_p:\n"
+            "\tmovl\t$7, %ebx\n"
+            "\tmovl\t%ebx, .La(%rip)\n"
+            "\tmovl\t.La(%rip), %ebx\n"
+            "\tmovslq\t%ebx, %rax\n"
+            "\tmovq\t$-2, %rcx\n"
+            "\tcqto\n"
+            "\tidivq\t%rcx\n"
+            "\tmovl\t%eax, %ebx\n"
+            "\timull\t.La(%rip), %ebx\n"
+            "\tmovl\t%ebx, .Lb(%rip)\n"
+            "\tmovl\t.Lc(%rip), %ebx\n"
+            "\ttestl\t%ebx, %ebx\n"
+            "\tsete\t%al\n"
+            "\tmovzbl\t%al, %ebx\n"
+            "\tmovl\t%ebx, .Lc(%rip)\n"
+            "\tmovl\t.Lb(%rip), %ebx\n"
+            "\tmovl\t%ebx, %eax\n"
+            "\tcall\t.Ltrupl_outb\n"
+            "\txorl\t%edi, %edi\n"
+            "\tcall\texit@PLT\n"
+            "\t.bss\n"
+            "\t.balign\t4\n"
+            ".La:\n"
+            "\t.zero\t4\n"
+            ".Lb:\n"
+            "\t.zero\t4\n"
+            ".Lc:\n"
+            "\t.zero\t4\n",
+            output.substr(start));
+}
+
+TEST_F(NativeCodeTest, Branches) {
+  std::string output = Compile(
+      "program p; a: int; "
+      "begin while a < 3 loop begin a := a + 1; end; end;", 4);
+  // Conditional branches test their register.
+  EXPECT_NE(std::string::npos,
+            output.find("\ttestl\t%ebx, %ebx\n"
+                        "\tje\t.L_compare_false2\n"));
+  EXPECT_NE(std::string::npos, output.find("\tjmp\t.L_while_cond0\n"));
+}
+
+TEST_F(NativeCodeTest, Procedures) {
+  std::string output = Compile(
+      "program p; procedure q(x: int) begin print x; end; "
+      "begin q(5); end;", 4);
+  // Calls keep the native stack aligned and save the link register.
+  EXPECT_NE(std::string::npos,
+            output.find("\tleaq\t.Ltrupl_stack(%rip), %rdx\n"
+                        "\tmovl\t%ebx, 4(%rdx,%r14,4)\n"
+                        "\tsubq\t$8, %rsp\n"
+                        "\tcall\t.L_q\n"
+                        ".L_call_return0:\n"
+                        "\taddq\t$8, %rsp\n"));
+  // Frame words are indexed by the stack register.
+  EXPECT_NE(std::string::npos,
+            output.find(".L_q:\n"
+                        "\taddl\t$5, %r14d\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("\tmovl\t-12(%rdx,%r14,4), %ebx\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("\tsubl\t$5, %r14d\n\tret\n"));
+}
+
+}  // namespace
@@ -1,5 +1,4 @@
 // Unit tests for Parser class.
-// NOTE: PARSER_TEST_MODE flag must be enabled before testing.
 // Copyright 2016 Hieu Le.
 
 #include "src/parser.h"
@@ -15,7 +14,10 @@ class ParserTest : public testing::Test {
   // Creates a parser from the given input string.
   std::unique_ptr<Parser> CreateParser(const std::string& input) {
     ss = util::make_unique<std::istringstream>(input);
-    return util::make_unique<Parser>(new Scanner(new Buffer(ss.get())));
+    std::unique_ptr<Parser> parser =
+        util::make_unique<Parser>(new Scanner(new Buffer(ss.get())));
+    parser->set_syntax_only(true);
+    return parser;
   }
 
  private:
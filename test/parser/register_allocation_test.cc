@@ -0,0 +1,339 @@
+// Unit tests for global register allocation.
+// Copyright 2016 Hieu Le.
+
+#include "src/parser.h"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/ptr_util.h"
+
+namespace {
+
+class RegisterAllocationTest : public testing::Test {
+ protected:
+  // Create a parser optimizing at level 1 from given input string.
+  std::unique_ptr<Parser> CreateParser(const std::string& input) {
+    ss_ = util::make_unique<std::istringstream>(input);
+    std::unique_ptr<Parser> parser =
+        util::make_unique<Parser>(new Scanner(new Buffer(ss_.get())));
+    parser->set_optimization_level(1);
+    parser->set_comments(false);
+    return parser;
+  }
+
+  void MatchOutput(const std::string& source, const std::string& expected) {
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(CreateParser(source)->parse_program());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), expected);
+  }
+
+ private:
+  std::unique_ptr<std::istringstream> ss_;
+};
+
+TEST_F(RegisterAllocationTest, LoopCarriedVariables) {
+  // a and b stay in R0 and R1 for the whole loop and only go back to memory
+  // before the program halts.
+  MatchOutput("program gcdfinder; a, b: int; "
+              "begin a := 28; b := 119; "
+              "while a <> b loop begin "
+              "if a < b then begin b := b - a; end "
+              "else begin a := a - b; end; end; "
+              "print a; end;",
+
+              "_gcdfinder:\n"
+              "\t\tmove R0, #28\n"
+              "\t\tmove R1, #119\n"
+              "_while_cond0:\n"
+              "\t\tmove R2, R0\n"
+              "\t\tsub R2, R1\n"
+              "\t\tbrez R2, _compare_false2\n"
+              "\t\tmove R2, R0\n"
+              "\t\tsub R2, R1\n"
+              "\t\tbrez R2, _compare_false3\n"
+              "\t\tbrpo R2, _compare_false3\n"
+              "\t\tsub R1, R0\n"
+              "\t\tbrun _if_done5\n"
+              "_else4:\n"
+              "_compare_false3:\n"
+              "\t\tsub R0, R1\n"
+              "_if_done5:\n"
+              "\t\tbrun _while_cond0\n"
+              "_while_done1:\n"
+              "_compare_false2:\n"
+              "\t\toutb R0\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove b, R1\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n");
+}
+
+TEST_F(RegisterAllocationTest, LoadAndWriteBack) {
+  // Only a is read before being written, and only b is written.
+  MatchOutput("program foo; a, b: int; begin b := a + 1; print b; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, a\n"
+              "\t\tadd R0, #1\n"
+              "\t\toutb R0\n"
+              "\t\tmove b, R0\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n");
+
+  // A constant is printed through any register that is free.
+  MatchOutput("program foo; a: int; begin print 5; print -a; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, a\n"
+              "\t\tmove R1, #5\n"
+              "\t\toutb R1\n"
+              "\t\tneg R0\n"
+              "\t\toutb R0\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n");
+}
+
+TEST_F(RegisterAllocationTest, SpillLongestIntervals) {
+  // Five variables are live around the loop. The ones whose intervals end
+  // last stay in their memory, and R2 is set aside to carry them.
+  MatchOutput("program foo; a, b, c, d, e: int; "
+              "begin a := 1; b := 2; c := 3; d := 4; e := 5; "
+              "while e > 0 loop begin e := e - 1; "
+              "a := a + b; b := b + c; c := c + d; d := d + a; end; "
+              "print a + b + c + d; end;",
+
+              "_foo:\n"
+              "\t\tmove R0, #1\n"
+              "\t\tmove R1, #2\n"
+              "\t\tmove R2, #3\n"
+              "\t\tmove c, R2\n"
+              "\t\tmove R2, #4\n"
+              "\t\tmove d, R2\n"
+              "\t\tmove R2, #5\n"
+              "\t\tmove e, R2\n"
+              "_while_cond0:\n"
+              "\t\tmove R2, e\n"
+              "\t\tbrne R2, _compare_false2\n"
+              "\t\tmove R2, e\n"
+              "\t\tbrez R2, _compare_false2\n"
+              "\t\tmove R2, e\n"
+              "\t\tsub R2, #1\n"
+              "\t\tmove e, R2\n"
+              "\t\tadd R0, R1\n"
+              "\t\tadd R1, c\n"
+              "\t\tmove R2, c\n"
+              "\t\tadd R2, d\n"
+              "\t\tmove c, R2\n"
+              "\t\tmove R2, d\n"
+              "\t\tadd R2, R0\n"
+              "\t\tmove d, R2\n"
+              "\t\tbrun _while_cond0\n"
+              "_while_done1:\n"
+              "_compare_false2:\n"
+              "\t\tmove R2, R0\n"
+              "\t\tadd R2, R1\n"
+              "\t\tadd R2, c\n"
+              "\t\tadd R2, d\n"
+              "\t\toutb R2\n"
+              "\t\tmove a, R0\n"
+              "\t\tmove b, R1\n"
+              "\t\thalt\n"
+              "a:\t\tdata 1\n"
+              "b:\t\tdata 1\n"
+              "c:\t\tdata 1\n"
+              "d:\t\tdata 1\n"
+              "e:\t\tdata 1\n");
+}
+
+TEST_F(RegisterAllocationTest, LargerRegisterFile) {
+  // With eight registers, all five variables stay in registers.
+  std::unique_ptr<Parser> parser = CreateParser(
+      "program foo; a, b, c, d, e: int; "
+      "begin a := 1; b := 2; c := 3; d := 4; e := 5; "
+      "while e > 0 loop begin e := e - 1; "
+      "a := a + b; b := b + c; c := c + d; d := d + a; end; "
+      "print a + b + c + d; end;");
+  parser->set_register_count(8);
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(parser->parse_program());
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "_foo:\n"
+            "\t\tmove R0, #1\n"
+            "\t\tmove R1, #2\n"
+            "\t\tmove R2, #3\n"
+            "\t\tmove R3, #4\n"
+            "\t\tmove R4, #5\n"
+            "_while_cond0:\n"
+            "\t\tbrne R4, _compare_false2\n"  // e > 0 tests e directly.
+            "\t\tbrez R4, _compare_false2\n"
+            "\t\tsub R4, #1\n"
+            "\t\tadd R0, R1\n"
+            "\t\tadd R1, R2\n"
+            "\t\tadd R2, R3\n"
+            "\t\tadd R3, R0\n"
+            "\t\tbrun _while_cond0\n"
+            "_while_done1:\n"
+            "_compare_false2:\n"
+            "\t\tmove R5, R0\n"
+            "\t\tadd R5, R1\n"
+            "\t\tadd R5, R2\n"
+            "\t\tadd R5, R3\n"
+            "\t\toutb R5\n"
+            "\t\tmove a, R0\n"
+            "\t\tmove b, R1\n"
+            "\t\tmove c, R2\n"
+            "\t\tmove d, R3\n"
+            "\t\tmove e, R4\n"
+            "\t\thalt\n"
+            "a:\t\tdata 1\n"
+            "b:\t\tdata 1\n"
+            "c:\t\tdata 1\n"
+            "d:\t\tdata 1\n"
+            "e:\t\tdata 1\n");
+}
+
+TEST_F(RegisterAllocationTest, RegisterFile) {
+  EXPECT_TRUE(Register_File::is_supported(TRAL_REGISTER_COUNT));
+  EXPECT_TRUE(Register_File::is_supported(32));
+  EXPECT_FALSE(Register_File::is_supported(5));
+  EXPECT_TRUE(Register_File::create(5) == nullptr);
+
+  // The lowest free register is handed out first. The last register is
+  // reserved for the stack.
+  std::unique_ptr<Register_File> registers(Register_File::create(8));
+  ASSERT_TRUE(registers != nullptr);
+  EXPECT_EQ(8, registers->get_register_count());
+  EXPECT_EQ(7, registers->get_stack_register()->get_num());
+  std::vector<Register*> allocated;
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_TRUE(registers->has_free_register());
+    allocated.push_back(registers->allocate_register());
+    EXPECT_EQ(i, allocated.back()->get_num());
+    EXPECT_TRUE(allocated.back()->is_inuse());
+  }
+  EXPECT_FALSE(registers->has_free_register());
+
+  registers->deallocate_register(allocated[5]);
+  registers->deallocate_register(allocated[2]);
+  EXPECT_FALSE(allocated[2]->is_inuse());
+  EXPECT_EQ(allocated[2], registers->allocate_register());
+  EXPECT_EQ(allocated[5], registers->allocate_register());
+  EXPECT_FALSE(registers->has_free_register());
+}
+
+TEST_F(RegisterAllocationTest, Liveness) {
+  std::unique_ptr<Parser> parser = CreateParser(
+      "program foo; a, b: int; "
+      "begin a := 0; while a < b loop begin a := a + 1; end; print b; end;");
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(parser->parse_program());
+  testing::internal::GetCapturedStdout();
+  IR_Function* function = parser->get_program()->functions[0];
+
+  // Variables were promoted to the last virtual registers.
+  const int n_vregs = function->vreg_types.size();
+  const int a = n_vregs - 2;
+  const int b = n_vregs - 1;
+  EXPECT_EQ(0, function->promoted_from[a]);
+  EXPECT_EQ(1, function->promoted_from[b]);
+
+  Liveness liveness(function);
+  Basic_Block* entry = function->blocks[0];
+  Basic_Block* cond = function->blocks[1];
+  EXPECT_EQ("_while_cond0", cond->label);
+
+  // b is read before being written, so it is loaded from memory on entry.
+  const IR_Instruction& load = entry->instructions[0];
+  EXPECT_EQ(IR_MOVE, load.opcode);
+  EXPECT_EQ(IR_Operand(IR_VREG, b), load.dst);
+  EXPECT_EQ(IR_Operand(IR_VARIABLE, 1), load.src1);
+  EXPECT_FALSE(liveness.is_live_in(entry, a));
+  EXPECT_FALSE(liveness.is_live_in(entry, b));
+  EXPECT_TRUE(liveness.is_live_out(entry, a));
+  EXPECT_TRUE(liveness.is_live_in(cond, a));
+  EXPECT_TRUE(liveness.is_live_in(cond, b));
+
+  // The loop body carries a around the back edge.
+  ASSERT_EQ(2u, cond->predecessors.size());
+  Basic_Block* body = cond->predecessors[1];
+  EXPECT_TRUE(liveness.is_live_out(body, a));
+  EXPECT_GT(liveness.get_iterations(), 1);
+}
+
+TEST_F(RegisterAllocationTest, RegisterSet) {
+  // Registers on both sides of a word boundary.
+  Register_Set set(130), other(130);
+  set.insert(3);
+  set.insert(64);
+  EXPECT_TRUE(set.contains(64));
+  EXPECT_FALSE(set.contains(63));
+  other.insert(64);
+  other.insert(129);
+  EXPECT_TRUE(set.unite(other));
+  EXPECT_FALSE(set.unite(other));
+  EXPECT_EQ(std::vector<int>({3, 64, 129}), set.members());
+
+  set.erase(64);
+  Register_Set excluded(130);
+  excluded.insert(129);
+  EXPECT_TRUE(set.unite_difference(other, excluded));
+  EXPECT_FALSE(set.unite_difference(other, excluded));
+  EXPECT_EQ(std::vector<int>({3, 64, 129}), set.members());
+}
+
+TEST_F(RegisterAllocationTest, SpillSlotColoring) {
+  // With a single register, v1 and v4 are spilled. Their intervals do not
+  // overlap, so they share a spill slot.
+  IR_Function function("foo");
+  IR_Builder builder(&function);
+  IR_Operand v[6];
+  for (int i = 0; i < 6; ++i) {
+    v[i] = function.new_vreg(INT_T);
+  }
+  builder.emit_move(v[0], IR_Operand(IR_IMMEDIATE, 1));
+  builder.emit_move(v[1], IR_Operand(IR_IMMEDIATE, 2));
+  builder.emit_3addr(IR_ADD, v[2], v[0], v[1]);
+  builder.emit_1addr(IR_OUTB, v[2]);
+  builder.emit_move(v[3], IR_Operand(IR_IMMEDIATE, 3));
+  builder.emit_move(v[4], IR_Operand(IR_IMMEDIATE, 4));
+  builder.emit_3addr(IR_ADD, v[5], v[3], v[4]);
+  builder.emit_1addr(IR_OUTB, v[5]);
+  builder.emit_halt();
+  function.build_cfg();
+
+  Linear_Scan scan(&function, Liveness(&function), 1);
+  EXPECT_EQ(2, scan.get_spill_count());
+  EXPECT_TRUE(scan.is_spilled(1));
+  EXPECT_TRUE(scan.is_spilled(4));
+  EXPECT_EQ(0, scan.get_spill_slot(1));
+  EXPECT_EQ(0, scan.get_spill_slot(4));
+  EXPECT_EQ(-1, scan.get_spill_slot(0));
+  EXPECT_EQ(1, scan.get_spill_slot_count());
+
+  // v1 and v2 are spilled while both are live, so they need a slot each.
+  IR_Function overlapping("bar");
+  IR_Builder other_builder(&overlapping);
+  for (int i = 0; i < 5; ++i) {
+    v[i] = overlapping.new_vreg(INT_T);
+  }
+  other_builder.emit_move(v[0], IR_Operand(IR_IMMEDIATE, 1));
+  other_builder.emit_move(v[1], IR_Operand(IR_IMMEDIATE, 2));
+  other_builder.emit_move(v[2], IR_Operand(IR_IMMEDIATE, 3));
+  other_builder.emit_3addr(IR_ADD, v[3], v[0], v[1]);
+  other_builder.emit_3addr(IR_ADD, v[4], v[3], v[2]);
+  other_builder.emit_1addr(IR_OUTB, v[4]);
+  other_builder.emit_halt();
+  overlapping.build_cfg();
+
+  Linear_Scan other_scan(&overlapping, Liveness(&overlapping), 1);
+  EXPECT_EQ(0, other_scan.get_spill_slot(1));
+  EXPECT_EQ(1, other_scan.get_spill_slot(2));
+  EXPECT_EQ(2, other_scan.get_spill_slot_count());
+}
+
+}  // namespace
@@ -1,5 +1,4 @@
 // Unit tests for Semantic Analyzer.
-// NOTE: PARSER_TEST_MODE flag must be disabled before testing.
 // Copyright 2016 Hieu Le.
 
 #include "src/parser.h"
@@ -0,0 +1,107 @@
+// Unit tests for the phase statistics and the counters.
+// Copyright 2016 Hieu Le.
+
+#include "src/stats.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "src/parser.h"
+
+namespace {
+
+class StatsTest : public testing::Test {
+ protected:
+  // Compiles a program with the statistics enabled.
+  void Compile(const std::string& source, const int level = 2) {
+    enable_statistics();
+    std::istringstream ss(source);
+    Parser parser(new Scanner(new Buffer(&ss)));
+    parser.set_optimization_level(level);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser.parse_program());
+    std::cout.flush();
+    output_ = testing::internal::GetCapturedStdout();
+  }
+
+  std::string output_;
+};
+
+TEST_F(StatsTest, ChargesEachPhase) {
+  Compile("program p; a, b: int;"
+          "begin a := 3; b := a * 4; while a > 0 loop begin"
+          " print b; a := a - 1; end; end;");
+
+  // The buffered target code is still written out in full.
+  EXPECT_NE(std::string::npos, output_.find("halt"));
+
+  // Phases are timed at coarse boundaries only, not around every token.
+  EXPECT_GT(get_phase_statistics(PHASE_BUFFERING).entries, 0);
+  EXPECT_EQ(1, get_phase_statistics(PHASE_PARSING).entries);
+  EXPECT_EQ(1, get_phase_statistics(PHASE_OPTIMIZATION).entries);
+  EXPECT_EQ(1, get_phase_statistics(PHASE_CODE_GENERATION).entries);
+  EXPECT_GT(get_phase_statistics(PHASE_OUTPUT).entries, 0);
+
+  EXPECT_GT(get_phase_statistics(PHASE_PARSING).allocations, 0);
+  EXPECT_GT(get_phase_statistics(PHASE_OPTIMIZATION).allocated_bytes, 0);
+
+  // Leaving a phase samples the peak resident set size, even right after a
+  // nested phase did.
+  EXPECT_GT(get_phase_statistics(PHASE_PARSING).peak_rss_kb, 0);
+  EXPECT_GT(get_phase_statistics(PHASE_CODE_GENERATION).peak_rss_kb, 0);
+
+  // The report samples the peak resident set size once more.
+  std::ostringstream out;
+  print_statistics(out, false);
+  EXPECT_GT(get_phase_statistics(PHASE_OTHER).peak_rss_kb, 0);
+}
+
+TEST_F(StatsTest, PrintsJson) {
+  Compile("program p; begin print 1; end;");
+  std::ostringstream out;
+  print_statistics(out, true);
+  const std::string json = out.str();
+
+  EXPECT_EQ(0u, json.find("{\"phases\": [{\"name\": \"other\", "));
+  EXPECT_NE(std::string::npos, json.find("{\"name\": \"parsing\", "));
+  EXPECT_NE(std::string::npos, json.find("], \"total\": {\"name\": \"total\""));
+  EXPECT_EQ("}\n", json.substr(json.size() - 2));
+}
+
+TEST_F(StatsTest, PrintsTable) {
+  Compile("program p; begin print 1; end;");
+  std::ostringstream out;
+  print_statistics(out, false);
+  const std::string table = out.str();
+
+  EXPECT_EQ(0u, table.find("Phase    "));
+  EXPECT_NE(std::string::npos, table.find("\ncode generation "));
+  EXPECT_NE(std::string::npos, table.find("\ntotal "));
+}
+
+TEST_F(StatsTest, CountsHotPaths) {
+  const Counters before = counters;
+  Compile("program p; a: int;"
+          "begin a := 3; while a > 0 loop begin print a; a := a - 1; end;"
+          " end;", 0);
+
+  EXPECT_EQ(9, counters.tokens[TOKEN_KEYWORD] - before.tokens[TOKEN_KEYWORD]);
+  EXPECT_EQ(7, counters.tokens[TOKEN_ID] - before.tokens[TOKEN_ID]);
+  EXPECT_EQ(1, counters.tokens[TOKEN_EOF] - before.tokens[TOKEN_EOF]);
+  EXPECT_GT(counters.symbol_lookups, before.symbol_lookups);
+  EXPECT_GE(counters.symbol_probes - before.symbol_probes,
+            counters.symbol_lookups - before.symbol_lookups);
+  EXPECT_GT(counters.register_allocations, before.register_allocations);
+  EXPECT_EQ(1, counters.instructions[INST_HALT - FIRST_INSTRUCTION]
+            - before.instructions[INST_HALT - FIRST_INSTRUCTION]);
+  EXPECT_EQ(1, counters.instructions[INST_OUTB - FIRST_INSTRUCTION]
+            - before.instructions[INST_OUTB - FIRST_INSTRUCTION]);
+
+  std::ostringstream out;
+  print_counters(out);
+  EXPECT_EQ(0u, out.str().find("{\"tokens\": {\"keyword\": "));
+  EXPECT_NE(std::string::npos, out.str().find("\"spills\": "));
+  EXPECT_NE(std::string::npos, out.str().find("\"halt\": "));
+}
+
+}  // namespace
@@ -0,0 +1,88 @@
+// Unit tests for the workload generator.
+// Copyright 2016 Hieu Le.
+
+#include "src/workload.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "src/parser.h"
+#include "src/simulator.h"
+
+namespace {
+
+class WorkloadTest : public testing::Test {
+ protected:
+  // Compiles a program, runs it and returns what it printed.
+  std::string CompileAndRun(const std::string& source, const int level) {
+    std::istringstream ss(source);
+    Parser parser(new Scanner(new Buffer(&ss)));
+    parser.set_optimization_level(level);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser.parse_program());
+    EXPECT_TRUE(parser.done_with_input());
+    std::istringstream target(testing::internal::GetCapturedStdout());
+
+    Simulator simulator(4, 4096);
+    EXPECT_TRUE(simulator.load(target)) << simulator.get_error();
+    std::ostringstream out;
+    EXPECT_EQ(SIM_HALTED, simulator.run(out, 100000000));
+    return out.str();
+  }
+};
+
+TEST_F(WorkloadTest, Deterministic) {
+  Workload_Shape shape = default_workload_shape();
+  const std::string program = generate_workload(shape);
+  EXPECT_EQ(program, generate_workload(shape));
+
+  shape.seed = 2;
+  EXPECT_NE(program, generate_workload(shape));
+}
+
+TEST_F(WorkloadTest, ValidPrograms) {
+  // The programs behave the same whatever the optimization level.
+  Workload_Shape shape = default_workload_shape();
+  shape.statements = 30;
+  for (int seed = 1; seed <= 8; ++seed) {
+    shape.seed = seed;
+    shape.declarations = 3 * seed;
+    shape.procedures = seed % 4;
+    shape.expression_depth = seed % 4;
+    shape.loop_nesting = seed % 3;
+    const std::string program = generate_workload(shape);
+    const std::string output = CompileAndRun(program, 0);
+    EXPECT_FALSE(output.empty());
+    EXPECT_EQ(output, CompileAndRun(program, 2)) << program;
+  }
+}
+
+TEST_F(WorkloadTest, Shape) {
+  Workload_Shape shape = default_workload_shape();
+  shape.declarations = 0;
+  shape.procedures = 0;
+  shape.statements = 1;
+  shape.loop_nesting = 0;
+  shape.comment_density = 0;
+  std::string program = generate_workload(shape);
+  EXPECT_EQ(0u, program.find("program workload;\nbegin\n  "));
+  EXPECT_EQ(std::string::npos, program.find('#'));
+  EXPECT_EQ(std::string::npos, program.find("while"));
+
+  shape.procedures = 3;
+  shape.comment_density = 1;
+  program = generate_workload(shape);
+  EXPECT_NE(std::string::npos, program.find("procedure q3 ("));
+  EXPECT_NE(std::string::npos, program.find('#'));
+
+  // Programs keep growing up to the target size.
+  shape.target_bytes = 50000;
+  std::ostringstream out;
+  Workload_Generator generator(shape);
+  const long long size = generator.generate(out);
+  EXPECT_EQ(static_cast<long long>(out.str().size()), size);
+  EXPECT_GE(size, 50000);
+  EXPECT_LT(size, 52000);
+}
+
+}  // namespace
@@ -0,0 +1,102 @@
+// Differential tests of the JIT against the TrAL simulator.
+// Copyright 2016 Hieu Le.
+
+#include "src/jit.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "src/parser.h"
+
+namespace {
+
+class JITTest : public testing::Test {
+ protected:
+  JITTest() : simulator_(4, 64) {}
+
+  // Runs a program in the simulator and as native code, and expects both to
+  // print the same values, end the same way and leave the same registers.
+  void ExpectSameBehavior(const std::string& program,
+                          long long max_steps = 1000) {
+    std::istringstream in(program);
+    ASSERT_TRUE(simulator_.load(in)) << simulator_.get_error();
+    std::ostringstream expected;
+    simulation_status_type status = simulator_.run(expected, max_steps);
+
+    if (!JIT::is_supported()) {
+      return;
+    }
+    JIT jit(&simulator_);
+    ASSERT_TRUE(jit.compile()) << jit.get_error();
+    std::ostringstream actual;
+    EXPECT_EQ(Simulator::describe(status),
+              Simulator::describe(jit.run(actual, max_steps)));
+    EXPECT_EQ(expected.str(), actual.str());
+    EXPECT_EQ(simulator_.get_statistics().instructions,
+              jit.get_instruction_count());
+    for (int reg = 0; reg < 4; ++reg) {
+      EXPECT_EQ(simulator_.get_register(reg), jit.get_register(reg));
+    }
+  }
+
+  Simulator simulator_;
+};
+
+TEST_F(JITTest, Arithmetic) {
+  ExpectSameBehavior("move R0, #7\nadd R0, #5\nsub R0, #2\nmul R0, #3\n"
+                     "div R0, #-9\noutb R0\nmove R1, R0\nnot R1\noutb R1\n"
+                     "not R1\nneg R1\noutb R1\n"
+                     "move R2, #2147483647\nadd R2, #1\noutb R2\n"
+                     "div R2, #-1\noutb R2\nmul R2, R2\noutb R2\nhalt\n");
+}
+
+TEST_F(JITTest, Memory) {
+  ExpectSameBehavior("\t\tmove R0, #5\n\t\tmove x, R0\n\t\tlea R1, y\n"
+                     "\t\tmove (R1), R0\n\t\tadd R0, (R1)\n"
+                     "\t\tmove (R1, #1), R0\n\t\tmove R2, z\n"
+                     "\t\tsub R2, x\n\t\tmul R2, (R1, #1)\n"
+                     "\t\tdiv R2, y\n\t\toutb R2\n"
+                     "\t\tmove (R3), R2\n\t\tadd R3, #1\n"
+                     "\t\tmove R0, (R3, #-1)\n\t\toutb R0\n\t\thalt\n"
+                     "x:\t\tdata 1\ny:\t\tdata 1\nz:\t\tdata 2\n");
+}
+
+TEST_F(JITTest, Branches) {
+  ExpectSameBehavior("\t\tmove R0, #3\n"
+                     "loop:\t\toutb R0\n\t\tsub R0, #1\n"
+                     "\t\tbrpo R0, loop\n\t\tbrne R0, loop\n"
+                     "\t\tmove R1, #9\n\t\tbrez R0, 8\n\t\toutb R1\n"
+                     "\t\tbrun R1\n\t\tmove R2, #12\n"
+                     "\t\tbrez R0, R2\n\t\toutb R2\n\t\thalt\n");
+}
+
+TEST_F(JITTest, Exceptions) {
+  ExpectSameBehavior("move R0, #1\ndiv R0, R1\nhalt\n");
+  ExpectSameBehavior("move R1, #1\noutb R1\nbrun x\nx: data 1\n");
+  ExpectSameBehavior("move R0, #-1\nmove R1, (R0)\nhalt\n");
+  ExpectSameBehavior("move R0, #1000\nmove (R0), R1\nhalt\n");
+  ExpectSameBehavior("move R0, #-1\nbrun R0\n");
+  ExpectSameBehavior("brun 70\n");
+  ExpectSameBehavior("outb R3\n");
+  ExpectSameBehavior("x: outb R0\nadd R0, #1\nbrun x\n");
+  ExpectSameBehavior("x: outb R0\nadd R0, #1\nbrun x\n", 0);
+}
+
+TEST_F(JITTest, CompiledProgram) {
+  for (int level = 0; level <= 1; ++level) {
+    std::istringstream source(
+        "program sums; i, n, s: int; "
+        "begin n := 50; i := 0; s := 0; "
+        "while i < n loop begin "
+        "if i / 3 * 3 = i then begin s := s + i * i; end "
+        "else begin s := s - i; end; "
+        "i := i + 1; print s; end; end;");
+    Parser parser(new Scanner(new Buffer(&source)));
+    parser.set_optimization_level(level);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser.parse_program());
+    ExpectSameBehavior(testing::internal::GetCapturedStdout(), 100000);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,366 @@
+// Unit tests for the TrAL simulator.
+// Copyright 2016 Hieu Le.
+
+#include "src/simulator.h"
+
+#include <memory>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "src/parser.h"
+#include "util/ptr_util.h"
+
+namespace {
+
+class SimulatorTest : public testing::Test {
+ protected:
+  SimulatorTest() : simulator_(4, 64) {}
+
+  // Loads a program and runs it to completion. Returns what it printed.
+  // The threaded code must behave exactly like the switch loop.
+  std::string Run(const std::string& program,
+                  simulation_status_type expected = SIM_HALTED) {
+    std::istringstream in(program);
+    EXPECT_TRUE(simulator_.load(in)) << simulator_.get_error();
+    std::ostringstream out;
+    EXPECT_EQ(expected, simulator_.run(out, 1000));
+    const Simulator_Statistics expected_statistics =
+        simulator_.get_statistics();
+
+    std::ostringstream threaded_out;
+    EXPECT_EQ(expected, simulator_.run_threaded(threaded_out, 1000));
+    EXPECT_EQ(out.str(), threaded_out.str());
+    ExpectSameStatistics(expected_statistics, simulator_.get_statistics());
+    return out.str();
+  }
+
+  void ExpectSameStatistics(const Simulator_Statistics& expected,
+                            const Simulator_Statistics& actual) {
+    EXPECT_EQ(expected.instructions, actual.instructions);
+    for (int i = 0; i < N_INSTS; ++i) {
+      EXPECT_EQ(expected.instruction_counts[i], actual.instruction_counts[i]);
+    }
+    EXPECT_EQ(expected.branches, actual.branches);
+    EXPECT_EQ(expected.branches_taken, actual.branches_taken);
+    EXPECT_EQ(expected.jumps, actual.jumps);
+    EXPECT_EQ(expected.memory_reads, actual.memory_reads);
+    EXPECT_EQ(expected.memory_writes, actual.memory_writes);
+  }
+
+  // Compiles a TruPL program at a given optimization level, unrolling its
+  // counted loops by a given factor. Returns the target code.
+  std::string Compile(const std::string& program, const int level,
+                      const int unroll = UNROLL_FACTOR) {
+    std::istringstream source(program);
+    Parser parser(new Scanner(new Buffer(&source)));
+    parser.set_optimization_level(level);
+    parser.set_unroll_factor(unroll);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(parser.parse_program());
+    return testing::internal::GetCapturedStdout();
+  }
+
+  // Expects a program to be rejected with an error on a given line.
+  void ExpectLoadError(const std::string& program, const std::string& error) {
+    std::istringstream in(program);
+    EXPECT_FALSE(simulator_.load(in));
+    EXPECT_EQ(error, simulator_.get_error().substr(0, error.size()));
+  }
+
+  Simulator simulator_;
+};
+
+TEST_F(SimulatorTest, Arithmetic) {
+  EXPECT_EQ("-3\n0\n1\n",
+            Run("move R0, #7\n"
+                "add R0, #5\n"      // 12
+                "sub R0, #2\n"      // 10
+                "mul R0, #3\n"      // 30
+                "div R0, #-9\n"     // -3 rounds toward zero
+                "outb R0\n"
+                "move R1, R0\n"
+                "not R1\n"
+                "outb R1\n"
+                "not R1\n"
+                "neg R1\n"
+                "neg R1\n"
+                "outb R1\n"
+                "halt\n"));
+  EXPECT_EQ(-3, simulator_.get_register(0));
+}
+
+TEST_F(SimulatorTest, AddressingModes) {
+  Run("\t\tmove R0, #5\n"
+      "\t\tmove x, R0\t\t; Memory direct.\n"
+      "\t\tlea R1, y\n"
+      "\t\tmove (R1), R0\n"
+      "\t\tadd R0, (R1)\n"     // 10
+      "\t\tmove (R1, #1), R0\n"
+      "\t\tmove R2, z\n"
+      "\t\tsub R2, x\n"        // 5
+      "\t\tmove x, R2\n"
+      "\t\thalt\n"
+      "x:\t\tdata 1\n"
+      "y:\t\tdata 1\n"
+      "z:\n"
+      "\t\tdata 2\n");
+  EXPECT_EQ(5, simulator_.get_memory("x"));
+  EXPECT_EQ(5, simulator_.get_memory("y"));
+  EXPECT_EQ(10, simulator_.get_memory("z"));
+
+  const Simulator_Statistics& statistics = simulator_.get_statistics();
+  EXPECT_EQ(10, statistics.instructions);
+  EXPECT_EQ(3, statistics.memory_reads);
+  EXPECT_EQ(4, statistics.memory_writes);
+}
+
+TEST_F(SimulatorTest, Stack) {
+  // The stack register starts past the program and the stack grows upward.
+  EXPECT_EQ("8\n8\n",
+            Run("move R0, #8\n"
+                "move (R3), R0\n"
+                "add R3, #1\n"
+                "move R1, (R3, #-1)\n"
+                "outb R3\n"
+                "outb R1\n"
+                "halt\n"));
+}
+
+TEST_F(SimulatorTest, Branches) {
+  // Counts down from 3, jumping through a register on the way out.
+  EXPECT_EQ("3\n2\n1\n",
+            Run("\t\tmove R0, #3\n"
+                "loop:\t\toutb R0\n"
+                "\t\tsub R0, #1\n"
+                "\t\tbrpo R0, loop\n"
+                "\t\tbrne R0, loop\n"
+                "\t\tmove R1, #9\n"
+                "\t\tbrez R0, 8\n"
+                "\t\toutb R1\n"
+                "\t\tbrun R1\n"
+                "\t\thalt\n"));
+
+  const Simulator_Statistics& statistics = simulator_.get_statistics();
+  EXPECT_EQ(15, statistics.instructions);
+  EXPECT_EQ(3, statistics.get_count(INST_OUTB));
+  EXPECT_EQ(3, statistics.get_count(INST_BRPO));
+  EXPECT_EQ(5, statistics.branches);
+  EXPECT_EQ(3, statistics.branches_taken);
+  EXPECT_EQ(1, statistics.jumps);
+}
+
+TEST_F(SimulatorTest, Exceptions) {
+  Run("move R0, #1\ndiv R0, R1\nhalt\n", SIM_DIVISION_BY_ZERO);
+  Run("brun x\nx: data 1\n", SIM_UNKNOWN_INSTRUCTION);
+  Run("move R0, #-1\nmove R1, (R0)\nhalt\n", SIM_BAD_ADDRESS);
+  Run("move R0, #-1\nbrun R0\n", SIM_BAD_ADDRESS);
+  Run("move R0, #1\ndiv R0, x\nhalt\nx: data 1\n", SIM_DIVISION_BY_ZERO);
+  Run("x: brun x\n", SIM_STEP_LIMIT);
+  EXPECT_EQ(1000, simulator_.get_statistics().instructions);
+}
+
+TEST_F(SimulatorTest, MalformedPrograms) {
+  ExpectLoadError("halt\njump R0\n", "line 2: unknown instruction");
+  ExpectLoadError("move R0\n", "line 1: wrong number of operands");
+  ExpectLoadError("move #1, R0\n", "line 1: illegal addressing mode");
+  ExpectLoadError("move x, y\nx: data 1\ny: data 1\n",
+                  "line 1: illegal addressing mode");
+  ExpectLoadError("neg x\nx: data 1\n", "line 1: illegal addressing mode");
+  ExpectLoadError("lea R0, #4\n", "line 1: illegal addressing mode");
+  ExpectLoadError("move R4, #1\n", "line 1: bad register");
+  ExpectLoadError("halt\nbrun done\n", "line 2: undefined label");
+  ExpectLoadError("x: halt\nx: halt\n", "line 2: bad or duplicate label");
+}
+
+TEST_F(SimulatorTest, CompiledProgram) {
+  // Runs the target code for the program in the README at both levels.
+  for (int level = 0; level <= 1; ++level) {
+    const std::string code = Compile(
+        "program gcdfinder; a, b: int; "
+        "begin a := 28; b := 119; "
+        "while a <> b loop begin "
+        "if a < b then begin b := b - a; end "
+        "else begin a := a - b; end; end; "
+        "print a; end;",
+        level);
+    EXPECT_EQ("7\n", Run(code));
+    EXPECT_EQ(7, simulator_.get_memory("a"));
+  }
+}
+
+TEST_F(SimulatorTest, AbsorbedDivisions) {
+  // Multiplying by 0 or and-ing with false still divides by zero, which
+  // stops the program before it prints anything.
+  for (int level = 0; level <= 2; ++level) {
+    EXPECT_EQ("", Run(Compile("program p; a, b: int; "
+                              "begin a := 1; b := 0; print (a / b) * 0; "
+                              "print 1; end;",
+                              level),
+                      SIM_DIVISION_BY_ZERO));
+    EXPECT_EQ("", Run(Compile("program p; a, b: int; "
+                              "begin a := 1; b := 0; "
+                              "if (a / b > 1) and (1 = 0) then begin "
+                              "print 2; end; print 1; end;",
+                              level),
+                      SIM_DIVISION_BY_ZERO));
+  }
+  // A constant false left operand skips the right one instead.
+  EXPECT_EQ("1\n", Run(Compile("program p; a, b: int; "
+                               "begin a := 1; b := 0; "
+                               "if (1 = 0) and (a / b > 1) then begin "
+                               "print 2; end; print 1; end;",
+                               0)));
+}
+
+TEST_F(SimulatorTest, ProcedureCalls) {
+  // Registers live across calls survive them, and the stack register is
+  // back at the base of the stack after each call.
+  for (int level = 0; level <= 1; ++level) {
+    const std::string code = Compile(
+        "program calls; i, s: int; "
+        "procedure step(n: int; odd: bool) t: int; "
+        "begin t := n * n; if odd then begin t := 0 - t; end; print t; end; "
+        "begin i := 0; s := 0; "
+        "while i < 4 loop begin step(i, i / 2 * 2 <> i); s := s + i; "
+        "i := i + 1; end; print s; end;",
+        level);
+    EXPECT_EQ("0\n-1\n4\n-9\n6\n", Run(code));
+    // Calls expanded in place leave no stack to set up.
+    const int stack_words =
+        code.find(STACK_LABEL) == std::string::npos ? 0 : TRAL_STACK_WORDS;
+    EXPECT_EQ(simulator_.get_program_size() - stack_words,
+              simulator_.get_register(3));
+  }
+}
+
+TEST_F(SimulatorTest, InlinedProcedures) {
+  // Expanded calls print the same values without the call overhead: no
+  // return address is loaded.
+  const std::string program =
+      "program calls; i: int; "
+      "procedure show(n: int) begin print n * n; end; "
+      "begin i := 0; while i < 3 loop begin show(i); show(0 - i); "
+      "i := i + 1; end; end;";
+  int instructions[2];
+  for (int level = 0; level <= 1; ++level) {
+    const std::string code = Compile(program, level);
+    EXPECT_EQ("0\n0\n1\n1\n4\n4\n", Run(code));
+    instructions[level] = simulator_.get_statistics().instructions;
+  }
+  EXPECT_EQ(0, simulator_.get_statistics().get_count(INST_LEA));
+  EXPECT_LT(instructions[1], instructions[0]);
+}
+
+TEST_F(SimulatorTest, LoopInvariants) {
+  // i * i is computed once per iteration of the outer loop instead of once
+  // per iteration of the inner loop, and the loops compute the same sum.
+  const std::string program =
+      "program loops; i, j, s: int; "
+      "begin i := 0; s := 0; "
+      "while i < 4 loop begin j := 0; "
+      "while j < 5 loop begin s := s + i * i - j; j := j + 1; end; "
+      "i := i + 1; end; print s; end;";
+  long long instructions[3];
+  for (int level = 1; level <= 2; ++level) {
+    // Keep the loops rolled, so that only hoisting saves instructions.
+    const std::string code = Compile(program, level, 1);
+    EXPECT_EQ("30\n", Run(code));
+    const Simulator_Statistics& statistics = simulator_.get_statistics();
+    EXPECT_EQ(level == 1 ? 20 : 4, statistics.get_count(INST_MUL));
+    instructions[level] = statistics.instructions;
+  }
+  // Each of the 16 multiplications saved came with a move.
+  EXPECT_EQ(2 * 16, instructions[1] - instructions[2]);
+}
+
+TEST_F(SimulatorTest, CommonSubexpressions) {
+  // The condition of the if statement reuses the value of a - b computed by
+  // the condition of the loop, once per iteration, and so does its else
+  // branch.
+  const std::string program =
+      "program gcdfinder; a, b: int; "
+      "begin a := 28; b := 119; while a <> b loop begin "
+      "if a < b then begin b := b - a; end "
+      "else begin a := a - b; end; end; print a; end;";
+  for (int level = 1; level <= 2; ++level) {
+    const std::string code = Compile(program, level);
+    EXPECT_EQ("7\n", Run(code));
+    EXPECT_EQ(level == 1 ? 22 : 12,
+              simulator_.get_statistics().get_count(INST_SUB));
+  }
+}
+
+TEST_F(SimulatorTest, ConstantPropagation) {
+  // The constants reach the loop and the prints through the merge of the
+  // if statement, so only the loop counter and the sum stay in registers.
+  const std::string program =
+      "program constants; a, b, c, i, s: int; "
+      "begin a := 6; b := a * 7; c := b; "
+      "if a > 5 then begin s := c + 1; end else begin s := 0; end; "
+      "i := 0; while i < b loop begin s := s + a; i := i + c - 41; end; "
+      "print s; print c; end;";
+  for (int level = 1; level <= 2; ++level) {
+    const std::string code = Compile(program, level);
+    EXPECT_EQ("295\n42\n", Run(code));
+    EXPECT_EQ(level == 1 ? 1 : 0,
+              simulator_.get_statistics().get_count(INST_MUL));
+    // The second print takes its value straight from a constant.
+    EXPECT_EQ(level == 2,
+              code.find("#42\n\t\toutb") != std::string::npos);
+  }
+}
+
+TEST_F(SimulatorTest, StrengthReduction) {
+  // The products of the loop counter are stepped along with it. After the
+  // loop, the multiplication by a constant becomes additions, and the
+  // division by n - 9, which is 1, a move.
+  const std::string program =
+      "program strength; i, n, s: int; "
+      "begin n := 10; i := 0; s := 0; "
+      "while i < n loop begin s := s + i * 3 + i * n; i := i + 1; end; "
+      "print s; print i * 5; print s / (n - 9); end;";
+  for (int level = 1; level <= 2; ++level) {
+    const std::string code = Compile(program, level);
+    EXPECT_EQ("585\n50\n585\n", Run(code));
+    const Simulator_Statistics& statistics = simulator_.get_statistics();
+    EXPECT_EQ(level == 1 ? 21 : 0, statistics.get_count(INST_MUL));
+    EXPECT_EQ(level == 1 ? 1 : 0, statistics.get_count(INST_DIV));
+  }
+}
+
+TEST_F(SimulatorTest, GlobalValueNumbering) {
+  // The square of u is computed once per iteration, for both the condition
+  // and the print after it.
+  const std::string program =
+      "program numbering; i, u: int; "
+      "begin i := 0; while i * i < 50 loop begin u := i + 3; "
+      "if u * u > 30 then begin print 1; end; "
+      "print u * u; i := i + 1; end; end;";
+  for (int level = 1; level <= 2; ++level) {
+    const std::string code = Compile(program, level);
+    EXPECT_EQ("9\n16\n25\n1\n36\n1\n49\n1\n64\n1\n81\n1\n100\n", Run(code));
+    const Simulator_Statistics& statistics = simulator_.get_statistics();
+    EXPECT_EQ(level == 1 ? 25 : 17, statistics.get_count(INST_MUL));
+  }
+}
+
+TEST_F(SimulatorTest, Unrolling) {
+  // Unrolled four times, the loop tests its condition after every fourth
+  // iteration until 8, then runs the last two iterations as before.
+  const std::string program =
+      "program unrolling; i, s: int; "
+      "begin i := 0; s := 0; "
+      "while i < 10 loop begin s := s + i; i := i + 1; end; "
+      "print s; print i; end;";
+  for (const int factor : {1, UNROLL_FACTOR}) {
+    const std::string code = Compile(program, 2, factor);
+    EXPECT_EQ("45\n10\n", Run(code));
+    const Simulator_Statistics& statistics = simulator_.get_statistics();
+    EXPECT_EQ(factor == 1 ? 21 : 7,
+              statistics.get_count(INST_BREZ)
+              + statistics.get_count(INST_BRPO)
+              + statistics.get_count(INST_BRNE));
+  }
+}
+
+}  // namespace